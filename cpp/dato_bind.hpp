@@ -0,0 +1,238 @@
+// DATO file format struct binding extension for the reader library - v1.0
+// See the end of this file for license information
+
+#pragma once
+#include "dato_reader.hpp"
+
+#include <string>
+#include <type_traits>
+#include <vector>
+
+
+namespace dato {
+
+// the default conversions of values to struct members (specialize for other member types)
+// - numbers and bools are cast from any number/bool, strings are read from 8-bit strings ..
+// .. and fixed size arrays of numbers from vectors of the same size and type
+// - the member is not modified if the value has a different type
+template <class M, class Enable = void> struct FieldConverter;
+
+template <class M> struct FieldConverter<M, typename std::enable_if<std::is_arithmetic<M>::value>::type>
+{
+	template <class DA> static void Convert(const DA& v, M& out)
+	{
+		if (v.IsNumber() || v.GetType() == TYPE_Bool)
+			out = v.template CastToNumber<M>();
+	}
+};
+template <> struct FieldConverter<bool>
+{
+	template <class DA> static void Convert(const DA& v, bool& out)
+	{
+		if (v.IsNumber() || v.GetType() == TYPE_Bool)
+			out = v.CastToBool();
+	}
+};
+template <> struct FieldConverter<std::string>
+{
+	template <class DA> static void Convert(const DA& v, std::string& out)
+	{
+		if (auto s = v.TryGetString8())
+			out.assign(s.GetData(), size_t(s.GetSize()));
+	}
+};
+template <class E, size_t N> struct FieldConverter<E[N], typename std::enable_if<std::is_arithmetic<E>::value>::type>
+{
+	template <class DA> static void Convert(const DA& v, E (&out)[N])
+	{
+		if (auto vec = v.template TryGetVector<E>(N))
+			vec.CopyTo(out, N);
+	}
+};
+
+// decodes string maps into structs, with a member for each bound key
+// - the key positions of decoded maps are cached as "shapes": maps with the same key slots as a ..
+// .. previously decoded map (same keys in the same order, which is typical with unique keys) ..
+// .. are decoded by index, without searching for any keys
+// - the shapes are only valid for one document (they are cleared when the reader is initialized ..
+// .. again, see Reader::GetDocumentId)
+// - the shapes are modified while decoding, so each thread needs its own binding
+template <class T, class R = Reader> struct StructBinding
+{
+	typedef typename R::Pos Pos;
+	typedef typename R::DynamicAccessor DynamicAccessor;
+	typedef typename R::StringMapAccessor StringMapAccessor;
+	typedef typename R::ArrayAccessor ArrayAccessor;
+	// converts the value to the member at `dst`
+	typedef void ConvertFunc(const DynamicAccessor& v, void* dst);
+
+	static const u32 MaxShapes = 64; // maps with other shapes are decoded by searching for each key
+
+	struct Field
+	{
+		const char* key;
+		size_t keyLength;
+		size_t offset;
+		ConvertFunc* convert;
+	};
+	struct Shape
+	{
+		u32 hash;
+		std::vector<char> keySlots;
+		std::vector<Pos> indices; // for each field (the map size if not found)
+	};
+
+	std::vector<Field> _fields;
+	std::vector<Shape> _shapes;
+	size_t _lastShape = 0;
+	u64 _shapeDocument = 0; // the Reader::GetDocumentId that the shapes refer to
+
+	// binds the key to the member (the key string is not copied)
+	template <class M> StructBinding& Bind(const char* key, M T::* member)
+	{
+		return Bind(key, member, [](const DynamicAccessor& v, void* dst)
+		{
+			FieldConverter<M>::Convert(v, *static_cast<M*>(dst));
+		});
+	}
+	template <class M> StructBinding& Bind(const char* key, M T::* member, ConvertFunc* convert)
+	{
+		T tmp {};
+		size_t offset = size_t(reinterpret_cast<char*>(&(tmp.*member)) - reinterpret_cast<char*>(&tmp));
+		_fields.push_back({ key, strlen(key), offset, convert });
+		ClearShapes();
+		return *this;
+	}
+
+	void ClearShapes()
+	{
+		_shapes.clear();
+		_lastShape = 0;
+		_shapeDocument = 0;
+	}
+	size_t GetShapeCount() const { return _shapes.size(); }
+
+	// decodes the bound keys of `map` into `out` (the members of missing keys are not modified)
+	void Decode(const StringMapAccessor& map, T& out)
+	{
+		if (!map)
+			return;
+		char* base = reinterpret_cast<char*>(&out);
+		if (const Pos* indices = _GetShapeIndices(map))
+		{
+			for (size_t f = 0; f < _fields.size(); f++)
+				if (indices[f] < map.GetSize())
+					_fields[f].convert(map.GetValueByIndex(indices[f]), base + _fields[f].offset);
+		}
+		else
+		{
+			for (const Field& field : _fields)
+				if (auto v = map.FindValueByKey(field.key, field.keyLength))
+					field.convert(v, base + field.offset);
+		}
+	}
+	// appends a struct for each value in the array (default-constructed for values that are not string maps)
+	void DecodeArray(const ArrayAccessor& arr, std::vector<T>& out)
+	{
+		size_t first = out.size();
+		out.resize(first + size_t(arr.GetSize()));
+		for (size_t i = 0; i < size_t(arr.GetSize()); i++)
+			if (auto map = arr[i].TryGetStringMap())
+				Decode(map, out[first + i]);
+	}
+
+	const Pos* _GetShapeIndices(const StringMapAccessor& map)
+	{
+		const char* keySlots = static_cast<const char*>(map.GetKeySlotData());
+		size_t numBytes = size_t(map.GetSize()) * sizeof(Pos);
+		if (map._r->GetDocumentId() != _shapeDocument)
+		{
+			ClearShapes();
+			_shapeDocument = map._r->GetDocumentId();
+		}
+
+		// usually the same as the previous map
+		if (_lastShape < _shapes.size())
+		{
+			const Shape& s = _shapes[_lastShape];
+			if (s.keySlots.size() == numBytes && DATO_MEMCMP(s.keySlots.data(), keySlots, numBytes) == 0)
+				return s.indices.data();
+		}
+		u32 hash = KeyHash(keySlots, numBytes);
+		for (size_t i = 0; i < _shapes.size(); i++)
+		{
+			const Shape& s = _shapes[i];
+			if (s.hash == hash && s.keySlots.size() == numBytes && DATO_MEMCMP(s.keySlots.data(), keySlots, numBytes) == 0)
+			{
+				_lastShape = i;
+				return s.indices.data();
+			}
+		}
+		if (_shapes.size() >= MaxShapes)
+			return nullptr;
+
+		Shape s;
+		s.hash = hash;
+		s.keySlots.assign(keySlots, keySlots + numBytes);
+		for (const Field& field : _fields)
+			s.indices.push_back(map._FindIndexByKey(field.key, field.keyLength));
+		_lastShape = _shapes.size();
+		_shapes.push_back(std::move(s));
+		return _shapes.back().indices.data();
+	}
+};
+
+} // dato
+
+/*
+This software is available under 2 licenses:
+-------------------------------------------------------------------------------
+OPTION 1: MIT License
+
+Copyright (c) 2023 Arvīds Kokins
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the “Software”), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+of the Software, and to permit persons to whom the Software is furnished to do
+so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+-------------------------------------------------------------------------------
+OPTION 2: Unlicense
+
+This is free and unencumbered software released into the public domain.
+
+Anyone is free to copy, modify, publish, use, compile, sell, or
+distribute this software, either in source code form or as a compiled
+binary, for any purpose, commercial or non-commercial, and by any
+means.
+
+In jurisdictions that recognize copyright laws, the author or authors
+of this software dedicate any and all copyright interest in the
+software to the public domain. We make this dedication for the benefit
+of the public at large and to the detriment of our heirs and
+successors. We intend this dedication to be an overt act of
+relinquishment in perpetuity of all present and future rights to this
+software under copyright law.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+OTHER DEALINGS IN THE SOFTWARE.
+
+For more information, please refer to <http://unlicense.org/>
+*/
@@ -28,16 +28,21 @@ inline const char* SubtypeToString(u8 subtype)
 	}
 }
 
-struct IValueDumperIterator : IValueIterator
+// prints values as text, calling Derived::PrintText for the output
+// - the callbacks are those of IValueIterator (virtual if Base is IValueIterator) and ValueVisitor
+template <class Derived, class Base = ValueVisitor>
+struct BasicValueDumper : Base
 {
 	// configuration
 	const char* indentText = "  ";
-	// output interface
-	virtual void PrintText(const char* text, u32 len) = 0;
 
 	// state
 	int _indent = 0;
 	// helpers
+	DATO_FORCEINLINE void PrintText(const char* text, u32 len)
+	{
+		static_cast<Derived*>(this)->PrintText(text, len);
+	}
 	void _WriteIndent()
 	{
 		const char* ite = indentText;
@@ -48,8 +53,8 @@ struct IValueDumperIterator : IValueIterator
 			PrintText(indentText, len);
 	}
 
-	// IValueIterator implementation
-	void BeginMap(u8 type, u32 size) override
+	// IValueIterator/ValueVisitor implementation
+	void BeginMap(u8 type, u32 size)
 	{
 		char bfr[32];
 		PrintText(bfr, snprintf(
@@ -62,36 +67,36 @@ struct IValueDumperIterator : IValueIterator
 		PrintText("{\n", 2);
 		_indent++;
 	}
-	void EndMap(u8 type) override
+	void EndMap(u8 type)
 	{
 		(void)type;
 		_indent--;
 		_WriteIndent();
 		PrintText("}", 1);
 	}
-	void BeginStringKey(const char* key, u32 length) override
+	void BeginStringKey(const char* key, u32 length)
 	{
 		_WriteIndent();
 		PrintText("\"", 1);
 		PrintText(key, length);
 		PrintText("\" = ", 4);
 	}
-	void EndStringKey() override
+	void EndStringKey()
 	{
 		PrintText("\n", 1);
 	}
-	void BeginIntKey(u32 key) override
+	void BeginIntKey(u32 key)
 	{
 		_WriteIndent();
 		char bfr[32];
 		PrintText(bfr, snprintf(bfr, 32, "%08X = ", unsigned(key)));
 	}
-	void EndIntKey() override
+	void EndIntKey()
 	{
 		PrintText("\n", 1);
 	}
 
-	void BeginArray(u32 size) override
+	void BeginArray(u32 size)
 	{
 		char bfr[32];
 		PrintText(bfr, snprintf(
@@ -103,60 +108,60 @@ struct IValueDumperIterator : IValueIterator
 		PrintText("{\n", 2);
 		_indent++;
 	}
-	void EndArray() override
+	void EndArray()
 	{
 		_indent--;
 		_WriteIndent();
 		PrintText("}", 1);
 	}
-	void BeginArrayIndex(u32 i) override
+	void BeginArrayIndex(u32 i)
 	{
 		_WriteIndent();
 		char bfr[32];
 		PrintText(bfr, snprintf(bfr, 32, "%u = ", unsigned(i)));
 	}
-	void EndArrayIndex() override
+	void EndArrayIndex()
 	{
 		PrintText("\n", 1);
 	}
 
-	void OnValueNull() override
+	void OnValueNull()
 	{
 		PrintText("null", 4);
 	}
-	void OnValueBool(bool value) override
+	void OnValueBool(bool value)
 	{
 		if (value)
 			PrintText("true", 4);
 		else
 			PrintText("false", 5);
 	}
-	void OnValueS32(s32 value) override
+	void OnValueS32(s32 value)
 	{
 		char bfr[32];
 		PrintText(bfr, snprintf(bfr, 32, "s32:%d", int(value)));
 	}
-	void OnValueU32(u32 value) override
+	void OnValueU32(u32 value)
 	{
 		char bfr[32];
 		PrintText(bfr, snprintf(bfr, 32, "u32:%u", unsigned(value)));
 	}
-	void OnValueF32(f32 value) override
+	void OnValueF32(f32 value)
 	{
 		char bfr[32];
 		PrintText(bfr, snprintf(bfr, 32, "f32:%g", value));
 	}
-	void OnValueS64(s64 value) override
+	void OnValueS64(s64 value)
 	{
 		char bfr[32];
 		PrintText(bfr, snprintf(bfr, 32, "s64:%lld", (long long) value));
 	}
-	void OnValueU64(u64 value) override
+	void OnValueU64(u64 value)
 	{
 		char bfr[32];
 		PrintText(bfr, snprintf(bfr, 32, "u64:%llu", (unsigned long long) value));
 	}
-	void OnValueF64(f64 value) override
+	void OnValueF64(f64 value)
 	{
 		char bfr[32];
 		PrintText(bfr, snprintf(bfr, 32, "f64:%g", value));
@@ -183,25 +188,25 @@ struct IValueDumperIterator : IValueIterator
 			}
 		}
 	}
-	void OnValueString(const char* data, u32 length) override
+	void OnValueString(const char* data, u32 length)
 	{
 		PrintText("str8:\"", 6);
 		_PrintString((const u8*) data, length);
 		PrintText("\"", 1);
 	}
-	void OnValueString(const u16* data, u32 length) override
+	void OnValueString(const u16* data, u32 length)
 	{
 		PrintText("str16:\"", 7);
 		_PrintString((const u16*) data, length);
 		PrintText("\"", 1);
 	}
-	void OnValueString(const u32* data, u32 length) override
+	void OnValueString(const u32* data, u32 length)
 	{
 		PrintText("str32:\"", 7);
 		_PrintString((const u32*) data, length);
 		PrintText("\"", 1);
 	}
-	void OnValueByteArray(const void* data, u32 length) override
+	void OnValueByteArray(const void* data, u32 length)
 	{
 		char bfr[32];
 		PrintText(bfr, snprintf(bfr, 32, "bytearray [%u]:", unsigned(length)));
@@ -229,24 +234,24 @@ struct IValueDumperIterator : IValueIterator
 			{
 			case SUBTYPE_S8: len = snprintf(bfr, 32, "%d", int(((const s8*) data)[i])); break;
 			case SUBTYPE_U8: len = snprintf(bfr, 32, "%u", unsigned(((const u8*) data)[i])); break;
-			case SUBTYPE_S16: len = snprintf(bfr, 32, "%d", int(((const s16*) data)[i])); break;
-			case SUBTYPE_U16: len = snprintf(bfr, 32, "%u", unsigned(((const u16*) data)[i])); break;
-			case SUBTYPE_S32: len = snprintf(bfr, 32, "%d", int(((const s32*) data)[i])); break;
-			case SUBTYPE_U32: len = snprintf(bfr, 32, "%u", unsigned(((const u32*) data)[i])); break;
+			case SUBTYPE_S16: len = snprintf(bfr, 32, "%d", int(ReadT<s16>((const s16*) data + i))); break;
+			case SUBTYPE_U16: len = snprintf(bfr, 32, "%u", unsigned(ReadT<u16>((const u16*) data + i))); break;
+			case SUBTYPE_S32: len = snprintf(bfr, 32, "%d", int(ReadT<s32>((const s32*) data + i))); break;
+			case SUBTYPE_U32: len = snprintf(bfr, 32, "%u", unsigned(ReadT<u32>((const u32*) data + i))); break;
 			case SUBTYPE_S64:
-				len = snprintf(bfr, 32, "%lld", (long long) (((const s64*) data)[i]));
+				len = snprintf(bfr, 32, "%lld", (long long) (ReadT<s64>((const s64*) data + i)));
 				break;
 			case SUBTYPE_U64:
-				len = snprintf(bfr, 32, "%llu", (unsigned long long) (((const u64*) data)[i]));
+				len = snprintf(bfr, 32, "%llu", (unsigned long long) (ReadT<u64>((const u64*) data + i)));
 				break;
-			case SUBTYPE_F32: len = snprintf(bfr, 32, "%g", ((const float*) data)[i]); break;
-			case SUBTYPE_F64: len = snprintf(bfr, 32, "%g", ((const double*) data)[i]); break;
+			case SUBTYPE_F32: len = snprintf(bfr, 32, "%g", ReadT<float>((const float*) data + i)); break;
+			case SUBTYPE_F64: len = snprintf(bfr, 32, "%g", ReadT<double>((const double*) data + i)); break;
 			default: bfr[len++] = '?'; bfr[len] = 0; break;
 			}
 			PrintText(bfr, len);
 		}
 	}
-	void OnValueVector(u8 subtype, u8 elemCount, const void* data) override
+	void OnValueVector(u8 subtype, u8 elemCount, const void* data)
 	{
 		char bfr[32];
 		PrintText(bfr, snprintf(
@@ -260,7 +265,7 @@ struct IValueDumperIterator : IValueIterator
 
 		PrintText("]", 1);
 	}
-	void OnValueVectorArray(u8 subtype, u8 elemCount, const void* data, u32 length) override
+	void OnValueVectorArray(u8 subtype, u8 elemCount, const void* data, u32 length)
 	{
 		char bfr[32];
 		PrintText(bfr, snprintf(
@@ -280,7 +285,7 @@ struct IValueDumperIterator : IValueIterator
 
 		PrintText("]", 1);
 	}
-	void OnUnknownValue(u8 type, u32 embedded, const char* buffer, u32 length) override
+	void OnUnknownValue(u8 type, u32 embedded, const char* buffer, u32 length)
 	{
 		(void)buffer;
 		(void)length;
@@ -290,6 +295,12 @@ struct IValueDumperIterator : IValueIterator
 	}
 };
 
+struct IValueDumperIterator : BasicValueDumper<IValueDumperIterator, IValueIterator>
+{
+	// output interface
+	virtual void PrintText(const char* text, u32 len) = 0;
+};
+
 struct FILEValueDumperIterator : IValueDumperIterator
 {
 	FILE* file = nullptr;
@@ -304,6 +315,21 @@ struct FILEValueDumperIterator : IValueDumperIterator
 	}
 };
 
+// the same for Visit (without virtual calls)
+struct FILEValueDumper : BasicValueDumper<FILEValueDumper>
+{
+	FILE* file = nullptr;
+
+	FILEValueDumper() {}
+	FILEValueDumper(FILE* f) : file(f) {}
+	FILEValueDumper(FILE* f, const char* indent) : file(f) { indentText = indent; }
+
+	void PrintText(const char* text, u32 len)
+	{
+		fwrite(text, len, 1, file);
+	}
+};
+
 } // dato
 
 /*
@@ -0,0 +1,243 @@
+// DATO file format memory-mapped file extension for the reader library - v1.0
+// See the end of this file for license information
+
+#pragma once
+#include "dato_reader.hpp"
+
+#ifdef _WIN32
+#  ifndef WIN32_LEAN_AND_MEAN
+#    define WIN32_LEAN_AND_MEAN
+#  endif
+#  include <windows.h>
+#else
+#  include <fcntl.h>
+#  include <sys/mman.h>
+#  include <sys/stat.h>
+#  include <unistd.h>
+#endif
+
+
+namespace dato {
+
+// access pattern hints for MappedFile (can be combined)
+// - on Windows, only Sequential and Random are used (as file access flags, so only when passed to Open)
+static const u8 MAPHINT_Default = 0;
+static const u8 MAPHINT_Sequential = 1 << 0; // read ahead aggressively and drop pages after reading
+static const u8 MAPHINT_Random = 1 << 1; // disable read-ahead (only the accessed pages are loaded)
+static const u8 MAPHINT_WillNeed = 1 << 2; // start loading the pages in the background
+static const u8 MAPHINT_HugePages = 1 << 3; // back the mapping with transparent huge pages (if supported)
+
+// a read-only mapping of an entire file, for passing to Reader::Init without copying
+// - the pages are loaded when first accessed, so only the parts of the file used by lookups are read
+// - the data must not be accessed after the mapping is closed or the file is truncated
+struct MappedFile
+{
+	const void* _data = nullptr;
+	u64 _size = 0;
+#ifdef _WIN32
+	HANDLE _file = INVALID_HANDLE_VALUE;
+	HANDLE _mapping = nullptr;
+#endif
+
+	MappedFile() {}
+	MappedFile(const char* path, u8 hints = MAPHINT_Default) { Open(path, hints); }
+	~MappedFile() { Close(); }
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator = (const MappedFile&) = delete;
+	MappedFile(MappedFile&& o) { _MoveFrom(o); }
+	MappedFile& operator = (MappedFile&& o)
+	{
+		if (this != &o)
+		{
+			Close();
+			_MoveFrom(o);
+		}
+		return *this;
+	}
+
+	DATO_FORCEINLINE bool IsOpen() const { return _data != nullptr; }
+	DATO_FORCEINLINE const void* GetData() const { return _data; }
+	DATO_FORCEINLINE u64 GetSize() const { return _size; }
+
+	// empty files cannot be mapped (and are not valid DATO files) so they fail to open
+	bool Open(const char* path, u8 hints = MAPHINT_Default)
+	{
+		Close();
+#ifdef _WIN32
+		DWORD flags = FILE_ATTRIBUTE_NORMAL;
+		if (hints & MAPHINT_Sequential)
+			flags |= FILE_FLAG_SEQUENTIAL_SCAN;
+		if (hints & MAPHINT_Random)
+			flags |= FILE_FLAG_RANDOM_ACCESS;
+		_file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, flags, nullptr);
+		if (_file == INVALID_HANDLE_VALUE)
+			return false;
+		LARGE_INTEGER size;
+		if (!GetFileSizeEx(_file, &size) || size.QuadPart <= 0 || u64(size.QuadPart) > ~size_t(0))
+		{
+			Close();
+			return false;
+		}
+		_mapping = CreateFileMappingA(_file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		if (!_mapping)
+		{
+			Close();
+			return false;
+		}
+		_data = MapViewOfFile(_mapping, FILE_MAP_READ, 0, 0, 0);
+		if (!_data)
+		{
+			Close();
+			return false;
+		}
+		_size = u64(size.QuadPart);
+#else
+		int fd = open(path, O_RDONLY | O_CLOEXEC);
+		if (fd < 0)
+			return false;
+		struct stat st;
+		if (fstat(fd, &st) != 0 || st.st_size <= 0 || u64(st.st_size) > ~size_t(0))
+		{
+			close(fd);
+			return false;
+		}
+		void* mem = mmap(nullptr, size_t(st.st_size), PROT_READ, MAP_SHARED, fd, 0);
+		close(fd); // the mapping keeps its own reference to the file
+		if (mem == MAP_FAILED)
+			return false;
+		_data = mem;
+		_size = u64(st.st_size);
+		Advise(hints);
+#endif
+		return true;
+	}
+
+	void Close()
+	{
+#ifdef _WIN32
+		if (_data)
+			UnmapViewOfFile(_data);
+		if (_mapping)
+			CloseHandle(_mapping);
+		if (_file != INVALID_HANDLE_VALUE)
+			CloseHandle(_file);
+		_mapping = nullptr;
+		_file = INVALID_HANDLE_VALUE;
+#else
+		if (_data)
+			munmap(const_cast<void*>(_data), size_t(_size));
+#endif
+		_data = nullptr;
+		_size = 0;
+	}
+
+	// applies the hints to the pages overlapping the specified range (clamped to the file size)
+	// - can be used after Open, e.g. to preload the parts of the file that are known to be needed soon
+	bool Advise(u8 hints, u64 offset = 0, u64 size = ~u64(0))
+	{
+		if (!_data || offset >= _size)
+			return false;
+		if (size > _size - offset)
+			size = _size - offset;
+#ifdef _WIN32
+		(void)hints;
+		return true;
+#else
+		u64 pageSize = u64(sysconf(_SC_PAGESIZE));
+		u64 start = offset - offset % pageSize; // the mapping itself is page-aligned
+		char* addr = (char*) const_cast<void*>(_data) + start;
+		size_t len = size_t(offset + size - start);
+		bool ok = true;
+		if (hints & MAPHINT_Sequential)
+			ok &= madvise(addr, len, MADV_SEQUENTIAL) == 0;
+		if (hints & MAPHINT_Random)
+			ok &= madvise(addr, len, MADV_RANDOM) == 0;
+		if (hints & MAPHINT_WillNeed)
+			ok &= madvise(addr, len, MADV_WILLNEED) == 0;
+#ifdef MADV_HUGEPAGE
+		if (hints & MAPHINT_HugePages)
+			ok &= madvise(addr, len, MADV_HUGEPAGE) == 0;
+#endif
+		return ok;
+#endif
+	}
+
+	// initializes the reader to read the mapped data (same arguments and return value as Reader::Init)
+	// - fails if the file is too big for the positions of the reader configuration
+	template <class R> bool InitReader(R& reader, const void* prefix = "DATO", u32 prefix_len = 4) const
+	{
+		typedef typename R::Pos Pos;
+		if (!_data || _size > u64(Pos(~Pos(0))))
+			return false;
+		return reader.Init(_data, Pos(_size), prefix, prefix_len);
+	}
+
+	void _MoveFrom(MappedFile& o)
+	{
+		_data = o._data;
+		_size = o._size;
+		o._data = nullptr;
+		o._size = 0;
+#ifdef _WIN32
+		_file = o._file;
+		_mapping = o._mapping;
+		o._file = INVALID_HANDLE_VALUE;
+		o._mapping = nullptr;
+#endif
+	}
+};
+
+} // dato
+
+/*
+This software is available under 2 licenses:
+-------------------------------------------------------------------------------
+OPTION 1: MIT License
+
+Copyright (c) 2023 Arvīds Kokins
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the “Software”), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+of the Software, and to permit persons to whom the Software is furnished to do
+so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+-------------------------------------------------------------------------------
+OPTION 2: Unlicense
+
+This is free and unencumbered software released into the public domain.
+
+Anyone is free to copy, modify, publish, use, compile, sell, or
+distribute this software, either in source code form or as a compiled
+binary, for any purpose, commercial or non-commercial, and by any
+means.
+
+In jurisdictions that recognize copyright laws, the author or authors
+of this software dedicate any and all copyright interest in the
+software to the public domain. We make this dedication for the benefit
+of the public at large and to the detriment of our heirs and
+successors. We intend this dedication to be an overt act of
+relinquishment in perpetuity of all present and future rights to this
+software under copyright law.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+OTHER DEALINGS IN THE SOFTWARE.
+
+For more information, please refer to <http://unlicense.org/>
+*/
@@ -0,0 +1,391 @@
+// DATO file format file output extension for the writer library - v1.0
+// See the end of this file for license information
+
+#pragma once
+#include "dato_writer.hpp"
+
+#include <stdio.h>
+
+#ifdef _WIN32
+#  ifndef WIN32_LEAN_AND_MEAN
+#    define WIN32_LEAN_AND_MEAN
+#  endif
+#  include <windows.h>
+#else
+#  include <errno.h>
+#  include <fcntl.h>
+#  include <sys/mman.h>
+#  include <unistd.h>
+#endif
+
+
+namespace dato {
+
+// writes to a file with write/pwrite (WriteFile on Windows)
+struct FileOutputStream : IOutputStream
+{
+#ifdef _WIN32
+	typedef HANDLE Handle;
+	HANDLE _file = INVALID_HANDLE_VALUE;
+#else
+	typedef int Handle;
+	int _fd = -1;
+#endif
+	bool _owned = false;
+	u64 _start = 0; // the file offset of the start of the data (for WriteAt)
+
+	FileOutputStream() {}
+	FileOutputStream(const char* path) { Open(path); }
+	~FileOutputStream() { Close(); }
+	FileOutputStream(const FileOutputStream&) = delete;
+	FileOutputStream& operator = (const FileOutputStream&) = delete;
+
+	// creates or truncates the file
+	bool Open(const char* path)
+	{
+		Close();
+#ifdef _WIN32
+		_file = CreateFileA(path, GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+		if (_file == INVALID_HANDLE_VALUE)
+			return false;
+#else
+		_fd = open(path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0666);
+		if (_fd < 0)
+			return false;
+#endif
+		_owned = true;
+		return true;
+	}
+	// uses an already open file without closing it, the data starts at its current position
+	void Attach(Handle h)
+	{
+		Close();
+#ifdef _WIN32
+		_file = h;
+		LARGE_INTEGER zero = {}, cur = {};
+		SetFilePointerEx(_file, zero, &cur, FILE_CURRENT);
+		_start = u64(cur.QuadPart);
+#else
+		_fd = h;
+		off_t cur = lseek(_fd, 0, SEEK_CUR);
+		_start = cur > 0 ? u64(cur) : 0;
+#endif
+		_owned = false;
+	}
+	void Close()
+	{
+#ifdef _WIN32
+		if (_owned && _file != INVALID_HANDLE_VALUE)
+			CloseHandle(_file);
+		_file = INVALID_HANDLE_VALUE;
+#else
+		if (_owned && _fd >= 0)
+			close(_fd);
+		_fd = -1;
+#endif
+		_owned = false;
+		_start = 0;
+	}
+	bool IsOpen() const
+	{
+#ifdef _WIN32
+		return _file != INVALID_HANDLE_VALUE;
+#else
+		return _fd >= 0;
+#endif
+	}
+
+	bool Write(const void* data, size_t size) override
+	{
+		auto* p = (const char*) data;
+		while (size)
+		{
+#ifdef _WIN32
+			DWORD n = 0;
+			if (!WriteFile(_file, p, DWORD(size < 0x40000000 ? size : 0x40000000), &n, nullptr) || n == 0)
+				return false;
+#else
+			ssize_t n = write(_fd, p, size);
+			if (n < 0 && errno == EINTR)
+				continue;
+			if (n <= 0)
+				return false;
+#endif
+			p += n;
+			size -= size_t(n);
+		}
+		return true;
+	}
+	bool WriteAt(u64 offset, const void* data, size_t size) override
+	{
+		auto* p = (const char*) data;
+		offset += _start;
+		while (size)
+		{
+#ifdef _WIN32
+			// (also moves the file pointer, which is restored after)
+			LARGE_INTEGER zero = {}, cur;
+			if (!SetFilePointerEx(_file, zero, &cur, FILE_CURRENT))
+				return false;
+			OVERLAPPED ov = {};
+			ov.Offset = DWORD(offset);
+			ov.OffsetHigh = DWORD(offset >> 32);
+			DWORD n = 0;
+			BOOL ok = WriteFile(_file, p, DWORD(size < 0x40000000 ? size : 0x40000000), &n, &ov);
+			if (!SetFilePointerEx(_file, cur, nullptr, FILE_BEGIN) || !ok || n == 0)
+				return false;
+#else
+			ssize_t n = pwrite(_fd, p, size, off_t(offset));
+			if (n < 0 && errno == EINTR)
+				continue;
+			if (n <= 0)
+				return false;
+#endif
+			p += n;
+			offset += u64(n);
+			size -= size_t(n);
+		}
+		return true;
+	}
+};
+
+// writes to a FILE* (WriteAt seeks there and back to the end)
+// - the data starts at the position of the file when the stream is created
+struct StdioOutputStream : IOutputStream
+{
+	FILE* _fp = nullptr;
+	u64 _start = 0;
+
+	StdioOutputStream() {}
+	StdioOutputStream(FILE* fp) : _fp(fp)
+	{
+#ifdef _WIN32
+		s64 cur = _ftelli64(fp);
+#else
+		s64 cur = s64(ftello(fp));
+#endif
+		_start = cur > 0 ? u64(cur) : 0;
+	}
+
+	bool Write(const void* data, size_t size) override
+	{
+		return fwrite(data, 1, size, _fp) == size;
+	}
+	bool WriteAt(u64 offset, const void* data, size_t size) override
+	{
+		offset += _start;
+#ifdef _WIN32
+		if (_fseeki64(_fp, s64(offset), SEEK_SET) != 0)
+			return false;
+		bool ok = fwrite(data, 1, size, _fp) == size;
+		return _fseeki64(_fp, 0, SEEK_END) == 0 && ok;
+#else
+		if (fseeko(_fp, off_t(offset), SEEK_SET) != 0)
+			return false;
+		bool ok = fwrite(data, 1, size, _fp) == size;
+		return fseeko(_fp, 0, SEEK_END) == 0 && ok;
+#endif
+	}
+};
+
+// a file that the data of a builder is written to directly, through a shared mapping that grows with it
+// (see BasicWriterBase::SetDataAllocator), so that it doesn't need to be copied to the file at the end
+// - the file is grown in large steps (doubling, in multiples of `step`) with ftruncate and mremap ..
+// .. (a new mapping where mremap is not available) and Finish truncates it to the size of the data
+// - only supports one block (the contiguous data of one builder), which is valid until Finish/Close
+struct MappedOutputFile : IAllocator
+{
+	char* _map = nullptr;
+	u64 _capacity = 0; // the size of the file and the mapping
+	u64 _step;
+#ifdef _WIN32
+	HANDLE _file = INVALID_HANDLE_VALUE;
+	HANDLE _mapping = nullptr;
+#else
+	int _fd = -1;
+#endif
+
+	MappedOutputFile(u64 step = 64 * 1024 * 1024) : _step(step ? step : 1) {}
+	MappedOutputFile(const char* path, u64 step = 64 * 1024 * 1024) : _step(step ? step : 1) { Open(path); }
+	~MappedOutputFile() { Close(); }
+	MappedOutputFile(const MappedOutputFile&) = delete;
+	MappedOutputFile& operator = (const MappedOutputFile&) = delete;
+
+	// creates or truncates the file
+	bool Open(const char* path)
+	{
+		Close();
+#ifdef _WIN32
+		_file = CreateFileA(path, GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+		return _file != INVALID_HANDLE_VALUE;
+#else
+		_fd = open(path, O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0666);
+		return _fd >= 0;
+#endif
+	}
+	bool IsOpen() const
+	{
+#ifdef _WIN32
+		return _file != INVALID_HANDLE_VALUE;
+#else
+		return _fd >= 0;
+#endif
+	}
+
+	// unmaps the data, truncates the file to `size` and closes it
+	bool Finish(u64 size)
+	{
+		if (!IsOpen() || size > _capacity)
+			return false;
+		_Unmap();
+#ifdef _WIN32
+		LARGE_INTEGER li;
+		li.QuadPart = LONGLONG(size);
+		bool ok = SetFilePointerEx(_file, li, nullptr, FILE_BEGIN) && SetEndOfFile(_file);
+#else
+		bool ok = ftruncate(_fd, off_t(size)) == 0;
+#endif
+		Close();
+		return ok;
+	}
+	// (without Finish, the file keeps its current size, which is usually bigger than the data)
+	void Close()
+	{
+		_Unmap();
+#ifdef _WIN32
+		if (_file != INVALID_HANDLE_VALUE)
+			CloseHandle(_file);
+		_file = INVALID_HANDLE_VALUE;
+#else
+		if (_fd >= 0)
+			close(_fd);
+		_fd = -1;
+#endif
+		_capacity = 0;
+	}
+
+	// returns null if the file could not be grown (the old mapping stays valid)
+	void* Realloc(void* ptr, size_t, size_t size) override
+	{
+		DATO_INPUT_EXPECT(ptr == _map);
+		(void) ptr;
+		if (u64(size) <= _capacity)
+			return _map;
+		u64 cap = _capacity * 2;
+		if (cap < u64(size))
+			cap = u64(size);
+		cap = (cap + _step - 1) / _step * _step;
+		return _Grow(cap) ? _map : nullptr;
+	}
+	// (the mapping is owned by the file)
+	void Free(void*, size_t) override {}
+
+	bool _Grow(u64 cap)
+	{
+		if (!IsOpen() || cap > u64(~size_t(0)))
+			return false;
+#ifdef _WIN32
+		// (creating a bigger mapping grows the file)
+		HANDLE mapping = CreateFileMappingA(_file, nullptr, PAGE_READWRITE, DWORD(cap >> 32), DWORD(cap), nullptr);
+		if (!mapping)
+			return false;
+		char* map = (char*) MapViewOfFile(mapping, FILE_MAP_WRITE, 0, 0, size_t(cap));
+		if (!map)
+		{
+			CloseHandle(mapping);
+			return false;
+		}
+		_Unmap();
+		_mapping = mapping;
+		_map = map;
+#else
+		if (ftruncate(_fd, off_t(cap)) != 0)
+			return false;
+		void* mem;
+#ifdef MREMAP_MAYMOVE
+		if (_map)
+			mem = mremap(_map, size_t(_capacity), size_t(cap), MREMAP_MAYMOVE);
+		else
+#endif
+		{
+			mem = mmap(nullptr, size_t(cap), PROT_READ | PROT_WRITE, MAP_SHARED, _fd, 0);
+			if (mem != MAP_FAILED && _map)
+				munmap(_map, size_t(_capacity));
+		}
+		if (mem == MAP_FAILED)
+			return false;
+		_map = (char*) mem;
+#endif
+		_capacity = cap;
+		return true;
+	}
+	void _Unmap()
+	{
+#ifdef _WIN32
+		if (_map)
+			UnmapViewOfFile(_map);
+		if (_mapping)
+			CloseHandle(_mapping);
+		_mapping = nullptr;
+#else
+		if (_map)
+			munmap(_map, size_t(_capacity));
+#endif
+		_map = nullptr;
+	}
+};
+
+} // dato
+
+/*
+This software is available under 2 licenses:
+-------------------------------------------------------------------------------
+OPTION 1: MIT License
+
+Copyright (c) 2023 Arvīds Kokins
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the “Software”), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+of the Software, and to permit persons to whom the Software is furnished to do
+so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+-------------------------------------------------------------------------------
+OPTION 2: Unlicense
+
+This is free and unencumbered software released into the public domain.
+
+Anyone is free to copy, modify, publish, use, compile, sell, or
+distribute this software, either in source code form or as a compiled
+binary, for any purpose, commercial or non-commercial, and by any
+means.
+
+In jurisdictions that recognize copyright laws, the author or authors
+of this software dedicate any and all copyright interest in the
+software to the public domain. We make this dedication for the benefit
+of the public at large and to the detriment of our heirs and
+successors. We intend this dedication to be an overt act of
+relinquishment in perpetuity of all present and future rights to this
+software under copyright law.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+OTHER DEALINGS IN THE SOFTWARE.
+
+For more information, please refer to <http://unlicense.org/>
+*/
@@ -0,0 +1,472 @@
+// DATO file format paged reading extension for the reader library - v1.0
+// See the end of this file for license information
+
+#pragma once
+#include "dato_reader.hpp"
+
+#if !defined(DATO_MALLOC) || !defined(DATO_REALLOC) || !defined(DATO_FREE)
+#  include <malloc.h>
+#  define DATO_MALLOC malloc
+#  define DATO_REALLOC realloc
+#  define DATO_FREE free
+#endif
+
+#ifdef _WIN32
+#  ifndef WIN32_LEAN_AND_MEAN
+#    define WIN32_LEAN_AND_MEAN
+#  endif
+#  include <windows.h>
+#else
+#  include <fcntl.h>
+#  include <sys/stat.h>
+#  include <unistd.h>
+#endif
+
+
+namespace dato {
+
+// the source of the pages of a PagedReader
+struct IPageSource
+{
+	virtual u64 GetSize() const = 0;
+	// reads exactly `size` bytes (only called for ranges within GetSize())
+	virtual bool ReadAt(u64 offset, void* dst, u32 size) = 0;
+};
+
+// reads the pages from a file with pread (ReadFile on Windows), without keeping a file position
+struct FilePageSource : IPageSource
+{
+#ifdef _WIN32
+	HANDLE _file = INVALID_HANDLE_VALUE;
+#else
+	int _fd = -1;
+#endif
+	u64 _size = 0;
+
+	FilePageSource() {}
+	FilePageSource(const char* path) { Open(path); }
+	~FilePageSource() { Close(); }
+	FilePageSource(const FilePageSource&) = delete;
+	FilePageSource& operator = (const FilePageSource&) = delete;
+
+	bool Open(const char* path)
+	{
+		Close();
+#ifdef _WIN32
+		_file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_RANDOM_ACCESS, nullptr);
+		if (_file == INVALID_HANDLE_VALUE)
+			return false;
+		LARGE_INTEGER size;
+		if (!GetFileSizeEx(_file, &size))
+		{
+			Close();
+			return false;
+		}
+		_size = u64(size.QuadPart);
+#else
+		_fd = open(path, O_RDONLY | O_CLOEXEC);
+		if (_fd < 0)
+			return false;
+		struct stat st;
+		if (fstat(_fd, &st) != 0)
+		{
+			Close();
+			return false;
+		}
+		_size = u64(st.st_size);
+#endif
+		return true;
+	}
+	void Close()
+	{
+#ifdef _WIN32
+		if (_file != INVALID_HANDLE_VALUE)
+			CloseHandle(_file);
+		_file = INVALID_HANDLE_VALUE;
+#else
+		if (_fd >= 0)
+			close(_fd);
+		_fd = -1;
+#endif
+		_size = 0;
+	}
+	bool IsOpen() const
+	{
+#ifdef _WIN32
+		return _file != INVALID_HANDLE_VALUE;
+#else
+		return _fd >= 0;
+#endif
+	}
+
+	u64 GetSize() const override { return _size; }
+	bool ReadAt(u64 offset, void* dst, u32 size) override
+	{
+		char* out = (char*) dst;
+		while (size)
+		{
+#ifdef _WIN32
+			OVERLAPPED ov = {};
+			ov.Offset = DWORD(offset);
+			ov.OffsetHigh = DWORD(offset >> 32);
+			DWORD numRead = 0;
+			if (!ReadFile(_file, out, size, &numRead, &ov) || numRead == 0)
+				return false;
+#else
+			ssize_t numRead = pread(_fd, out, size, off_t(offset));
+			if (numRead <= 0)
+				return false;
+#endif
+			out += numRead;
+			offset += u64(numRead);
+			size -= u32(numRead);
+		}
+		return true;
+	}
+};
+
+struct PageCacheStats
+{
+	u64 lookups = 0; // page lookups (every read touches one or more pages)
+	u64 misses = 0; // pages read from the source
+	u64 evictions = 0; // least recently used pages dropped to make space for others
+	u64 bytesRead = 0; // bytes read from the source
+	u64 readErrors = 0; // failed source reads
+};
+
+// a fixed number of fixed-size blocks of the source, filled on demand and evicted in LRU order
+struct PageCache
+{
+	static const u32 NONE = 0xffffffff;
+
+	struct Page
+	{
+		u64 index;
+		u32 prev; // towards the most recently used page
+		u32 next; // towards the least recently used page (or the next free page)
+		u32 hashNext;
+	};
+
+	IPageSource* _src = nullptr;
+	u64 _srcSize = 0;
+	u32 _blockSize = 0;
+	u32 _blockShift = 0;
+	u32 _numPages = 0;
+	u32 _usedPages = 0;
+	char* _mem = nullptr;
+	Page* _pages = nullptr;
+	u32* _buckets = nullptr;
+	u32 _bucketMask = 0;
+	u32 _head = NONE; // most recently used
+	u32 _tail = NONE; // least recently used
+	u32 _free = NONE;
+	u64 _lastIndex = ~u64(0); // the most recently used page (for consecutive reads from the same page)
+	const char* _lastData = nullptr;
+	PageCacheStats stats;
+
+	PageCache() {}
+	~PageCache() { _Free(); }
+	PageCache(const PageCache&) = delete;
+	PageCache& operator = (const PageCache&) = delete;
+
+	// `blockSize` must be a power of 2, `numPages * blockSize` bytes are allocated for the page data
+	bool Init(IPageSource* src, u32 blockSize = 4096, u32 numPages = 256)
+	{
+		_Free();
+		if (!src || blockSize == 0 || (blockSize & (blockSize - 1)) || numPages == 0 || numPages >= NONE / 2)
+			return false;
+		u32 numBuckets = 1;
+		while (numBuckets < numPages * 2)
+			numBuckets *= 2;
+		_mem = (char*) DATO_MALLOC(size_t(numPages) * blockSize);
+		_pages = (Page*) DATO_MALLOC(sizeof(Page) * numPages);
+		_buckets = (u32*) DATO_MALLOC(sizeof(u32) * numBuckets);
+		if (!_mem || !_pages || !_buckets)
+		{
+			_Free();
+			return false;
+		}
+		_src = src;
+		_srcSize = src->GetSize();
+		_blockSize = blockSize;
+		_blockShift = 0;
+		while ((1U << _blockShift) < blockSize)
+			_blockShift++;
+		_numPages = numPages;
+		_bucketMask = numBuckets - 1;
+		Clear();
+		return true;
+	}
+
+	// drops all pages (the stats are kept)
+	void Clear()
+	{
+		for (u32 i = 0; i <= _bucketMask && _buckets; i++)
+			_buckets[i] = NONE;
+		for (u32 i = 0; i < _numPages; i++)
+			_pages[i].next = i + 1 < _numPages ? i + 1 : NONE;
+		_free = _numPages ? 0 : NONE;
+		_head = NONE;
+		_tail = NONE;
+		_usedPages = 0;
+		_lastIndex = ~u64(0);
+		_lastData = nullptr;
+	}
+	DATO_FORCEINLINE void ResetStats() { stats = {}; }
+
+	DATO_FORCEINLINE u64 GetSize() const { return _srcSize; }
+	DATO_FORCEINLINE u32 GetBlockSize() const { return _blockSize; }
+	DATO_FORCEINLINE u32 GetCachedPageCount() const { return _usedPages; }
+
+	// returns the data of the page (the last one may be shorter than the block size) or null on read errors
+	const char* GetPage(u64 index)
+	{
+		stats.lookups++;
+		if (index == _lastIndex)
+			return _lastData;
+		u32 p = _buckets[index & _bucketMask];
+		while (p != NONE && _pages[p].index != index)
+			p = _pages[p].hashNext;
+		if (p != NONE)
+		{
+			if (p != _head)
+			{
+				_Unlink(p);
+				_PushFront(p);
+			}
+			_lastIndex = index;
+			return _lastData = _PageData(p);
+		}
+		return _Load(index);
+	}
+	// copies a range of bytes that can span several pages
+	bool Read(void* dst, u64 pos, u64 size)
+	{
+		if (pos > _srcSize || size > _srcSize - pos)
+			return false;
+		char* out = (char*) dst;
+		while (size)
+		{
+			const char* page = GetPage(pos >> _blockShift);
+			if (!page)
+				return false;
+			u32 off = u32(pos & (_blockSize - 1));
+			u64 chunk = _blockSize - off;
+			if (chunk > size)
+				chunk = size;
+			DATO_MEMCPY(out, page + off, size_t(chunk));
+			out += chunk;
+			pos += chunk;
+			size -= chunk;
+		}
+		return true;
+	}
+
+	DATO_FORCEINLINE char* _PageData(u32 p) const { return _mem + size_t(p) * _blockSize; }
+	void _Unlink(u32 p)
+	{
+		Page& P = _pages[p];
+		if (P.prev != NONE)
+			_pages[P.prev].next = P.next;
+		else
+			_head = P.next;
+		if (P.next != NONE)
+			_pages[P.next].prev = P.prev;
+		else
+			_tail = P.prev;
+	}
+	void _PushFront(u32 p)
+	{
+		_pages[p].prev = NONE;
+		_pages[p].next = _head;
+		if (_head != NONE)
+			_pages[_head].prev = p;
+		else
+			_tail = p;
+		_head = p;
+	}
+	void _RemoveFromHash(u32 p)
+	{
+		u32* pp = &_buckets[_pages[p].index & _bucketMask];
+		while (*pp != p)
+			pp = &_pages[*pp].hashNext;
+		*pp = _pages[p].hashNext;
+	}
+	DATO_NOINLINE const char* _Load(u64 index)
+	{
+		u64 pos = index << _blockShift;
+		if (pos >= _srcSize)
+			return nullptr;
+		_lastIndex = ~u64(0); // (may be evicted)
+		u32 p = _free;
+		if (p != NONE)
+			_free = _pages[p].next;
+		else
+		{
+			p = _tail;
+			_Unlink(p);
+			_RemoveFromHash(p);
+			_usedPages--;
+			stats.evictions++;
+		}
+		u32 size = _srcSize - pos < _blockSize ? u32(_srcSize - pos) : _blockSize;
+		if (!_src->ReadAt(pos, _PageData(p), size))
+		{
+			// (the page is not in the cache either way now)
+			stats.readErrors++;
+			_pages[p].next = _free;
+			_free = p;
+			return nullptr;
+		}
+		_usedPages++;
+		stats.misses++;
+		stats.bytesRead += size;
+		_pages[p].index = index;
+		_pages[p].hashNext = _buckets[index & _bucketMask];
+		_buckets[index & _bucketMask] = p;
+		_PushFront(p);
+		_lastIndex = index;
+		return _lastData = _PageData(p);
+	}
+	void _Free()
+	{
+		DATO_FREE(_mem);
+		DATO_FREE(_pages);
+		DATO_FREE(_buckets);
+		_mem = nullptr;
+		_pages = nullptr;
+		_buckets = nullptr;
+		_src = nullptr;
+		_srcSize = 0;
+		_numPages = 0;
+		_bucketMask = 0;
+		Clear();
+	}
+};
+
+// the read primitive of PagedReader (see BufferSource)
+struct PageSource
+{
+	static const bool Direct = false;
+
+	PageCache* _cache = nullptr;
+
+	// copies a range that is in the source (it can span pages), returns false on read errors
+	DATO_FORCEINLINE bool Read(void* dst, u64 pos, u64 size) const
+	{
+		u64 off = pos & (_cache->_blockSize - 1);
+		if (off + size > _cache->_blockSize)
+			return _cache->Read(dst, pos, size);
+		const char* page = _cache->GetPage(pos >> _cache->_blockShift);
+		if (!page)
+			return false;
+		DATO_MEMCPY(dst, page + off, size_t(size));
+		return true;
+	}
+	// compares the memory to a range of the source (`outDiff` is the result of memcmp), returns false on read errors
+	bool Compare(int& outDiff, u64 pos, const void* mem, u64 size) const
+	{
+		const char* m = (const char*) mem;
+		u64 mask = _cache->_blockSize - 1;
+		outDiff = 0;
+		while (size)
+		{
+			const char* page = _cache->GetPage(pos >> _cache->_blockShift);
+			if (!page)
+				return false;
+			u64 chunk = _cache->_blockSize - (pos & mask);
+			if (chunk > size)
+				chunk = size;
+			if ((outDiff = DATO_MEMCMP(m, page + (pos & mask), size_t(chunk))) != 0)
+				return true;
+			m += chunk;
+			pos += chunk;
+			size -= chunk;
+		}
+		return true;
+	}
+};
+
+// reads the data through a PageCache, loading only the pages that are accessed
+// - the lookup accessors are the ones of SafeReader (all checks are enabled: invalid data, invalid ..
+// .. arguments and read errors set the sticky error flag and return empty values)
+// - strings, byte arrays and vectors are copied out (see BasicReader::CopyingArrayAccessor), and there ..
+// .. are no functions that return pointers to the data (GetKeyCStr, Iterate/Visit, Validate)
+// - the page cache is modified by the reads, so the reader cannot be shared by several threads
+struct DATO_CONCAT(PagedReader, DATO_CONFIG) : BasicReader<DATO_CONCAT(ReaderConfig, DATO_CONFIG), CHECKS_Error, PageSource>
+{
+	// the cache must be initialized and must outlive the reader
+	DATO_NOINLINE bool Init(PageCache& cache, const void* prefix = "DATO", u32 prefix_len = 4)
+	{
+		PageSource src;
+		src._cache = &cache;
+		return cache._src && InitSource(src, cache.GetSize(), prefix, prefix_len);
+	}
+
+	// (empty if not initialized)
+	DynamicAccessor GetRoot() const
+	{
+		if (!GetCache())
+			return {};
+		return BasicReader::GetRoot();
+	}
+
+	DATO_FORCEINLINE PageCache* GetCache() const { return GetSource()._cache; }
+};
+
+using PagedReader = DATO_CONCAT(PagedReader, DATO_CONFIG);
+
+} // dato
+
+/*
+This software is available under 2 licenses:
+-------------------------------------------------------------------------------
+OPTION 1: MIT License
+
+Copyright (c) 2023 Arvīds Kokins
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the “Software”), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+of the Software, and to permit persons to whom the Software is furnished to do
+so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+-------------------------------------------------------------------------------
+OPTION 2: Unlicense
+
+This is free and unencumbered software released into the public domain.
+
+Anyone is free to copy, modify, publish, use, compile, sell, or
+distribute this software, either in source code form or as a compiled
+binary, for any purpose, commercial or non-commercial, and by any
+means.
+
+In jurisdictions that recognize copyright laws, the author or authors
+of this software dedicate any and all copyright interest in the
+software to the public domain. We make this dedication for the benefit
+of the public at large and to the detriment of our heirs and
+successors. We intend this dedication to be an overt act of
+relinquishment in perpetuity of all present and future rights to this
+software under copyright law.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+OTHER DEALINGS IN THE SOFTWARE.
+
+For more information, please refer to <http://unlicense.org/>
+*/
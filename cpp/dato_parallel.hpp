@@ -0,0 +1,321 @@
+// DATO file format parallel traversal extension for the reader library - v1.0
+// See the end of this file for license information
+
+#pragma once
+#include "dato_reader.hpp"
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+
+namespace dato {
+
+// a fixed set of threads that run ParallelFor jobs together with the calling thread
+// - the items of a job are split evenly between the workers, and the workers that run out of items ..
+// .. steal half of the remaining items of another worker
+// - one job runs at a time (ParallelFor blocks other callers, and must not be called from inside a job)
+struct ThreadPool
+{
+	// the remaining chunks of a worker, as (begin << 32) | end
+	// - the owner takes chunks from the beginning, thieves take the second half
+	struct _Range
+	{
+		std::atomic<u64> chunks;
+		char _pad[64 - sizeof(std::atomic<u64>)]; // (no false sharing between the workers)
+	};
+	typedef void _JobFunc(void* ctx, u32 worker, size_t begin, size_t end);
+
+	std::vector<std::thread> _threads;
+	std::vector<_Range> _ranges;
+	std::mutex _jobMutex; // held for the duration of a job
+	std::mutex _mutex;
+	std::condition_variable _wake;
+	std::condition_variable _done;
+	u64 _generation = 0;
+	u32 _numBusy = 0; // the number of threads that have not finished the current job
+	bool _stop = false;
+	_JobFunc* _func = nullptr;
+	void* _ctx = nullptr;
+	size_t _count = 0;
+	size_t _grain = 1;
+
+	// 0 = one worker per hardware thread (including the calling thread)
+	explicit ThreadPool(u32 numWorkers = 0) : _ranges(numWorkers ? numWorkers : DefaultWorkerCount())
+	{
+		for (u32 i = 1; i < _ranges.size(); i++)
+			_threads.emplace_back([this, i]() { _ThreadMain(i); });
+	}
+	~ThreadPool()
+	{
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+			_stop = true;
+		}
+		_wake.notify_all();
+		for (std::thread& t : _threads)
+			t.join();
+	}
+	ThreadPool(const ThreadPool&) = delete;
+	ThreadPool& operator = (const ThreadPool&) = delete;
+
+	static u32 DefaultWorkerCount()
+	{
+		u32 n = std::thread::hardware_concurrency();
+		return n ? n : 1;
+	}
+	// the number of workers (the calling thread is worker 0)
+	DATO_FORCEINLINE u32 GetWorkerCount() const { return u32(_ranges.size()); }
+
+	// calls `fn(worker, begin, end)` for consecutive ranges of at most `grain` items that cover [0; count), ..
+	// .. and returns after all of them are done (`worker` is in [0; GetWorkerCount()))
+	template <class F> void ParallelFor(size_t count, size_t grain, F&& fn)
+	{
+		if (count == 0)
+			return;
+		if (grain == 0)
+			grain = 1;
+		// (the chunk indices must fit in 32 bits)
+		if ((count - 1) / grain >= 0xffffffffU)
+			grain = (count - 1) / 0xffffffffU + 1;
+		std::lock_guard<std::mutex> jobLock(_jobMutex);
+		_Run(&_CallJob<typename std::remove_reference<F>::type>, &fn, count, grain);
+	}
+
+	template <class F> static void _CallJob(void* ctx, u32 worker, size_t begin, size_t end)
+	{
+		(*static_cast<F*>(ctx))(worker, begin, end);
+	}
+	void _Run(_JobFunc* func, void* ctx, size_t count, size_t grain)
+	{
+		u64 numChunks = (count - 1) / grain + 1;
+		u64 numWorkers = _ranges.size();
+		for (u64 i = 0; i < numWorkers; i++)
+			_ranges[i].chunks.store((numChunks * i / numWorkers) << 32 | (numChunks * (i + 1) / numWorkers));
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+			_func = func;
+			_ctx = ctx;
+			_count = count;
+			_grain = grain;
+			_numBusy = u32(_threads.size());
+			_generation++;
+		}
+		_wake.notify_all();
+		_Work(0);
+		std::unique_lock<std::mutex> lock(_mutex);
+		_done.wait(lock, [this]() { return _numBusy == 0; });
+	}
+	void _ThreadMain(u32 worker)
+	{
+		u64 seen = 0;
+		for (;;)
+		{
+			{
+				std::unique_lock<std::mutex> lock(_mutex);
+				_wake.wait(lock, [&]() { return _stop || _generation != seen; });
+				if (_stop)
+					return;
+				seen = _generation;
+			}
+			_Work(worker);
+			bool last;
+			{
+				std::lock_guard<std::mutex> lock(_mutex);
+				last = --_numBusy == 0;
+			}
+			if (last)
+				_done.notify_one();
+		}
+	}
+	void _Work(u32 worker)
+	{
+		for (;;)
+		{
+			u32 chunk;
+			if (!_TakeOwn(worker, chunk) && !_Steal(worker, chunk))
+				return;
+			size_t begin = size_t(chunk) * _grain;
+			size_t end = _count - begin > _grain ? begin + _grain : _count;
+			_func(_ctx, worker, begin, end);
+		}
+	}
+	bool _TakeOwn(u32 worker, u32& outChunk)
+	{
+		std::atomic<u64>& own = _ranges[worker].chunks;
+		u64 r = own.load();
+		for (;;)
+		{
+			u32 begin = u32(r >> 32), end = u32(r);
+			if (begin >= end)
+				return false;
+			if (own.compare_exchange_weak(r, u64(begin + 1) << 32 | end))
+			{
+				outChunk = begin;
+				return true;
+			}
+		}
+	}
+	bool _Steal(u32 worker, u32& outChunk)
+	{
+		u32 numWorkers = u32(_ranges.size());
+		for (u32 k = 1; k < numWorkers; k++)
+		{
+			std::atomic<u64>& victim = _ranges[(worker + k) % numWorkers].chunks;
+			u64 r = victim.load();
+			for (;;)
+			{
+				u32 begin = u32(r >> 32), end = u32(r);
+				if (begin >= end)
+					break;
+				u32 mid = begin + (end - begin) / 2;
+				if (victim.compare_exchange_weak(r, u64(begin) << 32 | mid))
+				{
+					// (only thieves that have seen a non-empty range modify it, so no one else changes ours now)
+					_ranges[worker].chunks.store(u64(mid + 1) << 32 | end);
+					outChunk = mid;
+					return true;
+				}
+			}
+		}
+		return false;
+	}
+};
+
+// calls `fn(worker, i, container[i])` for each element of an array or map accessor, in parallel ..
+// .. (for maps, the element is the iterator with GetKey / GetKeyCStr and GetValue)
+template <class A, class F> void ParallelForEach(ThreadPool& pool, const A& container, F&& fn, size_t grain = 256)
+{
+	pool.ParallelFor(container.GetSize(), grain, [&](u32 worker, size_t begin, size_t end)
+	{
+		for (size_t i = begin; i < end; i++)
+			fn(worker, i, container[i]);
+	});
+}
+
+// map-reduce over the elements of an array or map accessor
+// - each worker folds the elements it gets into its own copy of `init` with `fn(state, i, container[i])`, ..
+// .. then the states are combined with `reduce(a, b)` (the elements are processed in no particular order)
+template <class T, class A, class F, class R>
+T ParallelReduce(ThreadPool& pool, const A& container, T init, F&& fn, R&& reduce, size_t grain = 256)
+{
+	std::vector<T> states(pool.GetWorkerCount(), init);
+	pool.ParallelFor(container.GetSize(), grain, [&](u32 worker, size_t begin, size_t end)
+	{
+		// (the state is kept local while folding, so that the states of the workers do not share cache lines)
+		T state = std::move(states[worker]);
+		for (size_t i = begin; i < end; i++)
+			fn(state, i, container[i]);
+		states[worker] = std::move(state);
+	});
+	T result = std::move(states[0]);
+	for (u32 i = 1; i < states.size(); i++)
+		result = reduce(std::move(result), std::move(states[i]));
+	return result;
+}
+
+// visits the elements of a container in parallel, with one visitor for each worker (`visitors` must point ..
+// .. to GetWorkerCount() of them), and each element with all of its subvalues visited by the same visitor
+// - each element is visited between the BeginArrayIndex, BeginStringKey or BeginIntKey callback and its ..
+// .. End* pair, but the callbacks of the container itself are not called and the elements are not in order
+// - values that are not containers are visited by the first visitor
+template <class DA, class V> void ParallelVisit(ThreadPool& pool, DA value, V* visitors, size_t grain = 16)
+{
+	switch (value.GetType())
+	{
+	case TYPE_Array: {
+		auto arr = value.AsArray();
+		ParallelForEach(pool, arr, [&](u32 worker, size_t i, DA v)
+		{
+			V& it = visitors[worker];
+			it.BeginArrayIndex(u32(i));
+			v.Visit(it);
+			it.EndArrayIndex();
+		}, grain);
+		break; }
+	case TYPE_StringMap:
+	case TYPE_StringHashMap: {
+		auto map = value.AsStringMap();
+		ParallelForEach(pool, map, [&](u32 worker, size_t, const typename decltype(map)::Iterator& e)
+		{
+			V& it = visitors[worker];
+			u32 keyLength;
+			const char* key = e.GetKeyCStr(&keyLength);
+			it.BeginStringKey(key, keyLength);
+			e.GetValue().Visit(it);
+			it.EndStringKey();
+		}, grain);
+		break; }
+	case TYPE_IntMap: {
+		auto map = value.AsIntMap();
+		ParallelForEach(pool, map, [&](u32 worker, size_t, const typename decltype(map)::Iterator& e)
+		{
+			V& it = visitors[worker];
+			it.BeginIntKey(e.GetKey());
+			e.GetValue().Visit(it);
+			it.EndIntKey();
+		}, grain);
+		break; }
+	default:
+		value.Visit(visitors[0]);
+		break;
+	}
+}
+
+} // dato
+
+/*
+This software is available under 2 licenses:
+-------------------------------------------------------------------------------
+OPTION 1: MIT License
+
+Copyright (c) 2023 Arvīds Kokins
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the “Software”), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+of the Software, and to permit persons to whom the Software is furnished to do
+so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+-------------------------------------------------------------------------------
+OPTION 2: Unlicense
+
+This is free and unencumbered software released into the public domain.
+
+Anyone is free to copy, modify, publish, use, compile, sell, or
+distribute this software, either in source code form or as a compiled
+binary, for any purpose, commercial or non-commercial, and by any
+means.
+
+In jurisdictions that recognize copyright laws, the author or authors
+of this software dedicate any and all copyright interest in the
+software to the public domain. We make this dedication for the benefit
+of the public at large and to the detriment of our heirs and
+successors. We intend this dedication to be an overt act of
+relinquishment in perpetuity of all present and future rights to this
+software under copyright law.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+OTHER DEALINGS IN THE SOFTWARE.
+
+For more information, please refer to <http://unlicense.org/>
+*/
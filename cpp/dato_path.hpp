@@ -0,0 +1,425 @@
+// DATO file format compiled path query extension for the reader library - v1.0
+// See the end of this file for license information
+
+#pragma once
+#include "dato_reader.hpp"
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+
+namespace dato {
+
+// the number of values ahead of the current one that the batch evaluation of paths starts loading
+static const size_t PATH_BatchPrefetch = 8;
+
+// the resolved path prefixes of one document, shared by all of the paths that are evaluated with it
+// - the entries are only valid for one document (they are cleared when the reader is initialized ..
+// .. again, see Reader::GetDocumentId)
+// - the entries are modified while evaluating paths, so each thread needs its own cache
+template <class R = Reader> struct BasicPathCache
+{
+	typedef typename R::Pos Pos;
+
+	struct Entry
+	{
+		std::string prefix; // the path text up to the resolved step
+		Pos pos;
+		u8 type;
+	};
+
+	std::unordered_map<u32, Entry> _entries; // by the hash of the prefix
+	u64 _document = 0; // the Reader::GetDocumentId that the entries refer to
+
+	void Clear()
+	{
+		_entries.clear();
+		_document = 0;
+	}
+	size_t GetSize() const { return _entries.size(); }
+
+	void _SetDocument(const R& r)
+	{
+		if (r.GetDocumentId() != _document)
+		{
+			_entries.clear();
+			_document = r.GetDocumentId();
+		}
+	}
+	const Entry* _Find(u32 hash, const char* prefix, size_t len) const
+	{
+		auto it = _entries.find(hash);
+		if (it == _entries.end() || it->second.prefix.size() != len || DATO_MEMCMP(it->second.prefix.data(), prefix, len) != 0)
+			return nullptr;
+		return &it->second;
+	}
+	void _Store(u32 hash, const char* prefix, size_t len, Pos pos, u8 type)
+	{
+		Entry& e = _entries[hash]; // (replaces the entry of a different prefix with the same hash)
+		e.prefix.assign(prefix, len);
+		e.pos = pos;
+		e.type = type;
+	}
+};
+
+// a path to nested values, compiled once and evaluated against any number of values and documents
+// - the steps are separated by '/' (a leading '/' is optional and an empty path refers to the value itself)
+// - a step is looked up as a key in string maps, and as an index in arrays or a key in int maps ..
+// .. if it is a decimal number (without leading zeros, up to 2^32-1)
+// - the step "*" matches every value of a map or array (in the stored order)
+// - "~0", "~1" and "~2" in steps stand for '~', '/' and '*' (as in JSON pointers, plus the wildcard)
+// - the string map keys are looked up with key handles, which are modified by the lookups, ..
+// .. so each thread needs its own path (copies are compiled again and do not share the handles)
+// - the handles are resolved again in each document (see Reader::GetDocumentId), so one path ..
+// .. can be evaluated with any number of documents, including ones that reuse the same buffer
+template <class R = Reader> struct BasicPath
+{
+	typedef typename R::Pos Pos;
+	typedef typename R::KeyHandle KeyHandle;
+	typedef typename R::DynamicAccessor DynamicAccessor;
+	typedef BasicPathCache<R> PathCache;
+
+	struct Step
+	{
+		KeyHandle key; // (`str` points to `_keys`)
+		u32 index;
+		bool isIndex;
+		bool isWildcard;
+		size_t prefixLength; // the length of the path text up to the end of this step
+		u32 prefixHash;
+	};
+
+	std::string _path; // the text without the leading '/'
+	std::string _keys; // the unescaped keys, each followed by a 0 byte
+	std::vector<Step> _steps;
+	size_t _numLiteralSteps = 0; // the steps before the first wildcard
+
+	BasicPath() {}
+	explicit BasicPath(const char* path) { Compile(path); }
+	BasicPath(const BasicPath& o) { Compile(o._path.c_str()); }
+	BasicPath& operator = (const BasicPath& o)
+	{
+		if (this != &o)
+			Compile(o._path.c_str());
+		return *this;
+	}
+
+	// returns false (and leaves the path empty) if the path contains an invalid escape sequence
+	bool Compile(const char* path)
+	{
+		_path.clear();
+		_keys.clear();
+		_steps.clear();
+		_numLiteralSteps = 0;
+		if (*path == '/')
+			path++;
+		if (!*path)
+			return true;
+
+		_path = path;
+		std::vector<size_t> keyOffsets;
+		size_t begin = 0;
+		for (;;)
+		{
+			size_t end = _path.find('/', begin);
+			if (end == std::string::npos)
+				end = _path.size();
+
+			Step st {};
+			st.prefixLength = end;
+			st.prefixHash = KeyHash(_path.data(), end);
+			keyOffsets.push_back(_keys.size());
+			if (end - begin == 1 && _path[begin] == '*')
+				st.isWildcard = true;
+			for (size_t i = begin; i < end; i++)
+			{
+				char c = _path[i];
+				if (c == '~')
+				{
+					c = ++i < end ? _path[i] : 0;
+					if (c < '0' || c > '2')
+					{
+						Compile("");
+						return false;
+					}
+					c = "~/*"[c - '0'];
+				}
+				_keys.push_back(c);
+			}
+			st.key.len = _keys.size() - keyOffsets.back();
+			_keys.push_back('\0');
+			st.isIndex = _ParseIndex(_keys.data() + keyOffsets.back(), st.key.len, st.index);
+			_steps.push_back(st);
+
+			if (end == _path.size())
+				break;
+			begin = end + 1;
+		}
+
+		// the key buffer does not change after this
+		for (size_t s = 0; s < _steps.size(); s++)
+		{
+			KeyHandle& key = _steps[s].key;
+			key.str = _keys.data() + keyOffsets[s];
+			key.hash = KeyHash(key.str, key.len);
+			key.pos = 0;
+			key.document = 0;
+		}
+		while (_numLiteralSteps < _steps.size() && !_steps[_numLiteralSteps].isWildcard)
+			_numLiteralSteps++;
+		return true;
+	}
+
+	size_t GetStepCount() const { return _steps.size(); }
+	bool HasWildcards() const { return _numLiteralSteps < _steps.size(); }
+
+	// the first value at the path (in the stored order if there are wildcards), or an empty value
+	DynamicAccessor Find(const DynamicAccessor& from)
+	{
+		DynamicAccessor v = _FindLiteral(from);
+		return v && HasWildcards() ? _FindFirst(v) : v;
+	}
+	DynamicAccessor Find(const R& r) { return Find(r.GetRoot()); }
+	// reuses (and stores) the values of the longest prefix of the path that does not have wildcards
+	DynamicAccessor Find(const R& r, PathCache& cache)
+	{
+		cache._SetDocument(r);
+		size_t s = _numLiteralSteps;
+		DynamicAccessor v;
+		for (; s > 0; s--)
+		{
+			const Step& st = _steps[s - 1];
+			if (auto* e = cache._Find(st.prefixHash, _path.data(), st.prefixLength))
+			{
+				v = DynamicAccessor(&r, e->pos, e->type);
+				break;
+			}
+		}
+		if (s == 0)
+			v = r.GetRoot();
+		for (; s < _numLiteralSteps && v; s++)
+		{
+			Step& st = _steps[s];
+			v = _Step(v, st);
+			if (v)
+				cache._Store(st.prefixHash, _path.data(), st.prefixLength, v._pos, v._type);
+		}
+		return v && HasWildcards() ? _FindFirst(v) : v;
+	}
+
+	// calls `fn(const DynamicAccessor&)` for each value at the path, returns the number of values
+	template <class F> size_t ForEach(const DynamicAccessor& from, F&& fn)
+	{
+		DynamicAccessor v = _FindLiteral(from);
+		if (!v)
+			return 0;
+		size_t n = 0;
+		_Walk(v, _numLiteralSteps, [&n, &fn](const DynamicAccessor& found)
+		{
+			fn(found);
+			n++;
+			return true;
+		});
+		return n;
+	}
+	template <class F> size_t ForEach(const R& r, F&& fn) { return ForEach(r.GetRoot(), fn); }
+	size_t FindAll(const DynamicAccessor& from, std::vector<DynamicAccessor>& out)
+	{
+		return ForEach(from, [&out](const DynamicAccessor& v) { out.push_back(v); });
+	}
+	size_t FindAll(const R& r, std::vector<DynamicAccessor>& out) { return FindAll(r.GetRoot(), out); }
+
+	// finds the first value at the path for each of `count` documents or values (empty if not found), ..
+	// .. returns the number of values found
+	// - the steps are applied to all of them in turn, loading the next values ahead of the lookups
+	size_t FindInEach(const R* docs, size_t count, DynamicAccessor* out)
+	{
+		for (size_t i = 0; i < count; i++)
+			out[i] = docs[i].GetRoot();
+		return _FindInEach(out, count);
+	}
+	size_t FindInEach(const DynamicAccessor* from, size_t count, DynamicAccessor* out)
+	{
+		for (size_t i = 0; i < count; i++)
+			out[i] = from[i];
+		return _FindInEach(out, count);
+	}
+
+	static bool _ParseIndex(const char* str, size_t len, u32& out)
+	{
+		if (len == 0 || len > 10 || (len > 1 && str[0] == '0'))
+			return false;
+		u64 v = 0;
+		for (size_t i = 0; i < len; i++)
+		{
+			if (str[i] < '0' || str[i] > '9')
+				return false;
+			v = v * 10 + u64(str[i] - '0');
+		}
+		if (v > 0xffffffffU)
+			return false;
+		out = u32(v);
+		return true;
+	}
+
+	static DynamicAccessor _Step(const DynamicAccessor& v, Step& st)
+	{
+		switch (v.GetType())
+		{
+		case TYPE_StringMap:
+		case TYPE_StringHashMap:
+			return v.AsStringMap().FindValueByKey(st.key);
+		case TYPE_IntMap:
+			if (st.isIndex)
+				return v.AsIntMap().FindValueByKey(st.index);
+			break;
+		case TYPE_Array:
+			if (st.isIndex)
+			{
+				auto arr = v.AsArray();
+				if (st.index < arr.GetSize())
+					return arr.GetValueByIndex(st.index);
+			}
+			break;
+		}
+		return {};
+	}
+
+	DynamicAccessor _FindLiteral(DynamicAccessor v)
+	{
+		for (size_t s = 0; s < _numLiteralSteps && v; s++)
+			v = _Step(v, _steps[s]);
+		return v;
+	}
+
+	// the first value at the steps after the literal prefix (found at `v`)
+	DynamicAccessor _FindFirst(const DynamicAccessor& v)
+	{
+		DynamicAccessor ret;
+		_Walk(v, _numLiteralSteps, [&ret](const DynamicAccessor& found)
+		{
+			ret = found;
+			return false;
+		});
+		return ret;
+	}
+
+	// calls `fn` for each value at the steps from `s` until it returns false (which is then returned)
+	template <class F> bool _Walk(const DynamicAccessor& v, size_t s, const F& fn)
+	{
+		if (s == _steps.size())
+			return fn(v);
+		Step& st = _steps[s];
+		if (!st.isWildcard)
+		{
+			DynamicAccessor next = _Step(v, st);
+			return !next || _Walk(next, s + 1, fn);
+		}
+		switch (v.GetType())
+		{
+		case TYPE_StringMap:
+		case TYPE_StringHashMap:
+			for (auto e : v.AsStringMap())
+				if (!_Walk(e.GetValue(), s + 1, fn))
+					return false;
+			break;
+		case TYPE_IntMap:
+			for (auto e : v.AsIntMap())
+				if (!_Walk(e.GetValue(), s + 1, fn))
+					return false;
+			break;
+		case TYPE_Array:
+			for (auto e : v.AsArray())
+				if (!_Walk(e, s + 1, fn))
+					return false;
+			break;
+		}
+		return true;
+	}
+
+	size_t _FindInEach(DynamicAccessor* vals, size_t count)
+	{
+		for (size_t s = 0; s < _numLiteralSteps; s++)
+		{
+			Step& st = _steps[s];
+			for (size_t i = 0; i < count; i++)
+			{
+				if (i + PATH_BatchPrefetch < count)
+				{
+					const DynamicAccessor& ahead = vals[i + PATH_BatchPrefetch];
+					if (ahead)
+						DATO_PREFETCH(ahead._r->GetData() + ahead._pos);
+				}
+				if (vals[i])
+					vals[i] = _Step(vals[i], st);
+			}
+		}
+		size_t numFound = 0;
+		for (size_t i = 0; i < count; i++)
+		{
+			if (vals[i] && HasWildcards())
+				vals[i] = _FindFirst(vals[i]);
+			numFound += vals[i].IsValid();
+		}
+		return numFound;
+	}
+};
+
+using PathCache = BasicPathCache<>;
+using Path = BasicPath<>;
+
+} // dato
+
+/*
+This software is available under 2 licenses:
+-------------------------------------------------------------------------------
+OPTION 1: MIT License
+
+Copyright (c) 2023 Arvīds Kokins
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the “Software”), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+of the Software, and to permit persons to whom the Software is furnished to do
+so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+-------------------------------------------------------------------------------
+OPTION 2: Unlicense
+
+This is free and unencumbered software released into the public domain.
+
+Anyone is free to copy, modify, publish, use, compile, sell, or
+distribute this software, either in source code form or as a compiled
+binary, for any purpose, commercial or non-commercial, and by any
+means.
+
+In jurisdictions that recognize copyright laws, the author or authors
+of this software dedicate any and all copyright interest in the
+software to the public domain. We make this dedication for the benefit
+of the public at large and to the detriment of our heirs and
+successors. We intend this dedication to be an overt act of
+relinquishment in perpetuity of all present and future rights to this
+software under copyright law.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+OTHER DEALINGS IN THE SOFTWARE.
+
+For more information, please refer to <http://unlicense.org/>
+*/
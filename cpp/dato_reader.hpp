@@ -7,6 +7,25 @@
 #if !defined(DATO_MEMCPY) || !defined(DATO_MEMCMP) || !defined(DATO_STRCMP)
 #  include <string.h>
 #endif
+#include <stddef.h>
+#include <atomic>
+
+#if !defined(DATO_MALLOC) || !defined(DATO_REALLOC) || !defined(DATO_FREE)
+#  include <malloc.h>
+#  define DATO_MALLOC malloc
+#  define DATO_REALLOC realloc
+#  define DATO_FREE free
+#endif
+
+// whether to declare the standard iterator categories on accessor iterators (for STL algorithms and ranges)
+// - requires the <iterator> header, which can be disabled if compilation time matters more
+#ifndef DATO_STD_ITERATORS
+#  define DATO_STD_ITERATORS 1
+#endif
+
+#if DATO_STD_ITERATORS
+#  include <iterator>
+#endif
 
 // validation - triggers a code breakpoint when hitting the failure condition
 
@@ -44,16 +63,55 @@
 #  define DATO_CONFIG 0
 #endif
 
+// whether to search int map keys with SIMD instructions (SSE2, and AVX2/AVX-512 if supported by the CPU)
+#ifndef DATO_SIMD
+#  if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#    define DATO_SIMD 1
+#  else
+#    define DATO_SIMD 0
+#  endif
+#endif
+
+#if DATO_SIMD
+#  include <immintrin.h>
+#  ifdef _MSC_VER
+#    include <intrin.h>
+#  endif
+#endif
+
+#ifndef _MSC_VER
+#  define DATO_PREFETCH(p) __builtin_prefetch(p)
+#elif DATO_SIMD
+#  define DATO_PREFETCH(p) _mm_prefetch((const char*) (p), _MM_HINT_T0)
+#else
+#  define DATO_PREFETCH(p)
+#endif
+
+// the error flag of the reader may be set by accessors that are used on several threads at once
+#ifndef _MSC_VER
+#  define DATO_SET_FLAG(x) __atomic_store_n(&(x), true, __ATOMIC_RELAXED)
+#  define DATO_GET_FLAG(x) __atomic_load_n(&(x), __ATOMIC_RELAXED)
+#else
+#  define DATO_SET_FLAG(x) (*(volatile bool*) &(x) = true)
+#  define DATO_GET_FLAG(x) (*(const volatile bool*) &(x))
+#endif
+
 
 #ifdef _MSC_VER
 #  define DATO_FORCEINLINE __forceinline
 #  define DATO_NOINLINE __declspec(noinline)
+#  define DATO_UNLIKELY(x) (x)
+#  define DATO_TARGET(x)
 extern "C" void __ud2(void);
-#  pragma intrinsic(__ud2)
+extern "C" unsigned char _BitScanForward(unsigned long*, unsigned long);
+extern "C" unsigned char _BitScanReverse(unsigned long*, unsigned long);
+#  pragma intrinsic(__ud2, _BitScanForward, _BitScanReverse)
 #  define DATO_CRASH _dato_error()
 #else
 #  define DATO_FORCEINLINE inline __attribute__((always_inline))
 #  define DATO_NOINLINE __attribute__((noinline))
+#  define DATO_UNLIKELY(x) __builtin_expect(!!(x), 0)
+#  define DATO_TARGET(x) __attribute__((target(x)))
 #  define DATO_CRASH __builtin_trap()
 #endif
 
@@ -104,6 +162,8 @@ static const u8 TYPE_String32 = 13; // UTF-32
 static const u8 TYPE_ByteArray = 14;
 static const u8 TYPE_Vector = 15;
 static const u8 TYPE_VectorArray = 16;
+// - indexed containers
+static const u8 TYPE_StringHashMap = 17; // a string map followed by a hash table of its keys
 
 static const u8 SUBTYPE_S8 = 0;
 static const u8 SUBTYPE_U8 = 1;
@@ -130,6 +190,11 @@ template <> struct SubtypeInfo<f64> { enum { Subtype = SUBTYPE_F64 }; };
 
 static const u8 FLAG_Aligned = 1 << 0;
 static const u8 FLAG_SortedKeys = 1 << 1;
+// int maps with at least EYTZINGER_MinSize entries are stored in Eytzinger order (requires FLAG_SortedKeys)
+static const u8 FLAG_EytzingerIntMaps = 1 << 2;
+static const u32 EYTZINGER_MinSize = 256;
+// every key string is stored once (the keys of all maps with the same content refer to the same position)
+static const u8 FLAG_UniqueKeys = 1 << 3;
 
 #ifndef DATO_MEMCPY
 #  define DATO_MEMCPY memcpy
@@ -142,6 +207,7 @@ static const u8 FLAG_SortedKeys = 1 << 1;
 // override this if you're adding inline types
 #ifndef DATO_IS_REFERENCE_TYPE
 #define DATO_IS_REFERENCE_TYPE(t) ((t) >= TYPE_S64)
+#define DATO_DEFAULT_REFERENCE_TYPES // (the SIMD slot decoding depends on it)
 #endif
 
 DATO_FORCEINLINE bool IsReferenceType(u8 t)
@@ -149,11 +215,87 @@ DATO_FORCEINLINE bool IsReferenceType(u8 t)
 	return DATO_IS_REFERENCE_TYPE(t);
 }
 
-inline u32 RoundUp(u32 x, u32 n)
+// whether the reference `val` (stored relative to `origin`) of a container starting at `start` points strictly before it
+// - self-references would make recursive iteration loop forever
+template <class Pos> DATO_FORCEINLINE bool IsBackReference(Pos start, Pos origin, Pos val)
+{
+	return val - (origin - start) - 1 < start;
+}
+
+template <class T> inline T RoundUp(T x, u32 n)
 {
 	return (x + n - 1) / n * n;
 }
 
+// `v` must not be 0
+DATO_FORCEINLINE u32 CountTrailingZeroes(u32 v)
+{
+#ifdef _MSC_VER
+	unsigned long i;
+	_BitScanForward(&i, v);
+	return u32(i);
+#else
+	return u32(__builtin_ctz(v));
+#endif
+}
+DATO_FORCEINLINE u32 FloorLog2(u32 v)
+{
+#ifdef _MSC_VER
+	unsigned long i;
+	_BitScanReverse(&i, v);
+	return u32(i);
+#else
+	return u32(31 - __builtin_clz(v));
+#endif
+}
+
+// Eytzinger (BFS) order of `n` sorted keys: the children of slot s are 2s+1 and 2s+2
+// - returns the slot of the key with the sorted index `rank`
+inline u32 EytzingerSlotFromRank(u32 rank, u32 n)
+{
+	u32 h = FloorLog2(n) + 1; // the number of levels
+	u32 m = n - ((1U << (h - 1)) - 1); // the number of nodes on the last level
+	// the rank in a perfect tree with h levels (skipping the missing nodes on the last level)
+	u32 r = rank < 2 * m ? rank : 2 * rank - (2 * m - 1);
+	u32 t = CountTrailingZeroes(r + 1); // the height of the node
+	return (1U << (h - 1 - t)) + ((r + 1) >> (t + 1)) - 1;
+}
+
+// string hash maps: the hash of a key is FNV-1a (32-bit) of its bytes (excluding the 0-terminator)
+inline u32 KeyHash(const void* mem, size_t len)
+{
+	const u8* p = (const u8*) mem;
+	u32 hash = 0x811c9dc5;
+	for (size_t i = 0; i < len; i++)
+	{
+		hash ^= p[i];
+		hash *= 0x01000193;
+	}
+	return hash;
+}
+// the fingerprint stored in a hash table bucket (0 marks empty buckets)
+DATO_FORCEINLINE u8 KeyHashFingerprint(u32 hash)
+{
+	u8 fp = u8(hash >> 24);
+	return fp ? fp : 1;
+}
+// the number of buckets for `size` keys (a power of 2, at most 2/3 full, at least one empty)
+inline u64 HashMapBucketCount(u64 size)
+{
+	u64 n = 1;
+	while (n < size + size / 2 + 1)
+		n *= 2;
+	return n;
+}
+
+// a new value on each call (unique in the process), identifies documents in memory that may be reused ..
+// .. for other documents (buffers, readers and writers at the same address)
+inline u64 NewDocumentId()
+{
+	static std::atomic<u64> next { 1 };
+	return next.fetch_add(1, std::memory_order_relaxed);
+}
+
 #endif // DATO_COMMON_DEFS
 
 #ifndef DATO_STRCMP
@@ -180,6 +322,42 @@ template <> DATO_FORCEINLINE signed char ReadT(const void* ptr) { return *(const
 template <> DATO_FORCEINLINE unsigned char ReadT(const void* ptr) { return *(const unsigned char*)ptr; }
 #endif
 
+// random access iterator operators for iterators (It) that implement `operator *` (returning V by value),
+// `_Advance(n)` and `_Distance(o)` (the number of steps from `o` to this iterator)
+template <class It, class V> struct RandomAccessIteratorBase
+{
+	typedef V value_type;
+	typedef V reference; // elements are returned by value
+	typedef void pointer;
+	typedef ptrdiff_t difference_type;
+#if DATO_STD_ITERATORS
+	typedef std::random_access_iterator_tag iterator_category;
+	typedef std::random_access_iterator_tag iterator_concept;
+#endif
+
+	DATO_FORCEINLINE It& _Self() { return static_cast<It&>(*this); }
+	DATO_FORCEINLINE const It& _Self() const { return static_cast<const It&>(*this); }
+
+	DATO_FORCEINLINE It& operator ++ () { _Self()._Advance(1); return _Self(); }
+	DATO_FORCEINLINE It& operator -- () { _Self()._Advance(-1); return _Self(); }
+	DATO_FORCEINLINE It operator ++ (int) { It t = _Self(); _Self()._Advance(1); return t; }
+	DATO_FORCEINLINE It operator -- (int) { It t = _Self(); _Self()._Advance(-1); return t; }
+	DATO_FORCEINLINE It& operator += (ptrdiff_t n) { _Self()._Advance(n); return _Self(); }
+	DATO_FORCEINLINE It& operator -= (ptrdiff_t n) { _Self()._Advance(-n); return _Self(); }
+	DATO_FORCEINLINE It operator + (ptrdiff_t n) const { It t = _Self(); t._Advance(n); return t; }
+	DATO_FORCEINLINE It operator - (ptrdiff_t n) const { It t = _Self(); t._Advance(-n); return t; }
+	DATO_FORCEINLINE friend It operator + (ptrdiff_t n, const It& it) { return it + n; }
+	DATO_FORCEINLINE ptrdiff_t operator - (const It& o) const { return _Self()._Distance(o); }
+	DATO_FORCEINLINE V operator [] (ptrdiff_t n) const { return *(_Self() + n); }
+
+	DATO_FORCEINLINE bool operator == (const It& o) const { return _Self()._Distance(o) == 0; }
+	DATO_FORCEINLINE bool operator != (const It& o) const { return _Self()._Distance(o) != 0; }
+	DATO_FORCEINLINE bool operator < (const It& o) const { return _Self()._Distance(o) < 0; }
+	DATO_FORCEINLINE bool operator > (const It& o) const { return _Self()._Distance(o) > 0; }
+	DATO_FORCEINLINE bool operator <= (const It& o) const { return _Self()._Distance(o) <= 0; }
+	DATO_FORCEINLINE bool operator >= (const It& o) const { return _Self()._Distance(o) >= 0; }
+};
+
 inline u32 SubtypeGetSize(u8 subtype)
 {
 	switch (subtype)
@@ -198,93 +376,463 @@ inline u32 SubtypeGetSize(u8 subtype)
 	}
 }
 
-#define DATO_READSIZE_ARGS const char* data, u32 len, u32& pos
+// u32 key search (for int maps with 4-byte slots)
+// - returns the index of the first `key` in `count` consecutive keys at `keys`, or `count` if not found
+typedef u32 FindKeyU32Func(const char* keys, u32 count, u32 key);
+
+inline u32 FindKeyU32_Scalar(const char* keys, u32 count, u32 key)
+{
+	for (u32 i = 0; i < count; i++)
+		if (ReadT<u32>(keys + i * 4) == key)
+			return i;
+	return count;
+}
+
+#if DATO_SIMD
+inline u32 FindKeyU32_SSE2(const char* keys, u32 count, u32 key)
+{
+	__m128i vkey = _mm_set1_epi32(int(key));
+	u32 i = 0;
+	for (; i + 4 <= count; i += 4)
+	{
+		__m128i v = _mm_loadu_si128((const __m128i*) (keys + i * 4));
+		if (int mask = _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(v, vkey))))
+			return i + CountTrailingZeroes(u32(mask));
+	}
+	return i + FindKeyU32_Scalar(keys + i * 4, count - i, key);
+}
+
+DATO_TARGET("avx2") inline u32 FindKeyU32_AVX2(const char* keys, u32 count, u32 key)
+{
+	__m256i vkey = _mm256_set1_epi32(int(key));
+	u32 i = 0;
+	for (; i + 8 <= count; i += 8)
+	{
+		__m256i v = _mm256_loadu_si256((const __m256i*) (keys + i * 4));
+		if (int mask = _mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpeq_epi32(v, vkey))))
+			return i + CountTrailingZeroes(u32(mask));
+	}
+	return i + FindKeyU32_SSE2(keys + i * 4, count - i, key);
+}
+
+DATO_TARGET("avx512f") inline u32 FindKeyU32_AVX512(const char* keys, u32 count, u32 key)
+{
+	__m512i vkey = _mm512_set1_epi32(int(key));
+	for (u32 i = 0; i < count; i += 16)
+	{
+		// the last (partial) block is loaded with a mask, without touching the memory after the keys
+		u32 left = count - i;
+		__mmask16 load = left >= 16 ? __mmask16(0xffff) : __mmask16((1U << left) - 1);
+		__m512i v = _mm512_maskz_loadu_epi32(load, keys + i * 4);
+		if (u32 mask = _mm512_mask_cmpeq_epi32_mask(load, v, vkey))
+			return i + CountTrailingZeroes(mask);
+	}
+	return count;
+}
+
+static const u32 SIMD_SSE2 = 0;
+static const u32 SIMD_AVX2 = 1;
+static const u32 SIMD_AVX512 = 2;
+
+// the widest instruction set supported by the CPU and the OS
+inline u32 _DetectSIMD()
+{
+#ifdef _MSC_VER
+	int info[4];
+	__cpuid(info, 0);
+	if (info[0] < 7)
+		return SIMD_SSE2;
+	__cpuid(info, 1);
+	bool osxsave = (info[2] & (1 << 27)) != 0;
+	u64 xcr0 = osxsave ? _xgetbv(0) : 0;
+	__cpuidex(info, 7, 0);
+	if ((info[1] & (1 << 16)) && (xcr0 & 0xe6) == 0xe6)
+		return SIMD_AVX512;
+	if ((info[1] & (1 << 5)) && (xcr0 & 0x6) == 0x6)
+		return SIMD_AVX2;
+#else
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx512f"))
+		return SIMD_AVX512;
+	if (__builtin_cpu_supports("avx2"))
+		return SIMD_AVX2;
+#endif
+	return SIMD_SSE2;
+}
+
+inline FindKeyU32Func* _SelectFindKeyU32()
+{
+	switch (_DetectSIMD())
+	{
+	case SIMD_AVX512: return FindKeyU32_AVX512;
+	case SIMD_AVX2: return FindKeyU32_AVX2;
+	default: return FindKeyU32_SSE2;
+	}
+}
+#endif // DATO_SIMD
+
+// the widest key search supported by the CPU (selected on first use)
+inline FindKeyU32Func* GetFindKeyU32()
+{
+#if DATO_SIMD
+	static FindKeyU32Func* const fn = _SelectFindKeyU32();
+	return fn;
+#else
+	return FindKeyU32_Scalar;
+#endif
+}
+
+// value slot decoding (for bulk access to the values of arrays and maps)
+// - writes the embedded values and the absolute positions of the references (`origin` - the stored value) ..
+// .. of `count` consecutive slots at `vals` (with their types at `types`) to `out`
+// - returns whether all of the references point strictly before `start` (the position of the container, see IsBackReference)
+template <class Pos> inline bool DecodeValueSlots_Scalar(const char* vals, const u8* types, Pos start, Pos origin, u32 count, Pos* out)
+{
+	bool ok = true;
+	for (u32 i = 0; i < count; i++)
+	{
+		Pos val = ReadT<Pos>(vals + i * sizeof(Pos));
+		if (IsReferenceType(types[i]))
+		{
+			ok &= IsBackReference(start, origin, val);
+			val = origin - val;
+		}
+		out[i] = val;
+	}
+	return ok;
+}
+
+typedef bool DecodeValueSlotsU32Func(const char* vals, const u8* types, u32 start, u32 origin, u32 count, u32* out);
+
+#if DATO_SIMD && defined(DATO_DEFAULT_REFERENCE_TYPES)
+// (the references are the types after TYPE_F32, and `val - (origin - start) - 1 < start` is compared with the sign bits flipped)
+inline bool DecodeValueSlotsU32_SSE2(const char* vals, const u8* types, u32 start, u32 origin, u32 count, u32* out)
+{
+	__m128i vzero = _mm_setzero_si128();
+	__m128i vsign = _mm_set1_epi32(int(0x80000000));
+	__m128i vskip = _mm_set1_epi32(int(origin - start + 1));
+	__m128i vorigin = _mm_set1_epi32(int(origin));
+	__m128i vlimit = _mm_set1_epi32(int(start ^ 0x80000000u));
+	__m128i vlastEmbedded = _mm_set1_epi32(TYPE_F32);
+	__m128i vbad = vzero;
+	u32 i = 0;
+	for (; i + 16 <= count; i += 16)
+	{
+		__m128i t8 = _mm_loadu_si128((const __m128i*) (types + i));
+		__m128i t16lo = _mm_unpacklo_epi8(t8, vzero);
+		__m128i t16hi = _mm_unpackhi_epi8(t8, vzero);
+		__m128i t32[4] =
+		{
+			_mm_unpacklo_epi16(t16lo, vzero),
+			_mm_unpackhi_epi16(t16lo, vzero),
+			_mm_unpacklo_epi16(t16hi, vzero),
+			_mm_unpackhi_epi16(t16hi, vzero),
+		};
+		for (u32 j = 0; j < 4; j++)
+		{
+			__m128i v = _mm_loadu_si128((const __m128i*) (vals + (i + j * 4) * 4));
+			__m128i isRef = _mm_cmpgt_epi32(t32[j], vlastEmbedded);
+			__m128i backwards = _mm_cmplt_epi32(_mm_xor_si128(_mm_sub_epi32(v, vskip), vsign), vlimit);
+			vbad = _mm_or_si128(vbad, _mm_andnot_si128(backwards, isRef));
+			__m128i resolved = _mm_sub_epi32(vorigin, v);
+			_mm_storeu_si128((__m128i*) (out + i + j * 4),
+				_mm_or_si128(_mm_and_si128(isRef, resolved), _mm_andnot_si128(isRef, v)));
+		}
+	}
+	bool ok = _mm_movemask_epi8(vbad) == 0;
+	return DecodeValueSlots_Scalar<u32>(vals + i * 4, types + i, start, origin, count - i, out + i) && ok;
+}
+
+DATO_TARGET("avx2") inline bool DecodeValueSlotsU32_AVX2(const char* vals, const u8* types, u32 start, u32 origin, u32 count, u32* out)
+{
+	__m256i vsign = _mm256_set1_epi32(int(0x80000000));
+	__m256i vskip = _mm256_set1_epi32(int(origin - start + 1));
+	__m256i vorigin = _mm256_set1_epi32(int(origin));
+	__m256i vlimit = _mm256_set1_epi32(int(start ^ 0x80000000u));
+	__m256i vlastEmbedded = _mm256_set1_epi32(TYPE_F32);
+	__m256i vbad = _mm256_setzero_si256();
+	u32 i = 0;
+	for (; i + 32 <= count; i += 32)
+	{
+		for (u32 j = 0; j < 32; j += 8)
+		{
+			__m256i t = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i*) (types + i + j)));
+			__m256i v = _mm256_loadu_si256((const __m256i*) (vals + (i + j) * 4));
+			__m256i isRef = _mm256_cmpgt_epi32(t, vlastEmbedded);
+			__m256i backwards = _mm256_cmpgt_epi32(vlimit, _mm256_xor_si256(_mm256_sub_epi32(v, vskip), vsign));
+			vbad = _mm256_or_si256(vbad, _mm256_andnot_si256(backwards, isRef));
+			_mm256_storeu_si256((__m256i*) (out + i + j), _mm256_blendv_epi8(v, _mm256_sub_epi32(vorigin, v), isRef));
+		}
+	}
+	bool ok = _mm256_testz_si256(vbad, vbad) != 0;
+	return DecodeValueSlotsU32_SSE2(vals + i * 4, types + i, start, origin, count - i, out + i) && ok;
+}
+#endif
+
+// the widest slot decoding supported by the CPU (selected on first use)
+inline DecodeValueSlotsU32Func* GetDecodeValueSlotsU32()
+{
+#if DATO_SIMD && defined(DATO_DEFAULT_REFERENCE_TYPES)
+	static DecodeValueSlotsU32Func* const fn =
+		_DetectSIMD() >= SIMD_AVX2 ? DecodeValueSlotsU32_AVX2 : DecodeValueSlotsU32_SSE2;
+	return fn;
+#else
+	return DecodeValueSlots_Scalar<u32>;
+#endif
+}
+
+// branchless binary search in sorted keys, until at most `maxLeft` keys are left
+// - returns the start of the range, `n` is set to its size and the first key >= `key` is in [start, start + n]
+template <u32 Stride> DATO_FORCEINLINE u32 NarrowSortedKeysU32(const char* keys, u32& n, u32 key, u32 maxLeft)
+{
+	u32 base = 0;
+	while (n > maxLeft)
+	{
+		u32 half = n / 2;
+		DATO_PREFETCH(keys + (base + half / 2) * Stride);
+		DATO_PREFETCH(keys + (base + half + half / 2) * Stride);
+		base = ReadT<u32>(keys + (base + half) * Stride) < key ? base + half : base;
+		n -= half;
+	}
+	return base;
+}
+
+// sorted keys: binary search down to a block of 2 cache lines, then a linear search
+// - (SIMD linear search is faster than binary search for up to ~100 keys)
+static const u32 KEYSEARCH_LinearMax = 32;
+inline u32 FindKeyU32_Sorted(FindKeyU32Func* find, const char* keys, u32 count, u32 key)
+{
+	u32 n = count;
+	u32 base = NarrowSortedKeysU32<4>(keys, n, key, KEYSEARCH_LinearMax);
+	if (n < count - base)
+		n++;
+	u32 i = base + find(keys + base * 4, n, key);
+	return i < base + n ? i : count;
+}
+
+// sorted keys: finds a query with `cmp(i)` (comparing the query to the key i: <0, 0, >0), returns `count` if not found
+// - gallops forward from `next` (the position after the previous query), so that ascending queries walk the ..
+// .. keys once, with one comparison for each query that matches the next key
+// - queries before `next` (unsorted queries) are found with a binary search of the preceding keys
+template <class P, class Cmp> DATO_FORCEINLINE P GallopSortedKeys(P count, P& next, Cmp&& cmp)
+{
+	P L = 0, R = count;
+	if (next < count)
+	{
+		int diff = cmp(next);
+		if (diff == 0)
+			return next++;
+		if (diff < 0)
+			R = next;
+		else
+		{
+			P prev = next, step = 1;
+			for (;;)
+			{
+				P probe = prev + step;
+				if (probe >= count)
+				{
+					L = prev + 1;
+					break;
+				}
+				diff = cmp(probe);
+				if (diff == 0)
+				{
+					next = probe + 1;
+					return probe;
+				}
+				if (diff < 0)
+				{
+					L = prev + 1;
+					R = probe;
+					break;
+				}
+				prev = probe;
+				step *= 2;
+			}
+		}
+	}
+	while (L < R)
+	{
+		P M = (L + R) / 2;
+		int diff = cmp(M);
+		if (diff == 0)
+		{
+			next = M + 1;
+			return M;
+		}
+		if (diff < 0)
+			R = M;
+		else
+			L = M + 1;
+	}
+	next = L;
+	return count;
+}
+
+// keys in Eytzinger order (see EytzingerSlotFromRank), returns the slot of `key` or `count` if not found
+template <u32 Stride> inline u32 FindKeyU32_Eytzinger(const char* keys, u32 count, u32 key)
+{
+	const u32 perLine = 64 / Stride; // the descendants of slot s, log2(perLine) levels down, share a cache line
+	u32 k = 1; // (1-based)
+	while (k <= count)
+	{
+		if (k * perLine <= count)
+			DATO_PREFETCH(keys + (k * perLine - 1) * Stride);
+		k = 2 * k + (ReadT<u32>(keys + (k - 1) * Stride) < key);
+	}
+	// undo the right turns after the last left turn to get the first key >= `key`
+	k >>= CountTrailingZeroes(~k) + 1;
+	if (k == 0 || ReadT<u32>(keys + (k - 1) * Stride) != key)
+		return count;
+	return k - 1;
+}
+
+#define DATO_READSIZE_ARGS const char* data, Pos len, Pos& pos
 #define DATO_READSIZE_PASS data, len, pos
+// for the size reader templates, Pos is deduced from `pos` only, so `len` can be any integer
+template <class T> struct NonDeduced { typedef T Type; };
+template <bool C, class A, class B> struct SelectType { typedef A Type; };
+template <class A, class B> struct SelectType<false, A, B> { typedef B Type; };
+#define DATO_READSIZE_TARGS const char* data, typename NonDeduced<Pos>::Type len, Pos& pos
+
+// overflow-safe check for whether `n` bytes can be read at `pos`
+template <class Pos> DATO_FORCEINLINE bool HasBytesAt(Pos len, Pos pos, u32 n)
+{
+	if (sizeof(Pos) == 4) // cannot overflow in 64-bit math
+		return u64(pos) + n <= len;
+	return pos <= len && len - pos >= n;
+}
 
-inline u32 ReadSizeU8(DATO_READSIZE_ARGS)
+// if the size itself does not fit in the buffer, the size readers return ~Pos(0) (all bits set)
+// (every size read is followed by a range check that this value is guaranteed to fail)
+
+template <bool Checked = DATO_VALIDATE_BUFFERS != 0, class Pos = u32>
+inline Pos ReadSizeU8(DATO_READSIZE_TARGS)
 {
 	(void)len;
-	DATO_BUFFER_EXPECT(pos + 1 <= len);
+	if (Checked && !HasBytesAt(len, pos, 1))
+		return ~Pos(0);
 	return u8(data[pos++]);
 }
 
-inline u32 ReadSizeU16(DATO_READSIZE_ARGS)
+template <bool Checked = DATO_VALIDATE_BUFFERS != 0, class Pos = u32>
+inline Pos ReadSizeU16(DATO_READSIZE_TARGS)
 {
 	(void)len;
-	DATO_BUFFER_EXPECT(pos + 2 <= len);
-	u32 v = ReadT<u16>(data + pos);
+	if (Checked && !HasBytesAt(len, pos, 2))
+		return ~Pos(0);
+	Pos v = ReadT<u16>(data + pos);
 	pos += 2;
 	return v;
 }
 
-inline u32 ReadSizeU32(DATO_READSIZE_ARGS)
+template <bool Checked = DATO_VALIDATE_BUFFERS != 0, class Pos = u32>
+inline Pos ReadSizeU32(DATO_READSIZE_TARGS)
 {
 	(void)len;
-	DATO_BUFFER_EXPECT(pos + 4 <= len);
-	u32 v = ReadT<u32>(data + pos);
+	if (Checked && !HasBytesAt(len, pos, 4))
+		return ~Pos(0);
+	Pos v = ReadT<u32>(data + pos);
 	pos += 4;
 	return v;
 }
 
-inline u32 ReadSizeU8X32(DATO_READSIZE_ARGS)
+template <bool Checked = DATO_VALIDATE_BUFFERS != 0, class Pos = u32>
+inline Pos ReadSizeU8X32(DATO_READSIZE_TARGS)
 {
 	(void)len;
-	DATO_BUFFER_EXPECT(pos + 1 <= len);
-	u32 v = u8(data[pos++]);
+	if (Checked && !HasBytesAt(len, pos, 1))
+		return ~Pos(0);
+	Pos v = u8(data[pos++]);
 	if (v == 255)
 	{
-		DATO_BUFFER_EXPECT(pos + 4 <= len);
+		if (Checked && !HasBytesAt(len, pos, 4))
+			return ~Pos(0);
 		v = ReadT<u32>(data + pos);
 		pos += 4;
 	}
 	return v;
 }
 
+template <bool Checked = DATO_VALIDATE_BUFFERS != 0, class Pos = u64>
+inline Pos ReadSizeU64(DATO_READSIZE_TARGS)
+{
+	static_assert(sizeof(Pos) >= 8, "64-bit sizes require 64-bit positions");
+	(void)len;
+	if (Checked && !HasBytesAt(len, pos, 8))
+		return ~Pos(0);
+	Pos v = ReadT<u64>(data + pos);
+	pos += 8;
+	return v;
+}
+
 struct ReaderConfig0
 {
+	typedef u32 Pos; // the type of sizes and offsets
 	bool InitForReading(u8 id) { return id == 0; }
 
-	DATO_FORCEINLINE u32 ReadKeyLength(DATO_READSIZE_ARGS) const
-	{ return ReadSizeU32(DATO_READSIZE_PASS); }
-	DATO_FORCEINLINE u32 ReadMapSize(DATO_READSIZE_ARGS) const
-	{ return ReadSizeU32(DATO_READSIZE_PASS); }
-	DATO_FORCEINLINE u32 ReadArrayLength(DATO_READSIZE_ARGS) const
-	{ return ReadSizeU32(DATO_READSIZE_PASS); }
-	DATO_FORCEINLINE u32 ReadValueLength(DATO_READSIZE_ARGS) const
-	{ return ReadSizeU32(DATO_READSIZE_PASS); }
+	template <bool Checked> DATO_FORCEINLINE Pos ReadKeyLength(DATO_READSIZE_ARGS) const
+	{ return ReadSizeU32<Checked>(DATO_READSIZE_PASS); }
+	template <bool Checked> DATO_FORCEINLINE Pos ReadMapSize(DATO_READSIZE_ARGS) const
+	{ return ReadSizeU32<Checked>(DATO_READSIZE_PASS); }
+	template <bool Checked> DATO_FORCEINLINE Pos ReadArrayLength(DATO_READSIZE_ARGS) const
+	{ return ReadSizeU32<Checked>(DATO_READSIZE_PASS); }
+	template <bool Checked> DATO_FORCEINLINE Pos ReadValueLength(DATO_READSIZE_ARGS) const
+	{ return ReadSizeU32<Checked>(DATO_READSIZE_PASS); }
 };
 
 struct ReaderConfig1
 {
+	typedef u32 Pos;
 	bool InitForReading(u8 id) { return id == 1; }
 
-	DATO_FORCEINLINE u32 ReadKeyLength(DATO_READSIZE_ARGS) const
-	{ return ReadSizeU32(DATO_READSIZE_PASS); }
-	DATO_FORCEINLINE u32 ReadMapSize(DATO_READSIZE_ARGS) const
-	{ return ReadSizeU32(DATO_READSIZE_PASS); }
-	DATO_FORCEINLINE u32 ReadArrayLength(DATO_READSIZE_ARGS) const
-	{ return ReadSizeU32(DATO_READSIZE_PASS); }
-	DATO_FORCEINLINE u32 ReadValueLength(DATO_READSIZE_ARGS) const
-	{ return ReadSizeU8X32(DATO_READSIZE_PASS); }
+	template <bool Checked> DATO_FORCEINLINE Pos ReadKeyLength(DATO_READSIZE_ARGS) const
+	{ return ReadSizeU32<Checked>(DATO_READSIZE_PASS); }
+	template <bool Checked> DATO_FORCEINLINE Pos ReadMapSize(DATO_READSIZE_ARGS) const
+	{ return ReadSizeU32<Checked>(DATO_READSIZE_PASS); }
+	template <bool Checked> DATO_FORCEINLINE Pos ReadArrayLength(DATO_READSIZE_ARGS) const
+	{ return ReadSizeU32<Checked>(DATO_READSIZE_PASS); }
+	template <bool Checked> DATO_FORCEINLINE Pos ReadValueLength(DATO_READSIZE_ARGS) const
+	{ return ReadSizeU8X32<Checked>(DATO_READSIZE_PASS); }
 };
 
 struct ReaderConfig2
 {
+	typedef u32 Pos;
 	bool InitForReading(u8 id) { return id == 2; }
 
-	DATO_FORCEINLINE u32 ReadKeyLength(DATO_READSIZE_ARGS) const
-	{ return ReadSizeU32(DATO_READSIZE_PASS); }
-	DATO_FORCEINLINE u32 ReadMapSize(DATO_READSIZE_ARGS) const
-	{ return ReadSizeU8X32(DATO_READSIZE_PASS); }
-	DATO_FORCEINLINE u32 ReadArrayLength(DATO_READSIZE_ARGS) const
-	{ return ReadSizeU8X32(DATO_READSIZE_PASS); }
-	DATO_FORCEINLINE u32 ReadValueLength(DATO_READSIZE_ARGS) const
-	{ return ReadSizeU8X32(DATO_READSIZE_PASS); }
+	template <bool Checked> DATO_FORCEINLINE Pos ReadKeyLength(DATO_READSIZE_ARGS) const
+	{ return ReadSizeU32<Checked>(DATO_READSIZE_PASS); }
+	template <bool Checked> DATO_FORCEINLINE Pos ReadMapSize(DATO_READSIZE_ARGS) const
+	{ return ReadSizeU8X32<Checked>(DATO_READSIZE_PASS); }
+	template <bool Checked> DATO_FORCEINLINE Pos ReadArrayLength(DATO_READSIZE_ARGS) const
+	{ return ReadSizeU8X32<Checked>(DATO_READSIZE_PASS); }
+	template <bool Checked> DATO_FORCEINLINE Pos ReadValueLength(DATO_READSIZE_ARGS) const
+	{ return ReadSizeU8X32<Checked>(DATO_READSIZE_PASS); }
 };
 
+// 64-bit sizes and offsets (map/array slots and the root reference are 8 bytes as well)
+struct ReaderConfig3
+{
+	typedef u64 Pos;
+	bool InitForReading(u8 id) { return id == 3; }
+
+	template <bool Checked> DATO_FORCEINLINE Pos ReadKeyLength(DATO_READSIZE_ARGS) const
+	{ return ReadSizeU64<Checked>(DATO_READSIZE_PASS); }
+	template <bool Checked> DATO_FORCEINLINE Pos ReadMapSize(DATO_READSIZE_ARGS) const
+	{ return ReadSizeU64<Checked>(DATO_READSIZE_PASS); }
+	template <bool Checked> DATO_FORCEINLINE Pos ReadArrayLength(DATO_READSIZE_ARGS) const
+	{ return ReadSizeU64<Checked>(DATO_READSIZE_PASS); }
+	template <bool Checked> DATO_FORCEINLINE Pos ReadValueLength(DATO_READSIZE_ARGS) const
+	{ return ReadSizeU64<Checked>(DATO_READSIZE_PASS); }
+};
+
+// reads configurations 0-2 (3 has a different position type)
 struct ReaderConfigAdaptive
 {
-	typedef u32 ReadFunc(DATO_READSIZE_ARGS);
+	typedef u32 Pos;
+	typedef Pos ReadFunc(DATO_READSIZE_ARGS);
 
 	ReadFunc* keyLength = nullptr;
 	ReadFunc* mapSize = nullptr;
@@ -296,33 +844,35 @@ struct ReaderConfigAdaptive
 		switch (id)
 		{
 		case 0:
-			keyLength = &ReadSizeU32;
-			mapSize = &ReadSizeU32;
-			arrayLength = &ReadSizeU32;
-			valueLength = &ReadSizeU32;
+			keyLength = &ReadSizeU32<true>;
+			mapSize = &ReadSizeU32<true>;
+			arrayLength = &ReadSizeU32<true>;
+			valueLength = &ReadSizeU32<true>;
 			return true;
 		case 1:
-			keyLength = &ReadSizeU32;
-			mapSize = &ReadSizeU32;
-			arrayLength = &ReadSizeU32;
-			valueLength = &ReadSizeU8X32;
+			keyLength = &ReadSizeU32<true>;
+			mapSize = &ReadSizeU32<true>;
+			arrayLength = &ReadSizeU32<true>;
+			valueLength = &ReadSizeU8X32<true>;
 			return true;
 		case 2:
-			keyLength = &ReadSizeU32;
-			mapSize = &ReadSizeU8X32;
-			arrayLength = &ReadSizeU8X32;
-			valueLength = &ReadSizeU8X32;
+			keyLength = &ReadSizeU32<true>;
+			mapSize = &ReadSizeU8X32<true>;
+			arrayLength = &ReadSizeU8X32<true>;
+			valueLength = &ReadSizeU8X32<true>;
 			return true;
 		}
 		return false;
 	}
 
-	u32 ReadKeyLength(DATO_READSIZE_ARGS) const { return keyLength(DATO_READSIZE_PASS); }
-	u32 ReadMapSize(DATO_READSIZE_ARGS) const { return mapSize(DATO_READSIZE_PASS); }
-	u32 ReadArrayLength(DATO_READSIZE_ARGS) const { return arrayLength(DATO_READSIZE_PASS); }
-	u32 ReadValueLength(DATO_READSIZE_ARGS) const { return valueLength(DATO_READSIZE_PASS); }
+	// the size reading functions are always checked (the check is cheap compared to the indirect call)
+	template <bool> Pos ReadKeyLength(DATO_READSIZE_ARGS) const { return keyLength(DATO_READSIZE_PASS); }
+	template <bool> Pos ReadMapSize(DATO_READSIZE_ARGS) const { return mapSize(DATO_READSIZE_PASS); }
+	template <bool> Pos ReadArrayLength(DATO_READSIZE_ARGS) const { return arrayLength(DATO_READSIZE_PASS); }
+	template <bool> Pos ReadValueLength(DATO_READSIZE_ARGS) const { return valueLength(DATO_READSIZE_PASS); }
 };
 
+// (sizes are passed as 32-bit values, which truncates them in configurations with 64-bit sizes)
 struct IValueIterator
 {
 	virtual void BeginMap(u8 type, u32 size) = 0;
@@ -356,73 +906,529 @@ struct IValueIterator
 	virtual void OnUnknownValue(u8 type, u32 embedded, const char* buffer, u32 length) = 0;
 };
 
-struct DATO_CONCAT(Reader, DATO_CONFIG)
+// a base for visitors of the Visit functions of accessors (the callbacks are the same as in IValueIterator, ..
+// .. but they are called directly and can be inlined)
+// - visitors can hide any of these empty callbacks with their own versions
+struct ValueVisitor
 {
+	void BeginMap(u8 type, u32 size) { (void) type; (void) size; }
+	void EndMap(u8 type) { (void) type; }
+	void BeginStringKey(const char* key, u32 length) { (void) key; (void) length; }
+	void EndStringKey() {}
+	void BeginIntKey(u32 key) { (void) key; }
+	void EndIntKey() {}
+
+	void BeginArray(u32 size) { (void) size; }
+	void EndArray() {}
+	void BeginArrayIndex(u32 i) { (void) i; }
+	void EndArrayIndex() {}
+
+	void OnValueNull() {}
+	void OnValueBool(bool value) { (void) value; }
+	void OnValueS32(s32 value) { (void) value; }
+	void OnValueU32(u32 value) { (void) value; }
+	void OnValueF32(f32 value) { (void) value; }
+	void OnValueS64(s64 value) { (void) value; }
+	void OnValueU64(u64 value) { (void) value; }
+	void OnValueF64(f64 value) { (void) value; }
+	void OnValueString(const char* data, u32 length) { (void) data; (void) length; }
+	void OnValueString(const u16* data, u32 length) { (void) data; (void) length; }
+	void OnValueString(const u32* data, u32 length) { (void) data; (void) length; }
+
+	void OnValueByteArray(const void* data, u32 length) { (void) data; (void) length; }
+	void OnValueVector(u8 subtype, u8 elemCount, const void* data) { (void) subtype; (void) elemCount; (void) data; }
+	void OnValueVectorArray(u8 subtype, u8 elemCount, const void* data, u32 length)
+	{ (void) subtype; (void) elemCount; (void) data; (void) length; }
+	void OnUnknownValue(u8 type, u32 embedded, const char* buffer, u32 length)
+	{ (void) type; (void) embedded; (void) buffer; (void) length; }
+};
+
+// a key string and its position in a document, for repeated lookups of the same key in many maps
+// - created by Reader::ResolveKey and resolved by the first successful lookup with it, after which ..
+// .. the key positions are compared instead of the strings
+// - the string is not copied, and the handle is modified by the lookups (one handle per thread)
+template <class Config>
+struct BasicKeyHandle
+{
+	typedef typename Config::Pos Pos;
+
+	const char* str;
+	size_t len;
+	u32 hash;
+	Pos pos; // the position of the key string in `document`
+	u64 document; // the Reader::GetDocumentId that the key was resolved in (0 if not resolved yet)
+};
+
+// key handles scan the key positions of sorted maps up to this size (and use the string search for larger ones)
+static const u32 KEYHANDLE_ScanMax = 64;
+
+// buffer check modes of the reader
+static const u8 CHECKS_Default = 0; // crash on invalid data (if DATO_VALIDATE_BUFFERS is enabled)
+static const u8 CHECKS_None = 1; // no checks (only for buffers that have passed Reader::Validate)
+static const u8 CHECKS_Error = 2; // set the sticky error flag (HasError) and return empty values
+
+// the read primitive of BasicReader: the whole buffer is in memory and is read directly
+// - the sources that are not Direct (see PageSource) copy the bytes out, so the readers of those ..
+// .. have copying accessors for strings, byte arrays and vectors, and no functions that return ..
+// .. pointers to the data (GetData, GetKeyCStr, Iterate/Visit, Validate)
+struct BufferSource
+{
+	static const bool Direct = true;
+
+	// (only used with the sources that are not Direct)
+	bool Read(void*, u64, u64) const { return false; }
+	bool Compare(int&, u64, const void*, u64) const { return false; }
+};
+
+// Config is one of the ReaderConfig* types, Source is BufferSource or another source with the same functions
+// - after Init, the reader and its accessors only read the buffer, so they can be shared by any number of ..
+// .. threads (except for KeyHandles, which are modified by the lookups)
+template <class Config, u8 Checks = CHECKS_Default, class Source = BufferSource>
+struct BasicReader
+{
+	static_assert(Source::Direct || Checks == CHECKS_Error, "sources that can fail to read require CHECKS_Error");
+	template <class, u8, class> friend struct BasicReader;
+	typedef typename Config::Pos Pos; // the type of sizes and offsets
+	typedef BasicKeyHandle<Config> KeyHandle;
 private:
-	using Reader = DATO_CONCAT(Reader, DATO_CONFIG);
-	DATO_CONCAT(ReaderConfig, DATO_CONFIG) _cfg = {};
+	using Reader = BasicReader;
+	using TrustedReader = BasicReader<Config, CHECKS_None>;
+	static const bool _CheckBuffers =
+		Checks == CHECKS_Error || (Checks == CHECKS_Default && DATO_VALIDATE_BUFFERS != 0);
+	static const u32 SlotSize = sizeof(Pos); // the size of map keys and map/array values
+
+	Config _cfg = {};
 	const char* _data = nullptr;
-	u32 _len = 0;
+	Pos _len = 0;
 	u8 _flags = 0;
 	u8 _rootType = 0;
-	u32 _root = 0;
+	Pos _root = 0;
+	mutable bool _error = false; // set by the accessors in CHECKS_Error mode
+	Source _src = {}; // (`_data` is null if the source is not Direct)
+	u32 _prefetchDistance = 0; // see SetPrefetchDistance
+	u64 _documentId = 0; // see GetDocumentId
+
+	template <class T> DATO_FORCEINLINE T RD(Pos pos) const
+	{
+		if (Source::Direct)
+			return ReadT<T>(_data + pos);
+		T v;
+		if (!_Expect(HasBytesAt(_len, pos, sizeof(T)) && _src.Read(&v, pos, sizeof(T))))
+			return T(0);
+		return v;
+	}
+	// returns whether the caller can continue (otherwise it should return an empty value)
+	// - the return value is a constant unless using CHECKS_Error, so the failure paths are compiled out
+	DATO_FORCEINLINE bool _Expect(bool ok) const
+	{
+		if (Checks == CHECKS_Error)
+		{
+			if (DATO_UNLIKELY(!ok))
+			{
+				DATO_SET_FLAG(_error);
+				return false;
+			}
+		}
+		else if (Checks == CHECKS_Default)
+		{
+			DATO_BUFFER_EXPECT(ok);
+		}
+		(void)ok;
+		return true;
+	}
+	// same for invalid arguments (type/index mismatches), which can also be caused by bad data
+	// - `r` can be null for empty accessors, whose error was already recorded when they were created
+	static DATO_FORCEINLINE bool _ExpectInput(const Reader* r, bool ok)
+	{
+		if (Checks == CHECKS_Error)
+		{
+			if (DATO_UNLIKELY(!ok))
+			{
+				if (r)
+					DATO_SET_FLAG(r->_error);
+				return false;
+			}
+		}
+		else
+		{
+			DATO_INPUT_EXPECT(ok);
+		}
+		(void)r;
+		(void)ok;
+		return true;
+	}
+#define DATO_READER_INPUT_EXPECT(r, x) if (!Reader::_ExpectInput(r, x)) return {}
+	// for the functions that return pointers to the data
+#define DATO_READER_DIRECT_ONLY static_assert(Source::Direct, "only available with the data in memory")
+	// overflow-safe check for whether [pos; pos + count * elemSize) is inside the buffer
+	DATO_FORCEINLINE bool _InRange(Pos pos, u64 count, u32 elemSize) const
+	{
+		if (sizeof(Pos) == 4) // cannot overflow in 64-bit math
+			return u64(pos) + u64(count) * elemSize <= _len;
+		return pos <= _len && (elemSize == 0 || count <= (_len - pos) / elemSize);
+	}
+	// same for a key (including the 0-terminator)
+	DATO_FORCEINLINE bool _KeyInRange(Pos kpos, Pos len) const
+	{
+		return _InRange(kpos, len, 1) && kpos + len < _len;
+	}
 
-	template <class T> DATO_FORCEINLINE T RD(u32 pos) const { return ReadT<T>(_data + pos); }
+	// copies a range that is in the buffer (returns false on read errors)
+	DATO_FORCEINLINE bool _ReadBytes(void* dst, Pos pos, Pos size) const
+	{
+		if (Source::Direct)
+		{
+			DATO_MEMCPY(dst, _data + pos, size_t(size));
+			return true;
+		}
+		return _Expect(_src.Read(dst, pos, size));
+	}
+	// compares the memory to a range that is in the buffer (the same result as memcmp, -1 on read errors)
+	DATO_FORCEINLINE int _CompareBytes(Pos pos, const void* mem, Pos size) const
+	{
+		if (Source::Direct)
+			return DATO_MEMCMP(mem, &_data[pos], size_t(size));
+		int diff = -1;
+		_Expect(_src.Compare(diff, pos, mem, size));
+		return diff;
+	}
+
+	// the sizes are decoded from a copy of the bytes if the source is not Direct (they may span pages)
+	static const u32 _MaxSizeBytes = 9; // the longest encoded size
+	DATO_FORCEINLINE Pos _CopySizeBytes(Pos pos, char* bfr) const
+	{
+		if (pos >= _len)
+			return 0;
+		Pos n = _len - pos < _MaxSizeBytes ? _len - pos : _MaxSizeBytes;
+		return _ReadBytes(bfr, pos, n) ? n : 0;
+	}
+#define DATO_READER_READSIZE(method) \
+		if (Source::Direct) \
+			return _cfg.template method<_CheckBuffers>(_data, _len, pos); \
+		char bfr[_MaxSizeBytes]; \
+		Pos n = _CopySizeBytes(pos, bfr), lp = 0; \
+		Pos size = _cfg.template method<_CheckBuffers>(bfr, n, lp); \
+		pos += lp; \
+		return size;
+	DATO_FORCEINLINE Pos _ReadKeyLength(Pos& pos) const { DATO_READER_READSIZE(ReadKeyLength) }
+	DATO_FORCEINLINE Pos _ReadMapSize(Pos& pos) const { DATO_READER_READSIZE(ReadMapSize) }
+	DATO_FORCEINLINE Pos _ReadArrayLength(Pos& pos) const { DATO_READER_READSIZE(ReadArrayLength) }
+	DATO_FORCEINLINE Pos _ReadValueLength(Pos& pos) const { DATO_READER_READSIZE(ReadValueLength) }
+#undef DATO_READER_READSIZE
 
 	// compares the bytes until the first 0-char
-	bool KeyEquals(u32 kpos, const char* str) const
+	bool KeyEquals(Pos kpos, const char* str) const
 	{
-		u32 len = _cfg.ReadKeyLength(_data, _len, kpos);
-		(void)len;
-		DATO_BUFFER_EXPECT(kpos + len + 1 <= _len);
+		if (!Source::Direct)
+			return KeyEquals(kpos, str, strlen(str));
+		Pos len = _ReadKeyLength(kpos);
+		if (!_Expect(_KeyInRange(kpos, len)))
+			return false;
 		return DATO_STRCMP(str, &_data[kpos]) == 0;
 	}
-	int KeyCompare(u32 kpos, const char* str) const
+	int KeyCompare(Pos kpos, const char* str) const
 	{
-		u32 len = _cfg.ReadKeyLength(_data, _len, kpos);
-		(void)len;
-		DATO_BUFFER_EXPECT(kpos + len + 1 <= _len);
+		if (!Source::Direct)
+			return KeyCompare(kpos, str, strlen(str));
+		Pos len = _ReadKeyLength(kpos);
+		if (!_Expect(_KeyInRange(kpos, len)))
+			return -1;
 		return DATO_STRCMP(str, &_data[kpos]);
 	}
 	// compares the size first, then all of bytes
-	bool KeyEquals(u32 kpos, const void* mem, size_t lenMem) const
+	bool KeyEquals(Pos kpos, const void* mem, size_t lenMem) const
 	{
-		u32 len = _cfg.ReadKeyLength(_data, _len, kpos);
+		Pos len = _ReadKeyLength(kpos);
 		if (len != lenMem)
 			return false;
-		DATO_BUFFER_EXPECT(kpos + len + 1 <= _len);
-		return DATO_MEMCMP(mem, &_data[kpos], len) == 0;
+		if (!_Expect(_KeyInRange(kpos, len)))
+			return false;
+		return _CompareBytes(kpos, mem, len) == 0;
 	}
-	int KeyCompare(u32 kpos, const void* mem, size_t lenMem) const
+	int KeyCompare(Pos kpos, const void* mem, size_t lenMem) const
 	{
-		u32 len = _cfg.ReadKeyLength(_data, _len, kpos);
-		DATO_BUFFER_EXPECT(kpos + len + 1 <= _len);
-		u32 testLen = u32(len < lenMem ? len : lenMem);
-		if (int bc = DATO_MEMCMP(mem, &_data[kpos], testLen))
+		Pos len = _ReadKeyLength(kpos);
+		if (!_Expect(_KeyInRange(kpos, len)))
+			return -1;
+		Pos testLen = len < lenMem ? len : Pos(lenMem);
+		if (int bc = _CompareBytes(kpos, mem, testLen))
 			return bc;
 		if (lenMem == len)
 			return 0;
 		return lenMem < len ? -1 : 1;
 	}
 
+	// starts loading the value that a slot refers to (its header and the first slots after it)
+	// - only reads the slot and the type, which are expected to be in the range checked by the container
+	DATO_FORCEINLINE void _PrefetchSlot(Pos origin, Pos vpos, Pos tpos) const
+	{
+		if (!Source::Direct || !IsReferenceType(RD<u8>(tpos)))
+			return;
+		Pos val = RD<Pos>(vpos);
+		if (val - 1 >= origin)
+			return;
+		Pos pos = origin - val;
+		DATO_PREFETCH(_data + pos);
+		if (_len - pos > 64)
+			DATO_PREFETCH(_data + pos + 64);
+	}
+
+	// bulk value decoding (see DecodeValueSlots_Scalar)
+	static const u32 _DecodeChunkSize = 32;
+	static DATO_FORCEINLINE bool _DecodeValueSlots(const char* vals, const u8* types, u32 start, u32 origin, u32 count, u32* out)
+	{
+		return GetDecodeValueSlotsU32()(vals, types, start, origin, count, out);
+	}
+	static DATO_FORCEINLINE bool _DecodeValueSlots(const char* vals, const u8* types, u64 start, u64 origin, u32 count, u64* out)
+	{
+		return DecodeValueSlots_Scalar<u64>(vals, types, start, origin, count, out);
+	}
+	// decodes the slots [i; i + _DecodeChunkSize) (clamped to `count`) of a container to `pos`
+	// - `start` is the position of the container and `origin` the position after its size
+	// - `vpos` and `tpos` are the positions of the first value slot and type, all must be in the checked range
+	// - returns whether all of the references are valid
+	DATO_FORCEINLINE bool _DecodeChunk(Pos start, Pos origin, Pos vpos, Pos tpos, Pos i, Pos count, Pos* pos) const
+	{
+		u32 n = u32(count - i < _DecodeChunkSize ? count - i : _DecodeChunkSize);
+		if (!Source::Direct)
+		{
+			// (decoded from a copy of the slots)
+			char vals[_DecodeChunkSize * SlotSize] = {};
+			u8 types[_DecodeChunkSize] = {};
+			bool ok = _ReadBytes(vals, vpos + i * SlotSize, n * SlotSize);
+			ok = _ReadBytes(types, tpos + i, n) && ok;
+			return _DecodeValueSlots(vals, types, start, origin, n, pos) && ok;
+		}
+		return _DecodeValueSlots(_data + vpos + i * SlotSize, (const u8*) _data + tpos + i, start, origin, n, pos);
+	}
+	// returns the value of slot `i` from its position decoded by _DecodeChunk (the same value as GetValueByIndex)
+	template <class DA> DATO_FORCEINLINE DA _DecodedSlot(Pos start, Pos origin, Pos vpos, Pos tpos, Pos i, Pos pos, bool ok) const
+	{
+		u8 type = RD<u8>(tpos + i);
+		if (Checks == CHECKS_Error && !ok && IsReferenceType(type) && !_Expect(IsBackReference(start, origin, RD<Pos>(vpos + i * SlotSize))))
+			return {};
+		return { this, pos, type };
+	}
+	template <class DA> void _DecodeSlots(Pos start, Pos origin, Pos vpos, Pos tpos, Pos begin, Pos end, DA* out) const
+	{
+		Pos pos[_DecodeChunkSize];
+		for (Pos i = begin; i < end; i += _DecodeChunkSize)
+		{
+			bool ok = _DecodeChunk(start, origin, vpos, tpos, i, end, pos);
+			Pos n = end - i < _DecodeChunkSize ? end - i : _DecodeChunkSize;
+			for (Pos j = 0; j < n; j++)
+				out[i - begin + j] = _DecodedSlot<DA>(start, origin, vpos, tpos, i + j, pos[j], ok);
+		}
+	}
+
+	// the hash table of string hash maps is placed after the types
+	DATO_FORCEINLINE Pos _HashTablePos(Pos origin, Pos size) const
+	{
+		Pos pos = origin + size * (SlotSize * 2 + 1);
+		return _flags & FLAG_Aligned ? RoundUp(pos, 4) : pos;
+	}
+
+	// validation (all checks are always enabled and only return failure)
+	// - references only point backwards, so a shared container needs to be checked only once ..
+	// .. (again only for a greater remaining depth), which keeps the work linear in the buffer size
+	struct _ValidationState
+	{
+		struct Entry
+		{
+			Pos pos;
+			u32 depth; // the remaining depth it was checked with (0 = empty)
+			u8 type;
+		};
+
+		Pos valuesLeft;
+		Entry* _table = nullptr; // the containers that have passed
+		u32 _mask = 0;
+		u32 _count = 0;
+
+		_ValidationState(Pos maxValues) : valuesLeft(maxValues) {}
+		_ValidationState(const _ValidationState&) = delete;
+		_ValidationState& operator = (const _ValidationState&) = delete;
+		~_ValidationState() { DATO_FREE(_table); }
+
+		bool Contains(Pos pos, u8 type, u32 depth) const
+		{
+			return _table && _Find(pos, type)->depth >= depth;
+		}
+		void Add(Pos pos, u8 type, u32 depth)
+		{
+			if (_count * 2 >= _mask)
+				_Grow();
+			if (_count >= _mask)
+				return; // (out of memory, the rest is checked without skipping)
+			Entry* e = _Find(pos, type);
+			_count += e->depth == 0;
+			*e = { pos, depth, type };
+		}
+		Entry* _Find(Pos pos, u8 type) const
+		{
+			u32 i = u32((u64(pos) * 0x9E3779B97F4A7C15ull) >> 32) & _mask;
+			while (_table[i].depth && (_table[i].pos != pos || _table[i].type != type))
+				i = (i + 1) & _mask;
+			return &_table[i];
+		}
+		void _Grow()
+		{
+			u32 mask = _mask ? _mask * 2 + 1 : 63;
+			Entry* table = (Entry*) DATO_MALLOC(sizeof(Entry) * (size_t(mask) + 1));
+			if (!table)
+				return;
+			for (u32 i = 0; i <= mask; i++)
+				table[i].depth = 0;
+			Entry* old = _table;
+			u32 oldMask = _mask;
+			_table = table;
+			_mask = mask;
+			for (u32 i = 0; old && i <= oldMask; i++)
+				if (old[i].depth)
+					*_Find(old[i].pos, old[i].type) = old[i];
+			DATO_FREE(old);
+		}
+	};
+	bool _ValidateKey(Pos kpos) const
+	{
+		Pos len = _cfg.template ReadKeyLength<true>(_data, _len, kpos);
+		return _KeyInRange(kpos, len) && _data[kpos + len] == 0;
+	}
+	template <class T> bool _ValidateTypedArray(Pos pos, u32 align, bool nullTerminated) const
+	{
+		Pos size = _cfg.template ReadValueLength<true>(_data, _len, pos);
+		if (!_InRange(pos, size, sizeof(T)))
+			return false;
+		if (nullTerminated && !_InRange(pos + size * sizeof(T), 1, sizeof(T)))
+			return false;
+		if ((_flags & FLAG_Aligned) && align && pos % align)
+			return false;
+		return !nullTerminated || RD<T>(pos + size * sizeof(T)) == 0;
+	}
+	// `start` is the position of the container, `origin` is where the relative references start
+	bool _ValidateSlot(Pos start, Pos origin, Pos val, u8 type, u32 depth, _ValidationState& st) const
+	{
+		if (!IsReferenceType(type))
+			return true;
+		// references must point strictly backwards from the container to guarantee termination
+		if (val > origin || origin - val >= start)
+			return false;
+		return _ValidateValue(origin - val, type, depth, st);
+	}
+	bool _ValidateValue(Pos pos, u8 type, u32 depth, _ValidationState& st) const
+	{
+		if (!IsReferenceType(type))
+			return true;
+		if (depth == 0 || st.valuesLeft == 0)
+			return false;
+		if (st.Contains(pos, type, depth))
+			return true;
+		st.valuesLeft--;
+		u32 entryDepth = depth--;
+
+		bool aligned = (_flags & FLAG_Aligned) != 0;
+		switch (type)
+		{
+		case TYPE_S64:
+		case TYPE_U64:
+		case TYPE_F64:
+			return _InRange(pos, 1, 8) && (!aligned || pos % 8 == 0);
+		case TYPE_Array: {
+			Pos origin = pos;
+			Pos size = _cfg.template ReadArrayLength<true>(_data, _len, origin);
+			if (!_InRange(origin, size, SlotSize + 1) || (aligned && origin % SlotSize))
+				return false;
+			for (Pos i = 0; i < size; i++)
+			{
+				Pos val = RD<Pos>(origin + i * SlotSize);
+				u8 vtype = RD<u8>(origin + size * SlotSize + i);
+				if (!_ValidateSlot(pos, origin, val, vtype, depth, st))
+					return false;
+			}
+			st.Add(pos, type, entryDepth);
+			return true; }
+		case TYPE_StringMap:
+		case TYPE_IntMap:
+		case TYPE_StringHashMap: {
+			Pos origin = pos;
+			Pos size = _cfg.template ReadMapSize<true>(_data, _len, origin);
+			if (!_InRange(origin, size, SlotSize * 2 + 1) || (aligned && origin % SlotSize))
+				return false;
+			if (type == TYPE_StringHashMap)
+			{
+				// the buckets must refer to existing entries (the keys are not rehashed)
+				Pos table = _HashTablePos(origin, size);
+				u64 numBuckets = HashMapBucketCount(size);
+				if (!_InRange(table, numBuckets, 5))
+					return false;
+				for (u64 b = 0; b < numBuckets; b++)
+					if (RD<u8>(table + numBuckets * 4 + b) && RD<u32>(table + b * 4) >= size)
+						return false;
+			}
+			for (Pos i = 0; i < size; i++)
+			{
+				if (type != TYPE_IntMap && !_ValidateKey(RD<Pos>(origin + i * SlotSize)))
+					return false;
+				Pos val = RD<Pos>(origin + size * SlotSize + i * SlotSize);
+				u8 vtype = RD<u8>(origin + size * SlotSize * 2 + i);
+				if (!_ValidateSlot(pos, origin, val, vtype, depth, st))
+					return false;
+			}
+			st.Add(pos, type, entryDepth);
+			return true; }
+		case TYPE_String8: return _ValidateTypedArray<u8>(pos, 0, true);
+		case TYPE_String16: return _ValidateTypedArray<u16>(pos, 2, true);
+		case TYPE_String32: return _ValidateTypedArray<u32>(pos, 4, true);
+		case TYPE_ByteArray: return _ValidateTypedArray<u8>(pos, 0, false);
+		case TYPE_Vector:
+		case TYPE_VectorArray: {
+			if (!_InRange(pos, 2, 1))
+				return false;
+			u32 elemSize = SubtypeGetSize(RD<u8>(pos));
+			u32 elemCount = RD<u8>(pos + 1);
+			if (elemSize == 0 || elemCount == 0)
+				return false;
+			Pos dataPos = pos + 2;
+			Pos size = 1;
+			if (type == TYPE_VectorArray)
+				size = _cfg.template ReadValueLength<true>(_data, _len, dataPos);
+			if (!_InRange(dataPos, size, elemSize * elemCount))
+				return false;
+			return !aligned || size == 0 || dataPos % elemSize == 0; }
+		default: // unknown types cannot be validated
+			return false;
+		}
+	}
+
 public:
 	struct DynamicAccessor;
 	struct MapAccessor
 	{
-		Reader* _r;
-		u32 _size;
-		u32 _objpos;
+		const Reader* _r;
+		Pos _size;
+		Pos _objpos;
+		Pos _start; // the position of the size (what references to the map point at)
 
-		DATO_FORCEINLINE MapAccessor() : _r(nullptr), _size(0), _objpos(0) {}
-		MapAccessor(Reader* r, u32 pos) : _r(r)
+		DATO_FORCEINLINE MapAccessor() : _r(nullptr), _size(0), _objpos(0), _start(0) {}
+		MapAccessor(const Reader* r, Pos pos) : _r(r)
 		{
 			_objpos = pos;
-			_size = r->_cfg.ReadMapSize(r->_data, r->_len, _objpos);
-			DATO_BUFFER_EXPECT(pos + 9 * _size <= r->_len);
+			_start = pos;
+			_size = r->_ReadMapSize(_objpos);
+			if (!r->_Expect(r->_InRange(_objpos, _size, SlotSize * 2 + 1)))
+				*this = {};
 		}
 
 		DATO_FORCEINLINE operator const void* () const { return _r; } // to support `if (init)` exprs
-		DATO_FORCEINLINE u32 GetSize() const { return _size; }
+		DATO_FORCEINLINE Pos GetSize() const { return _size; }
+		DATO_FORCEINLINE Pos size() const { return _size; } // for std::size and std::ranges::sized_range
+		// the stored key slots (`GetSize() * sizeof(Pos)` bytes, in the range checked by the constructor)
+		// - with unique keys, maps that have the same keys in the same order have the same key slots
+		DATO_FORCEINLINE const void* GetKeySlotData() const
+		{
+			DATO_READER_DIRECT_ONLY;
+			return _r ? _r->_data + _objpos : nullptr;
+		}
 
 		// retrieving values
 		DATO_FORCEINLINE DynamicAccessor TryGetValueByIndex(size_t i) const
@@ -433,26 +1439,57 @@ public:
 		}
 		DATO_FORCEINLINE DynamicAccessor GetValueByIndex(size_t i) const
 		{
-			DATO_INPUT_EXPECT(i < _size);
-			u32 vpos = _objpos + _size * 4 + u32(i) * 4;
-			u32 tpos = _objpos + _size * 8 + u32(i);
-			u32 val = _r->RD<u32>(vpos);
+			DATO_READER_INPUT_EXPECT(_r, i < _size);
+			Pos vpos = _objpos + _size * SlotSize + Pos(i) * SlotSize;
+			Pos tpos = _objpos + _size * SlotSize * 2 + Pos(i);
+			Pos val = _r->template RD<Pos>(vpos);
 			u8 type = _r->RD<u8>(tpos);
 			if (IsReferenceType(type))
+			{
+				if (Checks == CHECKS_Error && !_r->_Expect(IsBackReference(_start, _objpos, val)))
+					return {};
 				val = _objpos - val;
+			}
 			return { _r, val, type };
 		}
+
+		// decodes the values of the slots [begin; begin + count) (clamped to the size) at once
+		// - returns the number of values written to `out`
+		size_t DecodeSlots(size_t begin, size_t count, DynamicAccessor* out) const
+		{
+			if (begin >= _size)
+				return 0;
+			count = count < _size - begin ? count : _size - begin;
+			_r->_DecodeSlots(_start, _objpos, _objpos + _size * SlotSize, _objpos + _size * SlotSize * 2, Pos(begin), Pos(begin + count), out);
+			return count;
+		}
+
+		DATO_FORCEINLINE void _PrefetchValue(size_t slot) const
+		{
+			if (slot < _size)
+				_r->_PrefetchSlot(_objpos, _objpos + _size * SlotSize + Pos(slot) * SlotSize, _objpos + _size * SlotSize * 2 + Pos(slot));
+		}
 	};
 	struct StringMapAccessor : MapAccessor
 	{
-		struct Iterator
+		struct Iterator : RandomAccessIteratorBase<Iterator, Iterator>
 		{
-			const StringMapAccessor* _obj;
-			u32 _i;
+			const StringMapAccessor* _obj = nullptr;
+			Pos _i = 0;
+			Pos _ahead = 0; // the prefetch distance (0 = disabled)
 
-			DATO_FORCEINLINE const Iterator& operator * () const { return *this; }
-			DATO_FORCEINLINE bool operator != (const Iterator& o) const { return _i != o._i; }
-			DATO_FORCEINLINE void operator ++ () { ++_i; }
+			DATO_FORCEINLINE Iterator() {}
+			DATO_FORCEINLINE Iterator(const StringMapAccessor* obj, Pos i, Pos ahead) : _obj(obj), _i(i), _ahead(ahead) {}
+
+			// the entry is the iterator itself (a copy, so that it stays valid while the original is advanced)
+			DATO_FORCEINLINE Iterator operator * () const { return *this; }
+			DATO_FORCEINLINE void _Advance(ptrdiff_t n)
+			{
+				if (_ahead)
+					_obj->_Prefetch(_i + _ahead);
+				_i += Pos(n);
+			}
+			DATO_FORCEINLINE ptrdiff_t _Distance(const Iterator& o) const { return ptrdiff_t(_i) - ptrdiff_t(o._i); }
 
 			DATO_FORCEINLINE const char* GetKeyCStr(u32* pOutLen = nullptr) const
 			{ return _obj->GetKeyCStr(_i, pOutLen); }
@@ -461,50 +1498,154 @@ public:
 			DATO_FORCEINLINE DynamicAccessor GetValue() const { return _obj->GetValueByIndex(_i); }
 		};
 
-		using MapAccessor::MapAccessor;
+		using MapAccessor::_r;
+		using MapAccessor::_size;
+		using MapAccessor::_objpos;
+		using MapAccessor::_start;
+		using MapAccessor::GetValueByIndex;
+
+		Pos _hashTable = 0; // the position of the hash table (0 if the map does not have one)
+		Pos _hashMask = 0; // the number of buckets - 1
+
+		DATO_FORCEINLINE StringMapAccessor() {}
+		StringMapAccessor(const Reader* r, Pos pos, u8 type = TYPE_StringMap) : MapAccessor(r, pos)
+		{
+			if (type == TYPE_StringHashMap && _r)
+			{
+				Pos table = r->_HashTablePos(_objpos, _size);
+				u64 numBuckets = HashMapBucketCount(_size);
+				if (!r->_Expect(r->_InRange(table, numBuckets, 5)))
+				{
+					*this = {};
+					return;
+				}
+				_hashTable = table;
+				_hashMask = Pos(numBuckets - 1);
+			}
+		}
+
+		DATO_FORCEINLINE bool HasHashTable() const { return _hashTable != 0; }
+
+		// prefetching (see SetPrefetchDistance)
+		DATO_FORCEINLINE void _Prefetch(size_t i) const
+		{
+			if (i >= _size)
+				return;
+			Pos kpos = _r->template RD<Pos>(_objpos + Pos(i) * SlotSize);
+			if (Source::Direct && kpos < _r->_len)
+				DATO_PREFETCH(_r->_data + kpos);
+			MapAccessor::_PrefetchValue(i);
+		}
+		DATO_FORCEINLINE Pos _PrefetchStart() const
+		{
+			Pos ahead = _r ? Pos(_r->_prefetchDistance) : 0;
+			if (DATO_UNLIKELY(ahead))
+				_PrefetchFirst(ahead);
+			return ahead;
+		}
+		DATO_NOINLINE void _PrefetchFirst(Pos n) const
+		{
+			for (Pos i = 0; i < n && i < _size; i++)
+				_Prefetch(i);
+		}
 
-		DATO_FORCEINLINE Iterator begin() const { return { this, 0 }; }
-		DATO_FORCEINLINE Iterator end() const { return { this, _size }; }
+		DATO_FORCEINLINE Iterator begin() const { return { this, 0, _PrefetchStart() }; }
+		DATO_FORCEINLINE Iterator end() const { return { this, _size, 0 }; }
 
 		DATO_FORCEINLINE Iterator operator [](size_t i) const
 		{
 			DATO_INPUT_EXPECT(i < _size);
-			return { this, u32(i) };
+			return { this, Pos(i), 0 };
 		}
 
 		// retrieving keys
 		const char* GetKeyCStr(size_t i, u32* pOutLen = nullptr) const
 		{
+			DATO_READER_DIRECT_ONLY;
 			auto* BR = _r;
-			DATO_INPUT_EXPECT(i < _size);
-			u32 kpos = BR->RD<u32>(_objpos + u32(i) * 4);
-			u32 L = BR->_cfg.ReadKeyLength(BR->_data, BR->_len, kpos);
+			if (!Reader::_ExpectInput(BR, i < _size))
+				return GetEmptyKey(pOutLen);
+			Pos kpos = BR->template RD<Pos>(_objpos + Pos(i) * SlotSize);
+			Pos L = BR->_ReadKeyLength(kpos);
+			if (!BR->_Expect(BR->_KeyInRange(kpos, L)))
+				return GetEmptyKey(pOutLen);
 			if (pOutLen)
-				*pOutLen = L;
-			DATO_BUFFER_EXPECT(kpos + L + 1 <= _r->_len);
+				*pOutLen = u32(L);
 			return &BR->_data[kpos];
 		}
+		static const char* GetEmptyKey(u32* pOutLen)
+		{
+			if (pOutLen)
+				*pOutLen = 0;
+			return "";
+		}
+		// copies up to `bufSize - 1` bytes of the key and a 0-terminator, returns the full length
+		u32 GetKey(size_t i, char* outBuf, size_t bufSize) const
+		{
+			if (bufSize)
+				outBuf[0] = 0;
+			auto* BR = _r;
+			if (!Reader::_ExpectInput(BR, i < _size))
+				return 0;
+			Pos kpos = BR->template RD<Pos>(_objpos + Pos(i) * SlotSize);
+			Pos L = BR->_ReadKeyLength(kpos);
+			if (!BR->_Expect(BR->_KeyInRange(kpos, L)))
+				return 0;
+			if (bufSize)
+			{
+				Pos n = L < bufSize - 1 ? L : Pos(bufSize - 1);
+				if (!BR->_ReadBytes(outBuf, kpos, n))
+					n = 0;
+				outBuf[n] = 0;
+			}
+			return u32(L);
+		}
 		DATO_FORCEINLINE u32 GetKeyLength(size_t i) const
 		{
-			u32 ret;
-			GetKeyCStr(i, &ret);
-			return ret;
+			return GetKey(i, nullptr, 0);
 		}
 
 		// searching for values
-		DATO_NOINLINE DynamicAccessor FindValueByKey(const char* keyToFind) const
+		// - one hash and usually one key comparison with a hash table
+		// - with a known key position (`kpos` != 0), the positions are compared first and, if the keys ..
+		// .. are unique (FLAG_UniqueKeys), the strings are not compared at all
+		DATO_NOINLINE Pos _FindIndexByHash(const void* keyToFind, size_t lenKeyToFind, u32 hash, Pos kpos) const
+		{
+			auto* BR = _r;
+			u8 fp = KeyHashFingerprint(hash);
+			bool compareStrings = !kpos || !(BR->_flags & FLAG_UniqueKeys);
+			Pos fpTable = _hashTable + (_hashMask + 1) * 4;
+			// linear probing until an empty bucket (bounded in case the data has none)
+			Pos b = hash & _hashMask;
+			for (Pos n = 0; n <= _hashMask; n++, b = (b + 1) & _hashMask)
+			{
+				u8 bfp = BR->template RD<u8>(fpTable + b);
+				if (bfp == 0)
+					break;
+				if (bfp != fp)
+					continue;
+				u32 i = BR->template RD<u32>(_hashTable + b * 4);
+				if (!BR->_Expect(i < _size))
+					return _size;
+				Pos key = BR->template RD<Pos>(_objpos + Pos(i) * SlotSize);
+				if (key == kpos || (compareStrings && BR->KeyEquals(key, keyToFind, lenKeyToFind)))
+					return i;
+			}
+			return _size;
+		}
+		DATO_NOINLINE Pos _FindIndexByKey(const char* keyToFind) const
 		{
 			auto* BR = _r;
 			if (BR->_flags & FLAG_SortedKeys)
 			{
-				u32 L = 0, R = _size;
+				Pos L = 0, R = _size;
 				while (L < R)
 				{
-					u32 M = (L + R) / 2;
-					u32 keyM = BR->RD<u32>(_objpos + M * 4);
+					Pos M = (L + R) / 2;
+					Pos keyM = BR->template RD<Pos>(_objpos + M * SlotSize);
 					int diff = BR->KeyCompare(keyM, keyToFind);
 					if (diff == 0)
-						return GetValueByIndex(M);
+						return M;
 					if (diff < 0)
 						R = M;
 					else
@@ -513,28 +1654,28 @@ public:
 			}
 			else
 			{
-				for (u32 i = 0; i < _size; i++)
+				for (Pos i = 0; i < _size; i++)
 				{
-					u32 key = BR->RD<u32>(_objpos + i * 4);
+					Pos key = BR->template RD<Pos>(_objpos + i * SlotSize);
 					if (BR->KeyEquals(key, keyToFind))
-						return GetValueByIndex(i);
+						return i;
 				}
 			}
-			return {};
+			return _size;
 		}
-		DATO_NOINLINE DynamicAccessor FindValueByKey(const void* keyToFind, size_t lenKeyToFind) const
+		DATO_NOINLINE Pos _FindIndexByKey(const void* keyToFind, size_t lenKeyToFind) const
 		{
 			auto* BR = _r;
 			if (BR->_flags & FLAG_SortedKeys)
 			{
-				u32 L = 0, R = _size;
+				Pos L = 0, R = _size;
 				while (L < R)
 				{
-					u32 M = (L + R) / 2;
-					u32 keyM = BR->RD<u32>(_objpos + M * 4);
+					Pos M = (L + R) / 2;
+					Pos keyM = BR->template RD<Pos>(_objpos + M * SlotSize);
 					int diff = BR->KeyCompare(keyM, keyToFind, lenKeyToFind);
 					if (diff == 0)
-						return GetValueByIndex(M);
+						return M;
 					if (diff < 0)
 						R = M;
 					else
@@ -543,26 +1684,135 @@ public:
 			}
 			else
 			{
-				for (u32 i = 0; i < _size; i++)
+				for (Pos i = 0; i < _size; i++)
 				{
-					u32 key = BR->RD<u32>(_objpos + i * 4);
+					Pos key = BR->template RD<Pos>(_objpos + i * SlotSize);
 					if (BR->KeyEquals(key, keyToFind, lenKeyToFind))
-						return GetValueByIndex(i);
+						return i;
 				}
 			}
+			return _size;
+		}
+		// finds the index of the key slot that contains `kpos`
+		DATO_FORCEINLINE Pos _FindIndexByKeyPos(Pos kpos) const
+		{
+			auto* BR = _r;
+#if DATO_SIMD
+			if (SlotSize == 4 && Source::Direct)
+				return GetFindKeyU32()(BR->_data + _objpos, u32(_size), u32(kpos));
+#endif
+			for (Pos i = 0; i < _size; i++)
+				if (BR->template RD<Pos>(_objpos + i * SlotSize) == kpos)
+					return i;
+			return _size;
+		}
+
+		DATO_FORCEINLINE DynamicAccessor FindValueByKey(const char* keyToFind) const
+		{
+			if (Checks == CHECKS_Error && !_r)
+				return {};
+			Pos i;
+			if (_hashTable)
+			{
+				size_t len = strlen(keyToFind);
+				i = _FindIndexByHash(keyToFind, len, KeyHash(keyToFind, len), 0);
+			}
+			else
+				i = _FindIndexByKey(keyToFind);
+			if (i < _size)
+				return GetValueByIndex(i);
+			return {};
+		}
+		DATO_FORCEINLINE DynamicAccessor FindValueByKey(const void* keyToFind, size_t lenKeyToFind) const
+		{
+			if (Checks == CHECKS_Error && !_r)
+				return {};
+			Pos i = _hashTable
+				? _FindIndexByHash(keyToFind, lenKeyToFind, KeyHash(keyToFind, lenKeyToFind), 0)
+				: _FindIndexByKey(keyToFind, lenKeyToFind);
+			if (i < _size)
+				return GetValueByIndex(i);
 			return {};
 		}
+		// compares key positions instead of strings once the handle is resolved (see Reader::ResolveKey)
+		// - the positions are scanned in small or unsorted maps, large sorted maps use the string search
+		DATO_NOINLINE DynamicAccessor FindValueByKey(KeyHandle& key) const
+		{
+			auto* BR = _r;
+			if (Checks == CHECKS_Error && !BR)
+				return {};
+			// (the handles are only resolved with the data in memory)
+			Pos kpos = Source::Direct && key.document == BR->_documentId ? key.pos : 0;
+			Pos i = _size;
+			if (_hashTable)
+				i = _FindIndexByHash(key.str, key.len, key.hash, kpos);
+			else if (kpos && (_size <= KEYHANDLE_ScanMax || !(BR->_flags & FLAG_SortedKeys)))
+			{
+				i = _FindIndexByKeyPos(kpos);
+				if (i == _size && !(BR->_flags & FLAG_UniqueKeys))
+					i = _FindIndexByKey(key.str, key.len);
+			}
+			else
+				i = _FindIndexByKey(key.str, key.len);
+			if (i >= _size)
+				return {};
+			if (!kpos && Source::Direct)
+			{
+				key.pos = BR->template RD<Pos>(_objpos + i * SlotSize);
+				key.document = BR->_documentId;
+			}
+			return GetValueByIndex(i);
+		}
+
+		// finds the values of `count` keys (empty for missing keys), returns the number of keys found
+		// - maps with sorted keys are walked once for queries sorted in the same order (by byte values, as strcmp)
+		DATO_NOINLINE size_t FindValuesByKeys(const char* const* keys, size_t count, DynamicAccessor* out) const
+		{
+			auto* BR = _r;
+			size_t numFound = 0;
+			if ((Checks == CHECKS_Error && !BR) || _hashTable || !(BR->_flags & FLAG_SortedKeys))
+			{
+				for (size_t q = 0; q < count; q++)
+				{
+					out[q] = FindValueByKey(keys[q]);
+					numFound += out[q].IsValid();
+				}
+				return numFound;
+			}
+			Pos next = 0;
+			for (size_t q = 0; q < count; q++)
+			{
+				const char* keyToFind = keys[q];
+				Pos i = GallopSortedKeys(_size, next, [&](Pos at)
+				{
+					return BR->KeyCompare(BR->template RD<Pos>(_objpos + at * SlotSize), keyToFind);
+				});
+				out[q] = i < _size ? GetValueByIndex(i) : DynamicAccessor();
+				numFound += i < _size;
+			}
+			return numFound;
+		}
 
-		DATO_NOINLINE void Iterate(IValueIterator& it)
+		DATO_NOINLINE void Iterate(IValueIterator& it) { Visit(it); }
+		template <class V> void Visit(V& it)
 		{
-			it.BeginMap(TYPE_StringMap, _size);
-			for (u32 i = 0; i < _size; i++)
+			it.BeginMap(TYPE_StringMap, u32(_size));
+			Pos ahead = _PrefetchStart();
+			Pos vpos = _objpos + _size * SlotSize;
+			Pos tpos = _objpos + _size * SlotSize * 2;
+			Pos pos[_DecodeChunkSize];
+			bool ok = true;
+			for (Pos i = 0; i < _size; i++)
 			{
+				if (i % _DecodeChunkSize == 0)
+					ok = _r->_DecodeChunk(_start, _objpos, vpos, tpos, i, _size, pos);
+				if (ahead)
+					_Prefetch(i + ahead);
 				u32 keyLength;
 				const char* key = GetKeyCStr(i, &keyLength);
 				it.BeginStringKey(key, keyLength);
 				{
-					GetValueByIndex(i).Iterate(it);
+					_r->template _DecodedSlot<DynamicAccessor>(_start, _objpos, vpos, tpos, i, pos[i % _DecodeChunkSize], ok).Visit(it);
 				}
 				it.EndStringKey();
 			}
@@ -571,75 +1821,240 @@ public:
 	};
 	struct IntMapAccessor : MapAccessor
 	{
-		struct Iterator
+		struct Iterator : RandomAccessIteratorBase<Iterator, Iterator>
 		{
-			const IntMapAccessor* _obj;
-			u32 _i;
+			const IntMapAccessor* _obj = nullptr;
+			Pos _i = 0;
+			Pos _ahead = 0; // the prefetch distance (0 = disabled)
+
+			DATO_FORCEINLINE Iterator() {}
+			DATO_FORCEINLINE Iterator(const IntMapAccessor* obj, Pos i, Pos ahead) : _obj(obj), _i(i), _ahead(ahead) {}
 
-			DATO_FORCEINLINE const Iterator& operator * () const { return *this; }
-			DATO_FORCEINLINE bool operator != (const Iterator& o) const { return _i != o._i; }
-			DATO_FORCEINLINE void operator ++ () { ++_i; }
+			// the entry is the iterator itself (a copy, so that it stays valid while the original is advanced)
+			DATO_FORCEINLINE Iterator operator * () const { return *this; }
+			DATO_FORCEINLINE void _Advance(ptrdiff_t n)
+			{
+				if (_ahead)
+					_obj->_Prefetch(_i + _ahead);
+				_i += Pos(n);
+			}
+			DATO_FORCEINLINE ptrdiff_t _Distance(const Iterator& o) const { return ptrdiff_t(_i) - ptrdiff_t(o._i); }
 
 			DATO_FORCEINLINE u32 GetKey() const { return _obj->GetKey(_i); }
 			DATO_FORCEINLINE DynamicAccessor GetValue() const { return _obj->GetValueByIndex(_i); }
 		};
 
 		using MapAccessor::MapAccessor;
+		using MapAccessor::_r;
+		using MapAccessor::_size;
+		using MapAccessor::_objpos;
+		using MapAccessor::_start;
 
-		DATO_FORCEINLINE Iterator begin() const { return { this, 0 }; }
-		DATO_FORCEINLINE Iterator end() const { return { this, _size }; }
+		DATO_FORCEINLINE Iterator begin() const { return { this, 0, _PrefetchStart() }; }
+		DATO_FORCEINLINE Iterator end() const { return { this, _size, 0 }; }
 
 		DATO_FORCEINLINE Iterator operator [](size_t i) const
 		{
 			DATO_INPUT_EXPECT(i < _size);
-			return { this, u32(i) };
+			return { this, Pos(i), 0 };
+		}
+
+		// indices are in the order of sorted keys, slots are in the stored order (different in Eytzinger order)
+		DATO_FORCEINLINE bool _IsEytzinger() const
+		{
+			return _size >= EYTZINGER_MinSize
+				&& (_r->_flags & (FLAG_SortedKeys | FLAG_EytzingerIntMaps)) == (FLAG_SortedKeys | FLAG_EytzingerIntMaps);
+		}
+		DATO_FORCEINLINE size_t _SlotFromIndex(size_t i) const
+		{
+			if (_IsEytzinger() && i < _size)
+				return EytzingerSlotFromRank(u32(i), u32(_size));
+			return i;
+		}
+
+		// prefetching (see SetPrefetchDistance)
+		DATO_FORCEINLINE void _Prefetch(size_t i) const
+		{
+			if (i < _size)
+				MapAccessor::_PrefetchValue(_SlotFromIndex(i));
+		}
+		DATO_FORCEINLINE Pos _PrefetchStart() const
+		{
+			Pos ahead = _r ? Pos(_r->_prefetchDistance) : 0;
+			if (DATO_UNLIKELY(ahead))
+				_PrefetchFirst(ahead);
+			return ahead;
+		}
+		DATO_NOINLINE void _PrefetchFirst(Pos n) const
+		{
+			for (Pos i = 0; i < n && i < _size; i++)
+				_Prefetch(i);
+		}
+
+		// retrieving values
+		DATO_FORCEINLINE DynamicAccessor TryGetValueByIndex(size_t i) const
+		{
+			if (i >= _size)
+				return {};
+			return GetValueByIndex(i);
+		}
+		DATO_FORCEINLINE DynamicAccessor GetValueByIndex(size_t i) const
+		{
+			return MapAccessor::GetValueByIndex(_SlotFromIndex(i));
+		}
+		// decodes the values [begin; begin + count) (clamped to the size) at once, in the order of the indices
+		// - returns the number of values written to `out`
+		size_t DecodeSlots(size_t begin, size_t count, DynamicAccessor* out) const
+		{
+			if (!_IsEytzinger())
+				return MapAccessor::DecodeSlots(begin, count, out);
+			if (begin >= _size)
+				return 0;
+			count = count < _size - begin ? count : _size - begin;
+			for (size_t i = 0; i < count; i++)
+				out[i] = GetValueByIndex(begin + i);
+			return count;
 		}
 
 		// retrieving keys
 		u32 GetKey(size_t i) const
 		{
-			DATO_INPUT_EXPECT(i < _size);
-			return _r->RD<u32>(_objpos + u32(i) * 4);
+			DATO_READER_INPUT_EXPECT(_r, i < _size);
+			return _r->template RD<u32>(_objpos + Pos(_SlotFromIndex(i)) * SlotSize); // (the low half of 64-bit slots)
 		}
 
 		// searching for values
 		DATO_NOINLINE DynamicAccessor FindValueByKey(u32 keyToFind) const
 		{
-			if (_r->_flags & FLAG_SortedKeys)
+			if (Checks == CHECKS_Error && !_r)
+				return {};
+			// the range of keys was checked by the constructor
+			const char* keys = Source::Direct ? _r->_data + _objpos : nullptr;
+			u32 count = u32(_size);
+			u32 slot = count;
+			if (!Source::Direct)
 			{
-				u32 L = 0, R = _size;
-				while (L < R)
+				slot = _FindSlotByReading(keyToFind);
+			}
+			else if (_IsEytzinger())
+			{
+				slot = FindKeyU32_Eytzinger<SlotSize>(keys, count, keyToFind);
+			}
+			else if (SlotSize == 4 && DATO_SIMD)
+			{
+				slot = (_r->_flags & FLAG_SortedKeys)
+					? FindKeyU32_Sorted(GetFindKeyU32(), keys, count, keyToFind)
+					: GetFindKeyU32()(keys, count, keyToFind);
+			}
+			else if (_r->_flags & FLAG_SortedKeys)
+			{
+				u32 n = count;
+				u32 base = NarrowSortedKeysU32<SlotSize>(keys, n, keyToFind, 4);
+				for (u32 i = base; i <= base + n && i < count; i++)
 				{
-					u32 M = (L + R) / 2;
-					u32 keyM = _r->RD<u32>(_objpos + M * 4);
-					if (keyToFind == keyM)
-						return GetValueByIndex(M);
-					if (keyToFind < keyM)
-						R = M;
-					else
-						L = M + 1;
+					if (ReadT<u32>(keys + i * SlotSize) == keyToFind)
+					{
+						slot = i;
+						break;
+					}
 				}
 			}
 			else
 			{
-				for (u32 i = 0; i < _size; i++)
+				for (u32 i = 0; i < count; i++)
 				{
-					u32 key = _r->RD<u32>(_objpos + i * 4);
-					if (key == keyToFind)
-						return GetValueByIndex(i);
+					if (ReadT<u32>(keys + i * SlotSize) == keyToFind)
+					{
+						slot = i;
+						break;
+					}
 				}
 			}
+			if (slot < count)
+				return MapAccessor::GetValueByIndex(slot);
 			return {};
 		}
+		// the same searches with the keys read one at a time (for the sources that are not Direct)
+		DATO_NOINLINE u32 _FindSlotByReading(u32 keyToFind) const
+		{
+			u32 count = u32(_size);
+			auto keyAt = [this](u32 slot) { return _r->template RD<u32>(_objpos + Pos(slot) * SlotSize); };
+			if (_IsEytzinger())
+			{
+				u32 k = 1;
+				while (k <= count)
+					k = 2 * k + (keyAt(k - 1) < keyToFind);
+				k >>= CountTrailingZeroes(~k) + 1;
+				return k != 0 && keyAt(k - 1) == keyToFind ? k - 1 : count;
+			}
+			if (_r->_flags & FLAG_SortedKeys)
+			{
+				u32 next = 0;
+				return GallopSortedKeys(count, next, [&](u32 at)
+				{
+					u32 key = keyAt(at);
+					return keyToFind < key ? -1 : keyToFind > key ? 1 : 0;
+				});
+			}
+			for (u32 i = 0; i < count; i++)
+				if (keyAt(i) == keyToFind)
+					return i;
+			return count;
+		}
 
-		DATO_NOINLINE void Iterate(IValueIterator& it)
+		// finds the values of `count` keys (empty for missing keys), returns the number of keys found
+		// - maps with sorted keys are walked once for ascending queries
+		DATO_NOINLINE size_t FindValuesByKeys(const u32* keys, size_t count, DynamicAccessor* out) const
 		{
-			it.BeginMap(TYPE_IntMap, _size);
-			for (u32 i = 0; i < _size; i++)
+			size_t numFound = 0;
+			if ((Checks == CHECKS_Error && !_r) || !Source::Direct || _IsEytzinger() || !(_r->_flags & FLAG_SortedKeys))
+			{
+				for (size_t q = 0; q < count; q++)
+				{
+					out[q] = FindValueByKey(keys[q]);
+					numFound += out[q].IsValid();
+				}
+				return numFound;
+			}
+			// the range of keys was checked by the constructor
+			const char* mapKeys = _r->_data + _objpos;
+			u32 mapCount = u32(_size);
+			u32 next = 0;
+			for (size_t q = 0; q < count; q++)
+			{
+				u32 keyToFind = keys[q];
+				u32 i = GallopSortedKeys(mapCount, next, [&](u32 at)
+				{
+					u32 key = ReadT<u32>(mapKeys + at * SlotSize);
+					return keyToFind < key ? -1 : keyToFind > key ? 1 : 0;
+				});
+				out[q] = i < mapCount ? MapAccessor::GetValueByIndex(i) : DynamicAccessor();
+				numFound += i < mapCount;
+			}
+			return numFound;
+		}
+
+		DATO_NOINLINE void Iterate(IValueIterator& it) { Visit(it); }
+		template <class V> void Visit(V& it)
+		{
+			it.BeginMap(TYPE_IntMap, u32(_size));
+			Pos ahead = _PrefetchStart();
+			// (the values are decoded in chunks unless the index order is different from the slot order)
+			bool eytzinger = _IsEytzinger();
+			Pos vpos = _objpos + _size * SlotSize;
+			Pos tpos = _objpos + _size * SlotSize * 2;
+			Pos pos[_DecodeChunkSize];
+			bool ok = true;
+			for (Pos i = 0; i < _size; i++)
 			{
+				if (i % _DecodeChunkSize == 0 && !eytzinger)
+					ok = _r->_DecodeChunk(_start, _objpos, vpos, tpos, i, _size, pos);
+				if (ahead)
+					_Prefetch(i + ahead);
 				it.BeginIntKey(GetKey(i));
 				{
-					GetValueByIndex(i).Iterate(it);
+					(eytzinger ? GetValueByIndex(i)
+						: _r->template _DecodedSlot<DynamicAccessor>(_start, _objpos, vpos, tpos, i, pos[i % _DecodeChunkSize], ok)).Visit(it);
 				}
 				it.EndIntKey();
 			}
@@ -648,36 +2063,79 @@ public:
 	};
 	struct ArrayAccessor
 	{
-		struct Iterator
+		struct Iterator : RandomAccessIteratorBase<Iterator, DynamicAccessor>
 		{
-			const ArrayAccessor* _obj;
-			u32 _i;
+			const ArrayAccessor* _obj = nullptr;
+			Pos _i = 0;
+			Pos _ahead = 0; // the prefetch distance (0 = disabled)
+
+			DATO_FORCEINLINE Iterator() {}
+			DATO_FORCEINLINE Iterator(const ArrayAccessor* obj, Pos i, Pos ahead) : _obj(obj), _i(i), _ahead(ahead) {}
 
 			DATO_FORCEINLINE DynamicAccessor operator * () const { return _obj->GetValueByIndex(_i); }
-			DATO_FORCEINLINE bool operator != (const Iterator& o) const { return _i != o._i; }
-			DATO_FORCEINLINE void operator ++ () { ++_i; }
+			DATO_FORCEINLINE void _Advance(ptrdiff_t n)
+			{
+				if (_ahead)
+					_obj->_Prefetch(_i + _ahead);
+				_i += Pos(n);
+			}
+			DATO_FORCEINLINE ptrdiff_t _Distance(const Iterator& o) const { return ptrdiff_t(_i) - ptrdiff_t(o._i); }
 		};
 
-		Reader* _r;
-		u32 _size;
-		u32 _arrpos;
+		const Reader* _r;
+		Pos _size;
+		Pos _arrpos;
+		Pos _start; // the position of the length (what references to the array point at)
 
-		DATO_FORCEINLINE ArrayAccessor() : _r(nullptr), _size(0), _arrpos(0) {}
-		ArrayAccessor(Reader* r, u32 pos) : _r(r)
+		DATO_FORCEINLINE ArrayAccessor() : _r(nullptr), _size(0), _arrpos(0), _start(0) {}
+		ArrayAccessor(const Reader* r, Pos pos) : _r(r)
 		{
 			_arrpos = pos;
-			_size = r->_cfg.ReadArrayLength(r->_data, r->_len, _arrpos);
-			DATO_BUFFER_EXPECT(pos + 5 * _size <= r->_len);
+			_start = pos;
+			_size = r->_ReadArrayLength(_arrpos);
+			if (!r->_Expect(r->_InRange(_arrpos, _size, SlotSize + 1)))
+				*this = {};
 		}
 
 		DATO_FORCEINLINE operator const void* () const { return _r; } // to support `if (init)` exprs
-		DATO_FORCEINLINE u32 GetSize() const { return _size; }
+		DATO_FORCEINLINE Pos GetSize() const { return _size; }
+		DATO_FORCEINLINE Pos size() const { return _size; } // for std::size and std::ranges::sized_range
 
-		DATO_FORCEINLINE Iterator begin() const { return { this, 0 }; }
-		DATO_FORCEINLINE Iterator end() const { return { this, _size }; }
+		DATO_FORCEINLINE Iterator begin() const { return { this, 0, _PrefetchStart() }; }
+		DATO_FORCEINLINE Iterator end() const { return { this, _size, 0 }; }
 
 		DATO_FORCEINLINE DynamicAccessor operator [](size_t i) const { return GetValueByIndex(i); }
 
+		// decodes the values [begin; begin + count) (clamped to the size) at once
+		// - returns the number of values written to `out`
+		size_t DecodeSlots(size_t begin, size_t count, DynamicAccessor* out) const
+		{
+			if (begin >= _size)
+				return 0;
+			count = count < _size - begin ? count : _size - begin;
+			_r->_DecodeSlots(_start, _arrpos, _arrpos, _arrpos + _size * SlotSize, Pos(begin), Pos(begin + count), out);
+			return count;
+		}
+
+		// prefetching (see SetPrefetchDistance)
+		DATO_FORCEINLINE void _Prefetch(size_t i) const
+		{
+			if (i < _size)
+				_r->_PrefetchSlot(_arrpos, _arrpos + Pos(i) * SlotSize, _arrpos + _size * SlotSize + Pos(i));
+		}
+		DATO_FORCEINLINE Pos _PrefetchStart() const
+		{
+			Pos ahead = _r ? Pos(_r->_prefetchDistance) : 0;
+			if (DATO_UNLIKELY(ahead))
+				_PrefetchFirst(ahead);
+			return ahead;
+		}
+		DATO_NOINLINE void _PrefetchFirst(Pos n) const
+		{
+			for (Pos i = 0; i < n && i < _size; i++)
+				_Prefetch(i);
+		}
+
 		// retrieving values
 		DATO_FORCEINLINE DynamicAccessor TryGetValueByIndex(size_t i) const
 		{
@@ -687,24 +2145,37 @@ public:
 		}
 		DATO_FORCEINLINE DynamicAccessor GetValueByIndex(size_t i) const
 		{
-			DATO_INPUT_EXPECT(i < _size);
-			u32 vpos = _arrpos + u32(i) * 4;
-			u32 tpos = _arrpos + _size * 4 + u32(i);
-			u32 val = _r->RD<u32>(vpos);
+			DATO_READER_INPUT_EXPECT(_r, i < _size);
+			Pos vpos = _arrpos + Pos(i) * SlotSize;
+			Pos tpos = _arrpos + _size * SlotSize + Pos(i);
+			Pos val = _r->template RD<Pos>(vpos);
 			u8 type = _r->RD<u8>(tpos);
 			if (IsReferenceType(type))
+			{
+				if (Checks == CHECKS_Error && !_r->_Expect(IsBackReference(_start, _arrpos, val)))
+					return {};
 				val = _arrpos - val;
+			}
 			return { _r, val, type };
 		}
 
-		DATO_NOINLINE void Iterate(IValueIterator& it)
+		DATO_NOINLINE void Iterate(IValueIterator& it) { Visit(it); }
+		template <class V> void Visit(V& it)
 		{
-			it.BeginArray(_size);
-			for (u32 i = 0; i < _size; i++)
+			it.BeginArray(u32(_size));
+			Pos ahead = _PrefetchStart();
+			Pos tpos = _arrpos + _size * SlotSize;
+			Pos pos[_DecodeChunkSize];
+			bool ok = true;
+			for (Pos i = 0; i < _size; i++)
 			{
-				it.BeginArrayIndex(i);
+				if (i % _DecodeChunkSize == 0)
+					ok = _r->_DecodeChunk(_start, _arrpos, _arrpos, tpos, i, _size, pos);
+				if (ahead)
+					_Prefetch(i + ahead);
+				it.BeginArrayIndex(u32(i));
 				{
-					GetValueByIndex(i).Iterate(it);
+					_r->template _DecodedSlot<DynamicAccessor>(_start, _arrpos, _arrpos, tpos, i, pos[i % _DecodeChunkSize], ok).Visit(it);
 				}
 				it.EndArrayIndex();
 			}
@@ -714,29 +2185,38 @@ public:
 	template <class T>
 	struct TypedArrayAccessor
 	{
-		struct Iterator
+		struct Iterator : RandomAccessIteratorBase<Iterator, T>
 		{
-			const T* _ptr;
+			const T* _ptr = nullptr;
+
+			DATO_FORCEINLINE Iterator() {}
+			DATO_FORCEINLINE Iterator(const T* ptr) : _ptr(ptr) {}
 
 			DATO_FORCEINLINE T operator * () const { return ReadT<T>(_ptr); }
-			DATO_FORCEINLINE bool operator != (const Iterator& o) const { return _ptr != o._ptr; }
-			DATO_FORCEINLINE void operator ++ () { ++_ptr; }
+			DATO_FORCEINLINE void _Advance(ptrdiff_t n) { _ptr += n; }
+			DATO_FORCEINLINE ptrdiff_t _Distance(const Iterator& o) const { return _ptr - o._ptr; }
 		};
 
 		const T* _data;
-		u32 _size;
+		Pos _size;
 
 		DATO_FORCEINLINE TypedArrayAccessor() : _data(nullptr), _size(0) {}
-		TypedArrayAccessor(Reader* r, u32 pos)
+		TypedArrayAccessor(const Reader* r, Pos pos)
 		{
-			_size = r->_cfg.ReadValueLength(r->_data, r->_len, pos);
-			DATO_BUFFER_EXPECT(pos + sizeof(T) * _size <= r->_len);
+			DATO_READER_DIRECT_ONLY;
+			_size = r->_ReadValueLength(pos);
+			if (!r->_Expect(r->_InRange(pos, _size, sizeof(T))))
+			{
+				*this = {};
+				return;
+			}
 			// will not be dereferenced until ReadT but casting early for simplified code
 			_data = (const T*) (const void*) (r->_data + pos);
 		}
 
 		DATO_FORCEINLINE operator const void* () const { return _data; } // to support `if (init)` exprs
-		DATO_FORCEINLINE u32 GetSize() const { return _size; }
+		DATO_FORCEINLINE Pos GetSize() const { return _size; }
+		DATO_FORCEINLINE Pos size() const { return _size; } // for std::size and std::ranges::sized_range
 
 		DATO_FORCEINLINE Iterator begin() const { return { _data }; }
 		DATO_FORCEINLINE Iterator end() const { return { _data + _size }; }
@@ -746,43 +2226,52 @@ public:
 	struct ByteArrayAccessor : TypedArrayAccessor<u8>
 	{
 		using TypedArrayAccessor<u8>::TypedArrayAccessor;
+		using TypedArrayAccessor<u8>::_data;
+		using TypedArrayAccessor<u8>::_size;
 
 		DATO_FORCEINLINE const u8* GetData() const { return _data; }
 		DATO_FORCEINLINE const u8* begin() const { return _data; }
 		DATO_FORCEINLINE const u8* end() const { return _data + _size; }
 
-		void Iterate(IValueIterator& it)
+		void Iterate(IValueIterator& it) { Visit(it); }
+		template <class V> void Visit(V& it)
 		{
-			it.OnValueByteArray(this->_data, this->_size);
+			it.OnValueByteArray(this->_data, u32(this->_size));
 		}
 	};
 	struct String8Accessor : TypedArrayAccessor<char>
 	{
 		using TypedArrayAccessor<char>::TypedArrayAccessor;
+		using TypedArrayAccessor<char>::_data;
+		using TypedArrayAccessor<char>::_size;
 
 		DATO_FORCEINLINE const char* GetData() const { return _data; }
 		DATO_FORCEINLINE const char* begin() const { return _data; }
 		DATO_FORCEINLINE const char* end() const { return _data + _size; }
 
-		void Iterate(IValueIterator& it)
+		void Iterate(IValueIterator& it) { Visit(it); }
+		template <class V> void Visit(V& it)
 		{
-			it.OnValueString(_data, _size);
+			it.OnValueString(_data, u32(_size));
 		}
 	};
 	template <class T> struct StringAccessor : TypedArrayAccessor<T>
 	{
 		using TypedArrayAccessor<T>::TypedArrayAccessor;
 
-		void Iterate(IValueIterator& it)
+		void Iterate(IValueIterator& it) { Visit(it); }
+		template <class V> void Visit(V& it)
 		{
-			it.OnValueString(this->_data, this->_size);
+			it.OnValueString(this->_data, u32(this->_size));
 		}
 	};
-	DATO_FORCEINLINE void ParseVectorAccessorPrefix(u32& pos, u8& outSubtype, u8& outElemCount)
+	DATO_FORCEINLINE bool ParseVectorAccessorPrefix(Pos& pos, u8& outSubtype, u8& outElemCount) const
 	{
-		DATO_BUFFER_EXPECT(pos + 2 <= _len);
+		if (!_Expect(_InRange(pos, 2, 1)))
+			return false;
 		outSubtype = RD<u8>(pos++);
 		outElemCount = RD<u8>(pos++);
+		return true;
 	}
 	template <class T>
 	struct VectorAccessor
@@ -792,9 +2281,14 @@ public:
 		u8 _elemCount;
 
 		DATO_FORCEINLINE VectorAccessor() : _data(nullptr), _subtype(0), _elemCount(0) {}
-		VectorAccessor(Reader* r, u32 pos, u8 st, u8 ec) : _subtype(st), _elemCount(ec)
+		VectorAccessor(const Reader* r, Pos pos, u8 st, u8 ec) : _subtype(st), _elemCount(ec)
 		{
-			DATO_BUFFER_EXPECT(pos + sizeof(T) * ec <= r->_len);
+			DATO_READER_DIRECT_ONLY;
+			if (!r->_Expect(r->_InRange(pos, ec, sizeof(T))))
+			{
+				*this = {};
+				return;
+			}
 			// will not be dereferenced until ReadT but casting early for simplified code
 			_data = (const T*) (const void*) (r->_data + pos);
 		}
@@ -813,7 +2307,8 @@ public:
 			memcpy(ret, _data, sizeof(T) * N);
 		}
 
-		void Iterate(IValueIterator& it)
+		void Iterate(IValueIterator& it) { Visit(it); }
+		template <class V> void Visit(V& it)
 		{
 			it.OnValueVector(_subtype, _elemCount, _data);
 		}
@@ -821,7 +2316,8 @@ public:
 	template <class T>
 	struct VectorArrayAccessor
 	{
-		struct Iterator
+		// one vector of the array
+		struct Element
 		{
 			const T* _ptr;
 			u8 elemCount;
@@ -831,96 +2327,219 @@ public:
 				DATO_INPUT_EXPECT(i < elemCount);
 				return ReadT<T>(&_ptr[i]);
 			}
-			DATO_FORCEINLINE const Iterator& operator * () const { return *this; }
-			DATO_FORCEINLINE bool operator != (const Iterator& o) const { return _ptr != o._ptr; }
-			DATO_FORCEINLINE void operator ++ () { _ptr += elemCount; }
+		};
+		struct Iterator : RandomAccessIteratorBase<Iterator, Element>
+		{
+			const T* _ptr = nullptr;
+			u8 elemCount = 0;
+
+			DATO_FORCEINLINE Iterator() {}
+			DATO_FORCEINLINE Iterator(const T* ptr, u8 ec) : _ptr(ptr), elemCount(ec) {}
+
+			DATO_FORCEINLINE Element operator * () const { return { _ptr, elemCount }; }
+			DATO_FORCEINLINE void _Advance(ptrdiff_t n) { _ptr += n * elemCount; }
+			DATO_FORCEINLINE ptrdiff_t _Distance(const Iterator& o) const
+			{ return elemCount ? (_ptr - o._ptr) / elemCount : 0; }
 		};
 
 		const T* _data;
 		u8 _subtype;
 		u8 _elemCount;
-		u32 _size;
+		Pos _size;
 
 		DATO_FORCEINLINE VectorArrayAccessor() : _data(nullptr), _subtype(0), _elemCount(0), _size(0) {}
-		VectorArrayAccessor(Reader* r, u32 pos, u8 st, u8 ec) : _subtype(st), _elemCount(ec)
+		VectorArrayAccessor(const Reader* r, Pos pos, u8 st, u8 ec) : _subtype(st), _elemCount(ec)
 		{
-			_size = r->_cfg.ReadValueLength(r->_data, r->_len, pos);
-			DATO_BUFFER_EXPECT(pos + sizeof(T) * _elemCount * _size <= r->_len);
+			DATO_READER_DIRECT_ONLY;
+			_size = r->_ReadValueLength(pos);
+			if (!r->_Expect(r->_InRange(pos, _size, sizeof(T) * _elemCount)))
+			{
+				*this = {};
+				return;
+			}
 			// will not be dereferenced until ReadT but casting early for simplified code
 			_data = (const T*) (const void*) (r->_data + pos);
 		}
 
 		DATO_FORCEINLINE operator const void* () const { return _data; } // to support `if (init)` exprs
 		DATO_FORCEINLINE u8 GetElementCount() const { return _elemCount; }
-		DATO_FORCEINLINE u32 GetSize() const { return _size; }
+		DATO_FORCEINLINE Pos GetSize() const { return _size; }
+		DATO_FORCEINLINE Pos size() const { return _size; } // for std::size and std::ranges::sized_range
 
 		DATO_FORCEINLINE Iterator begin() const { return { _data, _elemCount }; }
 		DATO_FORCEINLINE Iterator end() const { return { _data + _size * _elemCount, _elemCount }; }
 
 		DATO_FORCEINLINE T operator [](size_t i) const { return ReadT<T>(&_data[i]); }
-		DATO_FORCEINLINE void CopyTo(T* ret, u32 N, u32 elem = 0) const
+		DATO_FORCEINLINE void CopyTo(T* ret, Pos N, Pos elem = 0) const
 		{
 			DATO_INPUT_EXPECT(N + elem * _elemCount <= _size * _elemCount);
 			CopyTo_SkipChecks(ret, N, elem);
 		}
-		DATO_FORCEINLINE void CopyTo_SkipChecks(T* ret, u32 N, u32 elem = 0) const
+		DATO_FORCEINLINE void CopyTo_SkipChecks(T* ret, Pos N, Pos elem = 0) const
 		{
 			memcpy(ret, _data, sizeof(T) * (N + elem * _elemCount));
 		}
 
-		void Iterate(IValueIterator& it)
+		void Iterate(IValueIterator& it) { Visit(it); }
+		template <class V> void Visit(V& it)
 		{
-			it.OnValueVectorArray(_subtype, _elemCount, _data, _size);
+			it.OnValueVectorArray(_subtype, _elemCount, _data, u32(_size));
+		}
+	};
+	// strings, byte arrays and vectors with a source that is not Direct (the elements are copied out)
+	// - `_size` is the number of T elements (the string sizes do not include the 0-terminator)
+	template <class T>
+	struct CopyingArrayAccessor
+	{
+		const Reader* _r;
+		Pos _pos;
+		Pos _size;
+
+		DATO_FORCEINLINE CopyingArrayAccessor() : _r(nullptr), _pos(0), _size(0) {}
+		CopyingArrayAccessor(const Reader* r, Pos pos) : _r(r)
+		{
+			_size = r->_ReadValueLength(pos);
+			_pos = pos;
+			if (!r->_Expect(r->_InRange(_pos, _size, sizeof(T))))
+				*this = {};
+		}
+		// (a vector, see ParseVectorAccessorPrefix)
+		CopyingArrayAccessor(const Reader* r, Pos pos, u8 st, u8 ec) : _r(r), _pos(pos), _size(ec)
+		{
+			(void) st;
+			if (!r->_Expect(r->_InRange(_pos, _size, sizeof(T))))
+				*this = {};
+		}
+
+		DATO_FORCEINLINE operator const void* () const { return _r; } // to support `if (init)` exprs
+		DATO_FORCEINLINE Pos GetSize() const { return _size; }
+		DATO_FORCEINLINE Pos size() const { return _size; } // for std::size and std::ranges::sized_range
+
+		T operator [](size_t i) const
+		{
+			DATO_READER_INPUT_EXPECT(_r, i < _size);
+			return _r->template RD<T>(_pos + Pos(i) * sizeof(T));
+		}
+		// copies up to `count` elements starting from `first`, returns the number of elements copied
+		size_t CopyTo(T* out, size_t count, size_t first = 0) const
+		{
+			if (!_r || first >= _size)
+				return 0;
+			if (count > _size - first)
+				count = size_t(_size - first);
+			if (!_r->_ReadBytes(out, _pos + Pos(first) * sizeof(T), Pos(count) * sizeof(T)))
+				return 0;
+			return count;
+		}
+	};
+	template <class T>
+	struct CopyingVectorArrayAccessor : CopyingArrayAccessor<T>
+	{
+		u8 _elemCount;
+
+		DATO_FORCEINLINE CopyingVectorArrayAccessor() : _elemCount(0) {}
+		CopyingVectorArrayAccessor(const Reader* r, Pos pos, u8 st, u8 ec) : _elemCount(ec)
+		{
+			(void) st;
+			Pos size = r->_ReadValueLength(pos);
+			// (empty elements would not limit the length to the buffer size)
+			if (!r->_Expect(ec != 0 && r->_InRange(pos, size, sizeof(T) * ec)))
+				return;
+			this->_r = r;
+			this->_pos = pos;
+			this->_size = size * ec;
 		}
+
+		DATO_FORCEINLINE u8 GetElementCount() const { return _elemCount; }
+		// the number of vectors (the elements are indexed and copied as with CopyingArrayAccessor)
+		DATO_FORCEINLINE Pos GetSize() const { return _elemCount ? this->_size / _elemCount : 0; }
+		DATO_FORCEINLINE Pos size() const { return GetSize(); }
 	};
+	// the accessors that DynamicAccessor returns for the source
+	template <class A, class T> using _ArrayFor = typename SelectType<Source::Direct, A, CopyingArrayAccessor<T>>::Type;
+	template <class T> using _VectorArrayFor =
+		typename SelectType<Source::Direct, VectorArrayAccessor<T>, CopyingVectorArrayAccessor<T>>::Type;
+
 	struct DynamicAccessor
 	{
-		Reader* _r;
-		u32 _pos;
+		const Reader* _r;
+		Pos _pos;
 		u8 _type;
 
 		DATO_FORCEINLINE DynamicAccessor() : _r(nullptr), _pos(0), _type(TYPE_Null) {}
-		DATO_FORCEINLINE DynamicAccessor(Reader* r, u32 pos, u8 type)
+		DATO_FORCEINLINE DynamicAccessor(const Reader* r, Pos pos, u8 type)
 			: _r(r), _pos(pos), _type(type) {}
 
 		DATO_FORCEINLINE bool IsValid() const { return !!_r; }
 		DATO_FORCEINLINE operator const void* () const { return _r; } // to support `if (init)` exprs
 
-		DATO_NOINLINE void Iterate(IValueIterator& it)
+		// embedded values are stored in the low 32 bits of the slot
+		DATO_FORCEINLINE f32 _EmbeddedF32() const
+		{
+			u32 v = u32(_pos);
+			return ReadT<f32>(&v);
+		}
+		template <class T> DATO_FORCEINLINE T _Read64() const
+		{
+			if (!_r->_Expect(_r->_InRange(_pos, 1, 8)))
+				return T(0);
+			return _r->template RD<T>(_pos);
+		}
+
+		// traverses the value and its subvalues, calling the callbacks of the iterator or visitor
+		// - Visit calls the callbacks of V directly (see ValueVisitor), Iterate calls them virtually
+		DATO_NOINLINE void Iterate(IValueIterator& it) { Visit(it); }
+		template <class V> void Visit(V& it)
 		{
+			DATO_READER_DIRECT_ONLY;
 			switch (_type)
 			{
 			case TYPE_Null: it.OnValueNull(); break;
 			case TYPE_Bool: it.OnValueBool(_pos != 0); break;
-			case TYPE_S32: it.OnValueS32(_pos); break;
-			case TYPE_U32: it.OnValueU32(_pos); break;
-			case TYPE_F32: it.OnValueF32(ReadT<f32>(&_pos)); break;
-			case TYPE_S64: it.OnValueS64(_r->RD<s64>(_pos)); break;
-			case TYPE_U64: it.OnValueU64(_r->RD<u64>(_pos)); break;
-			case TYPE_F64: it.OnValueF64(_r->RD<f64>(_pos)); break;
-			case TYPE_Array: ArrayAccessor(_r, _pos).Iterate(it); break;
-			case TYPE_StringMap: StringMapAccessor(_r, _pos).Iterate(it); break;
-			case TYPE_IntMap: IntMapAccessor(_r, _pos).Iterate(it); break;
-			case TYPE_String8: String8Accessor(_r, _pos).Iterate(it); break;
-			case TYPE_String16: StringAccessor<u16>(_r, _pos).Iterate(it); break;
-			case TYPE_String32: StringAccessor<u32>(_r, _pos).Iterate(it); break;
-			case TYPE_ByteArray: ByteArrayAccessor(_r, _pos).Iterate(it); break;
+			case TYPE_S32: it.OnValueS32(s32(_pos)); break;
+			case TYPE_U32: it.OnValueU32(u32(_pos)); break;
+			case TYPE_F32: it.OnValueF32(_EmbeddedF32()); break;
+			case TYPE_S64: it.OnValueS64(_Read64<s64>()); break;
+			case TYPE_U64: it.OnValueU64(_Read64<u64>()); break;
+			case TYPE_F64: it.OnValueF64(_Read64<f64>()); break;
+			case TYPE_Array: ArrayAccessor(_r, _pos).Visit(it); break;
+			case TYPE_StringMap:
+			case TYPE_StringHashMap: StringMapAccessor(_r, _pos, _type).Visit(it); break;
+			case TYPE_IntMap: IntMapAccessor(_r, _pos).Visit(it); break;
+			case TYPE_String8: String8Accessor(_r, _pos).Visit(it); break;
+			case TYPE_String16: StringAccessor<u16>(_r, _pos).Visit(it); break;
+			case TYPE_String32: StringAccessor<u32>(_r, _pos).Visit(it); break;
+			case TYPE_ByteArray: ByteArrayAccessor(_r, _pos).Visit(it); break;
 			case TYPE_Vector: {
-				DATO_BUFFER_EXPECT(_pos + 2 <= _r->_len);
-				u8 subtype = _r->RD<u8>(_pos);
-				u8 elemCount = _r->RD<u8>(_pos + 1);
-				it.OnValueVector(subtype, elemCount, _r->_data + _pos + 2);
+				Pos vpos = _pos;
+				u8 subtype, elemCount;
+				if (!_r->ParseVectorAccessorPrefix(vpos, subtype, elemCount)
+					|| !_r->_Expect(_r->_InRange(vpos, elemCount, SubtypeGetSize(subtype))))
+				{
+					it.OnValueNull();
+					break;
+				}
+				it.OnValueVector(subtype, elemCount, _r->_data + vpos);
 				break; }
 			case TYPE_VectorArray: {
-				DATO_BUFFER_EXPECT(_pos + 2 <= _r->_len);
-				u32 vpos = _pos;
-				u8 subtype = _r->RD<u8>(vpos++);
-				u8 elemCount = _r->RD<u8>(vpos++);
-				u32 _size = _r->_cfg.ReadValueLength(_r->_data, _r->_len, vpos);
-				DATO_BUFFER_EXPECT(vpos + SubtypeGetSize(subtype) * elemCount * _size <= _r->_len);
-				it.OnValueVectorArray(subtype, elemCount, _r->_data + vpos, _size);
+				Pos vpos = _pos;
+				u8 subtype, elemCount;
+				if (!_r->ParseVectorAccessorPrefix(vpos, subtype, elemCount))
+				{
+					it.OnValueNull();
+					break;
+				}
+				Pos _size = _r->_ReadValueLength(vpos);
+				// (empty elements would not limit the length to the buffer size)
+				u32 elemSize = SubtypeGetSize(subtype) * elemCount;
+				if (!_r->_Expect(elemSize != 0 && _r->_InRange(vpos, _size, elemSize)))
+				{
+					it.OnValueNull();
+					break;
+				}
+				it.OnValueVectorArray(subtype, elemCount, _r->_data + vpos, u32(_size));
 				break; }
-			default: it.OnUnknownValue(_type, _pos, _r->_data, _r->_len); break;
+			default: it.OnUnknownValue(_type, u32(_pos), _r->_data, u32(_r->_len)); break;
 			}
 		}
 
@@ -928,14 +2547,16 @@ public:
 		DATO_FORCEINLINE u8 GetType() const { return _type; }
 		inline u8 GetSubtype() const
 		{
-			DATO_INPUT_EXPECT(_type == TYPE_Vector || _type == TYPE_VectorArray);
-			DATO_BUFFER_EXPECT(_pos + 2 <= _r->_len);
+			DATO_READER_INPUT_EXPECT(_r, _type == TYPE_Vector || _type == TYPE_VectorArray);
+			if (!_r->_Expect(_r->_InRange(_pos, 2, 1)))
+				return 0;
 			return _r->RD<u8>(_pos);
 		}
 		inline u8 GetElementCount() const
 		{
-			DATO_INPUT_EXPECT(_type == TYPE_Vector || _type == TYPE_VectorArray);
-			DATO_BUFFER_EXPECT(_pos + 2 <= _r->_len);
+			DATO_READER_INPUT_EXPECT(_r, _type == TYPE_Vector || _type == TYPE_VectorArray);
+			if (!_r->_Expect(_r->_InRange(_pos, 2, 1)))
+				return 0;
 			return _r->RD<u8>(_pos + 1);
 		}
 
@@ -957,7 +2578,8 @@ public:
 		{
 			if (_type == TYPE_Vector)
 			{
-				DATO_BUFFER_EXPECT(_pos + 2 <= _r->_len);
+				if (!_r->_Expect(_r->_InRange(_pos, 2, 1)))
+					return false;
 				return _r->RD<u8>(_pos) == subtype
 					&& _r->RD<u8>(_pos + 1) == elemCount;
 			}
@@ -971,7 +2593,8 @@ public:
 		{
 			if (_type == TYPE_VectorArray)
 			{
-				DATO_BUFFER_EXPECT(_pos + 2 <= _r->_len);
+				if (!_r->_Expect(_r->_InRange(_pos, 2, 1)))
+					return false;
 				return _r->RD<u8>(_pos) == subtype
 					&& _r->RD<u8>(_pos + 1) == elemCount;
 			}
@@ -983,97 +2606,100 @@ public:
 		}
 
 		// reading the assumed exact data
-		inline bool AsBool() const { DATO_INPUT_EXPECT(_type == TYPE_Bool); return _pos != 0; }
-		inline s32 AsS32() const { DATO_INPUT_EXPECT(_type == TYPE_S32); return _pos; }
-		inline u32 AsU32() const { DATO_INPUT_EXPECT(_type == TYPE_U32); return _pos; }
-		inline f32 AsF32() const { DATO_INPUT_EXPECT(_type == TYPE_F32); return ReadT<f32>(&_pos); }
-		inline s64 AsS64() const { DATO_INPUT_EXPECT(_type == TYPE_S64); return _r->RD<s64>(_pos); }
-		inline u64 AsU64() const { DATO_INPUT_EXPECT(_type == TYPE_U64); return _r->RD<u64>(_pos); }
-		inline f64 AsF64() const { DATO_INPUT_EXPECT(_type == TYPE_F64); return _r->RD<f64>(_pos); }
-
+		inline bool AsBool() const { DATO_READER_INPUT_EXPECT(_r, _type == TYPE_Bool); return _pos != 0; }
+		inline s32 AsS32() const { DATO_READER_INPUT_EXPECT(_r, _type == TYPE_S32); return s32(_pos); }
+		inline u32 AsU32() const { DATO_READER_INPUT_EXPECT(_r, _type == TYPE_U32); return u32(_pos); }
+		inline f32 AsF32() const { DATO_READER_INPUT_EXPECT(_r, _type == TYPE_F32); return _EmbeddedF32(); }
+		inline s64 AsS64() const { DATO_READER_INPUT_EXPECT(_r, _type == TYPE_S64); return _Read64<s64>(); }
+		inline u64 AsU64() const { DATO_READER_INPUT_EXPECT(_r, _type == TYPE_U64); return _Read64<u64>(); }
+		inline f64 AsF64() const { DATO_READER_INPUT_EXPECT(_r, _type == TYPE_F64); return _Read64<f64>(); }
+
+		// (also accepts string hash maps)
 		inline StringMapAccessor AsStringMap() const
 		{
-			DATO_INPUT_EXPECT(_type == TYPE_StringMap);
-			return { _r, _pos };
+			DATO_READER_INPUT_EXPECT(_r, _type == TYPE_StringMap || _type == TYPE_StringHashMap);
+			return { _r, _pos, _type };
 		}
 		inline IntMapAccessor AsIntMap() const
 		{
-			DATO_INPUT_EXPECT(_type == TYPE_IntMap);
+			DATO_READER_INPUT_EXPECT(_r, _type == TYPE_IntMap);
 			return { _r, _pos };
 		}
 		inline ArrayAccessor AsArray() const
 		{
-			DATO_INPUT_EXPECT(_type == TYPE_Array);
+			DATO_READER_INPUT_EXPECT(_r, _type == TYPE_Array);
 			return { _r, _pos };
 		}
 
-		inline String8Accessor AsString8() const
+		inline _ArrayFor<String8Accessor, char> AsString8() const
 		{
-			DATO_INPUT_EXPECT(_type == TYPE_String8);
+			DATO_READER_INPUT_EXPECT(_r, _type == TYPE_String8);
 			return { _r, _pos };
 		}
-		inline StringAccessor<u16> AsString16() const
+		inline _ArrayFor<StringAccessor<u16>, u16> AsString16() const
 		{
-			DATO_INPUT_EXPECT(_type == TYPE_String16);
+			DATO_READER_INPUT_EXPECT(_r, _type == TYPE_String16);
 			return { _r, _pos };
 		}
-		inline StringAccessor<u32> AsString32() const
+		inline _ArrayFor<StringAccessor<u32>, u32> AsString32() const
 		{
-			DATO_INPUT_EXPECT(_type == TYPE_String32);
+			DATO_READER_INPUT_EXPECT(_r, _type == TYPE_String32);
 			return { _r, _pos };
 		}
-		inline ByteArrayAccessor AsByteArray() const
+		inline _ArrayFor<ByteArrayAccessor, u8> AsByteArray() const
 		{
-			DATO_INPUT_EXPECT(_type == TYPE_ByteArray);
+			DATO_READER_INPUT_EXPECT(_r, _type == TYPE_ByteArray);
 			return { _r, _pos };
 		}
 
-		template <class T> inline VectorAccessor<T> AsVector() const
+		template <class T> inline _ArrayFor<VectorAccessor<T>, T> AsVector() const
 		{
-			DATO_INPUT_EXPECT(_type == TYPE_Vector);
-			u32 pos = _pos;
+			DATO_READER_INPUT_EXPECT(_r, _type == TYPE_Vector);
+			Pos pos = _pos;
 			u8 subtype, elemCount;
-			_r->ParseVectorAccessorPrefix(pos, subtype, elemCount);
-			DATO_INPUT_EXPECT(subtype == SubtypeInfo<T>::Subtype);
+			if (!_r->ParseVectorAccessorPrefix(pos, subtype, elemCount))
+				return {};
+			DATO_READER_INPUT_EXPECT(_r, subtype == SubtypeInfo<T>::Subtype);
 			return { _r, pos, subtype, elemCount };
 		}
-		template <class T> inline VectorAccessor<T> AsVector(u16 expectedElemCount) const
+		template <class T> inline _ArrayFor<VectorAccessor<T>, T> AsVector(u16 expectedElemCount) const
 		{
-			DATO_INPUT_EXPECT(_type == TYPE_Vector);
-			u32 pos = _pos;
+			DATO_READER_INPUT_EXPECT(_r, _type == TYPE_Vector);
+			Pos pos = _pos;
 			u8 subtype, elemCount;
-			_r->ParseVectorAccessorPrefix(pos, subtype, elemCount);
-			DATO_INPUT_EXPECT(subtype == SubtypeInfo<T>::Subtype);
-			(void)expectedElemCount;
-			DATO_INPUT_EXPECT(elemCount == expectedElemCount);
+			if (!_r->ParseVectorAccessorPrefix(pos, subtype, elemCount))
+				return {};
+			DATO_READER_INPUT_EXPECT(_r, subtype == SubtypeInfo<T>::Subtype);
+			DATO_READER_INPUT_EXPECT(_r, elemCount == expectedElemCount);
 			return { _r, pos, subtype, elemCount };
 		}
-		template <class T> inline VectorArrayAccessor<T> AsVectorArray() const
+		template <class T> inline _VectorArrayFor<T> AsVectorArray() const
 		{
-			DATO_INPUT_EXPECT(_type == TYPE_VectorArray);
-			u32 pos = _pos;
+			DATO_READER_INPUT_EXPECT(_r, _type == TYPE_VectorArray);
+			Pos pos = _pos;
 			u8 subtype, elemCount;
-			_r->ParseVectorAccessorPrefix(pos, subtype, elemCount);
-			DATO_INPUT_EXPECT(subtype == SubtypeInfo<T>::Subtype);
+			if (!_r->ParseVectorAccessorPrefix(pos, subtype, elemCount))
+				return {};
+			DATO_READER_INPUT_EXPECT(_r, subtype == SubtypeInfo<T>::Subtype);
 			return { _r, pos, subtype, elemCount };
 		}
-		template <class T> inline VectorArrayAccessor<T> AsVectorArray(u16 expectedElemCount) const
+		template <class T> inline _VectorArrayFor<T> AsVectorArray(u16 expectedElemCount) const
 		{
-			DATO_INPUT_EXPECT(_type == TYPE_VectorArray);
-			u32 pos = _pos;
+			DATO_READER_INPUT_EXPECT(_r, _type == TYPE_VectorArray);
+			Pos pos = _pos;
 			u8 subtype, elemCount;
-			_r->ParseVectorAccessorPrefix(pos, subtype, elemCount);
-			DATO_INPUT_EXPECT(subtype == SubtypeInfo<T>::Subtype);
-			(void)expectedElemCount;
-			DATO_INPUT_EXPECT(elemCount == expectedElemCount);
+			if (!_r->ParseVectorAccessorPrefix(pos, subtype, elemCount))
+				return {};
+			DATO_READER_INPUT_EXPECT(_r, subtype == SubtypeInfo<T>::Subtype);
+			DATO_READER_INPUT_EXPECT(_r, elemCount == expectedElemCount);
 			return { _r, pos, subtype, elemCount };
 		}
 
 		// reading data with validation (to avoid double validation)
 		inline StringMapAccessor TryGetStringMap() const
 		{
-			if (_type == TYPE_StringMap)
-				return { _r, _pos };
+			if (_type == TYPE_StringMap || _type == TYPE_StringHashMap)
+				return { _r, _pos, _type };
 			return {};
 		}
 		inline IntMapAccessor TryGetIntMap() const
@@ -1089,75 +2715,71 @@ public:
 			return {};
 		}
 
-		inline String8Accessor TryGetString8() const
+		inline _ArrayFor<String8Accessor, char> TryGetString8() const
 		{
 			if (_type == TYPE_String8)
 				return { _r, _pos };
 			return {};
 		}
-		inline StringAccessor<u16> TryGetString16() const
+		inline _ArrayFor<StringAccessor<u16>, u16> TryGetString16() const
 		{
 			if (_type == TYPE_String16)
 				return { _r, _pos };
 			return {};
 		}
-		inline StringAccessor<u32> TryGetString32() const
+		inline _ArrayFor<StringAccessor<u32>, u32> TryGetString32() const
 		{
 			if (_type == TYPE_String32)
 				return { _r, _pos };
 			return {};
 		}
-		inline ByteArrayAccessor TryGetByteArray() const
+		inline _ArrayFor<ByteArrayAccessor, u8> TryGetByteArray() const
 		{
 			if (_type == TYPE_ByteArray)
 				return { _r, _pos };
 			return {};
 		}
 
-		template <class T> inline VectorAccessor<T> TryGetVector() const
+		template <class T> inline _ArrayFor<VectorAccessor<T>, T> TryGetVector() const
 		{
 			if (_type == TYPE_Vector)
 			{
-				u32 pos = _pos;
+				Pos pos = _pos;
 				u8 st, ec;
-				_r->ParseVectorAccessorPrefix(pos, st, ec);
-				if (st == SubtypeInfo<T>::Subtype)
+				if (_r->ParseVectorAccessorPrefix(pos, st, ec) && st == SubtypeInfo<T>::Subtype)
 					return { _r, pos, st, ec };
 			}
 			return {};
 		}
-		template <class T> inline VectorAccessor<T> TryGetVector(u16 expectedElemCount) const
+		template <class T> inline _ArrayFor<VectorAccessor<T>, T> TryGetVector(u16 expectedElemCount) const
 		{
 			if (_type == TYPE_Vector)
 			{
-				u32 pos = _pos;
+				Pos pos = _pos;
 				u8 st, ec;
-				_r->ParseVectorAccessorPrefix(pos, st, ec);
-				if (st == SubtypeInfo<T>::Subtype && ec == expectedElemCount)
+				if (_r->ParseVectorAccessorPrefix(pos, st, ec) && st == SubtypeInfo<T>::Subtype && ec == expectedElemCount)
 					return { _r, pos, st, ec };
 			}
 			return {};
 		}
-		template <class T> inline VectorArrayAccessor<T> TryGetVectorArray() const
+		template <class T> inline _VectorArrayFor<T> TryGetVectorArray() const
 		{
 			if (_type == TYPE_VectorArray)
 			{
-				u32 pos = _pos;
+				Pos pos = _pos;
 				u8 st, ec;
-				_r->ParseVectorAccessorPrefix(pos, st, ec);
-				if (st == SubtypeInfo<T>::Subtype)
+				if (_r->ParseVectorAccessorPrefix(pos, st, ec) && st == SubtypeInfo<T>::Subtype)
 					return { _r, pos, st, ec };
 			}
 			return {};
 		}
-		template <class T> inline VectorArrayAccessor<T> TryGetVectorArray(u16 expectedElemCount) const
+		template <class T> inline _VectorArrayFor<T> TryGetVectorArray(u16 expectedElemCount) const
 		{
 			if (_type == TYPE_VectorArray)
 			{
-				u32 pos = _pos;
+				Pos pos = _pos;
 				u8 st, ec;
-				_r->ParseVectorAccessorPrefix(pos, st, ec);
-				if (st == SubtypeInfo<T>::Subtype && ec == expectedElemCount)
+				if (_r->ParseVectorAccessorPrefix(pos, st, ec) && st == SubtypeInfo<T>::Subtype && ec == expectedElemCount)
 					return { _r, pos, st, ec };
 			}
 			return {};
@@ -1170,11 +2792,11 @@ public:
 			{
 			case TYPE_Bool: return T(_pos ? 1 : 0);
 			case TYPE_S32: return T(s32(_pos));
-			case TYPE_U32: return T(_pos);
-			case TYPE_F32: return T(ReadT<f32>(&_pos));
-			case TYPE_S64: return T(_r->RD<s64>(_pos));
-			case TYPE_U64: return T(_r->RD<u64>(_pos));
-			case TYPE_F64: return T(_r->RD<f64>(_pos));
+			case TYPE_U32: return T(u32(_pos));
+			case TYPE_F32: return T(_EmbeddedF32());
+			case TYPE_S64: return T(_Read64<s64>());
+			case TYPE_U64: return T(_Read64<u64>());
+			case TYPE_F64: return T(_Read64<f64>());
 			default: return T(0);
 			}
 		}
@@ -1185,17 +2807,18 @@ public:
 			case TYPE_Bool:
 			case TYPE_S32:
 			case TYPE_U32: return _pos != 0;
-			case TYPE_F32: return ReadT<f32>(&_pos) != 0;
+			case TYPE_F32: return _EmbeddedF32() != 0;
 			case TYPE_S64:
-			case TYPE_U64: return _r->RD<u64>(_pos) != 0;
-			case TYPE_F64: return _r->RD<f64>(_pos) != 0;
+			case TYPE_U64: return _Read64<u64>() != 0;
+			case TYPE_F64: return _Read64<f64>() != 0;
 			default: return false;
 			}
 		}
 	};
 
-	DATO_NOINLINE bool Init(const void* data, u32 len, const void* prefix = "DATO", u32 prefix_len = 4)
+	DATO_NOINLINE bool Init(const void* data, Pos len, const void* prefix = "DATO", u32 prefix_len = 4)
 	{
+		DATO_READER_DIRECT_ONLY;
 		if (prefix_len + 3 > len)
 			return false;
 
@@ -1205,12 +2828,11 @@ public:
 		const char* cdata = (const char*) data;
 		u32 rootpos = prefix_len + 3;
 		if (cdata[prefix_len + 1] & FLAG_Aligned)
-			rootpos = RoundUp(rootpos, 4);
-		DATO_BUFFER_EXPECT(rootpos + 4 <= len);
-		if (!(rootpos + 4 <= len))
+			rootpos = RoundUp(rootpos, SlotSize);
+		if (!(rootpos + SlotSize <= len))
 			return false;
 
-		u32 root = ReadT<u32>(cdata + rootpos);
+		Pos root = ReadT<Pos>(cdata + rootpos);
 
 		if (!_cfg.InitForReading(cdata[prefix_len]))
 			return false;
@@ -1221,16 +2843,367 @@ public:
 		_flags = cdata[prefix_len + 1];
 		_root = root;
 		_rootType = cdata[prefix_len + 2];
+		_error = false;
+		_documentId = NewDocumentId();
 		return true;
 	}
 
-	DynamicAccessor GetRoot()
+	// initializes the reader to read a source that is not Direct (`size` is the size of its data)
+	// - the header is read through the source, which must stay valid while the reader is used
+	DATO_NOINLINE bool InitSource(const Source& src, u64 size, const void* prefix = "DATO", u32 prefix_len = 4)
+	{
+		static_assert(!Source::Direct, "buffers in memory are read with Init");
+		if (size > u64(Pos(~Pos(0))) || u64(prefix_len) + 3 > size)
+			return false;
+
+		_src = src;
+		_len = Pos(size);
+		_error = false;
+		Pos rootpos = prefix_len + 3;
+		u8 flags = RD<u8>(prefix_len + 1);
+		if (flags & FLAG_Aligned)
+			rootpos = RoundUp(rootpos, SlotSize);
+		if (_CompareBytes(0, prefix, prefix_len) != 0
+			|| !HasBytesAt(_len, rootpos, SlotSize)
+			|| !_cfg.InitForReading(RD<u8>(prefix_len))
+			|| _error)
+		{
+			_src = {};
+			_len = 0;
+			return false;
+		}
+
+		// safe to init
+		_flags = flags;
+		_root = RD<Pos>(rootpos);
+		_rootType = RD<u8>(prefix_len + 2);
+		_documentId = NewDocumentId();
+		return !_error;
+	}
+
+	DynamicAccessor GetRoot() const
 	{
 		return { this, _root, _rootType };
 	}
+
+	// the buffer passed to Init
+	DATO_FORCEINLINE const char* GetData() const { DATO_READER_DIRECT_ONLY; return _data; }
+	DATO_FORCEINLINE Pos GetSize() const { return _len; }
+	// the source passed to InitSource
+	DATO_FORCEINLINE const Source& GetSource() const { return _src; }
+	// changes with each successful Init/InitSource (also for the same buffer), identifies the document ..
+	// .. for the objects that keep positions in it (KeyHandle, PathCache, StructBinding)
+	DATO_FORCEINLINE u64 GetDocumentId() const { return _documentId; }
+
+	// creates a handle for repeated lookups of the key (the string must stay valid while the handle is used)
+	// - the handle is resolved again in each document (see GetDocumentId), the reader must be ..
+	// .. initialized again if the contents of its buffer change
+	KeyHandle ResolveKey(const void* key, size_t len) const
+	{
+		return { (const char*) key, len, KeyHash(key, len), 0, 0 };
+	}
+	KeyHandle ResolveKey(const char* key) const
+	{
+		return ResolveKey(key, strlen(key));
+	}
+
+	// the number of elements ahead of the current one that the container iterators and Visit start loading
+	// - helps when the elements are scattered over a buffer that is not in the cache (0 = disabled)
+	// - the accessors read the setting from the reader when the iteration starts
+	DATO_FORCEINLINE void SetPrefetchDistance(u32 n) { _prefetchDistance = n; }
+	DATO_FORCEINLINE u32 GetPrefetchDistance() const { return _prefetchDistance; }
+
+	// whether any accessor has encountered invalid data or arguments since Init (only set in CHECKS_Error mode)
+	// - the values returned after that may be empty/zero instead of the actual data
+	DATO_FORCEINLINE bool HasError() const { return DATO_GET_FLAG(_error); }
+
+	// walks the entire tree once, checking every size, reference, key, alignment and terminator
+	// - on success, `out` is initialized to read the same buffer without any buffer checks
+	// - shared containers are only checked once (the work is linear in the buffer size)
+	// - `maxValues` limits the number of checked values (0 = the buffer size)
+	// - `maxDepth` limits the recursion depth (and the depth of the files that can be validated)
+	DATO_NOINLINE bool Validate(TrustedReader& out, u32 maxDepth = 256, u32 maxValues = 0) const
+	{
+		DATO_READER_DIRECT_ONLY;
+		if (!_data)
+			return false;
+		_ValidationState st(maxValues ? maxValues : _len);
+		if (!_ValidateValue(_root, _rootType, maxDepth, st))
+			return false;
+
+		out._cfg = _cfg;
+		out._data = _data;
+		out._len = _len;
+		out._flags = _flags;
+		out._root = _root;
+		out._rootType = _rootType;
+		out._prefetchDistance = _prefetchDistance;
+		return true;
+	}
+};
+
+// events of TreeCursor (the same as the callbacks of IValueIterator)
+static const u8 CURSOR_End = 0; // the traversal is finished
+static const u8 CURSOR_BeginMap = 1;
+static const u8 CURSOR_EndMap = 2;
+static const u8 CURSOR_BeginStringKey = 3;
+static const u8 CURSOR_EndStringKey = 4;
+static const u8 CURSOR_BeginIntKey = 5;
+static const u8 CURSOR_EndIntKey = 6;
+static const u8 CURSOR_BeginArray = 7;
+static const u8 CURSOR_EndArray = 8;
+static const u8 CURSOR_BeginArrayIndex = 9;
+static const u8 CURSOR_EndArrayIndex = 10;
+static const u8 CURSOR_Value = 11; // a value that is not a map or an array
+static const u8 CURSOR_TooDeep = 12; // containers nested deeper than MaxDepth (the traversal is stopped)
+
+// pull-style traversal without recursion, producing the same events as Iterate/Visit
+// - each call to Next returns the next event, whose data can be retrieved with the getters or ..
+// .. passed to a visitor/iterator with Emit
+// - the containers being traversed are kept in a fixed-size stack (no allocations)
+template <class R, u32 MaxDepth = 256>
+struct BasicTreeCursor
+{
+	typedef typename R::Pos Pos;
+	typedef typename R::DynamicAccessor DynamicAccessor;
+	typedef typename R::StringMapAccessor StringMapAccessor;
+	typedef typename R::IntMapAccessor IntMapAccessor;
+	typedef typename R::ArrayAccessor ArrayAccessor;
+
+	struct Frame
+	{
+		Pos pos; // the position after the size (as in the accessors)
+		Pos start; // the position of the size
+		Pos size;
+		Pos index;
+		u8 type; // TYPE_Array, TYPE_StringMap or TYPE_IntMap
+		bool inValue; // between the begin and end events of the key/index
+	};
+
+	const R* _r = nullptr;
+	DynamicAccessor _pending; // the value to traverse next
+	bool _hasPending = false;
+	u8 _event = CURSOR_End;
+	// the data of the current event
+	DynamicAccessor _value;
+	const char* _key = nullptr;
+	u32 _keyLength = 0;
+	u32 _intKey = 0;
+	Pos _index = 0;
+	Pos _size = 0;
+	u8 _mapType = 0;
+	u32 _depth = 0;
+	Frame _stack[MaxDepth];
+
+	BasicTreeCursor() {}
+	BasicTreeCursor(const DynamicAccessor& root) { Reset(root); }
+
+	void Reset(const DynamicAccessor& root)
+	{
+		_r = root._r;
+		_pending = root;
+		_hasPending = true;
+		_event = CURSOR_End;
+		_depth = 0;
+	}
+
+	// the number of maps/arrays that have begun but not ended
+	DATO_FORCEINLINE u32 Depth() const { return _depth; }
+	DATO_FORCEINLINE u8 GetEvent() const { return _event; }
+	// the value (CURSOR_Value) or the container (CURSOR_BeginMap/BeginArray)
+	DATO_FORCEINLINE const DynamicAccessor& GetValue() const { return _value; }
+	// the key (CURSOR_BeginStringKey)
+	DATO_FORCEINLINE const char* GetKeyCStr(u32* pOutLen = nullptr) const
+	{
+		if (pOutLen)
+			*pOutLen = _keyLength;
+		return _key;
+	}
+	DATO_FORCEINLINE u32 GetIntKey() const { return _intKey; } // (CURSOR_BeginIntKey)
+	DATO_FORCEINLINE Pos GetIndex() const { return _index; } // (CURSOR_BeginArrayIndex)
+	DATO_FORCEINLINE Pos GetSize() const { return _size; } // (CURSOR_BeginMap/BeginArray)
+	DATO_FORCEINLINE u8 GetMapType() const { return _mapType; } // (CURSOR_BeginMap/EndMap)
+
+	// after CURSOR_BeginMap/BeginArray, skips to the end of the container ..
+	// .. and after CURSOR_BeginStringKey/BeginIntKey/BeginArrayIndex, skips the value
+	void SkipChildren()
+	{
+		switch (_event)
+		{
+		case CURSOR_BeginMap:
+		case CURSOR_BeginArray:
+			_stack[_depth - 1].index = _stack[_depth - 1].size;
+			break;
+		case CURSOR_BeginStringKey:
+		case CURSOR_BeginIntKey:
+		case CURSOR_BeginArrayIndex:
+			_hasPending = false;
+			break;
+		}
+	}
+
+	u8 Next()
+	{
+		if (_hasPending)
+		{
+			_hasPending = false;
+			return _event = _BeginValue(_pending);
+		}
+		if (_depth == 0)
+			return _event = CURSOR_End;
+
+		Frame& f = _stack[_depth - 1];
+		if (f.inValue)
+		{
+			f.inValue = false;
+			f.index++;
+			switch (f.type)
+			{
+			case TYPE_Array: return _event = CURSOR_EndArrayIndex;
+			case TYPE_StringMap: return _event = CURSOR_EndStringKey;
+			default: return _event = CURSOR_EndIntKey;
+			}
+		}
+		if (f.index >= f.size)
+		{
+			_depth--;
+			_mapType = f.type;
+			return _event = f.type == TYPE_Array ? CURSOR_EndArray : CURSOR_EndMap;
+		}
+
+		f.inValue = true;
+		_hasPending = true;
+		switch (f.type)
+		{
+		case TYPE_Array: {
+			ArrayAccessor a;
+			a._r = _r;
+			a._size = f.size;
+			a._arrpos = f.pos;
+			a._start = f.start;
+			_index = f.index;
+			_pending = a.GetValueByIndex(f.index);
+			return _event = CURSOR_BeginArrayIndex; }
+		case TYPE_StringMap: {
+			StringMapAccessor m;
+			m._r = _r;
+			m._size = f.size;
+			m._objpos = f.pos;
+			m._start = f.start;
+			_key = m.GetKeyCStr(f.index, &_keyLength);
+			_pending = m.GetValueByIndex(f.index);
+			return _event = CURSOR_BeginStringKey; }
+		default: {
+			IntMapAccessor m;
+			m._r = _r;
+			m._size = f.size;
+			m._objpos = f.pos;
+			m._start = f.start;
+			_intKey = m.GetKey(f.index);
+			_pending = m.GetValueByIndex(f.index);
+			return _event = CURSOR_BeginIntKey; }
+		}
+	}
+
+	u8 _BeginValue(const DynamicAccessor& v)
+	{
+		_value = v;
+		switch (v.GetType())
+		{
+		case TYPE_Array: {
+			if (_depth >= MaxDepth)
+				return _Stop();
+			ArrayAccessor a(v._r, v._pos);
+			_stack[_depth++] = { a._arrpos, a._start, a._size, 0, TYPE_Array, false };
+			_size = a._size;
+			return CURSOR_BeginArray; }
+		case TYPE_StringMap:
+		case TYPE_StringHashMap: {
+			if (_depth >= MaxDepth)
+				return _Stop();
+			StringMapAccessor m(v._r, v._pos, v._type);
+			_stack[_depth++] = { m._objpos, m._start, m._size, 0, TYPE_StringMap, false };
+			_size = m._size;
+			_mapType = TYPE_StringMap;
+			return CURSOR_BeginMap; }
+		case TYPE_IntMap: {
+			if (_depth >= MaxDepth)
+				return _Stop();
+			IntMapAccessor m(v._r, v._pos);
+			_stack[_depth++] = { m._objpos, m._start, m._size, 0, TYPE_IntMap, false };
+			_size = m._size;
+			_mapType = TYPE_IntMap;
+			return CURSOR_BeginMap; }
+		default:
+			return CURSOR_Value;
+		}
+	}
+	u8 _Stop()
+	{
+		_depth = 0;
+		return CURSOR_TooDeep;
+	}
+
+	// calls the callback of the iterator/visitor that corresponds to the current event
+	template <class V> void Emit(V& it) const
+	{
+		switch (_event)
+		{
+		case CURSOR_BeginMap: it.BeginMap(_mapType, u32(_size)); break;
+		case CURSOR_EndMap: it.EndMap(_mapType); break;
+		case CURSOR_BeginStringKey: it.BeginStringKey(_key, _keyLength); break;
+		case CURSOR_EndStringKey: it.EndStringKey(); break;
+		case CURSOR_BeginIntKey: it.BeginIntKey(_intKey); break;
+		case CURSOR_EndIntKey: it.EndIntKey(); break;
+		case CURSOR_BeginArray: it.BeginArray(u32(_size)); break;
+		case CURSOR_EndArray: it.EndArray(); break;
+		case CURSOR_BeginArrayIndex: it.BeginArrayIndex(u32(_index)); break;
+		case CURSOR_EndArrayIndex: it.EndArrayIndex(); break;
+		case CURSOR_Value: DynamicAccessor(_value).Visit(it); break;
+		}
+	}
 };
 
+using DATO_CONCAT(Reader, DATO_CONFIG) = BasicReader<DATO_CONCAT(ReaderConfig, DATO_CONFIG), CHECKS_Default>;
+using DATO_CONCAT(TrustedReader, DATO_CONFIG) = BasicReader<DATO_CONCAT(ReaderConfig, DATO_CONFIG), CHECKS_None>;
+using DATO_CONCAT(SafeReader, DATO_CONFIG) = BasicReader<DATO_CONCAT(ReaderConfig, DATO_CONFIG), CHECKS_Error>;
 using Reader = DATO_CONCAT(Reader, DATO_CONFIG);
+using TrustedReader = DATO_CONCAT(TrustedReader, DATO_CONFIG);
+using SafeReader = DATO_CONCAT(SafeReader, DATO_CONFIG);
+using KeyHandle = BasicKeyHandle<DATO_CONCAT(ReaderConfig, DATO_CONFIG)>;
+using TreeCursor = BasicTreeCursor<Reader>;
+
+template <class Config, u8 Checks, class F>
+bool _ReadWithConfig(const void* data, size_t len, F& func, const void* prefix, u32 prefix_len)
+{
+	typedef typename Config::Pos Pos;
+	if (u64(len) > u64(Pos(~Pos(0))))
+		return false;
+	BasicReader<Config, Checks> r;
+	if (!r.Init(data, Pos(len), prefix, prefix_len))
+		return false;
+	func(r);
+	return true;
+}
+
+// reads the configuration identifier of the buffer and calls `func(reader)` with a reader that is ..
+// .. specialized for that configuration (unlike with ReaderConfigAdaptive, the sizes are read without indirect calls)
+// - `func` is instantiated for all configurations (e.g. a generic lambda: `[&](auto& r) { ... }`)
+// - returns false (without calling `func`) if the buffer could not be initialized for reading
+template <u8 Checks = CHECKS_Default, class F>
+bool ReadAnyConfig(const void* data, size_t len, F&& func, const void* prefix = "DATO", u32 prefix_len = 4)
+{
+	if (prefix_len + 3 > len)
+		return false;
+	switch (static_cast<const u8*>(data)[prefix_len])
+	{
+	case 0: return _ReadWithConfig<ReaderConfig0, Checks>(data, len, func, prefix, prefix_len);
+	case 1: return _ReadWithConfig<ReaderConfig1, Checks>(data, len, func, prefix, prefix_len);
+	case 2: return _ReadWithConfig<ReaderConfig2, Checks>(data, len, func, prefix, prefix_len);
+	case 3: return _ReadWithConfig<ReaderConfig3, Checks>(data, len, func, prefix, prefix_len);
+	}
+	return false;
+}
 
 } // dato
 
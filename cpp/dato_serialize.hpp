@@ -0,0 +1,312 @@
+// DATO file format struct serialization extension for the writer library - v1.0
+// See the end of this file for license information
+
+#pragma once
+#include "dato_writer.hpp"
+
+#include <array>
+#include <string>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+
+namespace dato {
+
+// a field of a struct, written as a string map entry
+template <class T, class M> struct FieldDesc
+{
+	typedef M MemberType;
+
+	const char* key;
+	u32 keyLength;
+	M T::* member;
+};
+
+inline constexpr u32 ConstStrLen(const char* str)
+{
+	u32 len = 0;
+	while (str[len])
+		len++;
+	return len;
+}
+
+template <class T, class M> constexpr FieldDesc<T, M> MakeField(const char* key, M T::* member)
+{
+	return { key, ConstStrLen(key), member };
+}
+template <class... F> constexpr std::tuple<F...> MakeFieldList(F... fields)
+{
+	return std::tuple<F...>(fields...);
+}
+
+// the list of serialized fields of a struct (a tuple of FieldDesc)
+// - specialize with `static constexpr auto Get() { return MakeFieldList(MakeField("key", &T::member), ...); }` ..
+// .. or add the same function to the struct as `static constexpr auto DatoFields()`
+template <class T> struct StructFields
+{
+	template <class U = T> static constexpr auto Get() -> decltype(U::DatoFields()) { return U::DatoFields(); }
+};
+
+template <class T, class Enable = void> struct HasStructFields : std::false_type {};
+template <class T> struct HasStructFields<T, decltype((void) StructFields<T>::Get())> : std::true_type {};
+
+template <class T> using FieldListOf = decltype(StructFields<T>::Get());
+
+// the rank of each field in the sorted key order (compared the same way as in the writer)
+template <size_t N> struct FieldOrder
+{
+	u32 rank[N + 1];
+};
+
+inline constexpr bool ConstKeyLess(const char* a, u32 alen, const char* b, u32 blen)
+{
+	u32 minLen = alen < blen ? alen : blen;
+	for (u32 i = 0; i < minLen; i++)
+		if (a[i] != b[i])
+			return u8(a[i]) < u8(b[i]);
+	return alen < blen;
+}
+
+template <class L, size_t... I> constexpr FieldOrder<sizeof...(I)> SortFieldOrder(const L& list, std::index_sequence<I...>)
+{
+	const char* keys[] = { std::get<I>(list).key..., nullptr };
+	u32 lengths[] = { std::get<I>(list).keyLength..., 0 };
+	FieldOrder<sizeof...(I)> order {};
+	for (u32 i = 0; i < sizeof...(I); i++)
+		for (u32 j = 0; j < sizeof...(I); j++)
+			if (ConstKeyLess(keys[j], lengths[j], keys[i], lengths[i]))
+				order.rank[i]++;
+	return order;
+}
+template <size_t N> constexpr bool HasDistinctRanks(const FieldOrder<N>& order)
+{
+	for (u32 i = 0; i < N; i++)
+		for (u32 j = i + 1; j < N; j++)
+			if (order.rank[i] == order.rank[j])
+				return false;
+	return true;
+}
+template <class T> constexpr FieldOrder<std::tuple_size<FieldListOf<T>>::value> SortFieldOrder()
+{
+	constexpr FieldOrder<std::tuple_size<FieldListOf<T>>::value> order =
+		SortFieldOrder(StructFields<T>::Get(), std::make_index_sequence<std::tuple_size<FieldListOf<T>>::value>());
+	// (equal keys would get the same rank, leaving one of the sorted entries unwritten)
+	static_assert(HasDistinctRanks(order), "the keys of the struct fields must be unique");
+	return order;
+}
+
+template <class T> struct IsVectorSubtype : std::integral_constant<bool,
+	std::is_same<T, s8>::value || std::is_same<T, u8>::value ||
+	std::is_same<T, s16>::value || std::is_same<T, u16>::value ||
+	std::is_same<T, s32>::value || std::is_same<T, u32>::value ||
+	std::is_same<T, s64>::value || std::is_same<T, u64>::value ||
+	std::is_same<T, f32>::value || std::is_same<T, f64>::value> {};
+template <class T> struct IsVectorSubtypeArray : std::false_type {};
+template <class E, size_t N> struct IsVectorSubtypeArray<std::array<E, N>> : IsVectorSubtype<E> {};
+
+// the default conversions of struct members to values (specialize for other member types)
+// - numbers are written as the smallest fitting 32/64-bit type, fixed size number arrays as vectors ..
+// .. and std::vector of numbers (or of std::array of numbers) as vector arrays
+// - std::string is written as an 8-bit string, structs with StructFields as string maps ..
+// .. and other std::vector types as arrays
+template <class M, class W, class Enable = void> struct FieldWriter;
+
+template <class T, class W = Writer> struct StructWriter;
+
+template <class M, class W> struct FieldWriter<M, W, typename std::enable_if<std::is_arithmetic<M>::value>::type>
+{
+	DATO_FORCEINLINE typename W::ValueRef Write(W& w, M v)
+	{
+		if (std::is_same<M, bool>::value)
+			return w.WriteBool(v != 0);
+		if (std::is_floating_point<M>::value)
+			return sizeof(M) == 4 ? w.WriteF32(f32(v)) : w.WriteF64(f64(v));
+		if (sizeof(M) <= 4)
+			return std::is_signed<M>::value ? w.WriteS32(s32(v)) : w.WriteU32(u32(v));
+		return std::is_signed<M>::value ? w.WriteS64(s64(v)) : w.WriteU64(u64(v));
+	}
+};
+template <class E, size_t N, class W> struct FieldWriter<E[N], W, typename std::enable_if<IsVectorSubtype<E>::value>::type>
+{
+	static_assert(N >= 1 && N <= 255, "vectors must have 1-255 elements");
+	DATO_FORCEINLINE typename W::ValueRef Write(W& w, const E (&v)[N])
+	{
+		return w.WriteVectorT(v, N);
+	}
+};
+template <class E, size_t N, class W> struct FieldWriter<std::array<E, N>, W, typename std::enable_if<IsVectorSubtype<E>::value>::type>
+{
+	static_assert(N >= 1 && N <= 255, "vectors must have 1-255 elements");
+	DATO_FORCEINLINE typename W::ValueRef Write(W& w, const std::array<E, N>& v)
+	{
+		return w.WriteVectorT(v.data(), N);
+	}
+};
+template <class W> struct FieldWriter<std::string, W>
+{
+	DATO_FORCEINLINE typename W::ValueRef Write(W& w, const std::string& v)
+	{
+		return w.WriteString8(v.data(), typename W::Pos(v.size()));
+	}
+};
+template <class E, class W> struct FieldWriter<std::vector<E>, W, typename std::enable_if<IsVectorSubtype<E>::value>::type>
+{
+	DATO_FORCEINLINE typename W::ValueRef Write(W& w, const std::vector<E>& v)
+	{
+		return w.WriteVectorArrayT(v.data(), 1, typename W::Pos(v.size()));
+	}
+};
+template <class E, size_t N, class W> struct FieldWriter<std::vector<std::array<E, N>>, W, typename std::enable_if<IsVectorSubtype<E>::value>::type>
+{
+	static_assert(N >= 1 && N <= 255, "vectors must have 1-255 elements");
+	DATO_FORCEINLINE typename W::ValueRef Write(W& w, const std::vector<std::array<E, N>>& v)
+	{
+		return w.WriteVectorArrayT(v.empty() ? nullptr : v[0].data(), N, typename W::Pos(v.size()));
+	}
+};
+template <class E, class W> struct FieldWriter<std::vector<E>, W, typename std::enable_if<
+	!IsVectorSubtype<E>::value && !IsVectorSubtypeArray<E>::value>::type>
+{
+	FieldWriter<E, W> _elem;
+	std::vector<typename W::ValueRef> _refs;
+
+	typename W::ValueRef Write(W& w, const std::vector<E>& v)
+	{
+		// (nested arrays of the same type are written with their own element writer, so this is not reentered)
+		_refs.clear();
+		for (const auto& e : v)
+			_refs.push_back(_elem.Write(w, e));
+		return w.WriteArray(_refs.data(), u32(_refs.size()));
+	}
+};
+template <class M, class W> struct FieldWriter<M, W, typename std::enable_if<HasStructFields<M>::value>::type> : StructWriter<M, W> {};
+
+// writes structs with StructFields as string maps
+// - the field keys are written once (on the first write) and reused for all further structs, ..
+// .. and with FLAG_SortedKeys, the entries are written in the key order sorted at compile time, ..
+// .. so writing a struct does no key lookups or sorting
+// - the keys are written again when the object is used with another writer or after Writer::Reset ..
+// .. (see Writer::GetGeneration)
+// - structs that contain (arrays of) themselves are not supported
+template <class T, class W> struct StructWriter
+{
+	typedef typename W::KeyRef KeyRef;
+	typedef typename W::ValueRef ValueRef;
+	typedef typename W::StringMapEntry StringMapEntry;
+	typedef FieldListOf<T> List;
+	static const size_t NumFields = std::tuple_size<List>::value;
+	typedef std::make_index_sequence<NumFields> Indices;
+
+	template <class Seq> struct WritersOf;
+	template <size_t... I> struct WritersOf<std::index_sequence<I...>>
+	{
+		typedef std::tuple<FieldWriter<typename std::tuple_element<I, List>::type::MemberType, W>...> Type;
+	};
+
+	typename WritersOf<Indices>::Type _writers;
+	KeyRef _keys[NumFields + 1];
+	u64 _keysGeneration = 0; // the Writer::GetGeneration that `_keys` were written to (0 = none)
+
+	void Reset()
+	{
+		_keysGeneration = 0;
+	}
+
+	ValueRef Write(W& w, const T& v)
+	{
+		if (_keysGeneration != w.GetGeneration())
+			_WriteKeys(w, Indices());
+		StringMapEntry entries[NumFields + 1];
+		if (w._flags & FLAG_SortedKeys)
+			_WriteValues<true>(w, v, entries, Indices());
+		else
+			_WriteValues<false>(w, v, entries, Indices());
+		return w.WriteStringMapPresorted(entries, u32(NumFields));
+	}
+
+	template <size_t... I> void _WriteKeys(W& w, std::index_sequence<I...>)
+	{
+		constexpr List list = StructFields<T>::Get();
+		int unused[] = { 0, ((void) (_keys[I] = w.WriteStringKey(std::get<I>(list).key, std::get<I>(list).keyLength)), 0)... };
+		(void) unused;
+		_keysGeneration = w.GetGeneration();
+	}
+
+	template <bool Sorted, size_t I> DATO_FORCEINLINE void _WriteValue(W& w, const T& v, StringMapEntry* entries)
+	{
+		constexpr auto field = std::get<I>(StructFields<T>::Get());
+		constexpr u32 rank = SortFieldOrder<T>().rank[I];
+		entries[Sorted ? rank : I] = { _keys[I], std::get<I>(_writers).Write(w, v.*field.member) };
+	}
+	template <bool Sorted, size_t... I> DATO_FORCEINLINE void _WriteValues(W& w, const T& v, StringMapEntry* entries, std::index_sequence<I...>)
+	{
+		// (the values are written in the declaration order)
+		int unused[] = { 0, (_WriteValue<Sorted, I>(w, v, entries), 0)... };
+		(void) unused;
+	}
+};
+
+// writes an array of string maps
+template <class T, class W> typename W::ValueRef WriteStructArray(W& w, StructWriter<T, W>& sw, const T* items, size_t count)
+{
+	std::vector<typename W::ValueRef> refs(count);
+	for (size_t i = 0; i < count; i++)
+		refs[i] = sw.Write(w, items[i]);
+	return w.WriteArray(refs.data(), u32(count));
+}
+
+} // dato
+/*
+This software is available under 2 licenses:
+-------------------------------------------------------------------------------
+OPTION 1: MIT License
+
+Copyright (c) 2023 Arvīds Kokins
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the “Software”), to deal in
+the Software without restriction, including without limitation the rights to
+use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+of the Software, and to permit persons to whom the Software is furnished to do
+so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+-------------------------------------------------------------------------------
+OPTION 2: Unlicense
+
+This is free and unencumbered software released into the public domain.
+
+Anyone is free to copy, modify, publish, use, compile, sell, or
+distribute this software, either in source code form or as a compiled
+binary, for any purpose, commercial or non-commercial, and by any
+means.
+
+In jurisdictions that recognize copyright laws, the author or authors
+of this software dedicate any and all copyright interest in the
+software to the public domain. We make this dedication for the benefit
+of the public at large and to the detriment of our heirs and
+successors. We intend this dedication to be an overt act of
+relinquishment in perpetuity of all present and future rights to this
+software under copyright law.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+OTHER DEALINGS IN THE SOFTWARE.
+
+For more information, please refer to <http://unlicense.org/>
+*/
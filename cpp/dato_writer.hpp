@@ -4,6 +4,9 @@
 
 #pragma once
 
+#include <stddef.h>
+#include <atomic>
+
 #if !defined(DATO_MEMCPY) || !defined(DATO_MEMCMP)
 #  include <string.h>
 #endif
@@ -43,11 +46,19 @@
 
 #ifdef _MSC_VER
 #  define DATO_FORCEINLINE __forceinline
+#  define DATO_NOINLINE __declspec(noinline)
 extern "C" void __ud2(void);
-#  pragma intrinsic(__ud2)
+extern "C" unsigned char _BitScanForward(unsigned long*, unsigned long);
+extern "C" unsigned char _BitScanReverse(unsigned long*, unsigned long);
+#  pragma intrinsic(__ud2, _BitScanForward, _BitScanReverse)
+#  ifdef _M_X64
+extern "C" unsigned __int64 _umul128(unsigned __int64, unsigned __int64, unsigned __int64*);
+#    pragma intrinsic(_umul128)
+#  endif
 #  define DATO_CRASH _dato_error()
 #else
 #  define DATO_FORCEINLINE inline __attribute__((always_inline))
+#  define DATO_NOINLINE __attribute__((noinline))
 #  define DATO_CRASH __builtin_trap()
 #endif
 
@@ -98,6 +109,8 @@ static const u8 TYPE_String32 = 13; // UTF-32
 static const u8 TYPE_ByteArray = 14;
 static const u8 TYPE_Vector = 15;
 static const u8 TYPE_VectorArray = 16;
+// - indexed containers
+static const u8 TYPE_StringHashMap = 17; // a string map followed by a hash table of its keys
 
 static const u8 SUBTYPE_S8 = 0;
 static const u8 SUBTYPE_U8 = 1;
@@ -124,6 +137,11 @@ template <> struct SubtypeInfo<f64> { enum { Subtype = SUBTYPE_F64 }; };
 
 static const u8 FLAG_Aligned = 1 << 0;
 static const u8 FLAG_SortedKeys = 1 << 1;
+// int maps with at least EYTZINGER_MinSize entries are stored in Eytzinger order (requires FLAG_SortedKeys)
+static const u8 FLAG_EytzingerIntMaps = 1 << 2;
+static const u32 EYTZINGER_MinSize = 256;
+// every key string is stored once (the keys of all maps with the same content refer to the same position)
+static const u8 FLAG_UniqueKeys = 1 << 3;
 
 #ifndef DATO_MEMCPY
 #  define DATO_MEMCPY memcpy
@@ -136,6 +154,7 @@ static const u8 FLAG_SortedKeys = 1 << 1;
 // override this if you're adding inline types
 #ifndef DATO_IS_REFERENCE_TYPE
 #define DATO_IS_REFERENCE_TYPE(t) ((t) >= TYPE_S64)
+#define DATO_DEFAULT_REFERENCE_TYPES // (the SIMD slot decoding depends on it)
 #endif
 
 DATO_FORCEINLINE bool IsReferenceType(u8 t)
@@ -143,11 +162,87 @@ DATO_FORCEINLINE bool IsReferenceType(u8 t)
 	return DATO_IS_REFERENCE_TYPE(t);
 }
 
-inline u32 RoundUp(u32 x, u32 n)
+// whether the reference `val` (stored relative to `origin`) of a container starting at `start` points strictly before it
+// - self-references would make recursive iteration loop forever
+template <class Pos> DATO_FORCEINLINE bool IsBackReference(Pos start, Pos origin, Pos val)
+{
+	return val - (origin - start) - 1 < start;
+}
+
+template <class T> inline T RoundUp(T x, u32 n)
 {
 	return (x + n - 1) / n * n;
 }
 
+// `v` must not be 0
+DATO_FORCEINLINE u32 CountTrailingZeroes(u32 v)
+{
+#ifdef _MSC_VER
+	unsigned long i;
+	_BitScanForward(&i, v);
+	return u32(i);
+#else
+	return u32(__builtin_ctz(v));
+#endif
+}
+DATO_FORCEINLINE u32 FloorLog2(u32 v)
+{
+#ifdef _MSC_VER
+	unsigned long i;
+	_BitScanReverse(&i, v);
+	return u32(i);
+#else
+	return u32(31 - __builtin_clz(v));
+#endif
+}
+
+// Eytzinger (BFS) order of `n` sorted keys: the children of slot s are 2s+1 and 2s+2
+// - returns the slot of the key with the sorted index `rank`
+inline u32 EytzingerSlotFromRank(u32 rank, u32 n)
+{
+	u32 h = FloorLog2(n) + 1; // the number of levels
+	u32 m = n - ((1U << (h - 1)) - 1); // the number of nodes on the last level
+	// the rank in a perfect tree with h levels (skipping the missing nodes on the last level)
+	u32 r = rank < 2 * m ? rank : 2 * rank - (2 * m - 1);
+	u32 t = CountTrailingZeroes(r + 1); // the height of the node
+	return (1U << (h - 1 - t)) + ((r + 1) >> (t + 1)) - 1;
+}
+
+// string hash maps: the hash of a key is FNV-1a (32-bit) of its bytes (excluding the 0-terminator)
+inline u32 KeyHash(const void* mem, size_t len)
+{
+	const u8* p = (const u8*) mem;
+	u32 hash = 0x811c9dc5;
+	for (size_t i = 0; i < len; i++)
+	{
+		hash ^= p[i];
+		hash *= 0x01000193;
+	}
+	return hash;
+}
+// the fingerprint stored in a hash table bucket (0 marks empty buckets)
+DATO_FORCEINLINE u8 KeyHashFingerprint(u32 hash)
+{
+	u8 fp = u8(hash >> 24);
+	return fp ? fp : 1;
+}
+// the number of buckets for `size` keys (a power of 2, at most 2/3 full, at least one empty)
+inline u64 HashMapBucketCount(u64 size)
+{
+	u64 n = 1;
+	while (n < size + size / 2 + 1)
+		n *= 2;
+	return n;
+}
+
+// a new value on each call (unique in the process), identifies documents in memory that may be reused ..
+// .. for other documents (buffers, readers and writers at the same address)
+inline u64 NewDocumentId()
+{
+	static std::atomic<u64> next { 1 };
+	return next.fetch_add(1, std::memory_order_relaxed);
+}
+
 #endif // DATO_COMMON_DEFS
 
 
@@ -175,51 +270,422 @@ template <class T> inline u32 StrLen(const T* str)
 	return u32(p - str);
 }
 
-struct Builder
+// the source of all of the memory used by a writer (its data, hash tables and temporary buffers)
+// - the allocator must outlive the objects using it
+struct IAllocator
 {
-	char* _data = nullptr;
-	u32 _size = 0;
-	u32 _mem = 0;
+	// `ptr` is null (with `oldSize` = 0) or a block from this allocator of `oldSize` bytes, `size` > 0
+	// - returns a block of at least `size` bytes with the contents of the old block (up to `size`), ..
+	// .. or null if it fails (the old block is then unchanged and still owned by the caller)
+	// - failures set `error` in the builders (the data is then only good for discarding), ..
+	// .. the hash tables and temporary buffers only lose their deduplication or fall back to slower code
+	virtual void* Realloc(void* ptr, size_t oldSize, size_t size) = 0;
+	// `ptr` is null (with `size` = 0) or a block from this allocator of `size` bytes
+	virtual void Free(void* ptr, size_t size) = 0;
+};
+
+// uses DATO_REALLOC/DATO_FREE
+struct DefaultAllocator : IAllocator
+{
+	void* Realloc(void* ptr, size_t, size_t size) override { return DATO_REALLOC(ptr, size); }
+	void Free(void* ptr, size_t) override { DATO_FREE(ptr); }
+};
+inline IAllocator* GetDefaultAllocator()
+{
+	static DefaultAllocator alloc;
+	return &alloc;
+}
+
+// the destination of a streaming builder (see BasicBuilder::SetStreaming, dato_output.hpp has implementations)
+struct IOutputStream
+{
+	// appends exactly `size` bytes
+	virtual bool Write(const void* data, size_t size) = 0;
+	// overwrites already written bytes (used to patch the header at the end)
+	virtual bool WriteAt(u64 offset, const void* data, size_t size) = 0;
+};
+
+// one contiguous part of the data (layout-compatible with `struct iovec` for writev)
+struct DataSegment
+{
+	const void* data;
+	size_t size;
+};
+
+// Pos is the type of sizes and offsets (u32, or u64 for configurations that support >4 GiB of data)
+// - the data is one buffer that is reallocated to grow (the default) or, after SetSegmented, ..
+// .. a list of segments that are never moved after they have been filled (see GetSegments)
+// - each single append (the reserved size) is contiguous in either mode
+// - streaming (see SetStreaming) is segmented data that is written out and reused once it is ..
+// .. far enough behind the end, only positions from GetFlushedSize() onwards are in memory
+template <class Pos>
+struct BasicBuilder
+{
+	struct Segment
+	{
+		char* data;
+		Pos start; // the position of data[0] (only valid up to the current segment)
+		Pos mem;
+	};
+
+	char* _data = nullptr; // the buffer or the current segment
+	Pos _size = 0;
+	Pos _mem = 0; // the position of the end of `_data`
+	Pos _base = 0; // the position of `_data[0]`
 	bool error = false;
+	IAllocator* _alloc = GetDefaultAllocator();
+	// segmented data (the segments after `_curSegment` are unused and kept for reuse after truncation)
+	Segment* _segments = nullptr;
+	u32 _numSegments = 0;
+	u32 _memSegments = 0;
+	u32 _curSegment = 0;
+	Pos _segmentSize = 0;
+	// streaming
+	IOutputStream* _stream = nullptr;
+	Pos _window = 0;
+	Pos _flushed = 0; // the size of the data that has been written to `_stream`
+
+	BasicBuilder() {}
+	BasicBuilder(const BasicBuilder&) = delete;
+	BasicBuilder& operator = (const BasicBuilder&) = delete;
+	~BasicBuilder()
+	{
+		_FreeAll();
+	}
+	void _FreeAll()
+	{
+		if (_segments)
+		{
+			for (u32 i = 0; i < _numSegments; i++)
+				_alloc->Free(_segments[i].data, size_t(_segments[i].mem));
+			_alloc->Free(_segments, _memSegments * sizeof(Segment));
+		}
+		else
+			_alloc->Free(_data, size_t(_mem));
+	}
+
+	// the already written data is moved to the new allocator (only for contiguous data)
+	// - sets `error` and keeps the old allocator if the new one fails to allocate
+	void SetAllocator(IAllocator* alloc)
+	{
+		DATO_INPUT_EXPECT(!_segments);
+		if (!alloc)
+			alloc = GetDefaultAllocator();
+		if (_data)
+		{
+			char* data = (char*) alloc->Realloc(nullptr, 0, size_t(_mem));
+			if (!data)
+			{
+				error = true;
+				return;
+			}
+			memcpy(data, _data, size_t(_size));
+			_alloc->Free(_data, size_t(_mem));
+			_data = data;
+		}
+		_alloc = alloc;
+	}
+
+	// switches to segmented data (the already written data becomes the first segment)
+	// - `segmentSize` is the minimum size of new segments, they also grow with the data (to 1/4 of it) ..
+	// .. to keep their count low
+	void SetSegmented(Pos segmentSize = 1024 * 1024)
+	{
+		_segmentSize = segmentSize ? segmentSize : 1;
+		if (_segments)
+			return;
+		// (stays contiguous if the allocator fails)
+		Segment* segments = (Segment*) _alloc->Realloc(nullptr, 0, 16 * sizeof(Segment));
+		if (!segments)
+		{
+			error = true;
+			return;
+		}
+		if (!_data && !_ResizeImpl(_segmentSize))
+		{
+			_alloc->Free(segments, 16 * sizeof(Segment));
+			return;
+		}
+		_segments = segments;
+		_memSegments = 16;
+		_segments[0] = { _data, 0, _mem };
+		_numSegments = 1;
+		_curSegment = 0;
+	}
+	DATO_FORCEINLINE bool IsSegmented() const { return _segments != nullptr; }
+
+	// writes the data to `out` as soon as it is at least `window` bytes behind the end (in whole segments) ..
+	// .. and reuses the segments, so the memory use is about `window` + 2 * `segmentSize`
+	// - values longer than `window` are still written, but not deduplicated
+	void SetStreaming(IOutputStream* out, Pos window = 4 * 1024 * 1024, Pos segmentSize = 1024 * 1024)
+	{
+		SetSegmented(segmentSize);
+		if (!_segments)
+			return;
+		_stream = out;
+		_window = window;
+	}
+	DATO_FORCEINLINE bool IsStreaming() const { return _stream != nullptr; }
+	DATO_FORCEINLINE Pos GetFlushedSize() const { return _flushed; }
+	// writes out the rest of the data, returns false if any of the writes have failed
+	bool FinishStreaming()
+	{
+		_FlushSegments(_curSegment + 1);
+		return !error;
+	}
 
-	~Builder()
+	// the data in one buffer (segmented data must be in one segment, see Flatten)
+	DATO_FORCEINLINE const void* GetData() const
 	{
-		DATO_FREE(_data);
+		DATO_INPUT_EXPECT(!_curSegment && !_flushed);
+		return _data;
+	}
+	DATO_FORCEINLINE Pos GetSize() const { return _size; }
+	// merges the segments into one buffer (if there are several of them) for GetData
+	// - sets `error` and keeps the segments if the merged buffer could not be allocated
+	bool Flatten()
+	{
+		DATO_INPUT_EXPECT(!_flushed);
+		if (!_curSegment)
+			return true;
+		Pos mem = _size + _segmentSize;
+		char* data = (char*) _alloc->Realloc(nullptr, 0, size_t(mem));
+		if (!data)
+		{
+			error = true;
+			return false;
+		}
+		_Read(0, data, _size);
+		for (u32 i = 0; i < _numSegments; i++)
+			_alloc->Free(_segments[i].data, size_t(_segments[i].mem));
+		_segments[0] = { data, 0, mem };
+		_numSegments = 1;
+		_curSegment = 0;
+		_data = data;
+		_base = 0;
+		_mem = mem;
+		return true;
+	}
+
+	// fills up to `maxCount` segments with the data in order (e.g. for writev) and returns the number of them
+	u32 GetSegments(DataSegment* out, u32 maxCount) const
+	{
+		u32 count = _curSegment + 1;
+		for (u32 i = 0; i < count && i < maxCount; i++)
+		{
+			Pos start = _segments ? _segments[i].start : 0;
+			Pos end = i == _curSegment ? _size : _segments[i + 1].start;
+			out[i] = { _segments ? _segments[i].data : _data, size_t(end - start) };
+		}
+		return count;
 	}
 
-	DATO_FORCEINLINE const void* GetData() const { return _data; }
-	DATO_FORCEINLINE u32 GetSize() const { return _size; }
+	// removes everything after `size` and keeps the memory
+	void Truncate(Pos size)
+	{
+		DATO_INPUT_EXPECT(size >= _flushed);
+		if (size < _base)
+		{
+			const Segment& s = _segments[_FindSegment(size)];
+			_curSegment = u32(&s - _segments);
+			_data = s.data;
+			_base = s.start;
+			_mem = s.start + s.mem;
+		}
+		_size = size;
+	}
 
-	void Reserve(u32 atLeast)
+	void Reserve(Pos atLeast)
 	{
 		if (_mem < atLeast)
-			_ResizeImpl(atLeast);
+		{
+			if (_segments)
+				_NextSegment(atLeast - _size);
+			else
+				_ResizeImpl(atLeast);
+		}
+	}
+
+	// the data at `pos` (only contiguous up to the end of the append that wrote it)
+	DATO_FORCEINLINE char* _Ptr(Pos pos) const
+	{
+		if (pos >= _base)
+			return _data + (pos - _base);
+		const Segment& s = _segments[_FindSegment(pos)];
+		return s.data + (pos - s.start);
+	}
+	// overwrites [pos, pos + size) (which must have been written in one append)
+	void _Patch(Pos pos, const void* data, Pos size)
+	{
+		if (pos >= _base && pos + size > _mem)
+			return; // (the append was dropped, see _ResizeImpl)
+		if (pos >= _flushed)
+			memcpy(_Ptr(pos), data, size_t(size));
+		else if (!_stream->WriteAt(u64(pos), data, size_t(size)))
+			error = true;
+	}
+	// whether [pos, GetSize()) is contiguous
+	DATO_FORCEINLINE bool _IsContiguousToEnd(Pos pos) const { return pos >= _base; }
+	// the last segment that starts at or before `pos` (in the segments before the current one)
+	u32 _FindSegment(Pos pos) const
+	{
+		u32 lo = 0, hi = _curSegment;
+		while (lo < hi)
+		{
+			u32 mid = (lo + hi + 1) / 2;
+			if (_segments[mid].start <= pos)
+				lo = mid;
+			else
+				hi = mid - 1;
+		}
+		return lo;
+	}
+	// copies [pos, pos + size) to `dst`
+	void _Read(Pos pos, void* dst, Pos size) const
+	{
+		char* out = (char*) dst;
+		while (size)
+		{
+			Pos avail = size;
+			if (pos < _base)
+			{
+				u32 i = _FindSegment(pos);
+				Pos end = i == _curSegment ? _size : _segments[i + 1].start;
+				if (end - pos < avail)
+					avail = end - pos;
+			}
+			memcpy(out, _Ptr(pos), size_t(avail));
+			out += avail;
+			pos += avail;
+			size -= avail;
+		}
 	}
 
-	void _ResizeImpl(u32 newSize)
+	// if the allocator fails (e.g. a mapped file can't grow), sets `error` and keeps the old buffer ..
+	// .. (the appends that don't fit in it are dropped, so the data is only good for discarding)
+	bool _ResizeImpl(Pos newSize)
 	{
-		_data = (char*) DATO_REALLOC(_data, newSize);
+		char* data = (char*) _alloc->Realloc(_data, size_t(_mem), size_t(newSize));
+		if (!data)
+		{
+			error = true;
+			return false;
+		}
+		_data = data;
 		_mem = newSize;
+		return true;
+	}
+	// like _ResizeImpl, sets `error` and stays in the current segment if the allocator fails
+	bool _NextSegment(Pos sizeToAppend)
+	{
+		Pos want = _stream ? 0 : _size / 4;
+		if (want < _segmentSize)
+			want = _segmentSize;
+		if (want < sizeToAppend)
+			want = sizeToAppend;
+		u32 next = _curSegment + 1;
+		if (next == _numSegments)
+		{
+			if (_numSegments == _memSegments)
+			{
+				Segment* segments = (Segment*) _alloc->Realloc(
+					_segments, _memSegments * sizeof(Segment), _memSegments * 2 * sizeof(Segment));
+				if (!segments)
+				{
+					error = true;
+					return false;
+				}
+				_segments = segments;
+				_memSegments *= 2;
+			}
+			_segments[_numSegments++] = { nullptr, 0, 0 };
+		}
+		Segment& s = _segments[next];
+		if (s.mem < sizeToAppend)
+		{
+			// a new or unused segment is too small (nothing to keep)
+			_alloc->Free(s.data, size_t(s.mem));
+			s.data = (char*) _alloc->Realloc(nullptr, 0, size_t(want));
+			s.mem = s.data ? want : 0;
+			if (!s.data)
+			{
+				error = true;
+				return false;
+			}
+		}
+		s.start = _size;
+		_curSegment = next;
+		_data = s.data;
+		_base = _size;
+		_mem = _size + s.mem;
+
+		if (_stream)
+		{
+			u32 numFlushable = 0;
+			while (numFlushable < _curSegment && _segments[numFlushable + 1].start + _window <= _size)
+				numFlushable++;
+			if (numFlushable)
+				_FlushSegments(numFlushable);
+		}
+		return true;
+	}
+	// writes out the first `count` segments and moves them after the current one for reuse
+	void _FlushSegments(u32 count)
+	{
+		for (u32 i = 0; i < count; i++)
+		{
+			Pos end = i == _curSegment ? _size : _segments[i + 1].start;
+			if (end > _segments[i].start && !_stream->Write(_segments[i].data, size_t(end - _segments[i].start)))
+				error = true;
+		}
+		_flushed = count > _curSegment ? _size : _segments[count].start;
+		for (u32 i = 0; i < count; i++)
+		{
+			Segment tmp = _segments[0];
+			for (u32 j = 1; j < _numSegments; j++)
+				_segments[j - 1] = _segments[j];
+			_segments[_numSegments - 1] = tmp;
+		}
+		if (count > _curSegment)
+		{
+			// everything is written, continue in an unused segment
+			_curSegment = 0;
+			_segments[0].start = _size;
+			_data = _segments[0].data;
+			_base = _size;
+			_mem = _size + _segments[0].mem;
+		}
+		else
+			_curSegment -= count;
 	}
-	void _ReserveForAppend(u32 sizeToAppend)
+	// returns false if the space could not be allocated (see _ResizeImpl)
+	DATO_FORCEINLINE bool _ReserveForAppend(Pos sizeToAppend)
 	{
 		if (_size + sizeToAppend > _mem)
-			_ResizeImpl(_size + sizeToAppend + _mem);
+		{
+			if (_segments)
+				return _NextSegment(sizeToAppend);
+			else
+				return _ResizeImpl(_size + sizeToAppend + _mem);
+		}
+		return true;
 	}
+	DATO_FORCEINLINE char* _End() { return _data + (_size - _base); }
 
-	void AddZeroes(u32 num)
+	void AddZeroes(Pos num)
 	{
-		_ReserveForAppend(num);
-		for (u32 i = 0; i < num; i++)
-			_data[_size++] = 0;
+		if (!_ReserveForAppend(num))
+			return;
+		char* p = _End();
+		for (Pos i = 0; i < num; i++)
+			p[i] = 0;
+		_size += num;
 	}
-	void AddZeroesUntil(u32 pos)
+	void AddZeroesUntil(Pos pos)
 	{
 		if (pos <= _size)
 			return;
-		_ReserveForAppend(pos - _size);
-		while (_size < pos)
-			_data[_size++] = 0;
+		AddZeroes(pos - _size);
 	}
 	DATO_FORCEINLINE void AddU32(u32 v)
 	{
@@ -227,27 +693,41 @@ struct Builder
 	}
 	void AddByte(u8 byte)
 	{
-		_ReserveForAppend(1);
-		_data[_size++] = char(byte);
+		if (!_ReserveForAppend(1))
+			return;
+		*_End() = char(byte);
+		_size++;
 	}
-	void AddMem(const void* mem, u32 size)
+	void AddMem(const void* mem, Pos size)
 	{
-		_ReserveForAppend(size);
-		memcpy(&_data[_size], mem, size);
+		if (!_ReserveForAppend(size))
+			return;
+		memcpy(_End(), mem, size);
 		_size += size;
 	}
 
 	void SetError_ValueOutOfRange() { error = true; }
 };
 
-inline u32 WriteSizeU8(Builder& B, u32 val, u32 align, const void* prefix, u32 pfxsize)
+// the memory of a segmented builder for the key sorting functions (each key is contiguous)
+template <class Pos>
+struct SegmentedMem
+{
+	const BasicBuilder<Pos>* builder;
+
+	DATO_FORCEINLINE const char* operator + (Pos pos) const { return builder->_Ptr(pos); }
+	DATO_FORCEINLINE char operator [] (Pos pos) const { return *builder->_Ptr(pos); }
+};
+
+template <class Pos>
+inline Pos WriteSizeU8(BasicBuilder<Pos>& B, Pos val, u32 align, const void* prefix, u32 pfxsize)
 {
 	if (val > 0xff)
 	{
 		B.SetError_ValueOutOfRange();
 		val = 0;
 	}
-	u32 pos = B.GetSize();
+	Pos pos = B.GetSize();
 	if (align != 0)
 	{
 		u32 totalsize = 1 + pfxsize;
@@ -260,14 +740,15 @@ inline u32 WriteSizeU8(Builder& B, u32 val, u32 align, const void* prefix, u32 p
 	return pos;
 }
 
-inline u32 WriteSizeU16(Builder& B, u32 val, u32 align, const void* prefix, u32 pfxsize)
+template <class Pos>
+inline Pos WriteSizeU16(BasicBuilder<Pos>& B, Pos val, u32 align, const void* prefix, u32 pfxsize)
 {
 	if (val > 0xffff)
 	{
 		B.SetError_ValueOutOfRange();
 		val = 0;
 	}
-	u32 pos = B.GetSize();
+	Pos pos = B.GetSize();
 	if (align != 0)
 	{
 		if (align < 2)
@@ -278,13 +759,20 @@ inline u32 WriteSizeU16(Builder& B, u32 val, u32 align, const void* prefix, u32
 	}
 	if (pfxsize)
 		B.AddMem(prefix, pfxsize);
-	B.AddMem(&val, 2);
+	u16 v16 = u16(val);
+	B.AddMem(&v16, 2);
 	return pos;
 }
 
-inline u32 WriteSizeU32(Builder& B, u32 val, u32 align, const void* prefix, u32 pfxsize)
+template <class Pos>
+inline Pos WriteSizeU32(BasicBuilder<Pos>& B, Pos val, u32 align, const void* prefix, u32 pfxsize)
 {
-	u32 pos = B.GetSize();
+	if (u64(val) > 0xffffffff)
+	{
+		B.SetError_ValueOutOfRange();
+		val = 0;
+	}
+	Pos pos = B.GetSize();
 	if (align != 0)
 	{
 		if (align < 4)
@@ -295,13 +783,19 @@ inline u32 WriteSizeU32(Builder& B, u32 val, u32 align, const void* prefix, u32
 	}
 	if (pfxsize)
 		B.AddMem(prefix, pfxsize);
-	B.AddMem(&val, 4);
+	B.AddU32(u32(val));
 	return pos;
 }
 
-inline u32 WriteSizeU8X32(Builder& B, u32 val, u32 align, const void* prefix, u32 pfxsize)
+template <class Pos>
+inline Pos WriteSizeU8X32(BasicBuilder<Pos>& B, Pos val, u32 align, const void* prefix, u32 pfxsize)
 {
-	u32 pos = B.GetSize();
+	if (u64(val) > 0xffffffff)
+	{
+		B.SetError_ValueOutOfRange();
+		val = 0;
+	}
+	Pos pos = B.GetSize();
 	if (val < 0xff)
 	{
 		if (align != 0)
@@ -327,224 +821,490 @@ inline u32 WriteSizeU8X32(Builder& B, u32 val, u32 align, const void* prefix, u3
 		if (pfxsize)
 			B.AddMem(prefix, pfxsize);
 		B.AddByte(0xff);
-		B.AddMem(&val, 4);
+		B.AddU32(u32(val));
 	}
 	return pos;
 }
 
+template <class Pos>
+inline Pos WriteSizeU64(BasicBuilder<Pos>& B, Pos val, u32 align, const void* prefix, u32 pfxsize)
+{
+	static_assert(sizeof(Pos) >= 8, "64-bit sizes require 64-bit positions");
+	Pos pos = B.GetSize();
+	if (align != 0)
+	{
+		if (align < 8)
+			align = 8;
+		u32 totalsize = 8 + pfxsize;
+		pos = RoundUp(pos + totalsize, align) - totalsize;
+		B.AddZeroesUntil(pos);
+	}
+	if (pfxsize)
+		B.AddMem(prefix, pfxsize);
+	u64 v64 = val;
+	B.AddMem(&v64, 8);
+	return pos;
+}
+
 struct WriterConfig0
 {
+	typedef u32 Pos; // the type of sizes and offsets
 	static u8 Identifier() { return 0; }
 
-	static u32 WriteKeyLength(Builder& B, u32 val, u32 align, const void* prefix, u32 pfxsize)
+	static Pos WriteKeyLength(BasicBuilder<Pos>& B, Pos val, u32 align, const void* prefix, u32 pfxsize)
 	{ return WriteSizeU32(B, val, align, prefix, pfxsize); }
-	static u32 WriteMapSize(Builder& B, u32 val, u32 align, const void* prefix, u32 pfxsize)
+	static Pos WriteMapSize(BasicBuilder<Pos>& B, Pos val, u32 align, const void* prefix, u32 pfxsize)
 	{ return WriteSizeU32(B, val, align, prefix, pfxsize); }
-	static u32 WriteArrayLength(Builder& B, u32 val, u32 align, const void* prefix, u32 pfxsize)
+	static Pos WriteArrayLength(BasicBuilder<Pos>& B, Pos val, u32 align, const void* prefix, u32 pfxsize)
 	{ return WriteSizeU32(B, val, align, prefix, pfxsize); }
-	static u32 WriteValueLength(Builder& B, u32 val, u32 align, const void* prefix, u32 pfxsize)
+	static Pos WriteValueLength(BasicBuilder<Pos>& B, Pos val, u32 align, const void* prefix, u32 pfxsize)
 	{ return WriteSizeU32(B, val, align, prefix, pfxsize); }
 };
 
 struct WriterConfig1
 {
+	typedef u32 Pos;
 	static u8 Identifier() { return 1; }
 
-	static u32 WriteKeyLength(Builder& B, u32 val, u32 align, const void* prefix, u32 pfxsize)
+	static Pos WriteKeyLength(BasicBuilder<Pos>& B, Pos val, u32 align, const void* prefix, u32 pfxsize)
 	{ return WriteSizeU32(B, val, align, prefix, pfxsize); }
-	static u32 WriteMapSize(Builder& B, u32 val, u32 align, const void* prefix, u32 pfxsize)
+	static Pos WriteMapSize(BasicBuilder<Pos>& B, Pos val, u32 align, const void* prefix, u32 pfxsize)
 	{ return WriteSizeU32(B, val, align, prefix, pfxsize); }
-	static u32 WriteArrayLength(Builder& B, u32 val, u32 align, const void* prefix, u32 pfxsize)
+	static Pos WriteArrayLength(BasicBuilder<Pos>& B, Pos val, u32 align, const void* prefix, u32 pfxsize)
 	{ return WriteSizeU32(B, val, align, prefix, pfxsize); }
-	static u32 WriteValueLength(Builder& B, u32 val, u32 align, const void* prefix, u32 pfxsize)
+	static Pos WriteValueLength(BasicBuilder<Pos>& B, Pos val, u32 align, const void* prefix, u32 pfxsize)
 	{ return WriteSizeU8X32(B, val, align, prefix, pfxsize); }
 };
 
 struct WriterConfig2
 {
+	typedef u32 Pos;
 	static u8 Identifier() { return 2; }
 
-	static u32 WriteKeyLength(Builder& B, u32 val, u32 align, const void* prefix, u32 pfxsize)
+	static Pos WriteKeyLength(BasicBuilder<Pos>& B, Pos val, u32 align, const void* prefix, u32 pfxsize)
 	{ return WriteSizeU32(B, val, align, prefix, pfxsize); }
-	static u32 WriteMapSize(Builder& B, u32 val, u32 align, const void* prefix, u32 pfxsize)
+	static Pos WriteMapSize(BasicBuilder<Pos>& B, Pos val, u32 align, const void* prefix, u32 pfxsize)
 	{ return WriteSizeU8X32(B, val, align, prefix, pfxsize); }
-	static u32 WriteArrayLength(Builder& B, u32 val, u32 align, const void* prefix, u32 pfxsize)
+	static Pos WriteArrayLength(BasicBuilder<Pos>& B, Pos val, u32 align, const void* prefix, u32 pfxsize)
 	{ return WriteSizeU8X32(B, val, align, prefix, pfxsize); }
-	static u32 WriteValueLength(Builder& B, u32 val, u32 align, const void* prefix, u32 pfxsize)
+	static Pos WriteValueLength(BasicBuilder<Pos>& B, Pos val, u32 align, const void* prefix, u32 pfxsize)
 	{ return WriteSizeU8X32(B, val, align, prefix, pfxsize); }
 };
 
-struct KeyRef
+// 64-bit sizes and offsets (map/array slots and the root reference are 8 bytes as well)
+struct WriterConfig3
 {
-	u32 pos;
-	u32 dataPos;
+	typedef u64 Pos;
+	static u8 Identifier() { return 3; }
+
+	static Pos WriteKeyLength(BasicBuilder<Pos>& B, Pos val, u32 align, const void* prefix, u32 pfxsize)
+	{ return WriteSizeU64(B, val, align, prefix, pfxsize); }
+	static Pos WriteMapSize(BasicBuilder<Pos>& B, Pos val, u32 align, const void* prefix, u32 pfxsize)
+	{ return WriteSizeU64(B, val, align, prefix, pfxsize); }
+	static Pos WriteArrayLength(BasicBuilder<Pos>& B, Pos val, u32 align, const void* prefix, u32 pfxsize)
+	{ return WriteSizeU64(B, val, align, prefix, pfxsize); }
+	static Pos WriteValueLength(BasicBuilder<Pos>& B, Pos val, u32 align, const void* prefix, u32 pfxsize)
+	{ return WriteSizeU64(B, val, align, prefix, pfxsize); }
+};
+
+template <class Pos>
+struct BasicKeyRef
+{
+	Pos pos;
+	Pos dataPos; // the position of the contents (in a separate copy when streaming)
 	u32 dataLen;
 };
 
-struct ValueRef
+template <class Pos>
+struct BasicValueRef
 {
 	u8 type;
-	u32 pos;
+	Pos pos;
 };
 
-struct IntMapEntry
+template <class Pos>
+struct BasicIntMapEntry
 {
 	u32 key;
-	ValueRef value;
+	BasicValueRef<Pos> value;
 };
 
-struct StringMapEntry
+template <class Pos>
+struct BasicStringMapEntry
 {
-	KeyRef key;
-	ValueRef value;
+	BasicKeyRef<Pos> key;
+	BasicValueRef<Pos> value;
 };
 
-// both hashing functions are FNV-1a (32-bit)
-inline u32 MemHash(const void* rawp, u32 len)
+// the type of sizes and offsets in the written data (depends on the configuration)
+typedef DATO_CONCAT(WriterConfig, DATO_CONFIG)::Pos WriterPos;
+using Builder = BasicBuilder<WriterPos>;
+using KeyRef = BasicKeyRef<WriterPos>;
+using ValueRef = BasicValueRef<WriterPos>;
+using IntMapEntry = BasicIntMapEntry<WriterPos>;
+using StringMapEntry = BasicStringMapEntry<WriterPos>;
+
+// 64x64->128 bit multiply, a = low half, b = high half (portable, also usable in constant expressions)
+DATO_FORCEINLINE constexpr void _HashMumPortable(u64& a, u64& b)
 {
-	auto* mem = (const char*) rawp;
-	u32 nToHash = len < 32 ? len : 32;
-	u32 interval = len / nToHash;
-	u32 hash = 0x811c9dc5;
-	for (u32 i = 0; i < len; i += interval)
+	u64 ha = a >> 32, hb = b >> 32, la = u32(a), lb = u32(b);
+	u64 rh = ha * hb, rm0 = ha * lb, rm1 = hb * la, rl = la * lb;
+	u64 t = rl + (rm0 << 32);
+	u64 c = t < rl;
+	u64 lo = t + (rm1 << 32);
+	c += lo < t;
+	a = lo;
+	b = rh + (rm0 >> 32) + (rm1 >> 32) + c;
+}
+
+// the memory reads and multiplies of MemHash
+struct _HashOps
+{
+	static DATO_FORCEINLINE void Mum(u64& a, u64& b)
+	{
+#if defined(__SIZEOF_INT128__)
+		unsigned __int128 r = (unsigned __int128) a * b;
+		a = u64(r);
+		b = u64(r >> 64);
+#elif defined(_MSC_VER) && defined(_M_X64)
+		a = _umul128(a, b, &b);
+#else
+		_HashMumPortable(a, b);
+#endif
+	}
+	static DATO_FORCEINLINE u64 Read8(const u8* p) { u64 v; memcpy(&v, p, 8); return v; }
+	static DATO_FORCEINLINE u64 Read4(const u8* p) { u32 v; memcpy(&v, p, 4); return v; }
+};
+// the same in constant expressions (reads are little-endian)
+struct _HashOpsConstexpr
+{
+	static DATO_FORCEINLINE constexpr void Mum(u64& a, u64& b) { _HashMumPortable(a, b); }
+	static DATO_FORCEINLINE constexpr u64 ReadN(const char* p, u32 n)
 	{
-		hash ^= mem[i];
-		hash *= 0x01000193;
+		u64 v = 0;
+		for (u32 i = 0; i < n; i++)
+			v |= u64(u8(p[i])) << (i * 8);
+		return v;
 	}
-	return hash;
+	static DATO_FORCEINLINE constexpr u64 Read8(const char* p) { return ReadN(p, 8); }
+	static DATO_FORCEINLINE constexpr u64 Read4(const char* p) { return ReadN(p, 4); }
+};
+
+template <class Ops> DATO_FORCEINLINE constexpr u64 _HashMix(u64 a, u64 b)
+{
+	Ops::Mum(a, b);
+	return a ^ b;
 }
 
-inline constexpr u32 StrHash(const char* str)
+// see MemHash, `Ops` is _HashOps (with `P` = const u8*) or _HashOpsConstexpr (with `P` = const char*)
+template <class Ops, class P> DATO_FORCEINLINE constexpr u32 _MemHashImpl(P p, u32 len)
 {
-	u32 hash = 0x811c9dc5;
-	while (*str)
+	const u64 S0 = 0x2d358dccaa6c78a5ull;
+	const u64 S1 = 0x8bb84b93962eacc9ull;
+	const u64 S2 = 0x4b33a62ed433d4a3ull;
+	const u64 S3 = 0x4d5a2da51de1aa47ull;
+
+	u64 seed = _HashMix<Ops>(S0, S1);
+	u64 a = 0, b = 0;
+	if (len <= 16)
 	{
-		hash ^= *str++;
-		hash *= 0x01000193;
+		if (len >= 4)
+		{
+			u32 mid = (len >> 3) << 2;
+			a = (Ops::Read4(p) << 32) | Ops::Read4(p + mid);
+			b = (Ops::Read4(p + len - 4) << 32) | Ops::Read4(p + len - 4 - mid);
+		}
+		else if (len > 0)
+			a = (u64(u8(p[0])) << 16) | (u64(u8(p[len >> 1])) << 8) | u8(p[len - 1]);
 	}
-	return hash;
+	else
+	{
+		u32 i = len;
+		if (i > 48)
+		{
+			u64 seed1 = seed, seed2 = seed;
+			do
+			{
+				seed = _HashMix<Ops>(Ops::Read8(p) ^ S1, Ops::Read8(p + 8) ^ seed);
+				seed1 = _HashMix<Ops>(Ops::Read8(p + 16) ^ S2, Ops::Read8(p + 24) ^ seed1);
+				seed2 = _HashMix<Ops>(Ops::Read8(p + 32) ^ S3, Ops::Read8(p + 40) ^ seed2);
+				p += 48;
+				i -= 48;
+			}
+			while (i > 48);
+			seed ^= seed1 ^ seed2;
+		}
+		while (i > 16)
+		{
+			seed = _HashMix<Ops>(Ops::Read8(p) ^ S1, Ops::Read8(p + 8) ^ seed);
+			p += 16;
+			i -= 16;
+		}
+		a = Ops::Read8(p + i - 16);
+		b = Ops::Read8(p + i - 8);
+	}
+	a ^= S1;
+	b ^= seed;
+	Ops::Mum(a, b);
+	u64 h = _HashMix<Ops>(a ^ S0 ^ len, b ^ S1);
+	return u32(h ^ (h >> 32));
 }
 
-struct MemReuseHashTable
+// hashes all of the memory (wyhash-style: 3 independent lanes of 64x64->128 bit multiplies ..
+// .. for long inputs, overlapping reads for the tail, no per-byte loop)
+// - not stable across platforms with different endianness (only used in memory)
+inline u32 MemHash(const void* rawp, u32 len)
+{
+	return _MemHashImpl<_HashOps>((const u8*) rawp, len);
+}
+
+// MemHash(str, StrLen(str)) that can also be evaluated at compile time (e.g. for constant keys)
+// - the same as MemHash on little-endian platforms
+inline constexpr u32 StrHash(const char* str)
+{
+	u32 len = 0;
+	while (str[len])
+		len++;
+	return _MemHashImpl<_HashOpsConstexpr>(str, len);
+}
+
+// Robin Hood hashing: entries that are further from their ideal slot take over the slots ..
+// .. of the closer ones on insertion, which keeps probe sequences short and lets lookups stop ..
+// .. as soon as they reach an entry that is closer to its ideal slot than the probe
+template <class Pos>
+struct BasicMemReuseHashTable
 {
 	struct Entry
 	{
-		u32 valuePos;
-		u32 dataOff;
+		Pos valuePos;
+		Pos dataOff;
 		u32 len;
 		u32 hash;
 	};
+	// the hash is repeated here to avoid touching the entry on mismatches
+	struct Slot
+	{
+		u32 hash;
+		u32 entry;
+	};
 
-	char** _pdata = nullptr; // must be initialized
+	// the data that the entries point to (one of them must be initialized)
+	char** _pdata = nullptr;
+	const BasicBuilder<Pos>* _builder = nullptr; // (possibly segmented, the entries must be contiguous)
+	IAllocator* _alloc = GetDefaultAllocator();
 	Entry* _entries = nullptr;
 	u32 _numEntries = 0;
 	u32 _memEntries = 0;
 	static constexpr const u32 NO_VALUE = 0xffffffff;
-	u32* _table = nullptr;
-	u32 _numTableSlots = 0;
+	Slot* _table = nullptr;
+	u32 _numTableSlots = 0; // 0 or a power of 2
+
+	BasicMemReuseHashTable() {} // (_pdata or _builder must be set before use)
+	BasicMemReuseHashTable(char*& data) : _pdata(&data) {}
+	BasicMemReuseHashTable(const BasicBuilder<Pos>* builder) : _builder(builder) {}
+	BasicMemReuseHashTable(const BasicMemReuseHashTable&) = delete;
+	BasicMemReuseHashTable& operator = (const BasicMemReuseHashTable&) = delete;
+	~BasicMemReuseHashTable()
+	{
+		_alloc->Free(_entries, _memEntries * sizeof(Entry));
+		_alloc->Free(_table, _numTableSlots * sizeof(Slot));
+	}
+
+	// removes all entries and keeps the memory
+	void Clear()
+	{
+		_numEntries = 0;
+		for (u32 i = 0; i < _numTableSlots; i++)
+			_table[i] = { 0, NO_VALUE };
+	}
 
-	MemReuseHashTable(char*& data) : _pdata(&data) {}
-	~MemReuseHashTable()
+	DATO_FORCEINLINE const char* _Data(Pos off) const
 	{
-		DATO_FREE(_entries);
-		DATO_FREE(_table);
+		return _builder ? _builder->_Ptr(off) : *_pdata + off;
 	}
 
-	Entry* Find(const void* mem, u32 len) const
+	DATO_FORCEINLINE Entry* Find(const void* mem, u32 len) const
+	{
+		if (!_numEntries)
+			return nullptr;
+		return Find(mem, len, MemHash(mem, len));
+	}
+	// `hash` must be MemHash(mem, len)
+	Entry* Find(const void* mem, u32 len, u32 hash) const
 	{
 		if (!_numEntries)
 			return nullptr;
-		char* data = *_pdata;
-		u32 hash = MemHash(mem, len);
-		u32 ipos = hash % _numTableSlots;
-		u32 pos = ipos;
-		for (;;)
+		u32 mask = _numTableSlots - 1;
+		u32 pos = hash & mask;
+		for (u32 dist = 0;; dist++)
 		{
-			u32 p = _table[pos];
-			if (p == NO_VALUE)
-				return nullptr;
-			Entry& e = _entries[p];
-			if (e.hash == hash &&
-				e.len == len &&
-				memcmp(&data[e.dataOff], mem, len) == 0)
-				return &e;
-			pos = (pos + 1) % _numTableSlots;
-			if (pos == ipos)
+			const Slot& s = _table[pos];
+			if (s.entry == NO_VALUE || ((pos - s.hash) & mask) < dist)
 				return nullptr;
+			if (s.hash == hash)
+			{
+				Entry& e = _entries[s.entry];
+				if (e.len == len &&
+					memcmp(_Data(e.dataOff), mem, len) == 0)
+					return &e;
+			}
+			pos = (pos + 1) & mask;
 		}
 	}
 
 	// must not already exist in the table
-	void Insert(u32 valuePos, u32 dataOff, u32 len)
+	// - returns false (without inserting it) if the allocator fails
+	DATO_FORCEINLINE bool Insert(Pos valuePos, Pos dataOff, u32 len)
+	{
+		return Insert(valuePos, dataOff, len, MemHash(_Data(dataOff), len));
+	}
+	// `hash` must be MemHash(&data[dataOff], len)
+	bool Insert(Pos valuePos, Pos dataOff, u32 len, u32 hash)
 	{
 		// keep at least 20% of the hash->pos table free
-		if (_numEntries * 5 >= _numTableSlots * 4)
-			_Rehash(_numTableSlots == 0 ? 16 : _numTableSlots * 2);
+		if (_numEntries * 5 >= _numTableSlots * 4 && !_Rehash(_numTableSlots == 0 ? 16 : _numTableSlots * 2))
+			return false;
 
 		if (_numEntries >= _memEntries)
 		{
-			_memEntries = _memEntries == 0 ? 16 : _memEntries * 2;
-			_entries = (Entry*) DATO_REALLOC(_entries, _memEntries * sizeof(Entry));
+			u32 newMem = _memEntries == 0 ? 16 : _memEntries * 2;
+			Entry* entries = (Entry*) _alloc->Realloc(_entries, _memEntries * sizeof(Entry), newMem * sizeof(Entry));
+			if (!entries)
+				return false;
+			_entries = entries;
+			_memEntries = newMem;
 		}
 
-		char* data = *_pdata;
-		u32 hash = MemHash(&data[dataOff], len);
 		u32 entryIndex = _numEntries++;
 		_entries[entryIndex] = { valuePos, dataOff, len, hash };
-		_Insert(hash, entryIndex);
+		_Insert({ hash, entryIndex });
+		return true;
 	}
 
-	void _Rehash(u32 newSlots)
+	// keeps the old table if the allocator fails
+	bool _Rehash(u32 newSlots)
 	{
-		DATO_FREE(_table);
-		_table = (u32*) DATO_MALLOC(newSlots * sizeof(u32));
+		Slot* table = (Slot*) _alloc->Realloc(nullptr, 0, newSlots * sizeof(Slot));
+		if (!table)
+			return false;
+		_alloc->Free(_table, _numTableSlots * sizeof(Slot));
+		_table = table;
 		_numTableSlots = newSlots;
 
 		for (u32 i = 0; i < newSlots; i++)
-			_table[i] = NO_VALUE;
+			_table[i] = { 0, NO_VALUE };
 
 		for (u32 i = 0; i < _numEntries; i++)
-		{
-			const Entry& e = _entries[i];
-			_Insert(e.hash, i);
-		}
+			_Insert({ _entries[i].hash, i });
+		return true;
 	}
 
-	void _Insert(u32 hash, u32 entryIndex)
+	void _Insert(Slot ins)
 	{
-		u32 ipos = hash % _numTableSlots;
-		u32 pos = ipos;
-		for (;;)
+		u32 mask = _numTableSlots - 1;
+		u32 pos = ins.hash & mask;
+		for (u32 dist = 0;; dist++)
 		{
-			u32 p = _table[pos];
-			if (p == NO_VALUE)
+			Slot& s = _table[pos];
+			if (s.entry == NO_VALUE)
 			{
-				_table[pos] = entryIndex;
+				s = ins;
 				return;
 			}
-
-			// TODO robin hood hashing
-
-			pos = (pos + 1) % _numTableSlots;
-			if (pos == ipos)
+			// take the slot from the entry that is closer to its ideal slot and continue with that one
+			u32 sdist = (pos - s.hash) & mask;
+			if (sdist < dist)
 			{
-				// unexpectedly failed to insert
-				DATO_CRASH;
-				return;
+				Slot tmp = s;
+				s = ins;
+				ins = tmp;
+				dist = sdist;
 			}
+			pos = (pos + 1) & mask;
 		}
 	}
 };
+using MemReuseHashTable = BasicMemReuseHashTable<WriterPos>;
+
+// classes of values that the writer can deduplicate (identical values are written once and referenced again)
+static const u8 DEDUP_Strings = 1 << 0; // TYPE_String8/16/32
+static const u8 DEDUP_ByteArrays = 1 << 1;
+static const u8 DEDUP_Vectors = 1 << 2; // TYPE_Vector/VectorArray
+static const u8 DEDUP_Scalars64 = 1 << 3; // TYPE_S64/U64/F64
+static const u8 DEDUP_Containers = 1 << 4; // maps and arrays with the same keys, value types and value positions
+static const u8 DEDUP_All = 0x1f;
+
+inline u8 DedupClass(u8 type)
+{
+	switch (type)
+	{
+	case TYPE_String8:
+	case TYPE_String16:
+	case TYPE_String32: return DEDUP_Strings;
+	case TYPE_ByteArray: return DEDUP_ByteArrays;
+	case TYPE_Vector:
+	case TYPE_VectorArray: return DEDUP_Vectors;
+	case TYPE_S64:
+	case TYPE_U64:
+	case TYPE_F64: return DEDUP_Scalars64;
+	case TYPE_Array:
+	case TYPE_StringMap:
+	case TYPE_IntMap:
+	case TYPE_StringHashMap: return DEDUP_Containers;
+	}
+	return 0;
+}
 
-struct WriterBase : Builder
+template <class Pos>
+struct BasicWriterBase : BasicBuilder<Pos>
 {
-	MemReuseHashTable _keyTable { _data };
+	typedef BasicBuilder<Pos> Builder;
+	typedef BasicKeyRef<Pos> KeyRef;
+	typedef BasicValueRef<Pos> ValueRef;
+	using Builder::_data;
+	using Builder::GetSize;
+	using Builder::AddByte;
+	using Builder::AddMem;
+	using Builder::AddZeroesUntil;
+
+	static const u32 SlotSize = sizeof(Pos); // the size of map keys and map/array values
+
+	BasicMemReuseHashTable<Pos> _keyTable { this };
 	u32 _rootPos;
 	u32 _rootTypePos;
 	u8 _flags;
+	u64 _generation = NewDocumentId(); // see GetGeneration
+
+	// value deduplication (see DEDUP_*)
+	// - the written values of each type are found by their contents (starting from the value position, ..
+	// .. so that the alignment is the same), the 64-bit scalars of all types share one table
+	// - maps and arrays are compared by a copy of their data in `_dedupBlocks` with absolute value positions
+	// - when streaming, there are two generations of tables and copies (see SetStreaming), ..
+	// .. otherwise only the first one is used
+	u8 _dedupValues = 0;
+	u8 _dedupGen = 0; // the current generation
+	BasicMemReuseHashTable<Pos> _valueTables[2][TYPE_StringHashMap + 1];
+	BasicBuilder<Pos> _dedupBlocks[2];
+	// a copy of the key contents when streaming (KeyRef::dataPos is then a position in it)
+	BasicBuilder<Pos> _keyStore;
+
+	BasicWriterBase(const char* prefix, u32 pfxsize, u8 cfgid, u8 flags, IAllocator* alloc = nullptr) : _flags(flags)
+	{
+		if (!alloc)
+			alloc = GetDefaultAllocator();
+		Builder::SetAllocator(alloc);
+		_keyTable._alloc = alloc;
+		_keyStore.SetAllocator(alloc);
+		for (u8 g = 0; g < 2; g++)
+		{
+			_dedupBlocks[g].SetAllocator(alloc);
+			for (u8 t = 0; t <= TYPE_StringHashMap; t++)
+			{
+				_valueTables[g][t]._builder = DedupClass(t) == DEDUP_Containers ? &_dedupBlocks[g] : this;
+				_valueTables[g][t]._alloc = alloc;
+			}
+		}
 
-	WriterBase(const char* prefix, u32 pfxsize, u8 cfgid, u8 flags) : _flags(flags)
-	{
 		AddMem(prefix, pfxsize);
 		AddByte(cfgid);
 		AddByte(flags);
@@ -555,32 +1315,192 @@ struct WriterBase : Builder
 
 		// root position
 		if (flags & FLAG_Aligned)
-			AddZeroesUntil(RoundUp(GetSize(), 4));
+			AddZeroesUntil(RoundUp(GetSize(), SlotSize));
 		_rootPos = GetSize();
-		AddZeroesUntil(GetSize() + 4); // reserve the space
+		AddZeroesUntil(GetSize() + SlotSize); // reserve the space
 	}
 
 	void SetRoot(ValueRef objRef)
 	{
-		_data[_rootTypePos] = objRef.type;
-		memcpy(&_data[_rootPos], &objRef.pos, 4);
+		Builder::_Patch(_rootTypePos, &objRef.type, 1);
+		Builder::_Patch(_rootPos, &objRef.pos, SlotSize);
+	}
+
+	// puts the written data (not the other memory of the writer) in memory from `alloc` ..
+	// .. (e.g. MappedOutputFile from dato_output.hpp), moving the already written data
+	void SetDataAllocator(IAllocator* alloc)
+	{
+		Builder::SetAllocator(alloc);
 	}
 
+	// see BasicBuilder::SetStreaming (must be called before anything else is written)
+	// - the contents of the keys are kept in memory for key deduplication and sorting, ..
+	// .. and the deduplicated values are compared by a copy
+	// - the copies are kept in two generations of about `window` bytes: when the current one is full, ..
+	// .. the previous one is dropped and the values found in it are copied to the next one, so the ..
+	// .. copies take up to about 2 * `window` bytes and only the recent or reused values are deduplicated
+	void SetStreaming(IOutputStream* out, Pos window = 4 * 1024 * 1024, Pos segmentSize = 1024 * 1024)
+	{
+		DATO_INPUT_EXPECT(GetSize() == _rootPos + SlotSize);
+		Builder::SetStreaming(out, window, segmentSize);
+		if (!Builder::IsStreaming())
+			return;
+		_keyTable._builder = &_keyStore;
+		for (u8 g = 0; g < 2; g++)
+			for (auto& table : _valueTables[g])
+				table._builder = &_dedupBlocks[g];
+	}
+
+	// the contents of a key (see KeyRef::dataPos)
+	DATO_FORCEINLINE const char* _KeyData(Pos dataPos) const
+	{
+		return Builder::_stream ? _keyStore._data + dataPos : Builder::_Ptr(dataPos);
+	}
+
+	// starts a new document with the same header and settings, keeping all of the allocated memory
+	// - not possible after streaming has written anything
+	// - the KeyRefs and ValueRefs of the previous document must not be used after this (objects that ..
+	// .. keep them across documents, such as StructWriter, check GetGeneration)
+	void Reset()
+	{
+		_generation = NewDocumentId();
+		Builder::Truncate(_rootPos + SlotSize);
+		Builder::error = false;
+		SetRoot({ 0, 0 });
+		_keyTable.Clear();
+		_ClearValueTables(0);
+		_ClearValueTables(1);
+		_dedupGen = 0;
+		_keyStore.Truncate(0);
+	}
+	void _ClearValueTables(u8 gen)
+	{
+		for (auto& table : _valueTables[gen])
+			table.Clear();
+		_dedupBlocks[gen].Truncate(0);
+	}
+
+	// identifies the current document (unique in the process, also for writers created at the address ..
+	// .. of a destroyed one), the refs are only valid in the generation they were written in
+	DATO_FORCEINLINE u64 GetGeneration() const { return _generation; }
+
 	DATO_FORCEINLINE u8 Align(u8 a)
 	{
 		return _flags & FLAG_Aligned ? a : 0;
 	}
 
+	DATO_FORCEINLINE void AddSlot(Pos v)
+	{
+		AddMem(&v, SlotSize);
+	}
+
+	// enables deduplication of the value classes (DEDUP_*) written after this
+	// - the values are compared with all of the values of the same type that were written with it enabled
+	DATO_FORCEINLINE void SetValueDedup(u8 classes) { _dedupValues = classes; }
+	DATO_FORCEINLINE u8 GetValueDedup() const { return _dedupValues; }
+
+	// returns the earlier copy of the value that was just written at [ref.pos, GetSize()) and ..
+	// .. removes the new one (back to `start`), if there is one
+	DATO_FORCEINLINE ValueRef _Dedup(u8 dedupClass, ValueRef ref, Pos start)
+	{
+		if (!(_dedupValues & dedupClass))
+			return ref;
+		return _DedupImpl(ref, start);
+	}
+	DATO_NOINLINE ValueRef _DedupImpl(ValueRef ref, Pos start)
+	{
+		Pos len = GetSize() - ref.pos;
+		// (after errors, the value may not have been written, see BasicBuilder::_ResizeImpl)
+		if (u64(len) > 0xffffffff || start < Builder::_flushed || Builder::error)
+			return ref;
+		u8 tableIndex = ref.type == TYPE_S64 || ref.type == TYPE_F64 ? TYPE_U64 : ref.type;
+		// (the earlier values may have been written out when streaming)
+		if (Builder::_stream)
+			return _DedupContainerImpl(ref, start, 0, 0, false, tableIndex);
+		// (values that cross segments are not deduplicated)
+		if (!Builder::_IsContiguousToEnd(ref.pos))
+			return ref;
+		auto& table = _valueTables[0][tableIndex];
+		const char* mem = Builder::_Ptr(ref.pos);
+		u32 hash = MemHash(mem, u32(len));
+		if (auto* e = table.Find(mem, u32(len), hash))
+		{
+			Builder::Truncate(start);
+			return { ref.type, e->valuePos };
+		}
+		table.Insert(ref.pos, ref.pos, u32(len), hash);
+		return ref;
+	}
+	// `basepos` is where the relative references start, `hasKeys` is true for maps
+	DATO_FORCEINLINE ValueRef _DedupContainer(ValueRef ref, Pos start, Pos basepos, u32 count, bool hasKeys)
+	{
+		if (!(_dedupValues & DEDUP_Containers))
+			return ref;
+		return _DedupContainerImpl(ref, start, basepos, count, hasKeys, ref.type);
+	}
+	DATO_NOINLINE ValueRef _DedupContainerImpl(ValueRef ref, Pos start, Pos basepos, u32 count, bool hasKeys, u8 tableIndex)
+	{
+		Pos len = GetSize() - ref.pos;
+		if (u64(len) > 0xffffffff || start < Builder::_flushed || Builder::error)
+			return ref;
+		if (Builder::_stream && _dedupBlocks[_dedupGen].GetSize() >= Builder::_window)
+		{
+			_dedupGen ^= 1;
+			_ClearValueTables(_dedupGen);
+		}
+		auto& blocks = _dedupBlocks[_dedupGen];
+		Pos blockPos = blocks.GetSize();
+		if (!blocks._ReserveForAppend(len))
+			return ref;
+		char* block = blocks._End();
+		Builder::_Read(ref.pos, block, len);
+		blocks._size += len;
+		Pos values = basepos - ref.pos + (hasKeys ? Pos(count) * SlotSize : 0);
+		Pos types = values + Pos(count) * SlotSize;
+		for (u32 i = 0; i < count; i++)
+		{
+			if (!IsReferenceType(u8(block[types + i])))
+				continue;
+			Pos vp;
+			memcpy(&vp, &block[values + i * SlotSize], SlotSize);
+			vp = basepos - vp;
+			memcpy(&block[values + i * SlotSize], &vp, SlotSize);
+		}
+		auto& table = _valueTables[_dedupGen][tableIndex];
+		u32 hash = MemHash(block, u32(len));
+		if (auto* e = table.Find(block, u32(len), hash))
+		{
+			blocks.Truncate(blockPos);
+			Builder::Truncate(start);
+			return { ref.type, e->valuePos };
+		}
+		if (Builder::_stream)
+		{
+			if (auto* e = _valueTables[_dedupGen ^ 1][tableIndex].Find(block, u32(len), hash))
+			{
+				// (keeps the copy in the current generation)
+				ValueRef found = { ref.type, e->valuePos };
+				Builder::Truncate(start);
+				if (!table.Insert(found.pos, blockPos, u32(len), hash))
+					blocks.Truncate(blockPos);
+				return found;
+			}
+		}
+		if (!table.Insert(ref.pos, blockPos, u32(len), hash))
+			blocks.Truncate(blockPos);
+		return ref;
+	}
+
 	DATO_FORCEINLINE KeyRef WriteIntKey(u32 k)
 	{
 		return { k, 0, 0 };
 	}
 
-	DATO_FORCEINLINE u32 AddValue8(const void* mem)
+	DATO_FORCEINLINE Pos AddValue8(const void* mem)
 	{
 		if (_flags & FLAG_Aligned)
 			AddZeroesUntil(RoundUp(GetSize(), 8));
-		u32 ret = GetSize();
+		Pos ret = GetSize();
 		AddMem(mem, 8);
 		return ret;
 	}
@@ -607,27 +1527,31 @@ struct WriterBase : Builder
 	}
 	DATO_FORCEINLINE ValueRef WriteS64(s64 v)
 	{
-		return { TYPE_S64, AddValue8(&v) };
+		Pos start = GetSize();
+		return _Dedup(DEDUP_Scalars64, { TYPE_S64, AddValue8(&v) }, start);
 	}
 	DATO_FORCEINLINE ValueRef WriteU64(u64 v)
 	{
-		return { TYPE_U64, AddValue8(&v) };
+		Pos start = GetSize();
+		return _Dedup(DEDUP_Scalars64, { TYPE_U64, AddValue8(&v) }, start);
 	}
 	DATO_FORCEINLINE ValueRef WriteF64(f64 v)
 	{
-		return { TYPE_F64, AddValue8(&v) };
+		Pos start = GetSize();
+		return _Dedup(DEDUP_Scalars64, { TYPE_F64, AddValue8(&v) }, start);
 	}
 
 	ValueRef WriteVectorRaw(const void* data, u8 subtype, u8 sizeAlign, u16 elemCount)
 	{
 		DATO_INPUT_EXPECT(elemCount >= 1 && elemCount <= 255);
+		Pos start = GetSize();
 		if (_flags & FLAG_Aligned)
 			AddZeroesUntil(RoundUp(GetSize() + 2, sizeAlign) - 2);
-		u32 pos = GetSize();
+		Pos pos = GetSize();
 		AddByte(subtype);
 		AddByte(u8(elemCount));
 		AddMem(data, sizeAlign * elemCount);
-		return { TYPE_Vector, pos };
+		return _Dedup(DEDUP_Vectors, { TYPE_Vector, pos }, start);
 	}
 	template <class T>
 	DATO_FORCEINLINE ValueRef WriteVectorT(const T* values, u16 elemCount)
@@ -635,23 +1559,31 @@ struct WriterBase : Builder
 		return WriteVectorRaw(values, SubtypeInfo<T>::Subtype, sizeof(T), elemCount);
 	}
 };
+using WriterBase = BasicWriterBase<WriterPos>;
 
 struct TempMem
 {
 	void* _data = nullptr;
 	u32 _size = 0;
+	IAllocator* _alloc = GetDefaultAllocator();
 
+	TempMem() {}
+	TempMem(const TempMem&) = delete;
+	TempMem& operator = (const TempMem&) = delete;
 	~TempMem()
 	{
-		DATO_FREE(_data);
+		_alloc->Free(_data, _size);
 	}
+	// returns null if the allocator fails (and `atLeast` > 0)
 	void* GetDataBytes(u32 atLeast)
 	{
 		if (_size < atLeast)
 		{
+			_alloc->Free(_data, _size);
 			_size += atLeast;
-			DATO_FREE(_data);
-			_data = DATO_MALLOC(_size);
+			_data = _alloc->Realloc(nullptr, 0, _size);
+			if (!_data)
+				_size = 0;
 		}
 		return _data;
 	}
@@ -664,7 +1596,8 @@ struct TempMem
 	DATO_FORCEINLINE T* CopyData(const T* from, u32 count)
 	{
 		T* data = GetData<T>(count);
-		memcpy(data, from, sizeof(T) * count);
+		if (data)
+			memcpy(data, from, sizeof(T) * count);
 		return data;
 	}
 };
@@ -677,7 +1610,8 @@ template <class T> DATO_FORCEINLINE void PODSwap(T& a, T& b)
 	b = tmp;
 }
 
-inline void SortEntriesByKeyInt_Insertion(TempMem&, IntMapEntry* entries, u32 count)
+template <class Pos>
+inline void SortEntriesByKeyInt_Insertion(TempMem&, BasicIntMapEntry<Pos>* entries, u32 count)
 {
 	// insertion sort
 	if (count < 2)
@@ -696,11 +1630,18 @@ inline void SortEntriesByKeyInt_Insertion(TempMem&, IntMapEntry* entries, u32 co
 	}
 }
 
-inline void SortEntriesByKeyInt_Radix(TempMem& tempMem, IntMapEntry* entries, u32 count)
+template <class Pos>
+inline void SortEntriesByKeyInt_Radix(TempMem& tempMem, BasicIntMapEntry<Pos>* entries, u32 count)
 {
 	// radix sort
-	IntMapEntry* from = entries;
-	IntMapEntry* to = tempMem.GetData<IntMapEntry>(count);
+	BasicIntMapEntry<Pos>* from = entries;
+	BasicIntMapEntry<Pos>* to = tempMem.GetData<BasicIntMapEntry<Pos>>(count);
+	if (!to)
+	{
+		// (no memory for the copy)
+		SortEntriesByKeyInt_Insertion(tempMem, entries, count);
+		return;
+	}
 	for (int part = 0; part < 4; part++)
 	{
 		u32 shift = part * 8;
@@ -727,7 +1668,8 @@ inline void SortEntriesByKeyInt_Radix(TempMem& tempMem, IntMapEntry* entries, u3
 	}
 }
 
-DATO_FORCEINLINE void SortEntriesByKeyInt(TempMem& tempMem, IntMapEntry* entries, u32 count)
+template <class Pos>
+DATO_FORCEINLINE void SortEntriesByKeyInt(TempMem& tempMem, BasicIntMapEntry<Pos>* entries, u32 count)
 {
 	if (count <= 58)
 		SortEntriesByKeyInt_Insertion(tempMem, entries, count);
@@ -735,14 +1677,16 @@ DATO_FORCEINLINE void SortEntriesByKeyInt(TempMem& tempMem, IntMapEntry* entries
 		SortEntriesByKeyInt_Radix(tempMem, entries, count);
 }
 
-inline int Q3SS_CharAt(const char* mem, const StringMapEntry& e, u32 at)
+template <class Pos, class Mem>
+inline int Q3SS_CharAt(const Mem& mem, const BasicStringMapEntry<Pos>& e, u32 at)
 {
 	if (at < e.key.dataLen)
 		return u8(mem[e.key.dataPos + at]);
 	return -1;
 }
 
-inline bool SIN_LessThan(const char* mem, const KeyRef& a, const KeyRef& b, u32 which)
+template <class Pos, class Mem>
+inline bool SIN_LessThan(const Mem& mem, const BasicKeyRef<Pos>& a, const BasicKeyRef<Pos>& b, u32 which)
 {
 	u32 minLen = a.dataLen < b.dataLen ? a.dataLen : b.dataLen;
 	int diff = memcmp(mem + a.dataPos + which, mem + b.dataPos + which, minLen - which);
@@ -751,10 +1695,11 @@ inline bool SIN_LessThan(const char* mem, const KeyRef& a, const KeyRef& b, u32
 	return a.dataLen < b.dataLen;
 }
 
-inline void InsertionStringSort(const char* mem, StringMapEntry* entries, int low, int high, u32 which)
+template <class Pos, class Mem>
+inline void InsertionStringSort(const Mem& mem, BasicStringMapEntry<Pos>* entries, int low, int high, u32 which)
 {
-	StringMapEntry* start = entries + low;
-	StringMapEntry* end = entries + high + 1;
+	BasicStringMapEntry<Pos>* start = entries + low;
+	BasicStringMapEntry<Pos>* end = entries + high + 1;
 	for (auto* i = start + 1; i != end; i++)
 	{
 		auto cur = *i;
@@ -769,8 +1714,9 @@ inline void InsertionStringSort(const char* mem, StringMapEntry* entries, int lo
 }
 
 // three-way string quicksort
+template <class Pos, class Mem>
 inline void Quick3StringSort(
-	const char* mem, StringMapEntry* entries, int low, int high, u32 which, int IST = 64)
+	const Mem& mem, BasicStringMapEntry<Pos>* entries, int low, int high, u32 which, int IST = 64)
 {
 	if (high <= low)
 		return;
@@ -800,57 +1746,107 @@ inline void Quick3StringSort(
 	Quick3StringSort(mem, entries, subhigh + 1, high, which);
 }
 
-inline void SortEntriesByKeyString(const char* mem, StringMapEntry* entries, u32 count)
+template <class Pos, class Mem>
+inline void SortEntriesByKeyString(const Mem& mem, BasicStringMapEntry<Pos>* entries, u32 count)
 {
 	Quick3StringSort(mem, entries, 0, int(count - 1), 0);
 }
 #endif // DATO_USE_STD_SORT
 
-struct DATO_CONCAT(Writer, DATO_CONFIG) : WriterBase
+template <class Config>
+struct BasicWriter : BasicWriterBase<typename Config::Pos>
 {
-	using Config = DATO_CONCAT(WriterConfig, DATO_CONFIG);
+	typedef typename Config::Pos Pos; // the type of sizes and offsets
+	typedef BasicWriterBase<Pos> Base;
+	typedef BasicKeyRef<Pos> KeyRef;
+	typedef BasicValueRef<Pos> ValueRef;
+	typedef BasicIntMapEntry<Pos> IntMapEntry;
+	typedef BasicStringMapEntry<Pos> StringMapEntry;
+	using Base::SlotSize;
+	using Base::_data;
+	using Base::_flags;
+	using Base::_keyTable;
+	using Base::GetSize;
+	using Base::AddByte;
+	using Base::AddMem;
+	using Base::AddZeroes;
+	using Base::AddZeroesUntil;
+	using Base::AddSlot;
+	using Base::Align;
+	using Base::_Dedup;
+	using Base::_DedupContainer;
+
 	TempMem _sortableEntries;
 	TempMem _sortCopyEntries;
 	bool _skipDuplicateKeys;
 
-	DATO_FORCEINLINE DATO_CONCAT(Writer, DATO_CONFIG)
+	DATO_FORCEINLINE BasicWriter
 	(
 		const char* prefix = "DATO",
 		u32 pfxsize = 4,
 		u8 flags = FLAG_Aligned | FLAG_SortedKeys,
-		bool skipDuplicateKeys = true
+		bool skipDuplicateKeys = true,
+		u8 dedupValues = 0, // DEDUP_* (see SetValueDedup)
+		IAllocator* alloc = nullptr // for all of the memory of the writer (null = GetDefaultAllocator())
 	)
-		: WriterBase(prefix, pfxsize, Config::Identifier(), flags)
-		, _skipDuplicateKeys(skipDuplicateKeys)
-	{}
+		: Base(prefix, pfxsize, Config::Identifier(), flags, alloc)
+		, _skipDuplicateKeys(skipDuplicateKeys || (flags & FLAG_UniqueKeys))
+	{
+		_sortableEntries._alloc = Base::_alloc;
+		_sortCopyEntries._alloc = Base::_alloc;
+		Base::SetValueDedup(dedupValues);
+	}
 
 	KeyRef WriteStringKey(const char* str, u32 size)
 	{
+		u32 hash = 0;
 		if (_skipDuplicateKeys)
 		{
-			if (auto* e = _keyTable.Find(str, size))
+			hash = MemHash(str, size);
+			if (auto* e = _keyTable.Find(str, size, hash))
 				return { e->valuePos, e->dataOff, e->len };
 		}
 
-		u32 pos = Config::WriteKeyLength(*this, size, 0, nullptr, 0);
-		u32 dataPos = GetSize();
+		Pos pos = Config::WriteKeyLength(*this, size, 0, nullptr, 0);
+		Pos dataPos = GetSize();
+		if (!Base::_ReserveForAppend(size + 1)) // (keeps the key contiguous in segmented data)
+			return { pos, dataPos, 0 };
 		AddMem(str, size);
 		AddByte(0);
-
-		if (_skipDuplicateKeys)
+		if (Base::_stream)
 		{
-			_keyTable.Insert(pos, dataPos, size);
+			dataPos = Base::_keyStore.GetSize();
+			if (!Base::_keyStore._ReserveForAppend(size + 1))
+			{
+				Base::error = true;
+				return { pos, dataPos, 0 };
+			}
+			Base::_keyStore.AddMem(str, size);
+			Base::_keyStore.AddByte(0);
 		}
 
+		// (without the entry, the duplicates of this key would not be found)
+		if (_skipDuplicateKeys && !_keyTable.Insert(pos, dataPos, size, hash))
+			Base::error = true;
+
 		return { pos, dataPos, size };
 	}
 	DATO_FORCEINLINE KeyRef WriteStringKey(const char* str) { return WriteStringKey(str, StrLen(str)); }
 
+	// for the writes that fail to allocate their temporary memory (see TempMem)
+	ValueRef _TempMemFailed()
+	{
+		Base::error = true;
+		return Base::WriteNull();
+	}
+
 	ValueRef WriteStringMap(const StringMapEntry* entries, u32 count)
 	{
 		if (_flags & FLAG_SortedKeys)
 		{
 			StringMapEntry* sea = _sortableEntries.CopyData(entries, count);
+			if (!sea && count)
+				return _TempMemFailed();
 			_SortStringMapEntries(sea, count);
 			entries = sea;
 		}
@@ -866,6 +1862,29 @@ struct DATO_CONCAT(Writer, DATO_CONFIG) : WriterBase
 		return _WriteStringMapImpl(entries, count);
 	}
 
+	// writes the entries in the given order, without copying or sorting them
+	// - with FLAG_SortedKeys, they must already be in the order WriteStringMap would sort them to ..
+	// .. (not checked: the readers would not find the keys that are out of order)
+	ValueRef WriteStringMapPresorted(const StringMapEntry* entries, u32 count)
+	{
+		return _WriteStringMapImpl(entries, count);
+	}
+
+	// a string map with a hash table for lookups without key comparisons (TYPE_StringHashMap)
+	// - the entries (and thus iteration/indices) are in the same order as with WriteStringMap
+	ValueRef WriteStringHashMap(const StringMapEntry* entries, u32 count)
+	{
+		if (_flags & FLAG_SortedKeys)
+		{
+			StringMapEntry* sea = _sortableEntries.CopyData(entries, count);
+			if (!sea && count)
+				return _TempMemFailed();
+			_SortStringMapEntries(sea, count);
+			entries = sea;
+		}
+		return _WriteStringMapImpl(entries, count, true);
+	}
+
 	void _SortStringMapEntries(StringMapEntry* entries, u32 count)
 	{
 #ifdef DATO_USE_STD_SORT
@@ -875,25 +1894,57 @@ struct DATO_CONCAT(Writer, DATO_CONFIG) : WriterBase
 			[this](const StringMapEntry& a, const StringMapEntry& b)
 		{
 			u32 minSize = a.key.dataLen < b.key.dataLen ? a.key.dataLen : b.key.dataLen;
-			const char* ka = _data + a.key.dataPos;
-			const char* kb = _data + b.key.dataPos;
+			const char* ka = Base::_KeyData(a.key.dataPos);
+			const char* kb = Base::_KeyData(b.key.dataPos);
 			if (int diff = memcmp(ka, kb, minSize))
 				return diff < 0;
 			return a.key.dataLen < b.key.dataLen;
 		});
 #else
-		SortEntriesByKeyString(_data, entries, count);
+		if (Base::_stream)
+			SortEntriesByKeyString((const char*) Base::_keyStore._data, entries, count);
+		else if (Base::IsSegmented())
+			SortEntriesByKeyString(SegmentedMem<Pos>{ this }, entries, count);
+		else
+			SortEntriesByKeyString((const char*) _data, entries, count);
 #endif
 	}
 
-	ValueRef _WriteStringMapImpl(const StringMapEntry* entries, u32 count)
+	ValueRef _WriteStringMapImpl(const StringMapEntry* entries, u32 count, bool withHashTable = false)
 	{
-		u32 pos = Config::WriteMapSize(*this, count, Align(4), nullptr, 0);
-		u32 basepos = GetSize();
+		Pos start = GetSize();
+		Pos pos = Config::WriteMapSize(*this, count, Align(SlotSize), nullptr, 0);
+		Pos basepos = GetSize();
 		for (u32 i = 0; i < count; i++)
-			AddU32(entries[i].key.pos);
+			AddSlot(entries[i].key.pos);
 		_WriteMapValuesAndTypes(entries, count, basepos);
-		return { TYPE_StringMap, pos };
+		if (withHashTable)
+			_WriteKeyHashTable(entries, count);
+		return _DedupContainer({ withHashTable ? TYPE_StringHashMap : TYPE_StringMap, pos }, start, basepos, count, true);
+	}
+
+	void _WriteKeyHashTable(const StringMapEntry* entries, u32 count)
+	{
+		u32 numBuckets = u32(HashMapBucketCount(count));
+		u32 mask = numBuckets - 1;
+		if (_flags & FLAG_Aligned)
+			AddZeroesUntil(RoundUp(GetSize(), 4));
+		Pos indices = GetSize();
+		Pos fingerprints = indices + Pos(numBuckets) * 4;
+		AddZeroes(Pos(numBuckets) * 5);
+		if (GetSize() != fingerprints + Pos(numBuckets))
+			return; // (dropped, see BasicBuilder::_ResizeImpl)
+		char* table = Base::_Ptr(indices);
+		char* fptable = table + (fingerprints - indices);
+		for (u32 i = 0; i < count; i++)
+		{
+			u32 hash = KeyHash(Base::_KeyData(entries[i].key.dataPos), entries[i].key.dataLen);
+			u32 b = hash & mask;
+			while (fptable[b])
+				b = (b + 1) & mask;
+			memcpy(&table[Pos(b) * 4], &i, 4);
+			fptable[b] = char(KeyHashFingerprint(hash));
+		}
 	}
 
 	ValueRef WriteIntMap(const IntMapEntry* entries, u32 count)
@@ -901,6 +1952,8 @@ struct DATO_CONCAT(Writer, DATO_CONFIG) : WriterBase
 		if (_flags & FLAG_SortedKeys)
 		{
 			IntMapEntry* sea = _sortableEntries.CopyData(entries, count);
+			if (!sea && count)
+				return _TempMemFailed();
 			_SortIntMapEntries(sea, count);
 			entries = sea;
 		}
@@ -933,22 +1986,34 @@ struct DATO_CONCAT(Writer, DATO_CONFIG) : WriterBase
 
 	ValueRef _WriteIntMapImpl(const IntMapEntry* entries, u32 count)
 	{
-		u32 pos = Config::WriteMapSize(*this, count, Align(4), nullptr, 0);
-		u32 basepos = GetSize();
+		if (count >= EYTZINGER_MinSize
+			&& (_flags & (FLAG_SortedKeys | FLAG_EytzingerIntMaps)) == (FLAG_SortedKeys | FLAG_EytzingerIntMaps))
+		{
+			// (the sorting buffer is not used after sorting)
+			IntMapEntry* eo = _sortCopyEntries.GetData<IntMapEntry>(count);
+			if (!eo)
+				return _TempMemFailed();
+			for (u32 i = 0; i < count; i++)
+				eo[EytzingerSlotFromRank(i, count)] = entries[i];
+			entries = eo;
+		}
+		Pos start = GetSize();
+		Pos pos = Config::WriteMapSize(*this, count, Align(SlotSize), nullptr, 0);
+		Pos basepos = GetSize();
 		for (u32 i = 0; i < count; i++)
-			AddU32(entries[i].key);
+			AddSlot(entries[i].key);
 		_WriteMapValuesAndTypes(entries, count, basepos);
-		return { TYPE_IntMap, pos };
+		return _DedupContainer({ TYPE_IntMap, pos }, start, basepos, count, true);
 	}
 
-	template <class EntryT> void _WriteMapValuesAndTypes(const EntryT* entries, u32 count, u32 basepos)
+	template <class EntryT> void _WriteMapValuesAndTypes(const EntryT* entries, u32 count, Pos basepos)
 	{
 		for (u32 i = 0; i < count; i++)
 		{
-			u32 vp = entries[i].value.pos;
+			Pos vp = entries[i].value.pos;
 			if (IsReferenceType(entries[i].value.type))
 				vp = basepos - vp;
-			AddU32(vp);
+			AddSlot(vp);
 		}
 
 		for (u32 i = 0; i < count; i++)
@@ -957,40 +2022,43 @@ struct DATO_CONCAT(Writer, DATO_CONFIG) : WriterBase
 
 	ValueRef WriteArray(const ValueRef* values, u32 count)
 	{
-		u32 pos = Config::WriteArrayLength(*this, count, Align(4), nullptr, 0);
-		u32 basepos = GetSize();
+		Pos start = GetSize();
+		Pos pos = Config::WriteArrayLength(*this, count, Align(SlotSize), nullptr, 0);
+		Pos basepos = GetSize();
 
 		for (u32 i = 0; i < count; i++)
 		{
-			u32 vp = values[i].pos;
+			Pos vp = values[i].pos;
 			if (IsReferenceType(values[i].type))
 				vp = basepos - vp;
-			AddU32(vp);
+			AddSlot(vp);
 		}
 
 		for (u32 i = 0; i < count; i++)
 			AddByte(values[i].type);
-		return { TYPE_Array, pos };
+		return _DedupContainer({ TYPE_Array, pos }, start, basepos, count, false);
 	}
 
-	ValueRef WriteString8(const char* str, u32 size)
+	ValueRef WriteString8(const char* str, Pos size)
 	{
-		u32 pos = Config::WriteValueLength(*this, size, 0, nullptr, 0);
+		Pos start = GetSize();
+		Pos pos = Config::WriteValueLength(*this, size, 0, nullptr, 0);
 		AddMem(str, size);
 		AddByte(0);
-		return { TYPE_String8, pos };
+		return _Dedup(DEDUP_Strings, { TYPE_String8, pos }, start);
 	}
 	DATO_FORCEINLINE ValueRef WriteString8(const char* str) { return WriteString8(str, StrLen(str)); }
 
-	ValueRef WriteString16(const u16* str, u32 size)
+	ValueRef WriteString16(const u16* str, Pos size)
 	{
-		u32 pos = Config::WriteValueLength(*this, size, Align(2), nullptr, 0);
+		Pos start = GetSize();
+		Pos pos = Config::WriteValueLength(*this, size, Align(2), nullptr, 0);
 		AddMem(str, size * sizeof(*str));
 		AddZeroes(2);
-		return { TYPE_String16, pos };
+		return _Dedup(DEDUP_Strings, { TYPE_String16, pos }, start);
 	}
 	DATO_FORCEINLINE ValueRef WriteString16(const u16* str) { return WriteString16(str, StrLen(str)); }
-	DATO_FORCEINLINE ValueRef WriteString16(const char16_t* str, u32 size)
+	DATO_FORCEINLINE ValueRef WriteString16(const char16_t* str, Pos size)
 	{
 		static_assert(sizeof(u16) == sizeof(char16_t), "unexpected type size difference");
 		return WriteString16((const u16*) str, size);
@@ -998,15 +2066,16 @@ struct DATO_CONCAT(Writer, DATO_CONFIG) : WriterBase
 	DATO_FORCEINLINE ValueRef WriteString16(const char16_t* str)
 	{ return WriteString16(str, StrLen(str)); }
 
-	ValueRef WriteString32(const u32* str, u32 size)
+	ValueRef WriteString32(const u32* str, Pos size)
 	{
-		u32 pos = Config::WriteValueLength(*this, size, Align(4), nullptr, 0);
+		Pos start = GetSize();
+		Pos pos = Config::WriteValueLength(*this, size, Align(4), nullptr, 0);
 		AddMem(str, size * sizeof(*str));
 		AddZeroes(4);
-		return { TYPE_String32, pos };
+		return _Dedup(DEDUP_Strings, { TYPE_String32, pos }, start);
 	}
 	DATO_FORCEINLINE ValueRef WriteString32(const u32* str) { return WriteString32(str, StrLen(str)); }
-	DATO_FORCEINLINE ValueRef WriteString32(const char32_t* str, u32 size)
+	DATO_FORCEINLINE ValueRef WriteString32(const char32_t* str, Pos size)
 	{
 		static_assert(sizeof(u32) == sizeof(char32_t), "unexpected type size difference");
 		return WriteString32((const u32*) str, size);
@@ -1014,32 +2083,35 @@ struct DATO_CONCAT(Writer, DATO_CONFIG) : WriterBase
 	DATO_FORCEINLINE ValueRef WriteString32(const char32_t* str)
 	{ return WriteString32(str, StrLen(str)); }
 
-	ValueRef WriteByteArray(const void* data, u32 size, u32 align = 0)
+	ValueRef WriteByteArray(const void* data, Pos size, u32 align = 0)
 	{
-		u32 pos = Config::WriteValueLength(*this, size, align, nullptr, 0);
+		Pos start = GetSize();
+		Pos pos = Config::WriteValueLength(*this, size, align, nullptr, 0);
 		AddMem(data, size);
-		return { TYPE_ByteArray, pos };
+		return _Dedup(DEDUP_ByteArrays, { TYPE_ByteArray, pos }, start);
 	}
 
-	ValueRef WriteVectorArrayRaw(const void* data, u8 subtype, u8 sizeAlign, u16 elemCount, u32 length)
+	ValueRef WriteVectorArrayRaw(const void* data, u8 subtype, u8 sizeAlign, u16 elemCount, Pos length)
 	{
 		DATO_INPUT_EXPECT(elemCount >= 1 && elemCount <= 255);
 		u8 prefix[] = { subtype, u8(elemCount) };
-		u32 pos = Config::WriteValueLength(
+		Pos start = GetSize();
+		Pos pos = Config::WriteValueLength(
 			*this,
 			length,
 			Align(length ? sizeAlign : 1),
 			prefix,
 			sizeof(prefix));
-		AddMem(data, sizeAlign * elemCount * length);
-		return { TYPE_VectorArray, pos };
+		AddMem(data, Pos(sizeAlign * elemCount) * length);
+		return _Dedup(DEDUP_Vectors, { TYPE_VectorArray, pos }, start);
 	}
 	template <class T>
-	DATO_FORCEINLINE ValueRef WriteVectorArrayT(const T* values, u16 elemCount, u32 length)
+	DATO_FORCEINLINE ValueRef WriteVectorArrayT(const T* values, u16 elemCount, Pos length)
 	{
 		return WriteVectorArrayRaw(values, SubtypeInfo<T>::Subtype, sizeof(T), elemCount, length);
 	}
 };
+using DATO_CONCAT(Writer, DATO_CONFIG) = BasicWriter<DATO_CONCAT(WriterConfig, DATO_CONFIG)>;
 using Writer = DATO_CONCAT(Writer, DATO_CONFIG);
 
 } // dato
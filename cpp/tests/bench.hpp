@@ -31,6 +31,19 @@ DATO_FORCEINLINE Timestamp GetFrequency()
 	QueryPerformanceFrequency(&i);
 	return i.QuadPart;
 }
+#else
+#include <time.h>
+
+DATO_FORCEINLINE Timestamp GetTime()
+{
+	timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return Timestamp(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+}
+DATO_FORCEINLINE Timestamp GetFrequency()
+{
+	return 1000000000;
+}
 #endif
 
 double GetMs(Timestamp t, Timestamp f)
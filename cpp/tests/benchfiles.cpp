@@ -4,6 +4,11 @@
 #include "../dato_reader.hpp"
 #include "../dato_writer.hpp"
 #include "../dato_dump.hpp"
+#include "../dato_mmap.hpp"
+#include "../dato_paged.hpp"
+#include "../dato_bind.hpp"
+#include "../dato_serialize.hpp"
+#include "../dato_output.hpp"
 
 #include "bench.hpp"
 
@@ -49,11 +54,15 @@ struct LCG
 void SaveBuffer(const char* filename, WRTR& W)
 {
 	FILE* fp = fopen(filename, "wb");
-	fwrite(W.GetData(), W.GetSize(), 1, fp);
+	DataSegment segs[64];
+	u32 n = W.GetSegments(segs, 64);
+	for (u32 i = 0; i < n && i < 64; i++)
+		fwrite(segs[i].data, segs[i].size, 1, fp);
 	fclose(fp);
 }
 
-struct NULLValueIterator : IValueIterator
+// (virtual with IValueIterator as the base, or for Visit with ValueVisitor)
+template <class Base> struct NULLValueIteratorT : Base
 {
 	void UseMem(const void* mem, size_t size)
 	{
@@ -64,105 +73,350 @@ struct NULLValueIterator : IValueIterator
 		DoNotOpt(x);
 	}
 
-	void BeginMap(u8 type, u32 size) override {}
-	void EndMap(u8 type) override {}
-	void BeginStringKey(const char* key, u32 length) override
+	void BeginMap(u8 type, u32 size) {}
+	void EndMap(u8 type) {}
+	void BeginStringKey(const char* key, u32 length)
 	{
 		UseMem(key, length);
 	}
-	void EndStringKey() override {}
-	void BeginIntKey(u32 key) override {}
-	void EndIntKey() override {}
-
-	void BeginArray(u32 size) override {}
-	void EndArray() override {}
-	void BeginArrayIndex(u32 i) override {}
-	void EndArrayIndex() override {}
-
-	void OnValueNull() override {}
-	void OnValueBool(bool value) override {}
-	void OnValueS32(s32 value) override {}
-	void OnValueU32(u32 value) override {}
-	void OnValueF32(f32 value) override {}
-	void OnValueS64(s64 value) override {}
-	void OnValueU64(u64 value) override {}
-	void OnValueF64(f64 value) override {}
-	void OnValueString(const char* data, u32 length) override
+	void EndStringKey() {}
+	void BeginIntKey(u32 key) {}
+	void EndIntKey() {}
+
+	void BeginArray(u32 size) {}
+	void EndArray() {}
+	void BeginArrayIndex(u32 i) {}
+	void EndArrayIndex() {}
+
+	void OnValueNull() {}
+	void OnValueBool(bool value) {}
+	void OnValueS32(s32 value) {}
+	void OnValueU32(u32 value) {}
+	void OnValueF32(f32 value) {}
+	void OnValueS64(s64 value) {}
+	void OnValueU64(u64 value) {}
+	void OnValueF64(f64 value) {}
+	void OnValueString(const char* data, u32 length)
 	{
 		UseMem(data, length);
 	}
-	void OnValueString(const u16* data, u32 length) override
+	void OnValueString(const u16* data, u32 length)
 	{
 		UseMem(data, length * 2);
 	}
-	void OnValueString(const u32* data, u32 length) override
+	void OnValueString(const u32* data, u32 length)
 	{
 		UseMem(data, length * 4);
 	}
-	void OnValueByteArray(const void* data, u32 length) override
+	void OnValueByteArray(const void* data, u32 length)
 	{
 		UseMem(data, length);
 	}
-	void OnValueVector(u8 subtype, u8 elemCount, const void* data) override
+	void OnValueVector(u8 subtype, u8 elemCount, const void* data)
 	{
 		UseMem(data, elemCount * SubtypeGetSize(subtype));
 	}
-	void OnValueVectorArray(u8 subtype, u8 elemCount, const void* data, u32 length) override
+	void OnValueVectorArray(u8 subtype, u8 elemCount, const void* data, u32 length)
 	{
 		UseMem(data, elemCount * length * SubtypeGetSize(subtype));
 	}
-	void OnUnknownValue(u8 type, u32 embedded, const char* buffer, u32 length) override {}
+	void OnUnknownValue(u8 type, u32 embedded, const char* buffer, u32 length) {}
+};
+using NULLValueIterator = NULLValueIteratorT<IValueIterator>;
+using NULLValueVisitor = NULLValueIteratorT<ValueVisitor>;
+
+// counts the dumped text
+struct CountingDumperIterator : IValueDumperIterator
+{
+	size_t count = 0;
+	void PrintText(const char* text, u32 len) override { (void) text; count += len; }
+};
+struct CountingDumper : BasicValueDumper<CountingDumper>
+{
+	size_t count = 0;
+	void PrintText(const char* text, u32 len) { (void) text; count += len; }
+};
+
+
+template <class V> static void ReadNodeValues(const V& vpos, const V& vrot, const V& vscale, const V& vparent, const V& vname)
+{
+	if (vpos)
+	{
+		if (auto vv = vpos.template TryGetVector<float>(3))
+		{
+			float v[3];
+			vv.CopyTo(v, 3);
+			DoNotOpt(v);
+		}
+	}
+	if (vrot)
+	{
+		if (auto vv = vrot.template TryGetVector<float>(4))
+		{
+			float v[4];
+			vv.CopyTo(v, 4);
+			DoNotOpt(v);
+		}
+	}
+	if (vscale)
+	{
+		if (auto vv = vscale.template TryGetVector<float>(3))
+		{
+			float v[3];
+			vv.CopyTo(v, 3);
+			DoNotOpt(v);
+		}
+	}
+	if (vparent)
+	{
+		if (vparent.IsInteger())
+		{
+			auto v = vparent.template CastToNumber<s32>();
+			DoNotOpt(v);
+		}
+	}
+	if (vname)
+	{
+		if (auto v = vname.TryGetString8())
+		{
+			for (auto c : v)
+				DoNotOpt(c);
+		}
+	}
+}
+
+// `K` is a string or a key handle
+template <class R, class K> static void ReadNodes(R& rdr, K& kpos, K& krot, K& kscale, K& kparent, K& kname)
+{
+	if (auto arr = rdr.GetRoot().TryGetArray())
+	{
+		for (u32 i = 0; i < arr.GetSize(); i++)
+		{
+			if (auto obj = arr[i].TryGetStringMap())
+			{
+				ReadNodeValues(
+					obj.FindValueByKey(kpos),
+					obj.FindValueByKey(krot),
+					obj.FindValueByKey(kscale),
+					obj.FindValueByKey(kparent),
+					obj.FindValueByKey(kname));
+			}
+		}
+	}
+}
+
+template <class R> static void ReadNodes(R& rdr)
+{
+	const char* kpos = "localPosition";
+	const char* krot = "localRotation";
+	const char* kscale = "localScale";
+	const char* kparent = "parent";
+	const char* kname = "name";
+	ReadNodes(rdr, kpos, krot, kscale, kparent, kname);
+}
+
+template <class R> static void ReadNodesWithKeyHandles(R& rdr)
+{
+	auto kpos = rdr.ResolveKey("localPosition");
+	auto krot = rdr.ResolveKey("localRotation");
+	auto kscale = rdr.ResolveKey("localScale");
+	auto kparent = rdr.ResolveKey("parent");
+	auto kname = rdr.ResolveKey("name");
+	ReadNodes(rdr, kpos, krot, kscale, kparent, kname);
+}
+
+template <class R> static void ReadNodesBatched(R& rdr)
+{
+	// (sorted in the same order as the keys in the file)
+	static const char* const keys[] = { "localPosition", "localRotation", "localScale", "name", "parent" };
+	if (auto arr = rdr.GetRoot().TryGetArray())
+	{
+		for (u32 i = 0; i < arr.GetSize(); i++)
+		{
+			if (auto obj = arr[i].TryGetStringMap())
+			{
+				typename R::DynamicAccessor v[5];
+				obj.FindValuesByKeys(keys, 5, v);
+				ReadNodeValues(v[0], v[1], v[2], v[4], v[3]);
+			}
+		}
+	}
+}
+
+struct Node
+{
+	float pos[3] = {};
+	float rot[4] = {};
+	float scale[3] = {};
+	s32 parent = -1;
+	std::string name;
+};
+
+template <> struct dato::StructFields<Node>
+{
+	static constexpr auto Get()
+	{
+		return MakeFieldList(
+			MakeField("localPosition", &Node::pos),
+			MakeField("localRotation", &Node::rot),
+			MakeField("localScale", &Node::scale),
+			MakeField("parent", &Node::parent),
+			MakeField("name", &Node::name));
+	}
 };
 
+template <class R> static void BindNode(StructBinding<Node, R>& binding)
+{
+	binding
+		.Bind("localPosition", &Node::pos)
+		.Bind("localRotation", &Node::rot)
+		.Bind("localScale", &Node::scale)
+		.Bind("parent", &Node::parent)
+		.Bind("name", &Node::name);
+}
+
+template <class R> static void ReadNodeParents(R& rdr)
+{
+	if (auto arr = rdr.GetRoot().TryGetArray())
+	{
+		for (u32 i = 0; i < arr.GetSize(); i++)
+		{
+			if (auto obj = arr[i].TryGetStringMap())
+			{
+				auto v = obj.FindValueByKey("parent").template CastToNumber<s32>();
+				DoNotOpt(v);
+			}
+		}
+	}
+}
+
+static void WriteNodes(WRTR& W, int count)
+{
+	LCG lcg;
+	std::vector<ValueRef> vrnodes;
+	vrnodes.reserve(count);
+	for (int i = 0; i < count; i++)
+	{
+		float pos[3] = { lcg.getf(), lcg.getf(), lcg.getf() };
+		auto kpos = W.WriteStringKey("localPosition");
+		auto vpos = W.WriteVectorT(pos, 3);
+		float rot[4] = { lcg.getf(), lcg.getf(), lcg.getf(), lcg.getf() };
+		auto krot = W.WriteStringKey("localRotation");
+		auto vrot = W.WriteVectorT(rot, 4);
+		float scale[4] = { 1, 1, 1 };
+		auto kscale = W.WriteStringKey("localScale");
+		auto vscale = W.WriteVectorT(scale, 3);
+		auto kparent = W.WriteStringKey("parent");
+		auto vparent = W.WriteS32(-1);
+		auto kname = W.WriteStringKey("name");
+		auto vname = W.WriteString8("object");
+
+		StringMapEntry entries[5] =
+		{
+			{ kpos, vpos },
+			{ krot, vrot },
+			{ kscale, vscale },
+			{ kparent, vparent },
+			{ kname, vname },
+		};
+		auto node = W.WriteStringMap(entries, 5);
+		vrnodes.push_back(node);
+	}
+	auto vnodes = W.WriteArray(vrnodes.data(), vrnodes.size());
+	W.SetRoot(vnodes);
+}
 
 static void gen_nodes(int argc, char* argv[])
 {
 	int count = 1000;
 
-	WRTR W;
+	WRTR W("DATO", 4, FLAG_Aligned | FLAG_SortedKeys | FLAG_UniqueKeys, true);
 	{
-		Benchmark B("gen-nodes");//, 100000, 2);
+		Benchmark B("gen-nodes (new writer)");
 		while (B.Iterate())
 		{
-			LCG lcg;
 			W.~WRTR();
-			new (&W) WRTR("DATO", 4, FLAG_Aligned | FLAG_SortedKeys, true);
+			new (&W) WRTR("DATO", 4, FLAG_Aligned | FLAG_SortedKeys | FLAG_UniqueKeys, true);
 			W.Reserve(1024 * 1024);
+			WriteNodes(W, count);
+		}
+	}
+	{
+		Benchmark B("gen-nodes");//, 100000, 2);
+		while (B.Iterate())
+		{
+			W.Reset();
+			WriteNodes(W, count);
+		}
+	}
+	{
+		WRTR SGW("DATO", 4, FLAG_Aligned | FLAG_SortedKeys | FLAG_UniqueKeys, true);
+		SGW.SetSegmented(16 * 1024);
+		Benchmark B("gen-nodes (segmented)");
+		while (B.Iterate())
+		{
+			SGW.Reset();
+			WriteNodes(SGW, count);
+		}
+	}
+	WRTR DW("DATO", 4, FLAG_Aligned | FLAG_SortedKeys | FLAG_UniqueKeys, true, DEDUP_All);
+	{
+		Benchmark B("gen-nodes (value dedup)");
+		while (B.Iterate())
+		{
+			DW.Reset();
+			WriteNodes(DW, count);
+		}
+	}
+	{
+		WRTR SW("DATO", 4, FLAG_Aligned | FLAG_SortedKeys | FLAG_UniqueKeys, true);
+		Benchmark B("gen-nodes (struct writer)");
+		while (B.Iterate())
+		{
+			LCG lcg;
+			SW.Reset();
 
+			StructWriter<Node> sw;
 			std::vector<ValueRef> vrnodes;
 			vrnodes.reserve(count);
+			Node node;
+			node.scale[0] = node.scale[1] = node.scale[2] = 1;
+			node.name = "object";
 			for (int i = 0; i < count; i++)
 			{
-				float pos[3] = { lcg.getf(), lcg.getf(), lcg.getf() };
-				auto kpos = W.WriteStringKey("localPosition");
-				auto vpos = W.WriteVectorT(pos, 3);
-				float rot[4] = { lcg.getf(), lcg.getf(), lcg.getf(), lcg.getf() };
-				auto krot = W.WriteStringKey("localRotation");
-				auto vrot = W.WriteVectorT(rot, 4);
-				float scale[4] = { 1, 1, 1 };
-				auto kscale = W.WriteStringKey("localScale");
-				auto vscale = W.WriteVectorT(scale, 3);
-				auto kparent = W.WriteStringKey("parent");
-				auto vparent = W.WriteS32(-1);
-				auto kname = W.WriteStringKey("name");
-				auto vname = W.WriteString8("object");
-
-				StringMapEntry entries[5] =
-				{
-					{ kpos, vpos },
-					{ krot, vrot },
-					{ kscale, vscale },
-					{ kparent, vparent },
-					{ kname, vname },
-				};
-				auto node = W.WriteStringMap(entries, 5);
-				vrnodes.push_back(node);
+				for (float& v : node.pos)
+					v = lcg.getf();
+				for (float& v : node.rot)
+					v = lcg.getf();
+				vrnodes.push_back(sw.Write(SW, node));
 			}
-			auto vnodes = W.WriteArray(vrnodes.data(), vrnodes.size());
-			W.SetRoot(vnodes);
+			auto vnodes = SW.WriteArray(vrnodes.data(), vrnodes.size());
+			SW.SetRoot(vnodes);
+		}
+	}
+	{
+		WRTR FW("DATO", 4, FLAG_Aligned | FLAG_SortedKeys | FLAG_UniqueKeys, true);
+		Benchmark B("gen-nodes + save (heap, fwrite)");
+		while (B.Iterate())
+		{
+			FW.Reset();
+			WriteNodes(FW, count);
+			SaveBuffer("nodes-out.gen.dato", FW);
 		}
 	}
-	printf("size=%u\n", unsigned(W.GetSize()));
+	{
+		Benchmark B("gen-nodes + save (mapped output file)");
+		while (B.Iterate())
+		{
+			MappedOutputFile mof("nodes-out.gen.dato", 1024 * 1024);
+			WRTR MW("DATO", 4, FLAG_Aligned | FLAG_SortedKeys | FLAG_UniqueKeys, true);
+			MW.SetDataAllocator(&mof);
+			WriteNodes(MW, count);
+			mof.Finish(MW.GetSize());
+		}
+		remove("nodes-out.gen.dato");
+	}
+	printf("size=%u (with value dedup: %u)\n", unsigned(W.GetSize()), unsigned(DW.GetSize()));
 	{
 		Benchmark B("iter-nodes");//, 100000, 2);
 		while (B.Iterate())
@@ -173,6 +427,50 @@ static void gen_nodes(int argc, char* argv[])
 			rdr.GetRoot().Iterate(it);
 		}
 	}
+	{
+		Benchmark B("visit-nodes");//, 100000, 2);
+		while (B.Iterate())
+		{
+			RDR rdr;
+			rdr.Init(W.GetData(), W.GetSize());
+			NULLValueVisitor v;
+			rdr.GetRoot().Visit(v);
+		}
+	}
+	{
+		Benchmark B("cursor-nodes");//, 100000, 2);
+		while (B.Iterate())
+		{
+			RDR rdr;
+			rdr.Init(W.GetData(), W.GetSize());
+			NULLValueVisitor v;
+			BasicTreeCursor<RDR> c(rdr.GetRoot());
+			while (c.Next())
+				c.Emit(v);
+		}
+	}
+	{
+		Benchmark B("dump-nodes (iterator)");//, 100000, 2);
+		while (B.Iterate())
+		{
+			RDR rdr;
+			rdr.Init(W.GetData(), W.GetSize());
+			CountingDumperIterator it;
+			rdr.GetRoot().Iterate(it);
+			DoNotOpt(it.count);
+		}
+	}
+	{
+		Benchmark B("dump-nodes (visitor)");//, 100000, 2);
+		while (B.Iterate())
+		{
+			RDR rdr;
+			rdr.Init(W.GetData(), W.GetSize());
+			CountingDumper v;
+			rdr.GetRoot().Visit(v);
+			DoNotOpt(v.count);
+		}
+	}
 	{
 		Benchmark B("read-nodes");//, 100000, 2);
 		while (B.Iterate())
@@ -180,62 +478,160 @@ static void gen_nodes(int argc, char* argv[])
 			RDR rdr;
 			if (rdr.Init(W.GetData(), W.GetSize()))
 			{
+				ReadNodes(rdr);
+			}
+		}
+	}
+	{
+		Benchmark B("read-nodes (key handles)");//, 100000, 2);
+		while (B.Iterate())
+		{
+			RDR rdr;
+			if (rdr.Init(W.GetData(), W.GetSize()))
+			{
+				ReadNodesWithKeyHandles(rdr);
+			}
+		}
+	}
+	{
+		Benchmark B("read-nodes (batched)");//, 100000, 2);
+		while (B.Iterate())
+		{
+			RDR rdr;
+			if (rdr.Init(W.GetData(), W.GetSize()))
+			{
+				ReadNodesBatched(rdr);
+			}
+		}
+	}
+	{
+		StructBinding<Node, RDR> binding;
+		BindNode(binding);
+		std::vector<Node> nodes;
+		Benchmark B("read-nodes (bound structs)");//, 100000, 2);
+		while (B.Iterate())
+		{
+			RDR rdr;
+			if (rdr.Init(W.GetData(), W.GetSize()))
+			{
+				binding.ClearShapes();
+				nodes.clear();
 				if (auto arr = rdr.GetRoot().TryGetArray())
-				{
-					for (u32 i = 0; i < arr.GetSize(); i++)
-					{
-						if (auto obj = arr[i].TryGetStringMap())
-						{
-							if (auto vpos = obj.FindValueByKey("localPosition"))
-							{
-								if (auto vv = vpos.TryGetVector<float>(3))
-								{
-									float v[3];
-									vv.CopyTo(v, 3);
-									DoNotOpt(v);
-								}
-							}
-							if (auto vrot = obj.FindValueByKey("localRotation"))
-							{
-								if (auto vv = vrot.TryGetVector<float>(4))
-								{
-									float v[4];
-									vv.CopyTo(v, 4);
-									DoNotOpt(v);
-								}
-							}
-							if (auto vscale = obj.FindValueByKey("localScale"))
-							{
-								if (auto vv = vscale.TryGetVector<float>(3))
-								{
-									float v[3];
-									vv.CopyTo(v, 3);
-									DoNotOpt(v);
-								}
-							}
-							if (auto vparent = obj.FindValueByKey("parent"))
-							{
-								if (vparent.IsInteger())
-								{
-									auto v = vparent.CastToNumber<s32>();
-									DoNotOpt(v);
-								}
-							}
-							if (auto vname = obj.FindValueByKey("name"))
-							{
-								if (auto v = vname.TryGetString8())
-								{
-									for (auto c : v)
-										DoNotOpt(c);
-								}
-							}
-						}
-					}
-				}
+					binding.DecodeArray(arr, nodes);
+				DoNotOpt(nodes);
+			}
+		}
+	}
+	{
+		Benchmark B("validate-nodes");//, 100000, 2);
+		while (B.Iterate())
+		{
+			RDR rdr;
+			TrustedReader trdr;
+			if (rdr.Init(W.GetData(), W.GetSize()))
+			{
+				bool valid = rdr.Validate(trdr);
+				DoNotOpt(valid);
+			}
+		}
+	}
+	{
+		RDR rdr;
+		TrustedReader trdr;
+		if (rdr.Init(W.GetData(), W.GetSize()) && rdr.Validate(trdr))
+		{
+			Benchmark B("read-nodes (trusted)");//, 100000, 2);
+			while (B.Iterate())
+				ReadNodes(trdr);
+		}
+	}
+	{
+		Benchmark B("read-nodes (error mode)");//, 100000, 2);
+		while (B.Iterate())
+		{
+			SafeReader srdr;
+			if (srdr.Init(W.GetData(), W.GetSize()))
+			{
+				ReadNodes(srdr);
+				bool err = srdr.HasError();
+				DoNotOpt(err);
+			}
+		}
+	}
+	{
+		Benchmark B("read-nodes (any config)");//, 100000, 2);
+		while (B.Iterate())
+		{
+			ReadAnyConfig(W.GetData(), W.GetSize(), [](auto& rdr) { ReadNodes(rdr); });
+		}
+	}
+#if DATO_CONFIG != 3
+	{
+		Benchmark B("read-nodes (adaptive config)");//, 100000, 2);
+		while (B.Iterate())
+		{
+			BasicReader<ReaderConfigAdaptive> rdr;
+			if (rdr.Init(W.GetData(), W.GetSize()))
+			{
+				ReadNodes(rdr);
 			}
 		}
 	}
+#endif
 	SaveBuffer("nodes" DATO_STRINGIFY(CONFIG) ".gen.dato", W);
+	{
+		Benchmark B("open-nodes (read file)");//, 100000, 2);
+		while (B.Iterate())
+		{
+			FILE* fp = fopen("nodes" DATO_STRINGIFY(CONFIG) ".gen.dato", "rb");
+			fseek(fp, 0, SEEK_END);
+			std::vector<char> data(size_t(ftell(fp)));
+			fseek(fp, 0, SEEK_SET);
+			size_t numRead = fread(data.data(), 1, data.size(), fp);
+			fclose(fp);
+			RDR rdr;
+			if (rdr.Init(data.data(), RDR::Pos(numRead)))
+			{
+				auto v = rdr.GetRoot().AsArray().GetValueByIndex(500).AsStringMap().FindValueByKey("parent");
+				DoNotOpt(v);
+			}
+		}
+	}
+	{
+		Benchmark B("open-nodes (mapped file)");//, 100000, 2);
+		while (B.Iterate())
+		{
+			MappedFile mf("nodes" DATO_STRINGIFY(CONFIG) ".gen.dato", MAPHINT_Random);
+			RDR rdr;
+			if (mf.InitReader(rdr))
+			{
+				auto v = rdr.GetRoot().AsArray().GetValueByIndex(500).AsStringMap().FindValueByKey("parent");
+				DoNotOpt(v);
+			}
+		}
+	}
+	{
+		Benchmark B("read-node-parents");//, 100000, 2);
+		while (B.Iterate())
+		{
+			RDR rdr;
+			if (rdr.Init(W.GetData(), W.GetSize()))
+				ReadNodeParents(rdr);
+		}
+	}
+	{
+		FilePageSource src("nodes" DATO_STRINGIFY(CONFIG) ".gen.dato");
+		PageCache cache;
+		PagedReader prdr;
+		if (cache.Init(&src, 4096, 64) && prdr.Init(cache))
+		{
+			Benchmark B("read-node-parents (paged)");//, 100000, 2);
+			while (B.Iterate())
+				ReadNodeParents(prdr);
+		}
+		printf("paged: %u page lookups, %u pages read, %u evictions\n",
+			unsigned(cache.stats.lookups), unsigned(cache.stats.misses), unsigned(cache.stats.evictions));
+	}
 	{
 		FILE* fp = fopen("nodes" DATO_STRINGIFY(CONFIG) ".gen.dump.txt", "w");
 		RDR rdr;
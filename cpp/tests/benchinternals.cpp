@@ -1,12 +1,16 @@
 
 #include "../dato_reader.hpp"
 #include "../dato_writer.hpp"
+#include "../dato_parallel.hpp"
+#include "../dato_path.hpp"
 
 #include "bench.hpp"
 
 #include <stdio.h>
 #include <stdlib.h>
 #include <algorithm>
+#include <string>
+#include <vector>
 
 
 void Overhead()
@@ -394,7 +398,7 @@ void SizeDecodeSpeed()
 	}
 	{
 		Benchmark B("pfn read u8");
-		ReaderAdaptiveConfig::ReadFunc* fn = &ReadSizeU8;
+		ReaderConfigAdaptive::ReadFunc* fn = &ReadSizeU8;
 		while (B.Iterate())
 		{
 			DoNotOpt(fn);
@@ -411,7 +415,7 @@ void SizeDecodeSpeed()
 	}
 	{
 		Benchmark B("pfn read u16");
-		ReaderAdaptiveConfig::ReadFunc* fn = &ReadSizeU16;
+		ReaderConfigAdaptive::ReadFunc* fn = &ReadSizeU16;
 		while (B.Iterate())
 		{
 			DoNotOpt(fn);
@@ -428,7 +432,7 @@ void SizeDecodeSpeed()
 	}
 	{
 		Benchmark B("pfn read u32");
-		ReaderAdaptiveConfig::ReadFunc* fn = &ReadSizeU32;
+		ReaderConfigAdaptive::ReadFunc* fn = &ReadSizeU32;
 		while (B.Iterate())
 		{
 			DoNotOpt(fn);
@@ -445,7 +449,7 @@ void SizeDecodeSpeed()
 	}
 	{
 		Benchmark B("pfn read u8x32");
-		ReaderAdaptiveConfig::ReadFunc* fn = &ReadSizeU8X32;
+		ReaderConfigAdaptive::ReadFunc* fn = &ReadSizeU8X32;
 		while (B.Iterate())
 		{
 			DoNotOpt(fn);
@@ -462,6 +466,550 @@ void SizeDecodeSpeed()
 	}
 }
 
+struct SumVisitor : dato::ValueVisitor
+{
+	dato::u64 sum = 0;
+	void OnValueU32(dato::u32 v) { sum += v; }
+	void OnValueU64(dato::u64 v) { sum += v; }
+};
+
+void SlotDecodeSpeed()
+{
+	puts("= slot decode speed =");
+	using namespace dato;
+	// an array of mixed embedded and referenced values
+	const u32 N = 4096;
+	Writer wr;
+	std::vector<ValueRef> vals(N);
+	for (u32 i = 0; i < N; i++)
+		vals[i] = i % 3 == 0 ? wr.WriteU32(i) : i % 3 == 1 ? wr.WriteU64(i) : wr.WriteString8("str");
+	wr.SetRoot(wr.WriteArray(vals.data(), N));
+
+	Reader r;
+	r.Init(wr.GetData(), wr.GetSize());
+	auto arr = r.GetRoot().AsArray();
+	const char* slots = r.GetData() + arr._arrpos;
+	const u8* types = (const u8*) slots + N * 4;
+	{
+		Benchmark B("decode value slots (scalar)");
+		static u32 pos[N];
+		while (B.Iterate())
+		{
+			DecodeValueSlots_Scalar<u32>(slots, types, arr._start, arr._arrpos, N, pos);
+			DoNotOpt(pos);
+		}
+	}
+	{
+		Benchmark B("decode value slots (best SIMD)");
+		static u32 pos[N];
+		while (B.Iterate())
+		{
+			GetDecodeValueSlotsU32()(slots, types, arr._start, arr._arrpos, N, pos);
+			DoNotOpt(pos);
+		}
+	}
+	{
+		Benchmark B("get values (one by one)");
+		while (B.Iterate())
+		{
+			u32 sum = 0;
+			for (u32 i = 0; i < N; i++)
+			{
+				auto v = arr.GetValueByIndex(i);
+				sum += u32(v._pos) + v._type;
+			}
+			DoNotOpt(sum);
+		}
+	}
+	{
+		Benchmark B("get values (DecodeSlots)");
+		static Reader::DynamicAccessor out[64];
+		while (B.Iterate())
+		{
+			u32 sum = 0;
+			for (u32 i = 0; i < N; i += 64)
+			{
+				size_t n = arr.DecodeSlots(i, 64, out);
+				for (size_t j = 0; j < n; j++)
+					sum += u32(out[j]._pos) + out[j]._type;
+			}
+			DoNotOpt(sum);
+		}
+	}
+	{
+		Benchmark B("visit values");
+		while (B.Iterate())
+		{
+			SumVisitor sv;
+			arr.Visit(sv);
+			DoNotOpt(sv.sum);
+		}
+	}
+}
+
+void IntKeySearchSpeed()
+{
+	puts("= int key search speed =");
+	using namespace dato;
+	static u32 keys[1000];
+	static u32 lookups[256];
+	struct Impl { const char* name; FindKeyU32Func* fn; };
+	Impl impls[] =
+	{
+		{ "scalar", FindKeyU32_Scalar },
+#if DATO_SIMD
+		{ "sse2", FindKeyU32_SSE2 },
+#endif
+		{ "dispatched", GetFindKeyU32() },
+	};
+	for (u32 N : { 8, 20, 50, 100, 200, 1000 })
+	{
+		for (u32 i = 0; i < N; i++)
+			keys[i] = i * 2 + 1;
+		for (u32 i = 0; i < 256; i++)
+			lookups[i] = keys[u32(rand()) % N];
+		const char* data = (const char*) keys;
+		char buf[64];
+		for (const Impl& impl : impls)
+		{
+			sprintf(buf, "linear search %s (%u)", impl.name, unsigned(N));
+			Benchmark B(buf);
+			while (B.Iterate())
+			{
+				for (u32 k : lookups)
+				{
+					u32 idx = impl.fn(data, N, k);
+					DoNotOpt(idx);
+				}
+			}
+		}
+		{
+			sprintf(buf, "binary search (%u)", unsigned(N));
+			Benchmark B(buf);
+			while (B.Iterate())
+			{
+				for (u32 k : lookups)
+				{
+					u32 L = 0, R = N, idx = N;
+					while (L < R)
+					{
+						u32 M = (L + R) / 2;
+						u32 keyM = ReadT<u32>(data + M * 4);
+						if (k == keyM)
+						{
+							idx = M;
+							break;
+						}
+						if (k < keyM)
+							R = M;
+						else
+							L = M + 1;
+					}
+					DoNotOpt(idx);
+				}
+			}
+		}
+		for (const Impl& impl : impls)
+		{
+			sprintf(buf, "hybrid search %s (%u)", impl.name, unsigned(N));
+			Benchmark B(buf);
+			while (B.Iterate())
+			{
+				for (u32 k : lookups)
+				{
+					u32 idx = FindKeyU32_Sorted(impl.fn, data, N, k);
+					DoNotOpt(idx);
+				}
+			}
+		}
+	}
+}
+
+void LargeIntKeySearchSpeed()
+{
+	puts("= large int key search speed =");
+	using namespace dato;
+	std::vector<u32> keys;
+	std::vector<u32> eytz;
+	static u32 lookups[1024];
+	for (u32 N : { 1000, 10000, 100000, 1000000 })
+	{
+		keys.resize(N);
+		eytz.resize(N);
+		for (u32 i = 0; i < N; i++)
+			keys[i] = i * 2 + 1;
+		for (u32 i = 0; i < N; i++)
+			eytz[EytzingerSlotFromRank(i, N)] = keys[i];
+		for (u32 i = 0; i < 1024; i++)
+			lookups[i] = keys[u32(rand() * 32768 + rand()) % N];
+		const char* data = (const char*) keys.data();
+		char buf[64];
+		{
+			sprintf(buf, "binary search (%u)", unsigned(N));
+			Benchmark B(buf);
+			while (B.Iterate())
+			{
+				for (u32 k : lookups)
+				{
+					u32 idx = u32(std::lower_bound(keys.begin(), keys.end(), k) - keys.begin());
+					DoNotOpt(idx);
+				}
+			}
+		}
+		{
+			sprintf(buf, "branchless search (%u)", unsigned(N));
+			Benchmark B(buf);
+			while (B.Iterate())
+			{
+				for (u32 k : lookups)
+				{
+					u32 idx = FindKeyU32_Sorted(FindKeyU32_Scalar, data, N, k);
+					DoNotOpt(idx);
+				}
+			}
+		}
+		{
+			sprintf(buf, "eytzinger search (%u)", unsigned(N));
+			Benchmark B(buf);
+			while (B.Iterate())
+			{
+				for (u32 k : lookups)
+				{
+					u32 idx = FindKeyU32_Eytzinger<4>((const char*) eytz.data(), N, k);
+					DoNotOpt(idx);
+				}
+			}
+		}
+	}
+}
+
+void StringKeySearchSpeed()
+{
+	puts("= string key search speed =");
+	using namespace dato;
+	static char lookups[1024][16];
+	for (u32 N : { 8, 32, 100, 1000, 10000, 100000 })
+	{
+		Writer wr("DATO", 4, FLAG_Aligned | FLAG_SortedKeys);
+		std::vector<StringMapEntry> entries;
+		char key[16];
+		for (u32 i = 0; i < N; i++)
+		{
+			snprintf(key, sizeof(key), "prop_%u", unsigned(i * 2654435761U % 1000003));
+			entries.push_back({ wr.WriteStringKey(key), wr.WriteU32(i) });
+		}
+		StringMapEntry sme[] =
+		{
+			{ wr.WriteStringKey("sorted"), wr.WriteStringMap(entries.data(), N) },
+			{ wr.WriteStringKey("hashed"), wr.WriteStringHashMap(entries.data(), N) },
+		};
+		wr.SetRoot(wr.WriteStringMap(sme, 2));
+		for (u32 i = 0; i < 1024; i++)
+			snprintf(lookups[i], sizeof(lookups[i]), "prop_%u", unsigned(u32(rand() * 32768 + rand()) % N * 2654435761U % 1000003));
+
+		Reader r;
+		r.Init(wr.GetData(), wr.GetSize());
+		char buf[64];
+		for (const char* name : { "sorted", "hashed" })
+		{
+			auto map = r.GetRoot().AsStringMap().FindValueByKey(name).AsStringMap();
+			sprintf(buf, "%s string map search (%u)", name, unsigned(N));
+			Benchmark B(buf);
+			while (B.Iterate())
+			{
+				for (const char* k : lookups)
+				{
+					auto v = map.FindValueByKey(k);
+					DoNotOpt(v);
+				}
+			}
+		}
+	}
+}
+
+void KeyWriteSpeed()
+{
+	puts("= key write speed =");
+	using namespace dato;
+	std::string buf;
+	std::vector<u32> offsets;
+	// short keys and long keys that share a prefix and suffix and only differ in the middle
+	for (bool longKeys : { false, true })
+	{
+		for (u32 N : { 1000, 10000, 100000, 1000000 })
+		{
+			buf.clear();
+			offsets.clear();
+			for (u32 i = 0; i < N; i++)
+			{
+				char key[128];
+				if (longKeys)
+					snprintf(key, sizeof(key), "components/transform/children/%u/localToWorldMatrix", unsigned(i * 2654435761U % 1000003));
+				else
+					snprintf(key, sizeof(key), "prop_%u", unsigned(i * 2654435761U % 1000003));
+				offsets.push_back(u32(buf.size()));
+				buf += key;
+				buf.push_back(0);
+			}
+			char name[64];
+			sprintf(name, "write %s keys (%u distinct, 2x)", longKeys ? "long" : "short", unsigned(N));
+			Benchmark B(name, 100000, 1.0f);
+			while (B.Iterate())
+			{
+				Writer wr("DATO", 4, FLAG_Aligned | FLAG_SortedKeys);
+				// the second pass only finds the keys
+				for (int pass = 0; pass < 2; pass++)
+				{
+					for (u32 off : offsets)
+					{
+						auto k = wr.WriteStringKey(&buf[off], u32(strlen(&buf[off])));
+						DoNotOpt(k);
+					}
+				}
+			}
+		}
+	}
+}
+
+void PrefetchedIterationSpeed()
+{
+	puts("= prefetched iteration speed =");
+	using namespace dato;
+	// an array of small maps, stored in a different order than they are referenced ..
+	// .. so that (almost) every element is a cache miss
+	const u32 N = 1000000;
+	Writer wr;
+	KeyRef keys[] = { wr.WriteStringKey("id"), wr.WriteStringKey("parent"), wr.WriteStringKey("flags") };
+	std::vector<ValueRef> maps(N);
+	for (u32 i = 0; i < N; i++)
+	{
+		StringMapEntry sme[] =
+		{
+			{ keys[0], wr.WriteU32(i) },
+			{ keys[1], wr.WriteU32(i / 2) },
+			{ keys[2], wr.WriteU32(i & 7) },
+		};
+		maps[i] = wr.WriteStringMap(sme, 3);
+	}
+	for (u32 i = N - 1; i > 0; i--)
+		std::swap(maps[i], maps[u32(rand() * 32768 + rand()) % (i + 1)]);
+	wr.SetRoot(wr.WriteArray(maps.data(), N));
+
+	// evicts the buffer from the caches before each iteration
+	std::vector<u8> flush(64 * 1024 * 1024);
+
+	Reader r;
+	r.Init(wr.GetData(), wr.GetSize());
+	char buf[64];
+	for (u32 dist : { 0, 4, 8, 16 })
+	{
+		r.SetPrefetchDistance(dist);
+		sprintf(buf, "cold iteration (1M maps, prefetch %u)", unsigned(dist));
+		Benchmark B(buf, 10, 2);
+		while (B.Iterate())
+		{
+			for (size_t i = 0; i < flush.size(); i += 64)
+				flush[i]++;
+			B.PrepDone();
+			u64 sum = 0;
+			for (auto v : r.GetRoot().AsArray())
+				for (auto e : v.AsStringMap())
+					sum += e.GetValue().AsU32();
+			DoNotOpt(sum);
+		}
+	}
+	for (u32 dist : { 0, 4, 8, 16 })
+	{
+		r.SetPrefetchDistance(dist);
+		sprintf(buf, "cold visit (1M maps, prefetch %u)", unsigned(dist));
+		Benchmark B(buf, 10, 2);
+		while (B.Iterate())
+		{
+			for (size_t i = 0; i < flush.size(); i += 64)
+				flush[i]++;
+			B.PrepDone();
+			SumVisitor sv;
+			r.GetRoot().Visit(sv);
+			DoNotOpt(sv.sum);
+		}
+	}
+}
+
+void PathQuerySpeed()
+{
+	puts("= path query speed =");
+	using namespace dato;
+	// scenes/<s>/nodes/<n>/mesh/primitives/0/attributes/POSITION, with other keys at each level
+	const u32 NS = 4, NN = 1000;
+	Writer wr("DATO", 4, FLAG_Aligned | FLAG_SortedKeys | FLAG_UniqueKeys);
+	char key[16];
+	auto withExtraKeys = [&](std::vector<StringMapEntry> e, u32 n)
+	{
+		for (u32 i = 0; i < n; i++)
+		{
+			snprintf(key, sizeof(key), "extra%u", unsigned(i));
+			e.push_back({ wr.WriteStringKey(key), wr.WriteU32(i) });
+		}
+		return wr.WriteStringMap(e.data(), u32(e.size()));
+	};
+	std::vector<ValueRef> scenes;
+	for (u32 s = 0; s < NS; s++)
+	{
+		std::vector<ValueRef> nodes;
+		for (u32 n = 0; n < NN; n++)
+		{
+			ValueRef attr = withExtraKeys({ { wr.WriteStringKey("POSITION"), wr.WriteU32(s * NN + n) } }, 5);
+			ValueRef prim = withExtraKeys({ { wr.WriteStringKey("attributes"), attr } }, 3);
+			ValueRef mesh = withExtraKeys({ { wr.WriteStringKey("primitives"), wr.WriteArray(&prim, 1) } }, 3);
+			nodes.push_back(withExtraKeys({ { wr.WriteStringKey("mesh"), mesh } }, 10));
+		}
+		scenes.push_back(withExtraKeys({ { wr.WriteStringKey("nodes"), wr.WriteArray(nodes.data(), NN) } }, 10));
+	}
+	wr.SetRoot(withExtraKeys({ { wr.WriteStringKey("scenes"), wr.WriteArray(scenes.data(), NS) } }, 20));
+
+	Reader r;
+	r.Init(wr.GetData(), wr.GetSize());
+	const u32 NQ = 1024;
+	std::vector<u32> qs(NQ), qn(NQ);
+	std::vector<Path> paths(NQ);
+	char path[128];
+	for (u32 i = 0; i < NQ; i++)
+	{
+		qs[i] = u32(rand()) % NS;
+		qn[i] = u32(rand() * 32768 + rand()) % NN;
+		snprintf(path, sizeof(path), "scenes/%u/nodes/%u/mesh/primitives/0/attributes/POSITION", unsigned(qs[i]), unsigned(qn[i]));
+		paths[i].Compile(path);
+	}
+	{
+		Benchmark B("chained lookups (1024 paths)");
+		while (B.Iterate())
+		{
+			u64 sum = 0;
+			for (u32 i = 0; i < NQ; i++)
+			{
+				sum += r.GetRoot().AsStringMap().FindValueByKey("scenes").AsArray()[qs[i]]
+					.AsStringMap().FindValueByKey("nodes").AsArray()[qn[i]]
+					.AsStringMap().FindValueByKey("mesh").AsStringMap().FindValueByKey("primitives").AsArray()[0]
+					.AsStringMap().FindValueByKey("attributes").AsStringMap().FindValueByKey("POSITION").AsU32();
+			}
+			DoNotOpt(sum);
+		}
+	}
+	{
+		Benchmark B("compiled paths (1024 paths)");
+		while (B.Iterate())
+		{
+			u64 sum = 0;
+			for (Path& p : paths)
+				sum += p.Find(r).AsU32();
+			DoNotOpt(sum);
+		}
+	}
+	{
+		PathCache cache;
+		Benchmark B("compiled paths with cache (1024 paths)");
+		while (B.Iterate())
+		{
+			u64 sum = 0;
+			for (Path& p : paths)
+				sum += p.Find(r, cache).AsU32();
+			DoNotOpt(sum);
+		}
+	}
+
+	// a relative path from each node
+	std::vector<Reader::DynamicAccessor> from, out(NS * NN);
+	for (u32 s = 0; s < NS; s++)
+	{
+		snprintf(path, sizeof(path), "scenes/%u/nodes", unsigned(s));
+		for (auto v : Path(path).Find(r).AsArray())
+			from.push_back(v);
+	}
+	Path rel("mesh/primitives/0/attributes/POSITION");
+	{
+		Benchmark B("relative path, one at a time (4000 nodes)");
+		while (B.Iterate())
+		{
+			u64 sum = 0;
+			for (auto& v : from)
+				sum += rel.Find(v).AsU32();
+			DoNotOpt(sum);
+		}
+	}
+	{
+		Benchmark B("relative path, batch (4000 nodes)");
+		while (B.Iterate())
+		{
+			rel.FindInEach(from.data(), from.size(), out.data());
+			u64 sum = 0;
+			for (auto& v : out)
+				sum += v.AsU32();
+			DoNotOpt(sum);
+		}
+	}
+}
+
+void ParallelScaling()
+{
+	puts("= parallel scaling =");
+	using namespace dato;
+	// an array of records, as in a large file
+	const u32 N = 2000000;
+	Writer wr;
+	KeyRef keys[] = { wr.WriteStringKey("id"), wr.WriteStringKey("parent"), wr.WriteStringKey("name") };
+	std::vector<ValueRef> records(N);
+	char name[16];
+	for (u32 i = 0; i < N; i++)
+	{
+		snprintf(name, sizeof(name), "n%u", unsigned(i % 1000));
+		StringMapEntry sme[] =
+		{
+			{ keys[0], wr.WriteU32(i) },
+			{ keys[1], wr.WriteU32(i / 2) },
+			{ keys[2], wr.WriteString8(name) },
+		};
+		records[i] = wr.WriteStringMap(sme, 3);
+	}
+	wr.SetRoot(wr.WriteArray(records.data(), N));
+
+	Reader r;
+	r.Init(wr.GetData(), wr.GetSize());
+	auto arr = r.GetRoot().AsArray();
+	std::vector<u32> counts = { 1 };
+	for (u32 n = 2; n <= ThreadPool::DefaultWorkerCount(); n *= 2)
+		counts.push_back(n);
+	if (counts.back() != ThreadPool::DefaultWorkerCount())
+		counts.push_back(ThreadPool::DefaultWorkerCount());
+	char buf[64];
+	for (u32 numWorkers : counts)
+	{
+		ThreadPool pool(numWorkers);
+		sprintf(buf, "parallel reduce (2M records, %u workers)", unsigned(numWorkers));
+		{
+			Benchmark B(buf, 20, 2);
+			while (B.Iterate())
+			{
+				u64 sum = ParallelReduce(pool, arr, u64(0), [](u64& acc, size_t, Reader::DynamicAccessor v)
+				{
+					auto rec = v.AsStringMap();
+					acc += rec.FindValueByKey("parent").AsU32() + rec.FindValueByKey("name").AsString8().GetSize();
+				}, [](u64 a, u64 b) { return a + b; });
+				DoNotOpt(sum);
+			}
+		}
+		sprintf(buf, "parallel visit (2M records, %u workers)", unsigned(numWorkers));
+		{
+			Benchmark B(buf, 20, 2);
+			std::vector<SumVisitor> visitors(numWorkers);
+			while (B.Iterate())
+			{
+				ParallelVisit(pool, r.GetRoot(), visitors.data(), 256);
+				DoNotOpt(visitors[0].sum);
+			}
+		}
+	}
+}
+
 int main()
 {
 	Overhead();
@@ -469,4 +1017,12 @@ int main()
 	StringSortSpeed_RandomChars();
 	StringSortSpeed_SpecificSets();
 	SizeDecodeSpeed();
+	SlotDecodeSpeed();
+	IntKeySearchSpeed();
+	LargeIntKeySearchSpeed();
+	StringKeySearchSpeed();
+	KeyWriteSpeed();
+	PrefetchedIterationSpeed();
+	PathQuerySpeed();
+	ParallelScaling();
 }
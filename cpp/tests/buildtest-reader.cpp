@@ -1,4 +1,9 @@
-#line 2 "buildtest-reader.cpp"
+#include "../dato_mmap.hpp"
+#include "../dato_paged.hpp"
+#include "../dato_bind.hpp"
+#include "../dato_parallel.hpp"
+#include "../dato_path.hpp"
+#line 7 "buildtest-reader.cpp"
 using namespace dato;
 
 template <class T> void TypedArrayUser(const T& ca)
@@ -19,6 +24,22 @@ template <class T> void VectorUser(const T& ca)
 	a.CopyTo_SkipChecks(nullptr, 0);
 }
 
+template <class T> void RandomAccessUser(const T& c)
+{
+	auto it = c.begin();
+	auto d = c.end() - it;
+	it += d / 2;
+	it -= 1;
+	(void) it[0];
+	(void) *(it + 1);
+	(void) *(1 + it);
+	(void) *(it - 1);
+	(void) *it++;
+	(void) *it--;
+	(void) (it < c.end() && it >= c.begin() && it != c.end() && !(it == c.end()));
+	(void) c.size();
+}
+
 template <class T> void VectorArrayUser(const T& ca)
 {
 	if (ca) (void) ca;
@@ -34,17 +55,155 @@ template <class T> void VectorArrayUser(const T& ca)
 	a.CopyTo_SkipChecks(nullptr, 0);
 }
 
+struct BoundStruct
+{
+	f32 v[3];
+	s32 i;
+	bool b;
+	std::string s;
+};
+
+void TestBinding(const Reader::DynamicAccessor& dyn)
+{
+	StructBinding<BoundStruct> sb;
+	sb.Bind("v", &BoundStruct::v).Bind("i", &BoundStruct::i).Bind("b", &BoundStruct::b).Bind("s", &BoundStruct::s);
+	sb.Bind("x", &BoundStruct::i, [](const Reader::DynamicAccessor&, void*) {});
+	BoundStruct bs;
+	sb.Decode(dyn.AsStringMap(), bs);
+	std::vector<BoundStruct> vbs;
+	sb.DecodeArray(dyn.AsArray(), vbs);
+	sb.GetShapeCount();
+	sb.ClearShapes();
+}
+
+void TestParallel(const Reader::DynamicAccessor& dyn)
+{
+	ThreadPool pool(2);
+	pool.ParallelFor(10, 3, [](u32, size_t, size_t) {});
+	ParallelForEach(pool, dyn.AsArray(), [](u32, size_t, const Reader::DynamicAccessor&) {});
+	ParallelForEach(pool, dyn.AsStringMap(), [](u32, size_t, const Reader::StringMapAccessor::Iterator&) {}, 16);
+	u32 n = ParallelReduce(pool, dyn.AsIntMap(), 0U,
+		[](u32& acc, size_t, const Reader::IntMapAccessor::Iterator& e) { acc += e.GetKey(); },
+		[](u32 a, u32 b) { return a + b; });
+	(void)n;
+	std::vector<ValueVisitor> visitors(pool.GetWorkerCount());
+	ParallelVisit(pool, dyn, visitors.data());
+}
+
+template <class R> void TestPath(const R& r)
+{
+	BasicPath<R> p("a/0/*");
+	BasicPath<R> p2 = p;
+	p2.Compile("b/~1");
+	BasicPathCache<R> cache;
+	p.Find(r);
+	p.Find(r, cache);
+	p.Find(r.GetRoot());
+	p.ForEach(r, [](const typename R::DynamicAccessor&) {});
+	std::vector<typename R::DynamicAccessor> all;
+	p.FindAll(r, all);
+	typename R::DynamicAccessor out[2];
+	p.FindInEach(&r, 1, out);
+	p.FindInEach(out, 1, out);
+	p.GetStepCount();
+	p.HasWildcards();
+	cache.GetSize();
+	cache.Clear();
+}
+
 void TestReader()
 {
 	Reader r;
 	r.Init(nullptr, 0);
+	{
+		TrustedReader tr;
+		r.Validate(tr);
+		r.Validate(tr, 1, 1);
+		tr.GetRoot().AsStringMap().FindValueByKey("");
+		TestPath(tr);
+	}
+	{
+		SafeReader sr;
+		sr.Init(nullptr, 0);
+		sr.GetRoot().AsStringMap().FindValueByKey("").AsVector<float>(3);
+		sr.HasError();
+		TestPath(sr);
+	}
+	TestPath(r);
+	{
+		r.SetPrefetchDistance(r.GetPrefetchDistance() + 8);
+		RandomAccessUser(r.GetRoot().AsStringMap());
+		RandomAccessUser(r.GetRoot().AsIntMap());
+		RandomAccessUser(r.GetRoot().AsArray());
+		RandomAccessUser(r.GetRoot().AsString32());
+		RandomAccessUser(r.GetRoot().AsVectorArray<f32>());
+		for (auto e : r.GetRoot().AsStringMap())
+			for (auto v : e.GetValue().AsArray())
+				for (auto ie : v.AsIntMap())
+					ie.GetValue();
+	}
+	{
+		Reader::DynamicAccessor vals[16];
+		r.GetRoot().AsArray().DecodeSlots(0, 16, vals);
+		r.GetRoot().AsStringMap().DecodeSlots(1, 15, vals);
+		r.GetRoot().AsIntMap().DecodeSlots(2, 14, vals);
+	}
+	{
+		MappedFile mf("", MAPHINT_Sequential | MAPHINT_HugePages);
+		mf.Advise(MAPHINT_WillNeed);
+		mf.InitReader(r);
+	}
+	{
+		FilePageSource src("");
+		PageCache cache;
+		cache.Init(&src, 4096, 16);
+		PagedReader pr;
+		pr.Init(cache);
+		auto pv = pr.GetRoot().AsStringMap().FindValueByKey("");
+		pv.AsArray().GetValueByIndex(1).AsIntMap().FindValueByKey(1).CastToNumber<f64>();
+		char key[16];
+		pr.GetRoot().AsStringMap().GetKey(0, key, 16);
+		pv.AsString8().CopyTo(key, 16);
+		pv.AsVector<float>()[2];
+		pv.AsVectorArray<s16>().GetSize();
+		pr.HasError();
+	}
 	auto dyn = r.GetRoot();
 #ifdef CANDUMP
 	{
 		FILEValueDumperIterator it;
 		dyn.Iterate(it);
+		FILEValueDumper vd;
+		dyn.Visit(vd);
+		dyn.AsArray().Visit(vd);
 	}
 #endif
+	{
+		ValueVisitor vv;
+		dyn.Visit(vv);
+		dyn.AsStringMap().Visit(vv);
+		dyn.AsIntMap().Visit(vv);
+		dyn.AsArray().Visit(vv);
+		dyn.AsString8().Visit(vv);
+	}
+	{
+		TreeCursor tc(dyn);
+		tc.Reset(dyn);
+		while (tc.Next())
+		{
+			tc.GetEvent();
+			tc.Depth();
+			tc.GetValue();
+			tc.GetKeyCStr();
+			tc.GetIntKey();
+			tc.GetIndex();
+			tc.GetSize();
+			tc.GetMapType();
+			tc.SkipChildren();
+			ValueVisitor vv;
+			tc.Emit(vv);
+		}
+	}
 	{
 		if (dyn) (void) dyn;
 		dyn.GetType();
@@ -94,9 +253,13 @@ void TestReader()
 		}
 		sm[1];
 		sm.GetKeyCStr(0);
+		sm.HasHashTable();
 		sm.GetKeyLength(0);
 		sm.FindValueByKey("");
+		auto kh = r.ResolveKey("");
+		sm.FindValueByKey(kh);
 		sm.FindValueByKey(nullptr, 0);
+		sm.FindValuesByKeys(nullptr, 0, nullptr);
 	}
 	{
 		auto im = dyn.AsIntMap();
@@ -109,6 +272,7 @@ void TestReader()
 		im[1];
 		im.GetKey(0);
 		im.FindValueByKey(0);
+		im.FindValuesByKeys(nullptr, 0, nullptr);
 	}
 	{
 		auto arr = dyn.AsArray();
@@ -1,6 +1,60 @@
-#line 2 "buildtest-writer.cpp"
+#include "../dato_serialize.hpp"
+#include "../dato_output.hpp"
+#include "../dato_reader.hpp"
+#line 5 "buildtest-writer.cpp"
 using namespace dato;
 
+static_assert(StrHash("DATO") != StrHash("DATA"), "StrHash must be usable in constant expressions");
+
+struct SerStruct
+{
+	f32 v[3];
+	std::array<s16, 2> a;
+	s32 i;
+	u64 u;
+	bool b;
+	std::string s;
+	std::vector<u8> bytes;
+	std::vector<std::array<f32, 4>> colors;
+	std::vector<std::string> names;
+
+	static constexpr auto DatoFields()
+	{
+		return MakeFieldList(
+			MakeField("v", &SerStruct::v),
+			MakeField("a", &SerStruct::a),
+			MakeField("i", &SerStruct::i),
+			MakeField("u", &SerStruct::u),
+			MakeField("b", &SerStruct::b),
+			MakeField("s", &SerStruct::s),
+			MakeField("bytes", &SerStruct::bytes),
+			MakeField("colors", &SerStruct::colors),
+			MakeField("names", &SerStruct::names));
+	}
+};
+
+struct SerOuter
+{
+	SerStruct one;
+	std::vector<SerStruct> many;
+
+	static constexpr auto DatoFields()
+	{
+		return MakeFieldList(MakeField("one", &SerOuter::one), MakeField("many", &SerOuter::many));
+	}
+};
+
+void TestSerialize()
+{
+	Writer wr;
+	StructWriter<SerOuter> sw;
+	SerOuter so {};
+	wr.SetRoot(sw.Write(wr, so));
+	sw.Reset();
+	StructWriter<SerStruct> sw2;
+	WriteStructArray(wr, sw2, &so.one, 1);
+}
+
 void TestWriter()
 {
 	Writer wr;
@@ -15,6 +69,7 @@ void TestWriter()
 	wr.WriteF64(0.123456789);
 	wr.WriteArray(nullptr, 0);
 	wr.WriteStringMap(nullptr, 0);
+	wr.WriteStringHashMap(nullptr, 0);
 	wr.WriteIntMap(nullptr, 0);
 	wr.WriteString8("");
 	wr.WriteString16(u"");
@@ -40,9 +95,40 @@ void TestWriter()
 	wr.WriteVectorArrayT<u64>(nullptr, 3, 0);
 	wr.WriteVectorArrayT<f32>(nullptr, 3, 0);
 	wr.WriteVectorArrayT<f64>(nullptr, 3, 0);
+
+	Writer dwr("DATO", 4, FLAG_Aligned, true, DEDUP_All);
+	dwr.SetValueDedup(dwr.GetValueDedup() & ~DEDUP_Containers);
+	dwr.WriteString8("");
+	dwr.WriteArray(nullptr, 0);
+
+	Writer swr("DATO", 4, FLAG_Aligned, true, 0, GetDefaultAllocator());
+	swr.SetSegmented(4096);
+	swr.WriteString8("");
+	DataSegment segs[4];
+	swr.GetSegments(segs, 4);
+	swr.Reset();
+	swr.Flatten();
+	const Writer& cswr = swr;
+	cswr.GetData();
+
+	FileOutputStream fos;
+	StdioOutputStream sos(stdout);
+	Writer stw;
+	stw.SetStreaming(fos.IsOpen() ? (IOutputStream*) &fos : &sos, 1 << 20, 1 << 16);
+	stw.SetRoot(stw.WriteNull());
+	stw.FinishStreaming();
+
+	MappedOutputFile mof;
+	if (mof.Open("buildtest.gen.dato"))
+	{
+		Writer mw;
+		mw.SetDataAllocator(&mof);
+		mof.Finish(mw.GetSize());
+	}
 }
 
 int main()
 {
 	TestWriter();
+	TestSerialize();
 }
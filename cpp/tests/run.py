@@ -122,7 +122,7 @@ def run_benchinternals():
 def run_benchfiles():
 	validate = len(sys.argv) < 3 or sys.argv[2] == "check"
 	validate_defs = "" if validate else "-DDATO_VALIDATE_BUFFERS=0 -DDATO_VALIDATE_INPUTS=0"
-	for i in range(0, 3):
+	for i in range(0, 4):
 		print("config =", i)
 		RUN(
 			"clang++ -o benchfiles.exe -Wall -g -O2 -fno-exceptions -fno-rtti"
@@ -161,6 +161,10 @@ def run_buildtest():
 		"#define DATO_VALIDATE_INPUTS 0",
 		"#define DATO_VALIDATE_INPUTS 1",
 	]
+	def_cfg = [
+		"",
+		"#define DATO_CONFIG 3",
+	]
 	inclines = [
 		'#include "../dato_reader.hpp"',
 		#'#include "../dato_writer.hpp"',
@@ -168,19 +172,21 @@ def run_buildtest():
 	]
 	with open("buildtest-reader.cpp", "r") as f:
 		suffix = f.read()
-	for dvb in def_dvb:
-		for dvi in def_dvi:
-			for incline in inclines:
-				print(f"{dvb} / {dvi} / {incline}")
-				text = f"{dvb}\n{dvi}\n{incline}\n{suffix}\n"
-				BUILDTEST(text)
+	for cfg in def_cfg:
+		for dvb in def_dvb:
+			for dvi in def_dvi:
+				for incline in inclines:
+					print(f"{cfg} / {dvb} / {dvi} / {incline}")
+					text = f"{cfg}\n{dvb}\n{dvi}\n{incline}\n{suffix}\n"
+					BUILDTEST(text)
 	print("-- different validation configs (writer) --")
 	with open("buildtest-writer.cpp", "r") as f:
 		suffix = f.read()
-	for dvi in def_dvi:
-		incline = '#include "../dato_writer.hpp"'
-		print(f"{dvi} / {incline}")
-		text = f"{dvi}\n{incline}\n{suffix}\n"
-		BUILDTEST(text)
+	for cfg in def_cfg:
+		for dvi in def_dvi:
+			incline = '#include "../dato_writer.hpp"'
+			print(f"{cfg} / {dvi} / {incline}")
+			text = f"{cfg}\n{dvi}\n{incline}\n{suffix}\n"
+			BUILDTEST(text)
 
 locals()["run_" + tgt]()
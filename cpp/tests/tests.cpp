@@ -2,6 +2,13 @@
 #include "../dato_reader.hpp"
 #include "../dato_writer.hpp"
 #include "../dato_dump.hpp"
+#include "../dato_mmap.hpp"
+#include "../dato_paged.hpp"
+#include "../dato_bind.hpp"
+#include "../dato_serialize.hpp"
+#include "../dato_parallel.hpp"
+#include "../dato_path.hpp"
+#include "../dato_output.hpp"
 
 #include <initializer_list>
 #include <stdio.h>
@@ -280,11 +287,21 @@ void TestBasicHashCollisions()
 	{
 		u32 h = MemHash(name.c_str(), name.size());
 		revHashMap[h].push_back(name);
-		// all examples should be shorter than the size threshold ..
-		// .. above which MemHash starts to skip characters
 		if (h != StrHash(name.c_str()))
 			printf("MemHash != StrHash for \"%s\"!\n", name.c_str());
 	}
+	// StrHash also works at compile time (with all of the input lengths)
+	static constexpr const char* longKey = "a key that is long enough to be hashed in all three lanes";
+	static constexpr u32 longKeyHash = StrHash(longKey);
+	if (longKeyHash != MemHash(longKey, u32(strlen(longKey))))
+		printf("line %d: StrHash differs at compile time!\n", __LINE__);
+	std::string lenTest;
+	for (u32 len = 0; len < 120; len++)
+	{
+		if (MemHash(lenTest.c_str(), len) != StrHash(lenTest.c_str()))
+			printf("line %d: MemHash != StrHash for length %u!\n", __LINE__, unsigned(len));
+		lenTest.push_back(char('a' + len % 26));
+	}
 	bool anycol = false;
 	for (const auto& kvp : revHashMap)
 	{
@@ -432,6 +449,61 @@ void TestMemReuseHashTable()
 			unsigned(mrht._memEntries),
 			unsigned(mrht._numTableSlots));
 	}
+	// long keys with a shared prefix that differ in one character (all of the contents must be hashed)
+	{
+		std::string buf;
+		std::vector<u32> strlist;
+		for (unsigned i = 0; i < 1000; i++)
+		{
+			std::string s(100, 'k');
+			s += std::to_string(i);
+			s.append(100, 'k');
+			strlist.push_back(buf.size());
+			buf += s;
+			buf.push_back(0);
+		}
+		char* data = &buf[0];
+
+		MemReuseHashTable mrht(data);
+		std::set<u32> hashes;
+		for (u32 pos : strlist)
+		{
+			u32 len = u32(strlen(buf.c_str() + pos));
+			mrht.Insert(pos + 1, pos, len);
+			hashes.insert(mrht._entries[mrht._numEntries - 1].hash);
+		}
+		if (hashes.size() != strlist.size())
+			printf("ERROR (line %d): %u hash collisions among long keys\n",
+				__LINE__, unsigned(strlist.size() - hashes.size()));
+
+		u32 maxDist = 0;
+		for (u32 i = 0; i < mrht._numTableSlots; i++)
+		{
+			auto& s = mrht._table[i];
+			if (s.entry == MemReuseHashTable::NO_VALUE)
+				continue;
+			u32 dist = (i - s.hash) & (mrht._numTableSlots - 1);
+			if (dist > maxDist)
+				maxDist = dist;
+		}
+		for (u32 pos : strlist)
+		{
+			const char* str = buf.c_str() + pos;
+			auto* e = mrht.Find(str, u32(strlen(str)));
+			if (!e || e->dataOff != pos || e->valuePos != pos + 1)
+				printf("ERROR (line %d): did not find the entry for the long key at %u\n",
+					__LINE__, unsigned(pos));
+		}
+		std::string other(100, 'k');
+		other += "1000";
+		other.append(100, 'k');
+		if (mrht.Find(other.c_str(), u32(other.size())))
+			printf("ERROR (line %d): found a long key that isn't in the table\n", __LINE__);
+		printf("long keys: #entries=%u #tableSlots=%u max probe distance=%u\n",
+			unsigned(mrht._numEntries),
+			unsigned(mrht._numTableSlots),
+			unsigned(maxDist));
+	}
 #undef ALLOCSTR
 	puts("-----");
 	puts("");
@@ -584,6 +656,156 @@ struct ExpectationBuilder
 
 #define EBCFG0PFX(t) EBElement("DATO", 4), 0, 0x3, t, A(1)
 
+struct MemoryPageSource : dato::IPageSource
+{
+	const void* data;
+	dato::u64 size;
+	bool fail = false;
+
+	MemoryPageSource(const void* d, dato::u64 s) : data(d), size(s) {}
+	dato::u64 GetSize() const override { return size; }
+	bool ReadAt(dato::u64 offset, void* dst, dato::u32 n) override
+	{
+		if (fail)
+			return false;
+		memcpy(dst, (const char*) data + offset, n);
+		return true;
+	}
+};
+
+void TestIntKeySearch()
+{
+	puts("----- testing int key search -----");
+	using namespace dato;
+
+	std::vector<FindKeyU32Func*> funcs = { FindKeyU32_Scalar, GetFindKeyU32() };
+#if DATO_SIMD
+	funcs.push_back(FindKeyU32_SSE2);
+#  ifdef __GNUC__
+	if (__builtin_cpu_supports("avx2"))
+		funcs.push_back(FindKeyU32_AVX2);
+	if (__builtin_cpu_supports("avx512f"))
+		funcs.push_back(FindKeyU32_AVX512);
+#  endif
+#endif
+
+	// sorted unique keys, searching for all keys and the values between them
+	u32 numWrong = 0;
+	u32 keys[100];
+	for (u32 count = 0; count <= 100; count++)
+	{
+		for (u32 i = 0; i < count; i++)
+			keys[i] = i * 3 + 1;
+		for (FindKeyU32Func* f : funcs)
+		{
+			for (u32 k = 0; k < count * 3 + 3; k++)
+			{
+				u32 expected = k % 3 == 1 && k / 3 < count ? k / 3 : count;
+				if (f((const char*) keys, count, k) != expected)
+					numWrong++;
+				if (FindKeyU32_Sorted(f, (const char*) keys, count, k) != expected)
+					numWrong++;
+			}
+			if (f((const char*) keys, count, 0xffffffff) != count)
+				numWrong++;
+		}
+	}
+	// unsorted keys with duplicates (the first one is found)
+	for (u32 count = 0; count <= 100; count++)
+	{
+		for (u32 i = 0; i < count; i++)
+			keys[i] = (count - i) / 2;
+		for (FindKeyU32Func* f : funcs)
+			for (u32 k = 0; k <= count / 2 + 1; k++)
+				if (f((const char*) keys, count, k) != FindKeyU32_Scalar((const char*) keys, count, k))
+					numWrong++;
+	}
+	if (numWrong)
+		printf("ERROR (line %d): %u wrong search results\n", __LINE__, unsigned(numWrong));
+
+	// Eytzinger order (compared to an in-order traversal of the implicit tree)
+	u32 numWrongSlots = 0;
+	for (u32 n = 1; n <= 1000; n++)
+	{
+		std::vector<u32> expected(n);
+		u32 rank = 0;
+		struct Walker
+		{
+			static void Walk(std::vector<u32>& out, u32& rank, u32 slot)
+			{
+				if (slot >= out.size())
+					return;
+				Walk(out, rank, slot * 2 + 1);
+				out[rank++] = slot;
+				Walk(out, rank, slot * 2 + 2);
+			}
+		};
+		Walker::Walk(expected, rank, 0);
+		for (u32 i = 0; i < n; i++)
+			if (EytzingerSlotFromRank(i, n) != expected[i])
+				numWrongSlots++;
+	}
+	if (numWrongSlots)
+		printf("ERROR (line %d): %u wrong Eytzinger slots\n", __LINE__, unsigned(numWrongSlots));
+
+	// int maps
+	for (u8 flags : { u8(0), FLAG_SortedKeys, u8(FLAG_SortedKeys | FLAG_EytzingerIntMaps) })
+	{
+		for (u32 count : { 0, 1, 5, 16, 17, 33, 100, 250, 256, 1000, 5000 })
+		{
+			Writer wr("DATO", 4, flags);
+			std::vector<IntMapEntry> entries;
+			for (u32 i = 0; i < count; i++)
+				entries.push_back({ (i * 7919) % 10007 * 4 + 4, wr.WriteU32(i) });
+			wr.SetRoot(wr.WriteIntMap(entries.data(), count));
+			Reader r;
+			CHECK_TRUE(r.Init(wr.GetData(), wr.GetSize()));
+			MemoryPageSource src(wr.GetData(), wr.GetSize());
+			PageCache cache;
+			PagedReader pr;
+			CHECK_TRUE(cache.Init(&src, 256, 16) && pr.Init(cache));
+			auto map = r.GetRoot().AsIntMap();
+			auto pmap = pr.GetRoot().AsIntMap();
+			u32 numFound = 0;
+			u32 numPagedFound = 0;
+			for (u32 k = 0; k <= 40032; k++)
+			{
+				auto v = map.FindValueByKey(k);
+				if (v && v.AsU32() < count && entries[v.AsU32()].key == k)
+					numFound++;
+				else if (v)
+					numFound += 100000;
+				auto pv = pmap.FindValueByKey(k);
+				if (pv && pv.AsU32() < count && entries[pv.AsU32()].key == k)
+					numPagedFound++;
+				else if (pv)
+					numPagedFound += 100000;
+			}
+			if (numFound != count || numPagedFound != count)
+				printf("ERROR (line %d): found %u/%u/%u keys (flags=%u)\n", __LINE__,
+					unsigned(numFound), unsigned(numPagedFound), unsigned(count), unsigned(flags));
+			// indices follow the sorted order with any storage order
+			u32 numWrongIndices = 0;
+			for (u32 i = 0; i < count; i++)
+			{
+				if ((flags & FLAG_SortedKeys) && i && map.GetKey(i - 1) >= map.GetKey(i))
+					numWrongIndices++;
+				if (map.GetValueByIndex(i).AsU32() != map.FindValueByKey(map.GetKey(i)).AsU32()
+					|| pmap.GetKey(i) != map.GetKey(i)
+					|| pmap.GetValueByIndex(i).AsU32() != map.GetValueByIndex(i).AsU32())
+					numWrongIndices++;
+			}
+			if (numWrongIndices)
+				printf("ERROR (line %d): %u wrong indices (flags=%u, count=%u)\n", __LINE__,
+					unsigned(numWrongIndices), unsigned(flags), unsigned(count));
+			CHECK_TRUE(!pr.HasError());
+		}
+	}
+
+	puts("-----");
+	puts("");
+}
+
 void TestBasicStructures()
 {
 	puts("----- testing basic structures -----");
@@ -766,11 +988,2533 @@ void TestBasicStructures()
 	puts("");
 }
 
+struct NullDumperIterator : dato::IValueDumperIterator
+{
+	void PrintText(const char*, dato::u32) override {}
+};
+
+void TestSizeEncoding64()
+{
+	puts("----- testing 64-bit size encoding -----");
+	using namespace dato;
+
+	BasicBuilder<u64> B;
+	u64 big = (u64(1) << 32) + 5;
+	CHECK_TRUE(WriteSizeU64(B, big, 8, nullptr, 0) == 0);
+	CHECK_TRUE(B.GetSize() == 8 && !B.error);
+	u64 pos = 0;
+	CHECK_TRUE(ReadSizeU64<true>(B._data, B.GetSize(), pos) == big && pos == 8);
+
+	// truncated data and positions near the end of the address range
+	pos = 1;
+	CHECK_TRUE(ReadSizeU64<true>(B._data, B.GetSize(), pos) == ~u64(0));
+	pos = ~u64(0) - 3;
+	CHECK_TRUE(ReadSizeU64<true>(B._data, ~u64(0), pos) == ~u64(0));
+	CHECK_TRUE(!HasBytesAt(~u64(0), ~u64(0) - 3, 8));
+	CHECK_TRUE(HasBytesAt(~u64(0), ~u64(0) - 8, 8));
+
+	// 32-bit encodings cannot store 64-bit sizes
+	WriteSizeU32(B, big, 0, nullptr, 0);
+	CHECK_TRUE(B.error);
+	B.error = false;
+	WriteSizeU8X32(B, big, 0, nullptr, 0);
+	CHECK_TRUE(B.error);
+
+	puts("-----");
+	puts("");
+}
+
+// (long enough to use the 5-byte size encoding in configurations 1-2)
+template <class W> static void WriteConfigTestData(W& wr)
+{
+	using namespace dato;
+	u32 values[300];
+	std::vector<typename W::ValueRef> arr;
+	for (u32 i = 0; i < 300; i++)
+	{
+		values[i] = i * 3;
+		arr.push_back(wr.WriteU64(u64(i) << 33));
+	}
+	typename W::StringMapEntry e[] =
+	{
+		{ wr.WriteStringKey("name"), wr.WriteString8(std::string(300, 'x').c_str()) },
+		{ wr.WriteStringKey("values"), wr.WriteVectorArrayT(values, 1, 300) },
+		{ wr.WriteStringKey("array"), wr.WriteArray(arr.data(), 300) },
+	};
+	wr.SetRoot(wr.WriteStringMap(e, 3));
+}
+
+template <class R> static bool CheckConfigTestData(R& r)
+{
+	auto root = r.GetRoot().AsStringMap();
+	auto name = root.FindValueByKey("name").AsString8();
+	auto values = root.FindValueByKey("values").template AsVectorArray<dato::u32>(1);
+	auto arr = root.FindValueByKey("array").AsArray();
+	return name.GetSize() == 300 && name.GetData()[299] == 'x'
+		&& values.GetSize() == 300 && values[299] == 897
+		&& arr.GetSize() == 300 && arr[299].AsU64() == dato::u64(299) << 33;
+}
+
+void TestAnyConfig()
+{
+	puts("----- testing reading any configuration -----");
+	using namespace dato;
+
+	// all configurations can be written and read in the same translation unit
+	BasicWriter<WriterConfig0> wr0;
+	BasicWriter<WriterConfig1> wr1;
+	BasicWriter<WriterConfig2> wr2;
+	BasicWriter<WriterConfig3> wr3("DATO", 4, FLAG_SortedKeys);
+	WriteConfigTestData(wr0);
+	WriteConfigTestData(wr1);
+	WriteConfigTestData(wr2);
+	WriteConfigTestData(wr3);
+
+	const void* data[] = { wr0.GetData(), wr1.GetData(), wr2.GetData(), wr3.GetData() };
+	size_t sizes[] = { wr0.GetSize(), wr1.GetSize(), wr2.GetSize(), wr3.GetSize() };
+	for (u32 cfg = 0; cfg < 4; cfg++)
+	{
+		CHECK_TRUE(static_cast<const u8*>(data[cfg])[4] == cfg);
+		size_t posSize = 0;
+		bool ok = false;
+		CHECK_TRUE(ReadAnyConfig(data[cfg], sizes[cfg], [&](auto& r)
+		{
+			posSize = sizeof(typename std::remove_reference<decltype(r)>::type::Pos);
+			ok = CheckConfigTestData(r);
+		}));
+		CHECK_TRUE(ok);
+		CHECK_TRUE(posSize == (cfg == 3 ? 8U : 4U));
+
+		// statically specialized readers with other checking modes
+		ok = false;
+		CHECK_TRUE(ReadAnyConfig<CHECKS_Error>(data[cfg], sizes[cfg], [&](auto& r)
+		{
+			ok = CheckConfigTestData(r) && !r.HasError();
+		}));
+		CHECK_TRUE(ok);
+
+		// the adaptive configuration reads 0-2
+		BasicReader<ReaderConfigAdaptive> ra;
+		CHECK_TRUE(ra.Init(data[cfg], u32(sizes[cfg])) == (cfg != 3));
+		if (cfg != 3)
+			CHECK_TRUE(CheckConfigTestData(ra));
+	}
+
+	// invalid buffers are not read
+	u32 numCalls = 0;
+	auto count = [&](auto&) { numCalls++; };
+	CHECK_TRUE(!ReadAnyConfig(data[0], 3, count));
+	CHECK_TRUE(!ReadAnyConfig(data[0], sizes[0], count, "ABCD", 4));
+	std::vector<char> copy((const char*) data[0], (const char*) data[0] + sizes[0]);
+	copy[4] = 4;
+	CHECK_TRUE(!ReadAnyConfig(copy.data(), copy.size(), count));
+	copy[4] = 3;
+	CHECK_TRUE(!ReadAnyConfig(copy.data(), 10, count));
+	CHECK_TRUE(numCalls == 0);
+
+	puts("-----");
+	puts("");
+}
+
+static void WriteValidationTestData(dato::Writer& wr)
+{
+	using namespace dato;
+	s16 vadata[] = { 1, -2, 3, -4, 5, -6 };
+	f32 vdata[] = { 1.5f, -2.5f, 3.5f };
+	ValueRef arrvals[] =
+	{
+		wr.WriteS64(-1234567890987654321),
+		wr.WriteU64(1234567890987654321),
+		wr.WriteF64(0.123456789),
+		wr.WriteString8("abc"),
+		wr.WriteString16(u"abcd"),
+		wr.WriteString32(U"abcde"),
+		wr.WriteByteArray("a\0c$\xfe""f", 6),
+		wr.WriteVectorT(vdata, 3),
+		wr.WriteVectorArrayT(vadata, 3, 2),
+		wr.WriteS32(-5),
+	};
+	IntMapEntry ime[] =
+	{
+		{ 3, wr.WriteF32(0.5f) },
+		{ 1, wr.WriteNull() },
+		{ 2, wr.WriteBool(true) },
+	};
+	StringMapEntry inner = { wr.WriteStringKey("inner"), wr.WriteU32(123) };
+	StringMapEntry hme[] =
+	{
+		{ wr.WriteStringKey("b"), wr.WriteS32(-2) },
+		{ wr.WriteStringKey("a"), wr.WriteU32(1) },
+	};
+	StringMapEntry sme[] =
+	{
+		{ wr.WriteStringKey("array"), wr.WriteArray(arrvals, arraysize(arrvals)) },
+		{ wr.WriteStringKey("intmap"), wr.WriteIntMap(ime, arraysize(ime)) },
+		{ wr.WriteStringKey("map"), wr.WriteStringMap(&inner, 1) },
+		{ wr.WriteStringKey("inner"), wr.WriteString8("same key") },
+		{ wr.WriteStringKey("hashmap"), wr.WriteStringHashMap(hme, arraysize(hme)) },
+	};
+	wr.SetRoot(wr.WriteStringMap(sme, arraysize(sme)));
+}
+
+void TestValidation()
+{
+	puts("----- testing validation -----");
+	using namespace dato;
+
+	Writer wr;
+	WriteValidationTestData(wr);
+	NullDumperIterator ndi;
+
+	// valid data
+	{
+		Reader r;
+		TrustedReader tr;
+		CHECK_TRUE(r.Init(wr.GetData(), wr.GetSize()));
+		CHECK_TRUE(r.Validate(tr));
+		auto v = tr.GetRoot().AsStringMap().FindValueByKey("map").AsStringMap().FindValueByKey("inner");
+		CHECK_TRUE(v.GetType() == TYPE_U32 && v.AsU32() == 123);
+		CHECK_TRUE(!r.Validate(tr, 2)); // max depth
+		CHECK_TRUE(!r.Validate(tr, 256, 10)); // max values
+		CHECK_TRUE(!Reader().Validate(tr)); // not initialized
+		FILEValueDumperIterator it(stdout);
+		tr.GetRoot().Iterate(it);
+		puts("");
+	}
+
+	// truncated data
+	u32 numTruncValid = 0;
+	for (u32 len = 0; len < wr.GetSize(); len++)
+	{
+		Reader r;
+		TrustedReader tr;
+		if (r.Init(wr.GetData(), len) && r.Validate(tr))
+			numTruncValid++;
+	}
+	if (numTruncValid)
+		printf("ERROR (line %d): %u truncated buffers passed validation\n", __LINE__, unsigned(numTruncValid));
+
+	// corrupted data (anything that passes must be safe to read)
+	std::vector<char> buf((const char*) wr.GetData(), (const char*) wr.GetData() + wr.GetSize());
+	u32 numCorruptValid = 0;
+	for (u32 i = 7; i < buf.size(); i++)
+	{
+		for (u8 x : { 0x01, 0x80, 0xff })
+		{
+			buf[i] ^= x;
+			Reader r;
+			TrustedReader tr;
+			if (r.Init(buf.data(), u32(buf.size())) && r.Validate(tr))
+			{
+				numCorruptValid++;
+				tr.GetRoot().Iterate(ndi);
+			}
+			buf[i] ^= x;
+		}
+	}
+	printf("corrupted buffers that passed validation: %u\n", unsigned(numCorruptValid));
+
+	puts("-----");
+	puts("");
+}
+
+struct StringDumperIterator : dato::IValueDumperIterator
+{
+	std::string text;
+	void PrintText(const char* t, dato::u32 len) override { text.append(t, len); }
+};
+struct StringDumper : dato::BasicValueDumper<StringDumper>
+{
+	std::string text;
+	void PrintText(const char* t, dato::u32 len) { text.append(t, len); }
+};
+// only handles some of the callbacks
+struct NumberCountingVisitor : dato::ValueVisitor
+{
+	dato::u32 numMaps = 0;
+	dato::u32 numNumbers = 0;
+	void BeginMap(dato::u8, dato::u32) { numMaps++; }
+	void OnValueS32(dato::s32) { numNumbers++; }
+	void OnValueU32(dato::u32) { numNumbers++; }
+	void OnValueS64(dato::s64) { numNumbers++; }
+	void OnValueU64(dato::u64) { numNumbers++; }
+};
+
+void TestVisit()
+{
+	puts("----- testing visiting -----");
+	using namespace dato;
+
+	Writer wr;
+	WriteValidationTestData(wr);
+	Reader r;
+	CHECK_TRUE(r.Init(wr.GetData(), wr.GetSize()));
+
+	// the same callbacks as with Iterate
+	StringDumperIterator sdi;
+	r.GetRoot().Iterate(sdi);
+	StringDumper sd;
+	r.GetRoot().Visit(sd);
+	CHECK_TRUE(!sdi.text.empty() && sdi.text == sd.text);
+	StringDumper sdArr;
+	r.GetRoot().AsStringMap().FindValueByKey("array").AsArray().Visit(sdArr);
+	CHECK_TRUE(sdArr.text.compare(0, 12, "array [10]\n{") == 0);
+
+	NumberCountingVisitor ncv;
+	r.GetRoot().Visit(ncv);
+	CHECK_TRUE(ncv.numMaps == 4 && ncv.numNumbers == 6);
+
+	// invalid data is visited the same way in error mode
+	std::vector<char> buf((const char*) wr.GetData(), (const char*) wr.GetData() + wr.GetSize());
+	u32 numDifferent = 0;
+	for (u32 i = 7; i < buf.size(); i++)
+	{
+		char prev = buf[i];
+		buf[i] = char(0xff);
+		SafeReader sr;
+		if (sr.Init(buf.data(), buf.size()))
+		{
+			StringDumperIterator esdi;
+			sr.GetRoot().Iterate(esdi);
+			StringDumper esd;
+			sr.GetRoot().Visit(esd);
+			numDifferent += esdi.text != esd.text;
+		}
+		buf[i] = prev;
+	}
+	CHECK_TRUE(numDifferent == 0);
+
+	puts("-----");
+	puts("");
+}
+
+template <class Cursor> static std::string DumpWithCursor(Cursor& c)
+{
+	StringDumper sd;
+	while (c.Next())
+		c.Emit(sd);
+	return sd.text;
+}
+
+void TestTreeCursor()
+{
+	puts("----- testing tree cursor -----");
+	using namespace dato;
+
+	Writer wr;
+	WriteValidationTestData(wr);
+	Reader r;
+	CHECK_TRUE(r.Init(wr.GetData(), wr.GetSize()));
+
+	// the same events as Iterate
+	StringDumperIterator sdi;
+	r.GetRoot().Iterate(sdi);
+	TreeCursor c(r.GetRoot());
+	CHECK_TRUE(DumpWithCursor(c) == sdi.text);
+	CHECK_TRUE(c.Next() == CURSOR_End && c.Depth() == 0);
+
+	// a single value / an empty accessor
+	Reader::DynamicAccessor leaf = r.GetRoot().AsStringMap().FindValueByKey("inner");
+	c.Reset(leaf);
+	CHECK_TRUE(c.Next() == CURSOR_Value && c.GetValue().AsString8().GetSize() == 8 && c.Depth() == 0);
+	CHECK_TRUE(c.Next() == CURSOR_End);
+	c.Reset(Reader::DynamicAccessor());
+	CHECK_TRUE(c.Next() == CURSOR_Value && c.GetValue().GetType() == TYPE_Null);
+
+	// stopping early and skipping
+	c.Reset(r.GetRoot());
+	Reader::DynamicAccessor found;
+	while (u8 e = c.Next())
+	{
+		if (e == CURSOR_BeginStringKey && strcmp(c.GetKeyCStr(), "array") == 0)
+			c.SkipChildren();
+		if (e == CURSOR_BeginIntKey)
+			CHECK_TRUE(c.Depth() == 2);
+		if (e == CURSOR_BeginStringKey && strcmp(c.GetKeyCStr(), "inner") == 0 && c.Depth() == 2)
+		{
+			c.Next();
+			found = c.GetValue();
+			break;
+		}
+	}
+	CHECK_TRUE(found.GetType() == TYPE_U32 && found.AsU32() == 123);
+	c.Reset(r.GetRoot());
+	CHECK_TRUE(c.Next() == CURSOR_BeginMap && c.GetSize() == 5 && c.Depth() == 1);
+	c.SkipChildren();
+	CHECK_TRUE(c.Next() == CURSOR_EndMap && c.Depth() == 0);
+	CHECK_TRUE(c.Next() == CURSOR_End);
+
+	// deep nesting (no recursion in the cursor)
+	{
+		Writer dwr;
+		ValueRef v = dwr.WriteS32(7);
+		for (u32 i = 0; i < 1000; i++)
+			v = i % 3 == 0 ? dwr.WriteArray(&v, 1) : dwr.WriteStringMap(std::vector<StringMapEntry>{ { dwr.WriteStringKey("k"), v } }.data(), 1);
+		dwr.SetRoot(v);
+		Reader dr;
+		CHECK_TRUE(dr.Init(dwr.GetData(), dwr.GetSize()));
+		StringDumperIterator dsdi;
+		dr.GetRoot().Iterate(dsdi);
+		BasicTreeCursor<Reader, 1000> dc(dr.GetRoot());
+		CHECK_TRUE(DumpWithCursor(dc) == dsdi.text);
+
+		TreeCursor sc(dr.GetRoot());
+		u8 e;
+		u32 maxDepth = 0;
+		while ((e = sc.Next()) != CURSOR_End && e != CURSOR_TooDeep)
+			maxDepth = sc.Depth() > maxDepth ? sc.Depth() : maxDepth;
+		CHECK_TRUE(e == CURSOR_TooDeep && maxDepth == 256);
+		CHECK_TRUE(sc.Next() == CURSOR_End);
+	}
+
+	// the same events as Iterate for invalid data in error mode
+	std::vector<char> buf((const char*) wr.GetData(), (const char*) wr.GetData() + wr.GetSize());
+	u32 numDifferent = 0;
+	for (u32 i = 7; i < buf.size(); i++)
+	{
+		char prev = buf[i];
+		buf[i] = char(0xff);
+		SafeReader sr;
+		if (sr.Init(buf.data(), buf.size()))
+		{
+			StringDumperIterator esdi;
+			sr.GetRoot().Iterate(esdi);
+			BasicTreeCursor<SafeReader> ec(sr.GetRoot());
+			numDifferent += DumpWithCursor(ec) != esdi.text;
+		}
+		buf[i] = prev;
+	}
+	CHECK_TRUE(numDifferent == 0);
+
+	puts("-----");
+	puts("");
+}
+
+void TestDecodeSlots()
+{
+	puts("----- testing slot decoding -----");
+	using namespace dato;
+
+	// the same results as decoding one value at a time
+	for (u8 flags : { u8(0), u8(FLAG_SortedKeys | FLAG_EytzingerIntMaps) })
+	{
+		Writer wr("DATO", 4, flags);
+		std::vector<ValueRef> vals;
+		std::vector<IntMapEntry> ime;
+		std::vector<StringMapEntry> sme;
+		char key[16];
+		for (u32 i = 0; i < 100; i++)
+		{
+			ValueRef v = i % 4 == 0 ? wr.WriteU32(i) : i % 4 == 1 ? wr.WriteU64(i) : i % 4 == 2 ? wr.WriteF32(0.5f) : wr.WriteString8("x");
+			vals.push_back(v);
+			ime.push_back({ i * 7 % 100, v });
+			snprintf(key, sizeof(key), "k%u", unsigned(i));
+			sme.push_back({ wr.WriteStringKey(key), v });
+		}
+		ValueRef parts[] =
+		{
+			wr.WriteArray(vals.data(), vals.size()),
+			wr.WriteIntMap(ime.data(), ime.size()),
+			wr.WriteStringMap(sme.data(), sme.size()),
+		};
+		wr.SetRoot(wr.WriteArray(parts, 3));
+		Reader r;
+		CHECK_TRUE(r.Init(wr.GetData(), wr.GetSize()));
+		auto root = r.GetRoot().AsArray();
+		auto arr = root[0].AsArray();
+		auto im = root[1].AsIntMap();
+		auto sm = root[2].AsStringMap();
+
+		Reader::DynamicAccessor out[128];
+		u32 numDifferent = 0;
+		for (u32 begin : { 0, 1, 31, 32, 33, 99, 100, 150 })
+		{
+			for (u32 count : { 0, 1, 16, 32, 33, 128 })
+			{
+				size_t expected = begin >= 100 ? 0 : count < 100 - begin ? count : 100 - begin;
+				CHECK_TRUE(arr.DecodeSlots(begin, count, out) == expected);
+				for (size_t i = 0; i < expected; i++)
+					numDifferent += out[i]._pos != arr[begin + i]._pos || out[i]._type != arr[begin + i]._type;
+				CHECK_TRUE(im.DecodeSlots(begin, count, out) == expected);
+				for (size_t i = 0; i < expected; i++)
+					numDifferent += out[i]._pos != im.GetValueByIndex(begin + i)._pos || out[i]._type != im.GetValueByIndex(begin + i)._type;
+				CHECK_TRUE(sm.DecodeSlots(begin, count, out) == expected);
+				for (size_t i = 0; i < expected; i++)
+					numDifferent += out[i]._pos != sm.GetValueByIndex(begin + i)._pos;
+			}
+		}
+		CHECK_TRUE(numDifferent == 0);
+	}
+
+	// all of the implementations decode the same positions and find the same invalid references
+	{
+		u32 vals[100];
+		u8 types[100];
+		u32 expected[100], out[100];
+		u32 numDifferent = 0;
+		for (u32 test = 0; test < 100; test++)
+		{
+			u32 origin = test * 1000 + 10;
+			u32 start = origin - 1 - test % 8; // (the size prefix length varies)
+			for (u32 i = 0; i < 100; i++)
+			{
+				types[i] = u8(rand() % 20);
+				vals[i] = rand() % 8 == 0 ? 0xfffffff0U + i : rand() % (origin + 2);
+			}
+			if (test % 2) // a reference to the container itself or to just before it
+				vals[test] = IsReferenceType(types[test]) ? origin - start + test % 4 / 2 : vals[test];
+			u32 count = test;
+			bool ok = DecodeValueSlots_Scalar<u32>((const char*) vals, types, start, origin, count, expected);
+			std::vector<DecodeValueSlotsU32Func*> funcs = { GetDecodeValueSlotsU32() };
+#if DATO_SIMD && defined(DATO_DEFAULT_REFERENCE_TYPES)
+			funcs.push_back(DecodeValueSlotsU32_SSE2);
+			if (_DetectSIMD() >= SIMD_AVX2)
+				funcs.push_back(DecodeValueSlotsU32_AVX2);
+#endif
+			for (DecodeValueSlotsU32Func* fn : funcs)
+			{
+				bool fok = fn((const char*) vals, types, start, origin, count, out);
+				numDifferent += fok != ok || memcmp(out, expected, count * 4) != 0;
+			}
+		}
+		CHECK_TRUE(numDifferent == 0);
+	}
+
+	puts("-----");
+	puts("");
+}
+
+template <class A> static void DumpWithRangeFor(A v, std::string& out)
+{
+	switch (v.GetType())
+	{
+	case dato::TYPE_StringMap:
+	case dato::TYPE_StringHashMap:
+		for (auto e : v.AsStringMap())
+		{
+			out += e.GetKeyCStr();
+			out += ':';
+			DumpWithRangeFor(e.GetValue(), out);
+		}
+		break;
+	case dato::TYPE_IntMap:
+		for (auto e : v.AsIntMap())
+		{
+			out += std::to_string(e.GetKey());
+			out += ':';
+			DumpWithRangeFor(e.GetValue(), out);
+		}
+		break;
+	case dato::TYPE_Array:
+		for (auto e : v.AsArray())
+			DumpWithRangeFor(e, out);
+		break;
+	default: {
+		StringDumper sd;
+		v.Visit(sd);
+		out += sd.text;
+		break; }
+	}
+}
+
+void TestPrefetch()
+{
+	puts("----- testing prefetching -----");
+	using namespace dato;
+
+	// prefetching does not change the results
+	for (u8 flags : { u8(0), u8(FLAG_SortedKeys | FLAG_EytzingerIntMaps) })
+	{
+		Writer wr("DATO", 4, flags);
+		std::vector<IntMapEntry> ime;
+		std::vector<ValueRef> arr;
+		for (u32 i = 0; i < 100; i++)
+		{
+			ime.push_back({ i * 7 % 100, wr.WriteU64(i) });
+			arr.push_back(i % 2 ? wr.WriteString8("x") : wr.WriteS32(s32(i)));
+		}
+		StringMapEntry sme[] =
+		{
+			{ wr.WriteStringKey("intmap"), wr.WriteIntMap(ime.data(), ime.size()) },
+			{ wr.WriteStringKey("array"), wr.WriteArray(arr.data(), arr.size()) },
+		};
+		ValueRef parts[] = { wr.WriteStringMap(sme, 2), wr.WriteStringHashMap(sme, 2) };
+		wr.SetRoot(wr.WriteArray(parts, 2));
+
+		Reader r;
+		CHECK_TRUE(r.Init(wr.GetData(), wr.GetSize()) && r.GetPrefetchDistance() == 0);
+		StringDumper sd;
+		r.GetRoot().Visit(sd);
+		std::string rf;
+		DumpWithRangeFor(r.GetRoot(), rf);
+		for (u32 dist : { 1, 3, 64, 1000 })
+		{
+			r.SetPrefetchDistance(dist);
+			StringDumper psd;
+			r.GetRoot().Visit(psd);
+			CHECK_TRUE(psd.text == sd.text);
+			std::string prf;
+			DumpWithRangeFor(r.GetRoot(), prf);
+			CHECK_TRUE(prf == rf);
+		}
+		TrustedReader tr;
+		CHECK_TRUE(r.Validate(tr) && tr.GetPrefetchDistance() == 1000);
+	}
+
+	// invalid data does not cause any reads outside the buffer in error mode
+	Writer wr;
+	WriteValidationTestData(wr);
+	std::vector<char> buf((const char*) wr.GetData(), (const char*) wr.GetData() + wr.GetSize());
+	u32 numDifferent = 0;
+	for (u32 i = 7; i < buf.size(); i++)
+	{
+		char prev = buf[i];
+		buf[i] = char(0xff);
+		SafeReader sr;
+		if (sr.Init(buf.data(), buf.size()))
+		{
+			StringDumper esd;
+			sr.GetRoot().Visit(esd);
+			sr.SetPrefetchDistance(4);
+			StringDumper pesd;
+			sr.GetRoot().Visit(pesd);
+			numDifferent += esd.text != pesd.text;
+		}
+		buf[i] = prev;
+	}
+	CHECK_TRUE(numDifferent == 0);
+
+	puts("-----");
+	puts("");
+}
+
+void TestParallel()
+{
+	puts("----- testing parallel traversal -----");
+	using namespace dato;
+
+	const u32 N = 10000;
+	Writer wr;
+	std::vector<ValueRef> records;
+	std::vector<StringMapEntry> sme;
+	std::vector<IntMapEntry> ime;
+	KeyRef kid = wr.WriteStringKey("id");
+	KeyRef kname = wr.WriteStringKey("name");
+	char key[16];
+	for (u32 i = 0; i < N; i++)
+	{
+		snprintf(key, sizeof(key), "r%u", unsigned(i));
+		StringMapEntry rec[] = { { kid, wr.WriteU32(i) }, { kname, wr.WriteString8(key) } };
+		records.push_back(wr.WriteStringMap(rec, 2));
+		sme.push_back({ wr.WriteStringKey(key), wr.WriteU64(i) });
+		ime.push_back({ i, wr.WriteS32(-s32(i)) });
+	}
+	StringMapEntry root[] =
+	{
+		{ wr.WriteStringKey("records"), wr.WriteArray(records.data(), N) },
+		{ wr.WriteStringKey("strmap"), wr.WriteStringMap(sme.data(), N) },
+		{ wr.WriteStringKey("intmap"), wr.WriteIntMap(ime.data(), N) },
+	};
+	wr.SetRoot(wr.WriteStringMap(root, 3));
+	Reader r;
+	CHECK_TRUE(r.Init(wr.GetData(), wr.GetSize()));
+	auto arr = r.GetRoot().AsStringMap().FindValueByKey("records").AsArray();
+	auto strmap = r.GetRoot().AsStringMap().FindValueByKey("strmap").AsStringMap();
+	auto intmap = r.GetRoot().AsStringMap().FindValueByKey("intmap").AsIntMap();
+
+	NumberCountingVisitor serial;
+	r.GetRoot().Visit(serial);
+
+	for (u32 numWorkers : { 1, 3, 4 })
+	{
+		ThreadPool pool(numWorkers);
+		CHECK_TRUE(pool.GetWorkerCount() == numWorkers);
+
+		// each index exactly once, for any grain
+		for (size_t grain : { 0, 1, 7, 256, 100000 })
+		{
+			std::vector<u32> seen(N);
+			ParallelForEach(pool, arr, [&](u32 worker, size_t i, Reader::DynamicAccessor v)
+			{
+				if (worker < numWorkers && v.AsStringMap().FindValueByKey("id").AsU32() == i)
+					seen[i]++;
+			}, grain);
+			CHECK_TRUE(std::count(seen.begin(), seen.end(), 1U) == N);
+		}
+		pool.ParallelFor(0, 1, [](u32, size_t, size_t) { CHECK_TRUE(false); });
+		u32 numCalls = 0;
+		pool.ParallelFor(1, 1, [&](u32, size_t begin, size_t end) { numCalls += begin == 0 && end == 1; });
+		CHECK_TRUE(numCalls == 1);
+
+		// map-reduce
+		u64 sum = ParallelReduce(pool, arr, u64(0),
+			[](u64& acc, size_t, Reader::DynamicAccessor v) { acc += v.AsStringMap().FindValueByKey("id").AsU32(); },
+			[](u64 a, u64 b) { return a + b; });
+		CHECK_TRUE(sum == u64(N) * (N - 1) / 2);
+		u64 keyLengths = ParallelReduce(pool, strmap, u64(0),
+			[](u64& acc, size_t, const Reader::StringMapAccessor::Iterator& e) { acc += e.GetKeyLength() + e.GetValue().AsU64(); },
+			[](u64 a, u64 b) { return a + b; }, 100);
+		u64 expectedKeyLengths = 0;
+		for (auto e : strmap)
+			expectedKeyLengths += e.GetKeyLength() + e.GetValue().AsU64();
+		CHECK_TRUE(keyLengths == expectedKeyLengths);
+		std::vector<u32> allKeys = ParallelReduce(pool, intmap, std::vector<u32>(),
+			[](std::vector<u32>& acc, size_t, const Reader::IntMapAccessor::Iterator& e) { acc.push_back(e.GetKey()); },
+			[](std::vector<u32> a, std::vector<u32> b) { a.insert(a.end(), b.begin(), b.end()); return a; });
+		std::sort(allKeys.begin(), allKeys.end());
+		CHECK_TRUE(allKeys.size() == N && allKeys.front() == 0 && allKeys.back() == N - 1);
+
+		// visiting with one visitor per worker
+		std::vector<NumberCountingVisitor> visitors(pool.GetWorkerCount());
+		ParallelVisit(pool, r.GetRoot(), visitors.data());
+		NumberCountingVisitor total;
+		for (auto& v : visitors)
+		{
+			total.numMaps += v.numMaps;
+			total.numNumbers += v.numNumbers;
+		}
+		CHECK_TRUE(total.numMaps + 1 == serial.numMaps && total.numNumbers == serial.numNumbers);
+		std::vector<StringDumper> dumpers(pool.GetWorkerCount());
+		ParallelVisit(pool, arr.GetValueByIndex(5), dumpers.data());
+		u32 numWithName = 0;
+		for (auto& d : dumpers)
+			numWithName += d.text.find("\"r5\"") != std::string::npos;
+		CHECK_TRUE(numWithName == 1);
+		StringDumper sd;
+		arr.GetValueByIndex(5).AsStringMap().FindValueByKey("name").Visit(sd);
+		std::vector<StringDumper> leafDumpers(pool.GetWorkerCount());
+		ParallelVisit(pool, arr.GetValueByIndex(5).AsStringMap().FindValueByKey("name"), leafDumpers.data());
+		CHECK_TRUE(leafDumpers[0].text == sd.text);
+	}
+
+	// the error flag is shared by the workers
+	{
+		SafeReader sr;
+		CHECK_TRUE(sr.Init(wr.GetData(), wr.GetSize()));
+		auto sarr = sr.GetRoot().AsStringMap().FindValueByKey("records").AsArray();
+		ThreadPool pool(4);
+		ParallelForEach(pool, sarr, [](u32, size_t i, SafeReader::DynamicAccessor v)
+		{
+			if (i % 1000 == 999)
+				v.AsIntMap();
+		});
+		CHECK_TRUE(sr.HasError());
+	}
+
+	puts("-----");
+	puts("");
+}
+
+// an array whose first value and a map whose only value are patched to reference the container itself
+std::vector<char> WriteSelfReferenceTestDoc()
+{
+	using namespace dato;
+	Writer wr;
+	StringMapEntry sme = { wr.WriteStringKey("self"), wr.WriteStringMap(nullptr, 0) };
+	ValueRef vals[] = { wr.WriteArray(nullptr, 0), wr.WriteStringMap(&sme, 1) };
+	wr.SetRoot(wr.WriteArray(vals, 2));
+
+	std::vector<char> buf((const char*) wr.GetData(), (const char*) wr.GetData() + wr.GetSize());
+	Reader r;
+	r.Init(buf.data(), u32(buf.size()));
+	auto arr = r.GetRoot().AsArray();
+	auto map = arr.GetValueByIndex(1).AsStringMap();
+	Reader::Pos aself = arr._arrpos - arr._start;
+	Reader::Pos mself = map._objpos - map._start;
+	memcpy(&buf[arr._arrpos], &aself, sizeof(aself));
+	memcpy(&buf[map._objpos + map._size * sizeof(mself)], &mself, sizeof(mself));
+	return buf;
+}
+
+void TestErrorMode()
+{
+	puts("----- testing error mode -----");
+	using namespace dato;
+
+	Writer wr;
+	WriteValidationTestData(wr);
+	NullDumperIterator ndi;
+
+	// valid data
+	{
+		SafeReader r;
+		CHECK_TRUE(r.Init(wr.GetData(), wr.GetSize()));
+		r.GetRoot().Iterate(ndi);
+		CHECK_TRUE(!r.HasError());
+		auto v = r.GetRoot().AsStringMap().FindValueByKey("map").AsStringMap().FindValueByKey("inner");
+		CHECK_TRUE(v.GetType() == TYPE_U32 && v.AsU32() == 123);
+		CHECK_TRUE(!r.HasError());
+
+		// invalid arguments return empty values
+		CHECK_TRUE(!r.GetRoot().AsIntMap());
+		CHECK_TRUE(r.HasError());
+		CHECK_TRUE(r.Init(wr.GetData(), wr.GetSize()));
+		CHECK_TRUE(!r.HasError());
+		CHECK_TRUE(r.GetRoot().AsStringMap().GetValueByIndex(1000).IsNull());
+		CHECK_TRUE(r.HasError());
+		CHECK_TRUE(r.Init(wr.GetData(), wr.GetSize()));
+		CHECK_TRUE(r.GetRoot().AsIntMap().FindValueByKey(5).IsNull()); // empty accessors can still be used
+		CHECK_TRUE(r.GetRoot().AsF64() == 0);
+		CHECK_TRUE(r.HasError());
+	}
+
+	// references to the container itself are errors (instead of endless recursion)
+	{
+		std::vector<char> sbuf = WriteSelfReferenceTestDoc();
+		SafeReader r;
+		CHECK_TRUE(r.Init(sbuf.data(), u32(sbuf.size())));
+		auto arr = r.GetRoot().AsArray();
+		CHECK_TRUE(arr.GetSize() == 2 && !r.HasError());
+		CHECK_TRUE(!arr.GetValueByIndex(0) && r.HasError());
+		CHECK_TRUE(r.Init(sbuf.data(), u32(sbuf.size())));
+		auto map = r.GetRoot().AsArray().GetValueByIndex(1).AsStringMap();
+		CHECK_TRUE(map.GetSize() == 1 && !r.HasError());
+		CHECK_TRUE(!map.FindValueByKey("self") && r.HasError());
+		CHECK_TRUE(r.Init(sbuf.data(), u32(sbuf.size())));
+		BasicTreeCursor<SafeReader> c(r.GetRoot());
+		while (c.Next() != CURSOR_End) {}
+		CHECK_TRUE(r.HasError());
+		CHECK_TRUE(r.Init(sbuf.data(), u32(sbuf.size())));
+		SafeReader::DynamicAccessor out[2];
+		CHECK_TRUE(r.GetRoot().AsArray().DecodeSlots(0, 2, out) == 2 && !out[0] && out[1] && r.HasError());
+		CHECK_TRUE(r.Init(sbuf.data(), u32(sbuf.size())));
+		r.GetRoot().AsArray().GetValueByIndex(1).Iterate(ndi);
+		CHECK_TRUE(r.HasError());
+		CHECK_TRUE(r.Init(sbuf.data(), u32(sbuf.size())));
+		r.GetRoot().Iterate(ndi);
+		CHECK_TRUE(r.HasError());
+	}
+
+	// truncated data
+	u32 numTruncNoError = 0;
+	for (u32 len = 0; len < wr.GetSize(); len++)
+	{
+		SafeReader r;
+		if (r.Init(wr.GetData(), len))
+		{
+			r.GetRoot().Iterate(ndi);
+			if (!r.HasError())
+				numTruncNoError++;
+		}
+	}
+	if (numTruncNoError)
+		printf("ERROR (line %d): %u truncated buffers were read without errors\n", __LINE__, unsigned(numTruncNoError));
+
+	// corrupted data (must not crash, and whatever passes validation must not cause errors)
+	std::vector<char> buf((const char*) wr.GetData(), (const char*) wr.GetData() + wr.GetSize());
+	u32 numCorruptError = 0;
+	u32 numValidError = 0;
+	for (u32 i = 7; i < buf.size(); i++)
+	{
+		for (u8 x : { 0x01, 0x80, 0xff })
+		{
+			buf[i] ^= x;
+			SafeReader r;
+			TrustedReader tr;
+			if (r.Init(buf.data(), u32(buf.size())))
+			{
+				r.GetRoot().Iterate(ndi);
+				if (r.HasError())
+					numCorruptError++;
+				if (r.HasError() && r.Validate(tr))
+					numValidError++;
+			}
+			buf[i] ^= x;
+		}
+	}
+	if (numValidError)
+		printf("ERROR (line %d): %u valid buffers caused errors\n", __LINE__, unsigned(numValidError));
+	printf("corrupted buffers that caused errors: %u\n", unsigned(numCorruptError));
+
+	puts("-----");
+	puts("");
+}
+
+void TestMappedFile()
+{
+	puts("----- testing mapped files -----");
+	using namespace dato;
+
+	Writer wr;
+	WriteValidationTestData(wr);
+	const char* path = "mapped.gen.dato";
+	FILE* fp = fopen(path, "wb");
+	fwrite(wr.GetData(), wr.GetSize(), 1, fp);
+	fclose(fp);
+
+	{
+		MappedFile mf;
+		CHECK_TRUE(!mf.IsOpen());
+		CHECK_TRUE(!mf.Open("missing.gen.dato"));
+		CHECK_TRUE(mf.Open(path, MAPHINT_Random | MAPHINT_WillNeed));
+		CHECK_TRUE(mf.IsOpen() && mf.GetSize() == wr.GetSize());
+		CHECK_TRUE(memcmp(mf.GetData(), wr.GetData(), wr.GetSize()) == 0);
+		CHECK_TRUE(mf.Advise(MAPHINT_WillNeed, 5, 10));
+		CHECK_TRUE(!mf.Advise(MAPHINT_WillNeed, mf.GetSize()));
+
+		Reader r;
+		CHECK_TRUE(mf.InitReader(r));
+		auto v = r.GetRoot().AsStringMap().FindValueByKey("map").AsStringMap().FindValueByKey("inner");
+		CHECK_TRUE(v.GetType() == TYPE_U32 && v.AsU32() == 123);
+		CHECK_TRUE(!mf.InitReader(r, "DATX"));
+
+		MappedFile mf2(static_cast<MappedFile&&>(mf));
+		CHECK_TRUE(!mf.IsOpen() && mf2.IsOpen());
+		mf2.Close();
+		CHECK_TRUE(!mf2.IsOpen() && !mf2.InitReader(r));
+	}
+
+	// empty files are not mapped
+	fp = fopen(path, "wb");
+	fclose(fp);
+	{
+		MappedFile mf(path);
+		CHECK_TRUE(!mf.IsOpen());
+	}
+	remove(path);
+
+	puts("-----");
+	puts("");
+}
+
+template <class A, class B> static bool SamePagedElements(const A& a, const B& b)
+{
+	if (a.GetSize() != b.GetSize())
+		return false;
+	for (size_t i = 0; i < a.GetSize(); i++)
+		if (a[i] != b[i])
+			return false;
+	return true;
+}
+
+// compares the entire tree read by Reader and PagedReader
+static bool SamePagedValue(dato::Reader::DynamicAccessor a, dato::PagedReader::DynamicAccessor b)
+{
+	using namespace dato;
+	if (a.GetType() != b.GetType())
+		return false;
+	switch (a.GetType())
+	{
+	case TYPE_Null: return true;
+	case TYPE_Bool: return a.AsBool() == b.AsBool();
+	case TYPE_S32: return a.AsS32() == b.AsS32();
+	case TYPE_U32: return a.AsU32() == b.AsU32();
+	case TYPE_F32: return a.AsF32() == b.AsF32();
+	case TYPE_S64: return a.AsS64() == b.AsS64();
+	case TYPE_U64: return a.AsU64() == b.AsU64();
+	case TYPE_F64: return a.AsF64() == b.AsF64();
+	case TYPE_Array: {
+		auto aa = a.AsArray();
+		auto ba = b.AsArray();
+		if (aa.GetSize() != ba.GetSize())
+			return false;
+		for (size_t i = 0; i < aa.GetSize(); i++)
+			if (!SamePagedValue(aa[i], ba[i]))
+				return false;
+		return true; }
+	case TYPE_StringMap:
+	case TYPE_StringHashMap: {
+		auto am = a.AsStringMap();
+		auto bm = b.AsStringMap();
+		if (am.GetSize() != bm.GetSize())
+			return false;
+		for (size_t i = 0; i < am.GetSize(); i++)
+		{
+			char key[64];
+			u32 len = bm.GetKey(i, key, sizeof(key));
+			if (len != am.GetKeyLength(i) || strcmp(key, am.GetKeyCStr(i)) != 0)
+				return false;
+			if (!SamePagedValue(am.GetValueByIndex(i), bm.GetValueByIndex(i))
+				|| !SamePagedValue(am.GetValueByIndex(i), bm.FindValueByKey(key)))
+				return false;
+		}
+		return !bm.FindValueByKey("missing"); }
+	case TYPE_IntMap: {
+		auto am = a.AsIntMap();
+		auto bm = b.AsIntMap();
+		if (am.GetSize() != bm.GetSize())
+			return false;
+		for (size_t i = 0; i < am.GetSize(); i++)
+		{
+			if (am.GetKey(i) != bm.GetKey(i)
+				|| !SamePagedValue(am.GetValueByIndex(i), bm.GetValueByIndex(i))
+				|| !SamePagedValue(am.GetValueByIndex(i), bm.FindValueByKey(bm.GetKey(i))))
+				return false;
+		}
+		return !bm.FindValueByKey(12345); }
+	case TYPE_String8: {
+		auto as = a.AsString8();
+		auto bs = b.AsString8();
+		char bfr[64] = {};
+		return SamePagedElements(as, bs)
+			&& bs.CopyTo(bfr, sizeof(bfr)) == as.GetSize()
+			&& memcmp(bfr, as.GetData(), as.GetSize()) == 0; }
+	case TYPE_String16: return SamePagedElements(a.AsString16(), b.AsString16());
+	case TYPE_String32: return SamePagedElements(a.AsString32(), b.AsString32());
+	case TYPE_ByteArray: return SamePagedElements(a.AsByteArray(), b.AsByteArray());
+	case TYPE_Vector: {
+		if (a.GetSubtype() != SUBTYPE_F32)
+			return false;
+		auto av = a.AsVector<f32>();
+		auto bv = b.AsVector<f32>();
+		f32 bfr[4] = {};
+		return bv.GetSize() == av.GetElementCount()
+			&& bv.CopyTo(bfr, 4, 1) == size_t(av.GetElementCount() - 1)
+			&& bfr[0] == av[1]; }
+	case TYPE_VectorArray: {
+		if (a.GetSubtype() != SUBTYPE_S16)
+			return false;
+		auto av = a.AsVectorArray<s16>();
+		auto bv = b.AsVectorArray<s16>();
+		if (av.GetSize() != bv.GetSize() || av.GetElementCount() != bv.GetElementCount())
+			return false;
+		for (size_t i = 0; i < av.GetSize() * av.GetElementCount(); i++)
+			if (av[i] != bv[i])
+				return false;
+		return true; }
+	default: return false;
+	}
+}
+
+void TestStringHashMap()
+{
+	puts("----- testing string hash maps -----");
+	using namespace dato;
+
+	for (u8 flags : { u8(0), FLAG_Aligned, FLAG_SortedKeys, u8(FLAG_Aligned | FLAG_SortedKeys) })
+	{
+		for (u32 count : { 0, 1, 2, 3, 7, 100, 1000 })
+		{
+			Writer wr("DATO", 4, flags);
+			std::vector<StringMapEntry> entries;
+			char key[32];
+			for (u32 i = 0; i < count; i++)
+			{
+				snprintf(key, sizeof(key), "key%u", unsigned(i * 7919 % 1000));
+				entries.push_back({ wr.WriteStringKey(key), wr.WriteU32(i) });
+			}
+			// same entries without the hash table (for comparing the order)
+			StringMapEntry sme[] =
+			{
+				{ wr.WriteStringKey("plain"), wr.WriteStringMap(entries.data(), count) },
+				{ wr.WriteStringKey("hashed"), wr.WriteStringHashMap(entries.data(), count) },
+			};
+			wr.SetRoot(wr.WriteStringMap(sme, 2));
+
+			Reader r;
+			TrustedReader tr;
+			CHECK_TRUE(r.Init(wr.GetData(), wr.GetSize()) && r.Validate(tr));
+			auto plain = r.GetRoot().AsStringMap().FindValueByKey("plain").AsStringMap();
+			auto hv = r.GetRoot().AsStringMap().FindValueByKey("hashed");
+			CHECK_TRUE(hv.GetType() == TYPE_StringHashMap);
+			auto hashed = hv.AsStringMap();
+			CHECK_TRUE(hashed.HasHashTable() && !plain.HasHashTable());
+			CHECK_TRUE(hashed.GetSize() == count && hv.TryGetStringMap().GetSize() == count);
+			u32 numWrong = 0;
+			for (u32 i = 0; i < count; i++)
+			{
+				// same order as without the hash table
+				if (strcmp(plain.GetKeyCStr(i), hashed.GetKeyCStr(i)) != 0
+					|| plain.GetValueByIndex(i).AsU32() != hashed.GetValueByIndex(i).AsU32())
+					numWrong++;
+				snprintf(key, sizeof(key), "key%u", unsigned(i * 7919 % 1000));
+				if (hashed.FindValueByKey(key).AsU32() != i
+					|| hashed.FindValueByKey(key, strlen(key)).AsU32() != i
+					|| tr.GetRoot().AsStringMap().FindValueByKey("hashed").AsStringMap().FindValueByKey(key).AsU32() != i)
+					numWrong++;
+			}
+			for (const char* missing : { "", "key", "key1000", "missing" })
+				if (hashed.FindValueByKey(missing))
+					numWrong++;
+			if (numWrong)
+				printf("ERROR (line %d): %u wrong hash map results (flags=%u, count=%u)\n", __LINE__,
+					unsigned(numWrong), unsigned(flags), unsigned(count));
+
+			MemoryPageSource src(wr.GetData(), wr.GetSize());
+			PageCache cache;
+			PagedReader pr;
+			CHECK_TRUE(cache.Init(&src, 64, 4) && pr.Init(cache));
+			CHECK_TRUE(SamePagedValue(r.GetRoot(), pr.GetRoot()));
+			CHECK_TRUE(!pr.HasError());
+		}
+	}
+
+	// invalid tables
+	{
+		Writer wr("DATO", 4, FLAG_Aligned);
+		StringMapEntry entries[] =
+		{
+			{ wr.WriteStringKey("a"), wr.WriteU32(1) },
+			{ wr.WriteStringKey("b"), wr.WriteU32(2) },
+		};
+		wr.SetRoot(wr.WriteStringHashMap(entries, 2));
+		std::vector<char> buf((const char*) wr.GetData(), (const char*) wr.GetData() + wr.GetSize());
+		// 4 buckets (4 indices, 4 fingerprints) at the end
+		TrustedReader tr;
+		{
+			Reader r;
+			CHECK_TRUE(r.Init(buf.data(), u32(buf.size())) && r.Validate(tr));
+		}
+		// index out of range
+		std::vector<char> badIndex = buf;
+		for (u32 b = 0; b < 4; b++)
+			if (badIndex[badIndex.size() - 4 + b])
+				badIndex[badIndex.size() - 20 + b * 4] = 5;
+		{
+			Reader r;
+			CHECK_TRUE(r.Init(badIndex.data(), u32(badIndex.size())) && !r.Validate(tr));
+			SafeReader sr;
+			CHECK_TRUE(sr.Init(badIndex.data(), u32(badIndex.size())));
+			CHECK_TRUE(!sr.GetRoot().AsStringMap().FindValueByKey("a") && sr.HasError());
+		}
+		// no empty buckets (the search must terminate)
+		std::vector<char> full = buf;
+		for (u32 b = 0; b < 4; b++)
+			full[full.size() - 4 + b] = 1;
+		{
+			Reader r;
+			CHECK_TRUE(r.Init(full.data(), u32(full.size())) && r.Validate(tr));
+			CHECK_TRUE(!tr.GetRoot().AsStringMap().FindValueByKey("c"));
+		}
+		// truncated table
+		{
+			SafeReader sr;
+			CHECK_TRUE(sr.Init(buf.data(), u32(buf.size() - 1)));
+			CHECK_TRUE(!sr.GetRoot().AsStringMap() && sr.HasError());
+		}
+	}
+
+	puts("-----");
+	puts("");
+}
+
+template <class R> static dato::u32 CountKeyHandleMismatches(R& r)
+{
+	using namespace dato;
+	u32 numWrong = 0;
+	auto maps = r.GetRoot().AsArray();
+	for (u32 k = 0; k < 12; k++)
+	{
+		char key[16];
+		snprintf(key, sizeof(key), "key%u", unsigned(k * 10));
+		auto handle = r.ResolveKey(key);
+		for (u32 m = 0; m < maps.GetSize(); m++)
+		{
+			auto map = maps[m].AsStringMap();
+			auto expected = map.FindValueByKey(key);
+			auto v = map.FindValueByKey(handle);
+			if (v.IsValid() != expected.IsValid() || (v && v.AsU32() != expected.AsU32()))
+				numWrong++;
+		}
+		// resolved by the first map that has the key
+		if (k < 10 && (!handle.pos || strcmp(r.GetRoot().AsArray()[0].AsStringMap().GetKeyCStr(k), key) != 0))
+			numWrong++;
+	}
+	return numWrong;
+}
+
+void TestKeyHandles()
+{
+	puts("----- testing key handles -----");
+	using namespace dato;
+
+	for (u8 flags : { u8(0), FLAG_SortedKeys, FLAG_UniqueKeys, u8(FLAG_SortedKeys | FLAG_UniqueKeys) })
+	{
+		for (bool dedup : { false, true })
+		{
+			Writer wr("DATO", 4, flags, dedup);
+			std::vector<ValueRef> maps;
+			// maps with subsets of the keys, in various sizes, with and without hash tables
+			for (u32 size : { 10, 3, 0, 100, 10, 7 })
+			{
+				for (bool hashed : { false, true })
+				{
+					std::vector<StringMapEntry> entries;
+					for (u32 i = 0; i < size; i++)
+					{
+						char key[16];
+						snprintf(key, sizeof(key), "key%u", unsigned((size == 7 ? i + 3 : i) * 10));
+						entries.push_back({ wr.WriteStringKey(key), wr.WriteU32(size * 1000 + i) });
+					}
+					maps.push_back(hashed
+						? wr.WriteStringHashMap(entries.data(), size)
+						: wr.WriteStringMap(entries.data(), size));
+				}
+			}
+			wr.SetRoot(wr.WriteArray(maps.data(), u32(maps.size())));
+
+			Reader r;
+			TrustedReader tr;
+			SafeReader sr;
+			CHECK_TRUE(r.Init(wr.GetData(), wr.GetSize()) && r.Validate(tr) && sr.Init(wr.GetData(), wr.GetSize()));
+			u32 numWrong = CountKeyHandleMismatches(r) + CountKeyHandleMismatches(tr) + CountKeyHandleMismatches(sr);
+			if (numWrong)
+				printf("ERROR (line %d): %u wrong key handle results (flags=%u, dedup=%d)\n", __LINE__,
+					unsigned(numWrong), unsigned(flags), int(dedup));
+			CHECK_TRUE(!sr.HasError());
+		}
+	}
+
+	// a handle resolved in one document is re-resolved in another
+	{
+		Writer wr1, wr2;
+		StringMapEntry e1 = { wr1.WriteStringKey("key"), wr1.WriteU32(1) };
+		wr1.WriteString8("padding");
+		StringMapEntry e2 = { wr2.WriteStringKey("key"), wr2.WriteU32(2) };
+		wr1.SetRoot(wr1.WriteStringMap(&e1, 1));
+		wr2.SetRoot(wr2.WriteStringMap(&e2, 1));
+		Reader r1, r2;
+		CHECK_TRUE(r1.Init(wr1.GetData(), wr1.GetSize()) && r2.Init(wr2.GetData(), wr2.GetSize()));
+		auto handle = r1.ResolveKey("key");
+		CHECK_TRUE(r1.GetRoot().AsStringMap().FindValueByKey(handle).AsU32() == 1);
+		CHECK_TRUE(r2.GetRoot().AsStringMap().FindValueByKey(handle).AsU32() == 2);
+		CHECK_TRUE(r1.GetRoot().AsStringMap().FindValueByKey(handle).AsU32() == 1);
+	}
+
+	puts("-----");
+	puts("");
+}
+
+void TestBatchLookup()
+{
+	puts("----- testing batched key lookup -----");
+	using namespace dato;
+
+	for (u8 flags : { u8(0), FLAG_SortedKeys, u8(FLAG_SortedKeys | FLAG_EytzingerIntMaps) })
+	{
+		for (u32 size : { 0, 1, 5, 30, 300 })
+		{
+			Writer wr("DATO", 4, flags);
+			std::vector<StringMapEntry> sme;
+			std::vector<IntMapEntry> ime;
+			char key[16];
+			for (u32 i = 0; i < size; i++)
+			{
+				snprintf(key, sizeof(key), "k%03u", unsigned(i * 2));
+				sme.push_back({ wr.WriteStringKey(key), wr.WriteU32(i) });
+				ime.push_back({ i * 2, wr.WriteU32(i) });
+			}
+			ValueRef maps[] =
+			{
+				wr.WriteStringMap(sme.data(), size),
+				wr.WriteStringHashMap(sme.data(), size),
+				wr.WriteIntMap(ime.data(), size),
+			};
+			wr.SetRoot(wr.WriteArray(maps, 3));
+			Reader r;
+			CHECK_TRUE(r.Init(wr.GetData(), wr.GetSize()));
+
+			// query sets: dense and sparse ascending, descending, with missing keys and duplicates
+			std::vector<std::vector<u32>> querySets = { {}, { 0 }, { 0, 2, 4, 6, 8 }, { 1, 3, 5 } };
+			std::vector<u32> q;
+			for (u32 i = 0; i < size * 2 + 2; i += 3)
+				q.push_back(i);
+			querySets.push_back(q);
+			q.clear();
+			for (u32 i = 0; i < size * 2 + 2; i += 37)
+				q.push_back(i);
+			querySets.push_back(q);
+			std::reverse(q.begin(), q.end());
+			querySets.push_back(q);
+			querySets.push_back({ 8, 2, 2, 598, 0, 4, 4, 1000 });
+
+			u32 numWrong = 0;
+			for (const auto& qs : querySets)
+			{
+				std::vector<std::string> strs;
+				std::vector<const char*> cstrs;
+				for (u32 k : qs)
+				{
+					snprintf(key, sizeof(key), "k%03u", unsigned(k));
+					strs.push_back(key);
+				}
+				for (const auto& str : strs)
+					cstrs.push_back(str.c_str());
+				std::vector<Reader::DynamicAccessor> out(qs.size() + 1);
+				for (u32 m = 0; m < 2; m++)
+				{
+					auto map = r.GetRoot().AsArray()[m].AsStringMap();
+					size_t numFound = map.FindValuesByKeys(cstrs.data(), cstrs.size(), out.data());
+					size_t numExpected = 0;
+					for (size_t i = 0; i < qs.size(); i++)
+					{
+						auto v = map.FindValueByKey(cstrs[i]);
+						numExpected += v.IsValid();
+						if (v.IsValid() != out[i].IsValid() || (v && v.AsU32() != out[i].AsU32()))
+							numWrong++;
+					}
+					if (numFound != numExpected)
+						numWrong++;
+				}
+				auto imap = r.GetRoot().AsArray()[2].AsIntMap();
+				size_t numFound = imap.FindValuesByKeys(qs.data(), qs.size(), out.data());
+				size_t numExpected = 0;
+				for (size_t i = 0; i < qs.size(); i++)
+				{
+					auto v = imap.FindValueByKey(qs[i]);
+					numExpected += v.IsValid();
+					if (v.IsValid() != out[i].IsValid() || (v && v.AsU32() != out[i].AsU32()))
+						numWrong++;
+				}
+				if (numFound != numExpected)
+					numWrong++;
+			}
+			if (numWrong)
+				printf("ERROR (line %d): %u wrong batch lookup results (flags=%u, size=%u)\n", __LINE__,
+					unsigned(numWrong), unsigned(flags), unsigned(size));
+		}
+	}
+
+	// empty accessors
+	{
+		SafeReader::DynamicAccessor out[2];
+		const char* keys[] = { "a", "b" };
+		u32 ikeys[] = { 1, 2 };
+		CHECK_TRUE(SafeReader::StringMapAccessor().FindValuesByKeys(keys, 2, out) == 0 && !out[0] && !out[1]);
+		CHECK_TRUE(SafeReader::IntMapAccessor().FindValuesByKeys(ikeys, 2, out) == 0 && !out[0] && !out[1]);
+	}
+
+	puts("-----");
+	puts("");
+}
+
+struct BindTestItem
+{
+	float pos[3] = {};
+	dato::s32 id = -1;
+	dato::u64 big = 0;
+	bool flag = false;
+	std::string name;
+	dato::u32 custom = 0;
+};
+
+struct SerTestSub
+{
+	dato::s32 a = 0;
+	std::vector<dato::f32> values;
+
+	static constexpr auto DatoFields()
+	{
+		return dato::MakeFieldList(dato::MakeField("a", &SerTestSub::a), dato::MakeField("values", &SerTestSub::values));
+	}
+};
+
+struct SerTestItem
+{
+	dato::f32 pos[3] = {};
+	std::string name;
+	dato::u8 small = 0;
+	dato::s64 big = 0;
+	bool flag = false;
+	dato::f64 dbl = 0;
+	SerTestSub sub;
+	std::vector<SerTestSub> subs;
+	std::vector<std::array<dato::u16, 2>> pairs;
+	std::vector<std::string> tags;
+};
+
+template <> struct dato::StructFields<SerTestItem>
+{
+	static constexpr auto Get()
+	{
+		// (not in the sorted key order)
+		return dato::MakeFieldList(
+			dato::MakeField("pos", &SerTestItem::pos),
+			dato::MakeField("name", &SerTestItem::name),
+			dato::MakeField("small", &SerTestItem::small),
+			dato::MakeField("big", &SerTestItem::big),
+			dato::MakeField("flag", &SerTestItem::flag),
+			dato::MakeField("dbl", &SerTestItem::dbl),
+			dato::MakeField("sub", &SerTestItem::sub),
+			dato::MakeField("subs", &SerTestItem::subs),
+			dato::MakeField("pairs", &SerTestItem::pairs),
+			dato::MakeField("tags", &SerTestItem::tags),
+			dato::MakeField("a", &SerTestItem::small));
+	}
+};
+
+void TestStructWriter()
+{
+	puts("----- testing struct writer -----");
+	using namespace dato;
+
+	static_assert(HasStructFields<SerTestItem>::value && HasStructFields<SerTestSub>::value, "");
+	static_assert(!HasStructFields<s32>::value && !HasStructFields<std::string>::value, "");
+	constexpr auto order = SortFieldOrder<SerTestItem>();
+	static_assert(order.rank[10] == 0 && order.rank[0] == 6 && order.rank[9] == 10, "unexpected key order");
+	static_assert(HasDistinctRanks(order) && !HasDistinctRanks(FieldOrder<2>{ { 1, 1, 0 } }), "");
+
+	SerTestItem items[3];
+	for (u32 i = 0; i < 3; i++)
+	{
+		SerTestItem& it = items[i];
+		it.pos[0] = f32(i);
+		it.name = i ? "item" : "";
+		it.small = u8(200 + i);
+		it.big = -(s64(i) << 40);
+		it.flag = i == 1;
+		it.dbl = 0.5 * i;
+		it.sub.a = s32(i);
+		it.sub.values.assign(i, 1.5f);
+		it.subs.resize(i);
+		it.pairs.push_back({ { u16(i), 7 } });
+		it.tags.assign(i, "tag");
+	}
+
+	// the same data written manually, with the keys written first (same layout)
+	auto writeManually = [](Writer& wr, const SerTestItem* items, u32 count)
+	{
+		const char* keys[] = { "pos", "name", "small", "big", "flag", "dbl", "sub", "subs", "pairs", "tags", "a" };
+		KeyRef k[11];
+		for (u32 i = 0; i < 11; i++)
+			k[i] = wr.WriteStringKey(keys[i]);
+		KeyRef subKeys[2] = {};
+		bool subKeysWritten = false;
+		auto writeSub = [&](const SerTestSub& s)
+		{
+			if (!subKeysWritten)
+			{
+				subKeys[0] = wr.WriteStringKey("a");
+				subKeys[1] = wr.WriteStringKey("values");
+				subKeysWritten = true;
+			}
+			StringMapEntry e[] =
+			{
+				{ subKeys[0], wr.WriteS32(s.a) },
+				{ subKeys[1], wr.WriteVectorArrayT(s.values.data(), 1, WriterPos(s.values.size())) },
+			};
+			return wr.WriteStringMap(e, 2);
+		};
+		std::vector<ValueRef> itemRefs;
+		for (u32 i = 0; i < count; i++)
+		{
+			const SerTestItem& it = items[i];
+			StringMapEntry e[11];
+			e[0] = { k[0], wr.WriteVectorT(it.pos, 3) };
+			e[1] = { k[1], wr.WriteString8(it.name.data(), WriterPos(it.name.size())) };
+			e[2] = { k[2], wr.WriteU32(it.small) };
+			e[3] = { k[3], wr.WriteS64(it.big) };
+			e[4] = { k[4], wr.WriteBool(it.flag) };
+			e[5] = { k[5], wr.WriteF64(it.dbl) };
+			e[6] = { k[6], writeSub(it.sub) };
+			std::vector<ValueRef> refs;
+			for (const auto& s : it.subs)
+				refs.push_back(writeSub(s));
+			e[7] = { k[7], wr.WriteArray(refs.data(), u32(refs.size())) };
+			e[8] = { k[8], wr.WriteVectorArrayT(it.pairs[0].data(), 2, WriterPos(it.pairs.size())) };
+			refs.clear();
+			for (const auto& s : it.tags)
+				refs.push_back(wr.WriteString8(s.data(), WriterPos(s.size())));
+			e[9] = { k[9], wr.WriteArray(refs.data(), u32(refs.size())) };
+			e[10] = { k[10], wr.WriteU32(it.small) };
+			itemRefs.push_back(wr.WriteStringMap(e, 11));
+		}
+		return wr.WriteArray(itemRefs.data(), count);
+	};
+
+	for (u8 flags : { u8(0), FLAG_SortedKeys, u8(FLAG_Aligned | FLAG_SortedKeys), u8(FLAG_Aligned | FLAG_SortedKeys | FLAG_UniqueKeys) })
+	{
+		Writer wr1("DATO", 4, flags), wr2("DATO", 4, flags);
+		wr1.SetRoot(writeManually(wr1, items, 3));
+		StructWriter<SerTestItem> sw;
+		wr2.SetRoot(WriteStructArray(wr2, sw, items, 3));
+		if (wr1.GetSize() != wr2.GetSize() || memcmp(wr1.GetData(), wr2.GetData(), wr1.GetSize()) != 0)
+			printf("ERROR (line %d): struct writer output differs (flags=%u)\n", __LINE__, unsigned(flags));
+
+		Reader r;
+		CHECK_TRUE(r.Init(wr2.GetData(), wr2.GetSize()));
+		auto m = r.GetRoot().AsArray()[2].AsStringMap();
+		CHECK_TRUE(m.GetSize() == 11);
+		CHECK_TRUE(m.FindValueByKey("small").AsU32() == 202);
+		CHECK_TRUE(m.FindValueByKey("big").AsS64() == -(s64(2) << 40));
+		CHECK_TRUE(m.FindValueByKey("subs").AsArray().GetSize() == 2);
+		CHECK_TRUE(m.FindValueByKey("sub").AsStringMap().FindValueByKey("values").AsVectorArray<f32>(1).GetSize() == 2);
+		CHECK_TRUE(m.FindValueByKey("tags").AsArray()[1].AsString8().GetSize() == 3);
+		const char* firstKey = flags & FLAG_SortedKeys ? "a" : "pos";
+		const char* lastKey = flags & FLAG_SortedKeys ? "tags" : "a";
+		CHECK_TRUE(strcmp(m.GetKeyCStr(0), firstKey) == 0 && strcmp(m.GetKeyCStr(10), lastKey) == 0);
+	}
+
+	// the keys are written again after the writer is reset or changed
+	{
+		Writer wr1, wr2, wr3;
+		StructWriter<SerTestItem> sw;
+		wr1.SetRoot(WriteStructArray(wr1, sw, items, 3));
+		u64 generation = wr1.GetGeneration();
+		wr1.Reset();
+		CHECK_TRUE(wr1.GetGeneration() != generation);
+		wr1.SetRoot(WriteStructArray(wr1, sw, items, 3));
+		wr2.SetRoot(WriteStructArray(wr2, sw, items, 3));
+		StructWriter<SerTestItem> sw3;
+		wr3.SetRoot(WriteStructArray(wr3, sw3, items, 3));
+		CHECK_TRUE(wr1.GetSize() == wr3.GetSize() && memcmp(wr1.GetData(), wr3.GetData(), wr3.GetSize()) == 0);
+		CHECK_TRUE(wr2.GetSize() == wr3.GetSize() && memcmp(wr2.GetData(), wr3.GetData(), wr3.GetSize()) == 0);
+		// (a new writer at the address of a destroyed one)
+		generation = wr2.GetGeneration();
+		wr2.~Writer();
+		new (&wr2) Writer();
+		CHECK_TRUE(wr2.GetGeneration() != generation);
+		wr2.WriteString8("shifts the positions of the keys");
+		wr2.SetRoot(WriteStructArray(wr2, sw, items, 3));
+		Reader r;
+		CHECK_TRUE(r.Init(wr2.GetData(), wr2.GetSize()));
+		CHECK_TRUE(r.GetRoot().AsArray()[2].AsStringMap().FindValueByKey("small").AsU32() == 202);
+	}
+
+	// sorted entries are written the same way without being copied and sorted again
+	{
+		Writer wr1, wr2;
+		for (Writer* wr : { &wr1, &wr2 })
+		{
+			StringMapEntry e[] = { { wr->WriteStringKey("a"), wr->WriteU32(1) }, { wr->WriteStringKey("b"), wr->WriteU32(2) } };
+			wr->SetRoot(wr == &wr1 ? wr->WriteStringMap(e, 2) : wr->WriteStringMapPresorted(e, 2));
+		}
+		CHECK_TRUE(wr1.GetSize() == wr2.GetSize() && memcmp(wr1.GetData(), wr2.GetData(), wr1.GetSize()) == 0);
+	}
+
+	puts("-----");
+	puts("");
+}
+
+void TestStructBinding()
+{
+	puts("----- testing struct binding -----");
+	using namespace dato;
+
+	for (u8 flags : { u8(0), FLAG_SortedKeys, u8(FLAG_SortedKeys | FLAG_UniqueKeys) })
+	{
+		for (bool dedup : { false, true })
+		{
+			Writer wr("DATO", 4, flags, dedup);
+			std::vector<ValueRef> items;
+			for (u32 i = 0; i < 300; i++)
+			{
+				float pos[3] = { float(i), 1, 2 };
+				std::vector<StringMapEntry> e =
+				{
+					{ wr.WriteStringKey("pos"), wr.WriteVectorT(pos, 3) },
+					{ wr.WriteStringKey("id"), wr.WriteS32(s32(i)) },
+					{ wr.WriteStringKey("name"), wr.WriteString8(i % 2 ? "odd" : "even") },
+				};
+				// other shapes: extra/missing keys, different types and orders
+				if (i % 3 == 0)
+					e.push_back({ wr.WriteStringKey("big"), wr.WriteU64(u64(i) << 40) });
+				if (i % 5 == 0)
+					e.push_back({ wr.WriteStringKey("flag"), wr.WriteBool(true) });
+				if (i % 7 == 0)
+					e[1].value = wr.WriteString8("not a number");
+				if (i % 11 == 0)
+					std::swap(e[0], e[2]);
+				if (i % 13 == 0)
+					e.push_back({ wr.WriteStringKey("custom"), wr.WriteString8("12345") });
+				items.push_back(i % 17 == 0
+					? wr.WriteStringHashMap(e.data(), u32(e.size()))
+					: wr.WriteStringMap(e.data(), u32(e.size())));
+			}
+			items.push_back(wr.WriteU32(5)); // not a map
+			wr.SetRoot(wr.WriteArray(items.data(), u32(items.size())));
+
+			Reader r;
+			CHECK_TRUE(r.Init(wr.GetData(), wr.GetSize()));
+			StructBinding<BindTestItem> binding;
+			binding
+				.Bind("pos", &BindTestItem::pos)
+				.Bind("id", &BindTestItem::id)
+				.Bind("big", &BindTestItem::big)
+				.Bind("flag", &BindTestItem::flag)
+				.Bind("name", &BindTestItem::name)
+				.Bind("custom", &BindTestItem::custom, [](const Reader::DynamicAccessor& v, void* dst)
+				{
+					if (auto s = v.TryGetString8())
+						*static_cast<u32*>(dst) = u32(atoi(s.GetData()));
+				});
+			std::vector<BindTestItem> out;
+			out.resize(1);
+			binding.DecodeArray(r.GetRoot().AsArray(), out);
+			// decoding again uses the cached shapes
+			std::vector<BindTestItem> out2;
+			binding.DecodeArray(r.GetRoot().AsArray(), out2);
+
+			u32 numWrong = out.size() != 302 || out2.size() != 301;
+			for (u32 i = 0; i < 300 && !numWrong; i++)
+			{
+				const BindTestItem& it = out[i + 1];
+				if (it.pos[0] != float(i) || it.pos[2] != 2
+					|| it.id != (i % 7 == 0 ? -1 : s32(i))
+					|| it.big != (i % 3 == 0 ? u64(i) << 40 : 0)
+					|| it.flag != (i % 5 == 0)
+					|| it.name != (i % 2 ? "odd" : "even")
+					|| it.custom != (i % 13 == 0 ? 12345U : 0U))
+					numWrong++;
+				const BindTestItem& it2 = out2[i];
+				if (it2.id != it.id || it2.name != it.name || it2.big != it.big || it2.custom != it.custom)
+					numWrong++;
+			}
+			if (out.size() == 302 && (out[301].id != -1 || !out[301].name.empty()))
+				numWrong++;
+			if (numWrong)
+				printf("ERROR (line %d): %u wrong decoded items (flags=%u, dedup=%d)\n", __LINE__,
+					unsigned(numWrong), unsigned(flags), int(dedup));
+			// with unique keys, there are only as many shapes as combinations of keys
+			if (dedup && binding.GetShapeCount() > 40)
+				printf("ERROR (line %d): %u shapes\n", __LINE__, unsigned(binding.GetShapeCount()));
+		}
+	}
+
+	// shapes are not reused for another buffer
+	{
+		Writer wr1, wr2;
+		wr2.WriteStringKey("padding");
+		StringMapEntry e1[] = { { wr1.WriteStringKey("id"), wr1.WriteS32(1) }, { wr1.WriteStringKey("name"), wr1.WriteString8("a") } };
+		StringMapEntry e2[] = { { wr2.WriteStringKey("id"), wr2.WriteS32(2) }, { wr2.WriteStringKey("zzz"), wr2.WriteString8("b") } };
+		wr1.SetRoot(wr1.WriteStringMap(e1, 2));
+		wr2.SetRoot(wr2.WriteStringMap(e2, 2));
+		Reader r1, r2;
+		CHECK_TRUE(r1.Init(wr1.GetData(), wr1.GetSize()) && r2.Init(wr2.GetData(), wr2.GetSize()));
+		StructBinding<BindTestItem> binding;
+		binding.Bind("id", &BindTestItem::id).Bind("name", &BindTestItem::name);
+		BindTestItem a, b;
+		binding.Decode(r1.GetRoot().AsStringMap(), a);
+		binding.Decode(r2.GetRoot().AsStringMap(), b);
+		CHECK_TRUE(a.id == 1 && a.name == "a" && b.id == 2 && b.name.empty());
+	}
+
+	puts("-----");
+	puts("");
+}
+
+void TestPagedReader()
+{
+	puts("----- testing paged reader -----");
+	using namespace dato;
+
+	Writer wr;
+	WriteValidationTestData(wr);
+	Reader r;
+	CHECK_TRUE(r.Init(wr.GetData(), wr.GetSize()));
+
+	// same data for various block sizes and cache sizes (with values spanning pages)
+	MemoryPageSource src(wr.GetData(), wr.GetSize());
+	for (u32 blockSize : { 8, 16, 64, 4096 })
+	{
+		for (u32 numPages : { 1, 3, 64 })
+		{
+			PageCache cache;
+			CHECK_TRUE(cache.Init(&src, blockSize, numPages));
+			PagedReader pr;
+			CHECK_TRUE(pr.Init(cache));
+			CHECK_TRUE(SamePagedValue(r.GetRoot(), pr.GetRoot()));
+			CHECK_TRUE(!pr.HasError());
+			CHECK_TRUE(cache.GetCachedPageCount() <= numPages);
+			CHECK_TRUE(cache.stats.misses == cache.stats.bytesRead / blockSize + (cache.stats.bytesRead % blockSize != 0)
+				|| cache.stats.evictions != 0);
+		}
+	}
+
+	// errors
+	{
+		PageCache cache;
+		CHECK_TRUE(!cache.Init(&src, 48));
+		CHECK_TRUE(cache.Init(&src, 16, 4));
+		PagedReader pr;
+		CHECK_TRUE(!pr.Init(cache, "DATX"));
+		CHECK_TRUE(!pr.GetRoot());
+		CHECK_TRUE(pr.Init(cache));
+		CHECK_TRUE(pr.GetRoot().AsStringMap().FindValueByKey("map").AsStringMap().FindValueByKey("inner").AsU32() == 123);
+		CHECK_TRUE(!pr.HasError());
+		CHECK_TRUE(!pr.GetRoot().AsIntMap());
+		CHECK_TRUE(pr.HasError());
+
+		cache.Clear();
+		src.fail = true;
+		CHECK_TRUE(!pr.Init(cache));
+		CHECK_TRUE(cache.stats.readErrors != 0 && cache.GetCachedPageCount() == 0);
+		src.fail = false;
+
+		// failed reads into evicted and free pages
+		for (u64 i = 0; i < 4; i++)
+			CHECK_TRUE(cache.GetPage(i) != nullptr);
+		CHECK_TRUE(cache.GetCachedPageCount() == 4);
+		src.fail = true;
+		CHECK_TRUE(!cache.GetPage(10) && cache.GetCachedPageCount() == 3);
+		CHECK_TRUE(!cache.GetPage(11) && cache.GetCachedPageCount() == 3);
+		src.fail = false;
+		CHECK_TRUE(cache.GetPage(12) && cache.GetCachedPageCount() == 4);
+		CHECK_TRUE(cache.GetPage(13) && cache.GetCachedPageCount() == 4);
+	}
+
+	// bulk decoding, key handles and batch lookups through the pages
+	{
+		PageCache cache;
+		CHECK_TRUE(cache.Init(&src, 16, 4));
+		PagedReader pr;
+		CHECK_TRUE(pr.Init(cache));
+		auto map = r.GetRoot().AsStringMap();
+		auto pmap = pr.GetRoot().AsStringMap();
+		std::vector<PagedReader::DynamicAccessor> vals(pmap.GetSize());
+		CHECK_TRUE(pmap.DecodeSlots(0, vals.size(), vals.data()) == map.GetSize());
+		bool same = true;
+		for (size_t i = 0; i < vals.size(); i++)
+			same = same && SamePagedValue(map.GetValueByIndex(i), vals[i]);
+		CHECK_TRUE(same);
+		KeyHandle key = pr.ResolveKey("map");
+		CHECK_TRUE(pmap.FindValueByKey(key) && pmap.FindValueByKey(key) && key.pos == 0);
+		const char* keys[] = { "map", "missing" };
+		PagedReader::DynamicAccessor found[2];
+		CHECK_TRUE(pmap.FindValuesByKeys(keys, 2, found) == 1 && found[0].TryGetStringMap() && !found[1]);
+		CHECK_TRUE(!pr.HasError());
+	}
+
+	// references to the container itself are errors
+	{
+		std::vector<char> sbuf = WriteSelfReferenceTestDoc();
+		MemoryPageSource ssrc(sbuf.data(), u32(sbuf.size()));
+		PageCache cache;
+		CHECK_TRUE(cache.Init(&ssrc, 16, 4));
+		PagedReader pr;
+		CHECK_TRUE(pr.Init(cache));
+		CHECK_TRUE(!pr.GetRoot().AsArray().GetValueByIndex(0) && pr.HasError());
+		CHECK_TRUE(pr.Init(cache));
+		CHECK_TRUE(!pr.GetRoot().AsArray().GetValueByIndex(1).AsStringMap().FindValueByKey("self") && pr.HasError());
+	}
+
+	// truncated data (must not crash)
+	for (u32 len = 0; len < wr.GetSize(); len++)
+	{
+		MemoryPageSource tsrc(wr.GetData(), len);
+		PageCache cache;
+		PagedReader pr;
+		if (cache.Init(&tsrc, 16, 2) && pr.Init(cache))
+			SamePagedValue(r.GetRoot(), pr.GetRoot());
+	}
+
+	// a point lookup only loads the pages on its path
+	{
+		Writer bwr;
+		std::vector<ValueRef> nodes;
+		for (u32 i = 0; i < 10000; i++)
+		{
+			StringMapEntry e[] =
+			{
+				{ bwr.WriteStringKey("id"), bwr.WriteU32(i) },
+				{ bwr.WriteStringKey("name"), bwr.WriteString8("object") },
+			};
+			nodes.push_back(bwr.WriteStringMap(e, 2));
+		}
+		bwr.SetRoot(bwr.WriteArray(nodes.data(), u32(nodes.size())));
+
+		const char* path = "paged.gen.dato";
+		FILE* fp = fopen(path, "wb");
+		fwrite(bwr.GetData(), bwr.GetSize(), 1, fp);
+		fclose(fp);
+
+		FilePageSource fsrc;
+		CHECK_TRUE(!fsrc.Open("missing.gen.dato"));
+		CHECK_TRUE(fsrc.Open(path) && fsrc.GetSize() == bwr.GetSize());
+		PageCache cache;
+		CHECK_TRUE(cache.Init(&fsrc, 4096, 16));
+		PagedReader pr;
+		CHECK_TRUE(pr.Init(cache));
+		u64 numFilePages = (bwr.GetSize() + 4095) / 4096;
+		CHECK_TRUE(pr.GetRoot().AsArray().GetValueByIndex(7000).AsStringMap().FindValueByKey("id").AsU32() == 7000);
+		u64 misses = cache.stats.misses;
+		printf("file pages: %u, loaded for one lookup: %u\n", unsigned(numFilePages), unsigned(misses));
+		CHECK_TRUE(misses <= 5 && numFilePages > 50); // header, array slot, array type, map, key
+		CHECK_TRUE(pr.GetRoot().AsArray().GetValueByIndex(7000).AsStringMap().FindValueByKey("id").AsU32() == 7000);
+		CHECK_TRUE(cache.stats.misses == misses);
+
+		for (u32 i = 0; i < 10000; i += 100)
+			CHECK_TRUE(pr.GetRoot().AsArray().GetValueByIndex(i).AsStringMap().FindValueByKey("id").AsU32() == i);
+		CHECK_TRUE(cache.GetCachedPageCount() == 16 && cache.stats.evictions != 0 && !pr.HasError());
+		fsrc.Close();
+		remove(path);
+	}
+
+	puts("-----");
+	puts("");
+}
+
+void TestRandomAccessIterators()
+{
+	puts("----- testing random access iterators -----");
+	using namespace dato;
+
+	Writer wr;
+	std::vector<ValueRef> vals;
+	std::vector<IntMapEntry> ime;
+	std::vector<StringMapEntry> sme;
+	char key[16];
+	for (u32 i = 0; i < 50; i++)
+	{
+		ValueRef v = wr.WriteU32(i * 3);
+		vals.push_back(v);
+		ime.push_back({ i * 2, v });
+		snprintf(key, sizeof(key), "k%02u", unsigned(i));
+		sme.push_back({ wr.WriteStringKey(key), v });
+	}
+	u32 chars[20];
+	f32 vecs[20 * 3];
+	for (u32 i = 0; i < 20; i++)
+	{
+		chars[i] = i * 10;
+		for (u32 j = 0; j < 3; j++)
+			vecs[i * 3 + j] = f32(i * 3 + j);
+	}
+	StringMapEntry rootEntries[] =
+	{
+		{ wr.WriteStringKey("arr"), wr.WriteArray(vals.data(), vals.size()) },
+		{ wr.WriteStringKey("im"), wr.WriteIntMap(ime.data(), ime.size()) },
+		{ wr.WriteStringKey("sm"), wr.WriteStringMap(sme.data(), sme.size()) },
+		{ wr.WriteStringKey("str"), wr.WriteString32(chars, 20) },
+		{ wr.WriteStringKey("vecs"), wr.WriteVectorArrayT(vecs, 3, 20) },
+	};
+	wr.SetRoot(wr.WriteStringMap(rootEntries, arraysize(rootEntries)));
+	Reader r;
+	CHECK_TRUE(r.Init(wr.GetData(), wr.GetSize()));
+	auto root = r.GetRoot().AsStringMap();
+	auto arr = root.FindValueByKey("arr").AsArray();
+	auto im = root.FindValueByKey("im").AsIntMap();
+	auto sm = root.FindValueByKey("sm").AsStringMap();
+	auto str = root.FindValueByKey("str").AsString32();
+	auto va = root.FindValueByKey("vecs").AsVectorArray<f32>(3);
+
+	// distances, offsets and comparisons
+	CHECK_TRUE(std::distance(arr.begin(), arr.end()) == 50);
+	CHECK_TRUE(arr.end() - arr.begin() == ptrdiff_t(arr.size()));
+	CHECK_TRUE(std::distance(str.begin(), str.end()) == 20);
+	CHECK_TRUE(va.end() - va.begin() == 20);
+	CHECK_TRUE(std::size(sm) == 50);
+	CHECK_TRUE(arr.begin()[7].AsU32() == 21);
+	CHECK_TRUE((*(arr.end() - 1)).AsU32() == 147);
+	CHECK_TRUE((*(3 + im.begin())).GetKey() == 6);
+	CHECK_TRUE(sm.begin() < sm.end() && sm.end() > sm.begin() && sm.begin() <= sm.begin() && !(sm.begin() >= sm.end()));
+	CHECK_TRUE(va.begin()[2][1] == 7.0f);
+	{
+		auto it = str.end();
+		it -= 5;
+		CHECK_TRUE(*it == 150);
+		CHECK_TRUE(*it-- == 150 && *it == 140);
+		CHECK_TRUE(*--it == 130 && *++it == 140);
+		CHECK_TRUE(it - str.begin() == 14);
+	}
+
+	// STL algorithms
+	CHECK_TRUE(std::lower_bound(str.begin(), str.end(), 95u) - str.begin() == 10);
+	CHECK_TRUE(std::binary_search(str.begin(), str.end(), 120u));
+	CHECK_TRUE(!std::binary_search(str.begin(), str.end(), 121u));
+	{
+		auto it = std::lower_bound(im.begin(), im.end(), 31u, [](const Reader::IntMapAccessor::Iterator& e, u32 k) { return e.GetKey() < k; });
+		CHECK_TRUE(it - im.begin() == 16 && (*it).GetValue().AsU32() == 48);
+		auto it2 = std::partition_point(sm.begin(), sm.end(), [](const Reader::StringMapAccessor::Iterator& e) { return strcmp(e.GetKeyCStr(), "k25") < 0; });
+		CHECK_TRUE(it2 - sm.begin() == 25);
+	}
+	CHECK_TRUE(std::count_if(arr.begin(), arr.end(), [](const Reader::DynamicAccessor& v) { return v.AsU32() % 2 == 0; }) == 25);
+	{
+		// entries stay valid after the iterator is advanced
+		std::vector<Reader::StringMapAccessor::Iterator> entries(sm.begin(), sm.end());
+		std::reverse(entries.begin(), entries.end());
+		CHECK_TRUE(entries.size() == 50 && strcmp(entries[0].GetKeyCStr(), "k49") == 0);
+		std::vector<Reader::VectorArrayAccessor<f32>::Element> vs(va.begin(), va.end());
+		CHECK_TRUE(vs.size() == 20 && vs[19][2] == 59.0f);
+	}
+	{
+		std::reverse_iterator<Reader::TypedArrayAccessor<u32>::Iterator> rit(str.end()), rend(str.begin());
+		CHECK_TRUE(*rit == 190 && std::distance(rit, rend) == 20);
+	}
+	CHECK_TRUE(std::is_sorted(str.begin(), str.end()));
+
+#if defined(__cpp_lib_ranges) && __cpp_lib_ranges >= 201911L
+	static_assert(std::random_access_iterator<Reader::ArrayAccessor::Iterator>, "");
+	static_assert(std::random_access_iterator<Reader::StringMapAccessor::Iterator>, "");
+	static_assert(std::random_access_iterator<Reader::IntMapAccessor::Iterator>, "");
+	static_assert(std::random_access_iterator<Reader::TypedArrayAccessor<u32>::Iterator>, "");
+	static_assert(std::random_access_iterator<Reader::VectorArrayAccessor<f32>::Iterator>, "");
+	static_assert(std::ranges::random_access_range<Reader::ArrayAccessor> && std::ranges::sized_range<Reader::ArrayAccessor>, "");
+	static_assert(std::ranges::sized_range<Reader::StringMapAccessor> && std::ranges::sized_range<Reader::IntMapAccessor>, "");
+	static_assert(std::ranges::sized_range<Reader::VectorArrayAccessor<f32>>, "");
+	CHECK_TRUE(std::ranges::size(arr) == 50);
+	CHECK_TRUE(std::ranges::lower_bound(str, 95u) - str.begin() == 10);
+	CHECK_TRUE(std::ranges::distance(sm) == 50);
+#endif
+}
+
+// scenes/<s>/nodes/<n>/mesh/primitives/0/attributes/POSITION = base + s * 100 + n
+static void WritePathTestDoc(dato::Writer& wr, dato::u32 base)
+{
+	using namespace dato;
+	std::vector<ValueRef> scenes;
+	for (u32 s = 0; s < 2; s++)
+	{
+		std::vector<ValueRef> nodes;
+		for (u32 n = 0; n < 20; n++)
+		{
+			StringMapEntry attr[] = { { wr.WriteStringKey("POSITION"), wr.WriteU32(base + s * 100 + n) } };
+			StringMapEntry prim[] = { { wr.WriteStringKey("attributes"), wr.WriteStringMap(attr, 1) } };
+			ValueRef prims = wr.WriteStringMap(prim, 1);
+			StringMapEntry mesh[] = { { wr.WriteStringKey("primitives"), wr.WriteArray(&prims, 1) } };
+			IntMapEntry ids[] = { { 5, wr.WriteU32(n * 5) }, { 10, wr.WriteU32(n * 10) } };
+			std::vector<StringMapEntry> node =
+			{
+				{ wr.WriteStringKey("name"), wr.WriteString8("node") },
+				{ wr.WriteStringKey("ids"), wr.WriteIntMap(ids, 2) },
+				{ wr.WriteStringKey("a/b"), wr.WriteU32(1) },
+				{ wr.WriteStringKey("*"), wr.WriteU32(2) },
+				{ wr.WriteStringKey("~"), wr.WriteU32(3) },
+				{ wr.WriteStringKey("007"), wr.WriteU32(4) },
+			};
+			if (n % 4 != 3)
+				node.push_back({ wr.WriteStringKey("mesh"), wr.WriteStringMap(mesh, 1) });
+			nodes.push_back(n % 2 ? wr.WriteStringHashMap(node.data(), u32(node.size())) : wr.WriteStringMap(node.data(), u32(node.size())));
+		}
+		StringMapEntry scene[] = { { wr.WriteStringKey("nodes"), wr.WriteArray(nodes.data(), u32(nodes.size())) } };
+		scenes.push_back(wr.WriteStringMap(scene, 1));
+	}
+	StringMapEntry root[] =
+	{
+		{ wr.WriteStringKey("scenes"), wr.WriteArray(scenes.data(), u32(scenes.size())) },
+		{ wr.WriteStringKey("0"), wr.WriteU32(base) },
+	};
+	wr.SetRoot(wr.WriteStringMap(root, 2));
+}
+
+void TestPaths()
+{
+	puts("----- testing paths -----");
+	using namespace dato;
+
+	for (u8 flags : { u8(0), u8(FLAG_SortedKeys | FLAG_UniqueKeys) })
+	{
+		Writer wr("DATO", 4, flags);
+		WritePathTestDoc(wr, 1000);
+		Reader r;
+		CHECK_TRUE(r.Init(wr.GetData(), wr.GetSize()));
+
+		// literal paths
+		Path p("scenes/1/nodes/12/mesh/primitives/0/attributes/POSITION");
+		CHECK_TRUE(p.GetStepCount() == 9 && !p.HasWildcards());
+		CHECK_TRUE(p.Find(r).AsU32() == 1112);
+		CHECK_TRUE(p.Find(r).AsU32() == 1112); // with resolved key handles
+		CHECK_TRUE(Path("/scenes/0/nodes/2/mesh/primitives/0/attributes/POSITION").Find(r).AsU32() == 1002);
+		CHECK_TRUE(Path("").Find(r)._pos == r.GetRoot()._pos && Path("/").GetStepCount() == 0);
+		CHECK_TRUE(!Path("scenes/0/nodes/3/mesh").Find(r)); // missing key
+		CHECK_TRUE(!Path("scenes/0/nodes/20").Find(r)); // out of range
+		CHECK_TRUE(!Path("scenes/0/nodes/x").Find(r)); // not an index
+		CHECK_TRUE(!Path("scenes/0/nodes/01").Find(r)); // leading zero
+		CHECK_TRUE(!Path("scenes/0/nodes/0/name/0").Find(r)); // not a container
+		CHECK_TRUE(Path("0").Find(r).AsU32() == 1000); // a numeric string map key
+		CHECK_TRUE(Path("scenes/0/nodes/1/007").Find(r).AsU32() == 4);
+		CHECK_TRUE(Path("scenes/0/nodes/4/ids/10").Find(r).AsU32() == 40);
+		CHECK_TRUE(!Path("scenes/0/nodes/4/ids/7").Find(r));
+
+		// escapes
+		CHECK_TRUE(Path("scenes/0/nodes/0/a~1b").Find(r).AsU32() == 1);
+		CHECK_TRUE(Path("scenes/0/nodes/0/~2").Find(r).AsU32() == 2);
+		CHECK_TRUE(Path("scenes/0/nodes/0/~0").Find(r).AsU32() == 3);
+		Path bad;
+		CHECK_TRUE(!bad.Compile("scenes/~3") && bad.GetStepCount() == 0);
+		CHECK_TRUE(!bad.Compile("scenes/~") && bad.GetStepCount() == 0);
+
+		// wildcards
+		Path w("scenes/*/nodes/*/mesh/primitives/0/attributes/POSITION");
+		CHECK_TRUE(w.HasWildcards());
+		std::vector<Reader::DynamicAccessor> all;
+		CHECK_TRUE(w.FindAll(r, all) == 30 && all.size() == 30);
+		u32 sum = 0, expectedSum = 0;
+		for (auto& v : all)
+			sum += v.AsU32();
+		for (u32 s = 0; s < 2; s++)
+			for (u32 n = 0; n < 20; n++)
+				if (n % 4 != 3)
+					expectedSum += 1000 + s * 100 + n;
+		CHECK_TRUE(sum == expectedSum);
+		CHECK_TRUE(w.Find(r).AsU32() == 1000);
+		CHECK_TRUE(Path("scenes/1/nodes/3/*").ForEach(r, [](const Reader::DynamicAccessor&) {}) == 6);
+		CHECK_TRUE(Path("scenes/0/nodes/3/ids/*").ForEach(r, [](const Reader::DynamicAccessor&) {}) == 2);
+		CHECK_TRUE(!Path("scenes/*/nodes/3/mesh").Find(r));
+		{
+			// copies have their own key handles
+			Path c = w;
+			CHECK_TRUE(c.Find(r).AsU32() == 1000 && c._steps[4].key.str != w._steps[4].key.str);
+		}
+
+		// relative paths in a batch of values
+		Path rel("mesh/primitives/0/attributes/POSITION");
+		auto nodes = Path("scenes/1/nodes").Find(r).AsArray();
+		std::vector<Reader::DynamicAccessor> from(nodes.begin(), nodes.end()), out(from.size());
+		CHECK_TRUE(rel.FindInEach(from.data(), from.size(), out.data()) == 15);
+		u32 numWrong = 0;
+		for (u32 n = 0; n < 20; n++)
+			numWrong += n % 4 == 3 ? out[n].IsValid() : out[n].AsU32() != 1100 + n;
+		CHECK_TRUE(numWrong == 0);
+		CHECK_TRUE(Path("*/POSITION").FindInEach(from.data(), from.size(), out.data()) == 0);
+		CHECK_TRUE(Path("ids/*").FindInEach(from.data(), from.size(), out.data()) == 20 && out[7].AsU32() == 35);
+	}
+
+	// cached prefixes and batches of documents
+	{
+		Writer wrs[3] = { { "DATO", 4, FLAG_SortedKeys }, { "DATO", 4, FLAG_SortedKeys }, { "DATO", 4, FLAG_SortedKeys } };
+		Reader rs[3];
+		for (u32 d = 0; d < 3; d++)
+		{
+			WritePathTestDoc(wrs[d], 1000 * (d + 1));
+			CHECK_TRUE(rs[d].Init(wrs[d].GetData(), wrs[d].GetSize()));
+		}
+		PathCache cache;
+		Path p1("scenes/1/nodes/5/mesh/primitives/0/attributes/POSITION");
+		Path p2("scenes/1/nodes/5/name");
+		Path p3("scenes/1/nodes/*/mesh/primitives/0/attributes/POSITION");
+		for (u32 d = 0; d < 3; d++)
+		{
+			CHECK_TRUE(p1.Find(rs[d], cache).AsU32() == 1000 * (d + 1) + 105);
+			CHECK_TRUE(cache.GetSize() == 9);
+			CHECK_TRUE(p1.Find(rs[d], cache).AsU32() == 1000 * (d + 1) + 105);
+			CHECK_TRUE(p2.Find(rs[d], cache).AsString8().GetSize() == 4);
+			CHECK_TRUE(cache.GetSize() == 10); // (shares the first 4 steps)
+			CHECK_TRUE(p3.Find(rs[d], cache).AsU32() == 1000 * (d + 1) + 100);
+			CHECK_TRUE(cache.GetSize() == 10);
+			CHECK_TRUE(!Path("scenes/1/nodes/7/mesh").Find(rs[d], cache));
+		}
+		cache.Clear();
+		CHECK_TRUE(cache.GetSize() == 0);
+
+		Reader::DynamicAccessor out[3];
+		CHECK_TRUE(p1.FindInEach(rs, 3, out) == 3);
+		CHECK_TRUE(out[0].AsU32() == 1105 && out[1].AsU32() == 2105 && out[2].AsU32() == 3105);
+		CHECK_TRUE(p3.FindInEach(rs, 3, out) == 3 && out[2].AsU32() == 3100);
+		CHECK_TRUE(Path("scenes/2").FindInEach(rs, 3, out) == 0 && !out[0] && !out[2]);
+	}
+
+	// documents in the same buffer (the key handles and cached prefixes are resolved again)
+	{
+		static char buf[1024];
+		Reader r;
+		Path pa("a"), pma("m/a");
+		PathCache cache;
+		for (u32 d = 0; d < 2; d++)
+		{
+			// (the second document has the key "b" where the first one has "a", and "m" elsewhere)
+			Writer wr("DATO", 4, FLAG_Aligned | FLAG_SortedKeys | FLAG_UniqueKeys);
+			KeyRef k1 = wr.WriteStringKey(d ? "b" : "a");
+			KeyRef k2 = wr.WriteStringKey(d ? "a" : "b");
+			KeyRef ka = d ? k2 : k1, kb = d ? k1 : k2;
+			if (d)
+				wr.WriteString8("padding");
+			StringMapEntry inner[] = { { ka, wr.WriteU32(10 + d) }, { kb, wr.WriteU32(20 + d) } };
+			StringMapEntry outer[] = { { ka, wr.WriteU32(1) }, { kb, wr.WriteU32(2) }, { wr.WriteStringKey("m"), wr.WriteStringMap(inner, 2) } };
+			wr.SetRoot(wr.WriteStringMap(outer, 3));
+			memcpy(buf, wr.GetData(), wr.GetSize());
+			CHECK_TRUE(r.Init(buf, wr.GetSize()));
+			CHECK_TRUE(pa.Find(r).AsU32() == 1 && pa._steps[0].key.document == r.GetDocumentId());
+			CHECK_TRUE(pma.Find(r, cache).AsU32() == 10 + d && pma.Find(r, cache).AsU32() == 10 + d);
+		}
+	}
+}
+
+// writes the same data with any value deduplication options
+static void WriteDedupTestDoc(dato::Writer& wr)
+{
+	using namespace dato;
+	u8 bytes[100];
+	for (u32 i = 0; i < 100; i++)
+		bytes[i] = u8(i * 7);
+	const u16 str16[] = { 'a', 'b', 'c', 0 };
+	const u32 str32[] = { 'a', 'b', 'c', 'd', 0 };
+	f32 vec[3] = { 1, 2, 3 };
+	ValueRef flags[] = { wr.WriteU32(1), wr.WriteBool(true), wr.WriteNull() };
+	std::vector<ValueRef> items;
+	for (u32 i = 0; i < 40; i++)
+	{
+		// repeated leaf values
+		StringMapEntry e[] =
+		{
+			{ wr.WriteStringKey("name"), wr.WriteString8(i % 2 ? "object" : "other object") },
+			{ wr.WriteStringKey("s16"), wr.WriteString16(str16) },
+			{ wr.WriteStringKey("s32"), wr.WriteString32(str32) },
+			{ wr.WriteStringKey("bytes"), wr.WriteByteArray(bytes, i % 3 ? 100 : 99) },
+			{ wr.WriteStringKey("vec"), wr.WriteVectorT(vec, 3) },
+			{ wr.WriteStringKey("vecs"), wr.WriteVectorArrayT(vec, 1, 3) },
+			{ wr.WriteStringKey("u64"), wr.WriteU64(u64(1) << 40) },
+			{ wr.WriteStringKey("s64"), wr.WriteS64(s64(1) << 40) }, // (the same bytes as u64)
+			{ wr.WriteStringKey("f64"), wr.WriteF64(0.25) },
+			{ wr.WriteStringKey("id"), wr.WriteU32(i % 4) },
+			{ wr.WriteStringKey("flags"), wr.WriteArray(flags, 3) }, // (only embedded values)
+		};
+		// repeated containers, which refer to the repeated values
+		ValueRef arr[] = { e[0].value, e[6].value, wr.WriteU32(5) };
+		IntMapEntry ime[] = { { 1, e[4].value }, { 2, wr.WriteArray(arr, 3) } };
+		StringMapEntry sub[] = { { wr.WriteStringKey("im"), wr.WriteIntMap(ime, 2) }, e[9] };
+		std::vector<StringMapEntry> all(e, e + 11);
+		all.push_back({ wr.WriteStringKey("sub"), i % 5 ? wr.WriteStringMap(sub, 2) : wr.WriteStringHashMap(sub, 2) });
+		items.push_back(wr.WriteStringMap(all.data(), u32(all.size())));
+	}
+	wr.SetRoot(wr.WriteArray(items.data(), u32(items.size())));
+}
+
+void TestValueDedup()
+{
+	puts("----- testing value deduplication -----");
+	using namespace dato;
+
+	for (u8 flags : { u8(0), u8(FLAG_Aligned | FLAG_SortedKeys) })
+	{
+		Writer ref("DATO", 4, flags);
+		WriteDedupTestDoc(ref);
+		Reader rr;
+		CHECK_TRUE(rr.Init(ref.GetData(), ref.GetSize()));
+		StringDumper expected;
+		rr.GetRoot().Visit(expected);
+
+		size_t prevSize = ref.GetSize();
+		for (u8 dedup : { DEDUP_Strings, DEDUP_ByteArrays, DEDUP_Vectors, DEDUP_Scalars64, DEDUP_Containers, DEDUP_All })
+		{
+			Writer wr("DATO", 4, flags, true, dedup);
+			CHECK_TRUE(wr.GetValueDedup() == dedup);
+			WriteDedupTestDoc(wr);
+			CHECK_TRUE(wr.GetSize() < ref.GetSize());
+			Reader r;
+			TrustedReader tr;
+			CHECK_TRUE(r.Init(wr.GetData(), wr.GetSize()) && r.Validate(tr));
+			StringDumper sd;
+			r.GetRoot().Visit(sd);
+			CHECK_TRUE(sd.text == expected.text);
+			if (dedup == DEDUP_All)
+				CHECK_TRUE(wr.GetSize() * 4 < prevSize);
+		}
+
+		// only the values of each type are compared and the duplicates are the earlier values
+		Writer wr("DATO", 4, flags, true, DEDUP_All);
+		ValueRef a = wr.WriteString8("abc");
+		ValueRef b = wr.WriteByteArray("\x03" "abc", 4);
+		ValueRef c = wr.WriteString8("abc");
+		CHECK_TRUE(c.pos == a.pos && c.type == TYPE_String8 && b.pos != a.pos);
+		ValueRef d = wr.WriteF64(1.0);
+		size_t size = wr.GetSize();
+		ValueRef e = wr.WriteU64(BitCast<u64>(1.0));
+		CHECK_TRUE(e.pos == d.pos && e.type == TYPE_U64 && wr.GetSize() == size);
+		wr.SetValueDedup(0);
+		CHECK_TRUE(wr.WriteString8("abc").pos != a.pos);
+		ValueRef arr1 = wr.WriteArray(&a, 1);
+		wr.SetValueDedup(DEDUP_Containers);
+		ValueRef arr2 = wr.WriteArray(&a, 1);
+		ValueRef arr3 = wr.WriteArray(&a, 1);
+		ValueRef arr4 = wr.WriteArray(&b, 1);
+		CHECK_TRUE(arr2.pos != arr1.pos && arr3.pos == arr2.pos && arr4.pos != arr2.pos);
+		ValueRef im1 = wr.WriteIntMap(nullptr, 0);
+		ValueRef arr5 = wr.WriteArray(nullptr, 0);
+		CHECK_TRUE(wr.WriteIntMap(nullptr, 0).pos == im1.pos && wr.WriteArray(nullptr, 0).pos == arr5.pos && im1.pos != arr5.pos);
+	}
+
+	// validation checks the shared containers once (with the default limits)
+	{
+		Writer wr("DATO", 4, FLAG_Aligned | FLAG_SortedKeys, true, DEDUP_All);
+		std::vector<ValueRef> records;
+		for (u32 i = 0; i < 200; i++)
+		{
+			std::vector<StringMapEntry> fields;
+			for (u32 f = 0; f < 30; f++)
+				fields.push_back({ wr.WriteStringKey(("f" + std::to_string(f)).c_str()), wr.WriteF64(f * 0.5) });
+			records.push_back(wr.WriteStringMap(fields.data(), 30));
+		}
+		wr.SetRoot(wr.WriteArray(records.data(), 200));
+		Reader r;
+		TrustedReader tr;
+		CHECK_TRUE(r.Init(wr.GetData(), wr.GetSize()) && r.Validate(tr));
+		CHECK_TRUE(tr.GetRoot().AsArray()[199].AsStringMap().FindValueByKey("f29").AsF64() == 14.5);
+
+		// (2^100 paths through the tree)
+		Writer dwr("DATO", 4, FLAG_Aligned | FLAG_SortedKeys, true, DEDUP_All);
+		ValueRef v = dwr.WriteF64(1.0);
+		for (u32 i = 0; i < 100; i++)
+		{
+			ValueRef pair[] = { v, v };
+			v = dwr.WriteArray(pair, 2);
+		}
+		dwr.SetRoot(v);
+		CHECK_TRUE(r.Init(dwr.GetData(), dwr.GetSize()) && r.Validate(tr));
+		CHECK_TRUE(!r.Validate(tr, 100) && r.Validate(tr, 101));
+	}
+}
+
+// keeps track of the live memory (and fails to allocate more than `budget` bytes in total)
+struct CountingAllocator : dato::IAllocator
+{
+	size_t live = 0;
+	size_t allocs = 0;
+	size_t budget = ~size_t(0);
+
+	void* Realloc(void* ptr, size_t oldSize, size_t size) override
+	{
+		if (live - oldSize + size > budget)
+			return nullptr;
+		live += size - oldSize;
+		allocs++;
+		return realloc(ptr, size);
+	}
+	void Free(void* ptr, size_t size) override
+	{
+		live -= size;
+		free(ptr);
+	}
+};
+
+// fails to allocate more than `limit` bytes at once
+struct LimitedAllocator : dato::IAllocator
+{
+	size_t limit;
+
+	LimitedAllocator(size_t l) : limit(l) {}
+	void* Realloc(void* ptr, size_t, size_t size) override
+	{
+		return size <= limit ? realloc(ptr, size) : nullptr;
+	}
+	void Free(void* ptr, size_t) override
+	{
+		free(ptr);
+	}
+};
+
+static std::string GatherSegments(const dato::Builder& b)
+{
+	dato::DataSegment segs[256];
+	dato::u32 n = b.GetSegments(segs, 256);
+	std::string out;
+	for (dato::u32 i = 0; i < n && i < 256; i++)
+		out.append((const char*) segs[i].data, segs[i].size);
+	return out;
+}
+
+void TestSegmentedWriter()
+{
+	puts("----- testing segmented writer data, reuse and allocators -----");
+	using namespace dato;
+
+	for (u8 flags : { u8(0), u8(FLAG_Aligned | FLAG_SortedKeys) })
+	{
+		Writer ref("DATO", 4, flags);
+		WritePathTestDoc(ref, 1000);
+		std::string expected((const char*) ref.GetData(), ref.GetSize());
+
+		// many small segments (the same data as the contiguous one, no dedup)
+		Writer wr("DATO", 4, flags);
+		wr.SetSegmented(64);
+		CHECK_TRUE(wr.IsSegmented());
+		WritePathTestDoc(wr, 1000);
+		DataSegment segs[256];
+		u32 numSegs = wr.GetSegments(segs, 256);
+		CHECK_TRUE(numSegs > 10 && numSegs < 256);
+		CHECK_TRUE(GatherSegments(wr) == expected);
+		const char* firstSeg = (const char*) segs[0].data;
+		CHECK_TRUE(wr._Ptr(0) == firstSeg);
+
+		// reuse after Reset (keeps the segments)
+		wr.Reset();
+		CHECK_TRUE(wr.GetSegments(segs, 256) == 1 && segs[0].data == firstSeg);
+		WritePathTestDoc(wr, 1000);
+		CHECK_TRUE(wr.GetSegments(segs, 256) == numSegs);
+		CHECK_TRUE(GatherSegments(wr) == expected);
+
+		// merged into one buffer
+		CHECK_TRUE(wr.Flatten());
+		CHECK_TRUE(wr.GetSize() == expected.size() && memcmp(wr.GetData(), expected.data(), expected.size()) == 0);
+		CHECK_TRUE(wr.GetSegments(segs, 256) == 1);
+		Reader r;
+		TrustedReader tr;
+		CHECK_TRUE(r.Init(wr.GetData(), wr.GetSize()) && r.Validate(tr));
+
+		// contiguous reuse
+		ref.Reset();
+		CHECK_TRUE(ref.GetSize() == Writer("DATO", 4, flags).GetSize());
+		WritePathTestDoc(ref, 1000);
+		CHECK_TRUE(std::string((const char*) ref.GetData(), ref.GetSize()) == expected);
+
+		// value dedup with segmented data (values across segments are kept as they are)
+		Writer dref("DATO", 4, flags, true, DEDUP_All);
+		WriteDedupTestDoc(dref);
+		Reader rr;
+		CHECK_TRUE(rr.Init(dref.GetData(), dref.GetSize()));
+		StringDumper dexpected;
+		rr.GetRoot().Visit(dexpected);
+		Writer dwr("DATO", 4, flags, true, DEDUP_All);
+		dwr.SetSegmented(256);
+		for (int pass = 0; pass < 2; pass++)
+		{
+			dwr.Reset();
+			WriteDedupTestDoc(dwr);
+			CHECK_TRUE(dwr.GetSize() < ref.GetSize());
+			std::string data = GatherSegments(dwr);
+			Reader dr;
+			CHECK_TRUE(dr.Init(data.data(), data.size()) && dr.Validate(tr));
+			StringDumper sd;
+			dr.GetRoot().Visit(sd);
+			CHECK_TRUE(sd.text == dexpected.text);
+		}
+	}
+
+	// all of the memory comes from the allocator
+	CountingAllocator ca;
+	{
+		Writer wr("DATO", 4, FLAG_Aligned | FLAG_SortedKeys, true, DEDUP_All, &ca);
+		wr.SetSegmented(128);
+		WriteDedupTestDoc(wr);
+		WritePathTestDoc(wr, 1000);
+		CHECK_TRUE(ca.allocs > 10 && ca.live > wr.GetSize());
+		size_t allocs = ca.allocs;
+		wr.Reset();
+		WritePathTestDoc(wr, 1000);
+		CHECK_TRUE(ca.allocs == allocs);
+	}
+	CHECK_TRUE(ca.live == 0);
+
+	// allocation failures set `error` (in any of the writer's memory) instead of crashing
+	for (size_t budget : { 100, 1000, 10000, 100000, 1000000 })
+	{
+		CountingAllocator ba;
+		ba.budget = budget;
+		{
+			Writer wr("DATO", 4, FLAG_Aligned | FLAG_SortedKeys, true, DEDUP_All, &ba);
+			wr.SetSegmented(4096);
+			StringMapEntry entries[100];
+			for (u32 i = 0; i < 100000; i++)
+			{
+				char str[16];
+				int len = snprintf(str, sizeof(str), "s%u", i);
+				ValueRef v = wr.WriteString8(str, len);
+				if (i % 1000 < 100)
+					entries[i % 100] = { wr.WriteStringKey(str, len), v };
+				if (i % 1000 == 99)
+					wr.WriteStringMap(entries, 100);
+			}
+			CHECK_TRUE(wr.error && ba.live <= budget);
+			CHECK_TRUE(!wr._curSegment || !wr.Flatten()); // (no memory to merge the segments)
+		}
+		CHECK_TRUE(ba.live == 0);
+	}
+}
+
+struct StringOutputStream : dato::IOutputStream
+{
+	std::string data;
+
+	bool Write(const void* mem, size_t size) override
+	{
+		data.append((const char*) mem, size);
+		return true;
+	}
+	bool WriteAt(dato::u64 offset, const void* mem, size_t size) override
+	{
+		if (offset + size > data.size())
+			return false;
+		memcpy(&data[size_t(offset)], mem, size);
+		return true;
+	}
+};
+
+static std::string ReadWholeFile(const char* path)
+{
+	std::string out;
+	if (FILE* fp = fopen(path, "rb"))
+	{
+		char buf[4096];
+		while (size_t n = fread(buf, 1, sizeof(buf), fp))
+			out.append(buf, n);
+		fclose(fp);
+	}
+	return out;
+}
+
+void TestStreamingWriter()
+{
+	puts("----- testing streaming writer -----");
+	using namespace dato;
+
+	for (u8 flags : { u8(0), u8(FLAG_Aligned | FLAG_SortedKeys) })
+	{
+		Writer ref("DATO", 4, flags);
+		WritePathTestDoc(ref, 1000);
+		std::string expected((const char*) ref.GetData(), ref.GetSize());
+
+		StringOutputStream out;
+		{
+			Writer wr("DATO", 4, flags);
+			wr.SetStreaming(&out, 256, 128);
+			CHECK_TRUE(wr.IsStreaming());
+			// keys that have been written out are still deduplicated
+			KeyRef k1 = wr.WriteStringKey("POSITION");
+			WritePathTestDoc(wr, 1000);
+			KeyRef k2 = wr.WriteStringKey("POSITION");
+			CHECK_TRUE(k1.pos == k2.pos && k2.pos < wr.GetFlushedSize());
+			CHECK_TRUE(out.data.size() == wr.GetFlushedSize() && wr.GetFlushedSize() + 1024 > wr.GetSize());
+			DataSegment segs[16];
+			CHECK_TRUE(wr.GetSegments(segs, 16) <= 5);
+			CHECK_TRUE(wr.FinishStreaming());
+			CHECK_TRUE(out.data.size() == wr.GetSize());
+		}
+		// (the same document with one extra key before it)
+		Writer ref2("DATO", 4, flags);
+		ref2.WriteStringKey("POSITION");
+		WritePathTestDoc(ref2, 1000);
+		CHECK_TRUE(out.data == std::string((const char*) ref2.GetData(), ref2.GetSize()));
+
+		// value dedup compares copies of the values
+		Writer dref("DATO", 4, flags, true, DEDUP_All);
+		WriteDedupTestDoc(dref);
+		Reader rr;
+		CHECK_TRUE(rr.Init(dref.GetData(), dref.GetSize()));
+		StringDumper dexpected;
+		rr.GetRoot().Visit(dexpected);
+		StringOutputStream dout;
+		{
+			// (the window holds the copies of all of the values, see the memory bound test below)
+			Writer dwr("DATO", 4, flags, true, DEDUP_All);
+			dwr.SetStreaming(&dout, 512 * Writer::SlotSize, 256);
+			WriteDedupTestDoc(dwr);
+			CHECK_TRUE(dwr.GetFlushedSize() > 0);
+			CHECK_TRUE(dwr.FinishStreaming() && dwr.GetSize() == dref.GetSize());
+		}
+		Reader dr;
+		TrustedReader tr;
+		CHECK_TRUE(dr.Init(dout.data.data(), dout.data.size()) && dr.Validate(tr));
+		StringDumper sd;
+		dr.GetRoot().Visit(sd);
+		CHECK_TRUE(sd.text == dexpected.text);
+
+		// file descriptors and FILE* (after some other data)
+		const char* path = "stream.gen.dato";
+		{
+			FileOutputStream fos;
+			CHECK_TRUE(fos.Open(path) && fos.IsOpen());
+			Writer wr("DATO", 4, flags);
+			wr.SetStreaming(&fos, 256, 128);
+			WritePathTestDoc(wr, 1000);
+			CHECK_TRUE(wr.FinishStreaming());
+		}
+		CHECK_TRUE(ReadWholeFile(path) == expected);
+		if (FILE* fp = fopen(path, "wb"))
+		{
+			fwrite("head", 1, 4, fp);
+			StdioOutputStream sos(fp);
+			Writer wr("DATO", 4, flags);
+			wr.SetStreaming(&sos, 256, 128);
+			WritePathTestDoc(wr, 1000);
+			CHECK_TRUE(wr.FinishStreaming());
+			fclose(fp);
+		}
+		CHECK_TRUE(ReadWholeFile(path) == "head" + expected);
+		remove(path);
+	}
+
+	// the copies of the deduplicated values are dropped behind the window (the memory stays bounded)
+	CountingAllocator ca;
+	{
+		StringOutputStream out;
+		Writer wr("DATO", 4, FLAG_Aligned | FLAG_SortedKeys, true, DEDUP_Strings, &ca);
+		wr.SetStreaming(&out, 64 * 1024, 16 * 1024);
+		size_t maxLive = 0, maxBlocks = 0;
+		ValueRef last;
+		for (u32 i = 0; i < 200000; i++)
+		{
+			char str[16];
+			int len = snprintf(str, sizeof(str), "s%u", i);
+			last = wr.WriteString8(str, len);
+			if (i % 1000 == 0)
+				CHECK_TRUE(wr.WriteString8(str, len).pos == last.pos); // (recent values are still deduplicated)
+			maxLive = ca.live > maxLive ? ca.live : maxLive;
+			size_t blocks = size_t(wr._dedupBlocks[0].GetSize() + wr._dedupBlocks[1].GetSize());
+			maxBlocks = blocks > maxBlocks ? blocks : maxBlocks;
+		}
+		wr.SetRoot(last);
+		CHECK_TRUE(wr.FinishStreaming() && out.data.size() > 1000000);
+		printf("streaming dedup: output=%u max live memory=%u max copies=%u\n",
+			unsigned(out.data.size()), unsigned(maxLive), unsigned(maxBlocks));
+		CHECK_TRUE(maxBlocks <= 2 * 64 * 1024 + 64 && maxLive < 1024 * 1024);
+	}
+	CHECK_TRUE(ca.live == 0);
+}
+
+void TestMappedOutputFile()
+{
+	puts("----- testing mapped output files -----");
+	using namespace dato;
+
+	Writer ref;
+	WritePathTestDoc(ref, 1000);
+	std::string expected((const char*) ref.GetData(), ref.GetSize());
+
+	const char* path = "mappedout.gen.dato";
+	{
+		// (small steps to grow the file several times)
+		MappedOutputFile mof(4096);
+		CHECK_TRUE(!mof.IsOpen() && !mof.Finish(0));
+		CHECK_TRUE(mof.Open(path) && mof.IsOpen());
+		Writer wr;
+		wr.SetDataAllocator(&mof);
+		CHECK_TRUE(wr._data == mof._map && mof._capacity == 4096);
+		WritePathTestDoc(wr, 1000);
+		CHECK_TRUE(wr._data == mof._map && mof._capacity > wr.GetSize() && mof._capacity % 4096 == 0);
+		CHECK_TRUE(memcmp(wr._data, expected.data(), expected.size()) == 0);
+		CHECK_TRUE(mof.Finish(wr.GetSize()) && !mof.IsOpen());
+	}
+	CHECK_TRUE(ReadWholeFile(path) == expected);
+	{
+		// (an unopened file can't allocate, the data stays where it was)
+		MappedOutputFile mof;
+		Writer wr;
+		wr.SetDataAllocator(&mof);
+		CHECK_TRUE(wr.error && wr._alloc != &mof);
+		WritePathTestDoc(wr, 1000);
+		CHECK_TRUE(std::string((const char*) wr.GetData(), wr.GetSize()) == expected);
+	}
+	{
+		// failed growth drops the data that doesn't fit instead of writing past the buffer
+		Writer vwr("DATO", 4, FLAG_Aligned | FLAG_SortedKeys, true, DEDUP_All);
+		WriteValidationTestData(vwr);
+		u32 numBad = 0;
+		for (size_t limit = 0; limit < vwr.GetSize() * 2; limit += 5)
+		{
+			LimitedAllocator la(limit);
+			Writer wr("DATO", 4, FLAG_Aligned | FLAG_SortedKeys, true, DEDUP_All);
+			wr.SetDataAllocator(&la);
+			WriteValidationTestData(wr);
+			numBad += !(wr.GetSize() == vwr.GetSize() || wr.error) || (wr._alloc == &la && wr._mem > limit);
+		}
+		CHECK_TRUE(numBad == 0);
+	}
+	{
+		MappedFile mf(path);
+		Reader r;
+		CHECK_TRUE(mf.InitReader(r) && r.GetRoot().AsStringMap().FindValueByKey("0").AsU32() == 1000);
+	}
+	remove(path);
+}
+
 int main()
 {
 	TestSortingInt();
 	TestSortingString();
 	TestBasicHashCollisions();
 	TestMemReuseHashTable();
+	TestIntKeySearch();
+	TestStringHashMap();
+	TestKeyHandles();
+	TestBatchLookup();
+	TestStructBinding();
+	TestStructWriter();
 	TestBasicStructures();
+	TestSizeEncoding64();
+	TestAnyConfig();
+	TestValidation();
+	TestErrorMode();
+	TestVisit();
+	TestTreeCursor();
+	TestPrefetch();
+	TestDecodeSlots();
+	TestParallel();
+	TestRandomAccessIterators();
+	TestPaths();
+	TestValueDedup();
+	TestSegmentedWriter();
+	TestStreamingWriter();
+	TestMappedOutputFile();
+	TestMappedFile();
+	TestPagedReader();
 }